@@ -1,2 +1,4 @@
 export 'src/vpn_engine.dart';
 export 'src/model/vpn_status.dart';
+export 'src/model/traffic_counters.dart';
+export 'src/model/vpn_stage_event.dart';
@@ -0,0 +1,85 @@
+///Counters of a tunnel's network interface, sent by desktop native sides
+class TrafficCounters {
+  TrafficCounters({
+    this.byteIn = 0,
+    this.byteOut = 0,
+    this.unicastPacketsIn = 0,
+    this.unicastPacketsOut = 0,
+    this.nonUnicastPacketsIn = 0,
+    this.nonUnicastPacketsOut = 0,
+    this.errorsIn = 0,
+    this.errorsOut = 0,
+    this.discardsIn = 0,
+    this.discardsOut = 0,
+  });
+
+  ///Bytes received
+  final int byteIn;
+
+  ///Bytes sent
+  final int byteOut;
+
+  ///Unicast packets received
+  final int unicastPacketsIn;
+
+  ///Unicast packets sent
+  final int unicastPacketsOut;
+
+  ///Broadcast and multicast packets received
+  final int nonUnicastPacketsIn;
+
+  ///Broadcast and multicast packets sent
+  final int nonUnicastPacketsOut;
+
+  ///Received packets dropped because of errors
+  final int errorsIn;
+
+  ///Packets that could not be sent because of errors
+  final int errorsOut;
+
+  ///Received packets dropped without an error (no buffer, filtered)
+  final int discardsIn;
+
+  ///Outgoing packets dropped without an error
+  final int discardsOut;
+
+  ///All packets received
+  int get packetsIn => unicastPacketsIn + nonUnicastPacketsIn;
+
+  ///All packets sent
+  int get packetsOut => unicastPacketsOut + nonUnicastPacketsOut;
+
+  ///Read the counters whose keys start with [prefix] from a stats map
+  factory TrafficCounters.fromMap(Map data, {String prefix = ""}) {
+    int intOf(String key) => (data["$prefix$key"] as num?)?.toInt() ?? 0;
+    return TrafficCounters(
+      byteIn: intOf("byte_in"),
+      byteOut: intOf("byte_out"),
+      unicastPacketsIn: intOf("unicast_packets_in"),
+      unicastPacketsOut: intOf("unicast_packets_out"),
+      nonUnicastPacketsIn: intOf("non_unicast_packets_in"),
+      nonUnicastPacketsOut: intOf("non_unicast_packets_out"),
+      errorsIn: intOf("errors_in"),
+      errorsOut: intOf("errors_out"),
+      discardsIn: intOf("discards_in"),
+      discardsOut: intOf("discards_out"),
+    );
+  }
+
+  ///Convert to JSON
+  Map<String, dynamic> toJson() => {
+        "byte_in": byteIn,
+        "byte_out": byteOut,
+        "unicast_packets_in": unicastPacketsIn,
+        "unicast_packets_out": unicastPacketsOut,
+        "non_unicast_packets_in": nonUnicastPacketsIn,
+        "non_unicast_packets_out": nonUnicastPacketsOut,
+        "errors_in": errorsIn,
+        "errors_out": errorsOut,
+        "discards_in": discardsIn,
+        "discards_out": discardsOut,
+      };
+
+  @override
+  String toString() => toJson().toString();
+}
@@ -0,0 +1,48 @@
+import '../vpn_engine.dart';
+
+///Structured stage event sent by native sides that support it (Windows)
+class VpnStageEvent {
+  VpnStageEvent({
+    required this.stage,
+    required this.rawStage,
+    this.tunnelId = "default",
+    this.version = 0,
+    this.timestamp,
+    this.errorCode = 0,
+    this.reason = "",
+  });
+
+  ///Stage of the connection
+  final VPNStage stage;
+
+  ///Stage name as sent by the native side
+  final String rawStage;
+
+  ///Tunnel the event belongs to, "default" for platforms with a single tunnel
+  final String tunnelId;
+
+  ///Schema version of the event, 0 for plain string events
+  final int version;
+
+  ///Monotonic time of the event, only meaningful relative to other events
+  final Duration? timestamp;
+
+  ///Native error code, 0 if the stage is not an error
+  final int errorCode;
+
+  ///Human readable reason for [errorCode], empty if none
+  final String reason;
+
+  ///Convert to JSON
+  Map<String, dynamic> toJson() => {
+        "stage": rawStage,
+        "tunnel_id": tunnelId,
+        "version": version,
+        "timestamp_ms": timestamp?.inMilliseconds,
+        "error_code": errorCode,
+        "reason": reason,
+      };
+
+  @override
+  String toString() => toJson().toString();
+}
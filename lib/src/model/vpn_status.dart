@@ -1,3 +1,5 @@
+import 'traffic_counters.dart';
+
 ///To store datas of VPN Connection's status detail
 class VpnStatus {
   VpnStatus({
@@ -9,6 +11,11 @@ class VpnStatus {
     this.packetsOut,
     this.speedIn,
     this.speedOut,
+    this.counters,
+    this.interval,
+    this.intervalCounters,
+    this.linkSpeedIn,
+    this.linkSpeedOut,
   });
 
   ///Latest connection date
@@ -24,10 +31,10 @@ class VpnStatus {
   ///Upload byte usages
   final String? byteOut;
 
-  ///Packets in byte usages
+  ///Packets received
   final String? packetsIn;
 
-  ///Packets out byte usages
+  ///Packets sent
   final String? packetsOut;
 
   ///Download speed in Mbps
@@ -36,6 +43,24 @@ class VpnStatus {
   ///Upload speed in Mbps
   final String? speedOut;
 
+  ///Full counter set since the connect (Windows and Linux only)
+  final TrafficCounters? counters;
+
+  ///Time covered by [intervalCounters]: since the previous status of the
+  ///same kind (stream event or status call) (Windows and Linux only)
+  final Duration? interval;
+
+  ///Growth of [counters] over [interval] (Windows and Linux only)
+  final TrafficCounters? intervalCounters;
+
+  ///Receive link speed of the tunnel interface in bits per second, 0 if the
+  ///driver reports none (Windows and Linux only)
+  final int? linkSpeedIn;
+
+  ///Transmit link speed of the tunnel interface in bits per second, 0 if the
+  ///driver reports none (Windows and Linux only)
+  final int? linkSpeedOut;
+
   /// VPNStatus as empty data
   factory VpnStatus.empty() => VpnStatus(
         duration: "00:00:00",
@@ -58,6 +83,11 @@ class VpnStatus {
         "packets_out": packetsOut,
         "speed_in": speedIn,
         "speed_out": speedOut,
+        "counters": counters?.toJson(),
+        "interval_ms": interval?.inMilliseconds,
+        "interval_counters": intervalCounters?.toJson(),
+        "link_speed_in_bps": linkSpeedIn,
+        "link_speed_out_bps": linkSpeedOut,
       };
 
   @override
@@ -1,8 +1,11 @@
 import 'dart:async';
 import 'dart:convert';
+import 'dart:developer' as developer;
 import 'dart:io';
 import 'dart:math';
 import 'package:flutter/services.dart';
+import 'model/vpn_stage_event.dart';
+import 'model/traffic_counters.dart';
 import 'model/vpn_status.dart';
 
 ///Stages of vpn connections
@@ -38,6 +41,10 @@ class OpenVPN {
   static const String _eventChannelVpnStage =
       "id.laskarmedia.openvpn_flutter/vpnstage";
 
+  ///Channel's names of _vpnStatsSnapshot
+  static const String _eventChannelVpnStats =
+      "id.laskarmedia.openvpn_flutter/vpnstats";
+
   ///Channel's names of _channelControl
   static const String _methodChannelVpnControl =
       "id.laskarmedia.openvpn_flutter/vpncontrol";
@@ -46,9 +53,28 @@ class OpenVPN {
   static const MethodChannel _channelControl =
       MethodChannel(_methodChannelVpnControl);
 
+  ///Tunnel addressed when no tunnelId is given
+  static const String defaultTunnel = "default";
+
+  ///Name the plugin logs under (dart:developer)
+  static const String _logName = "openvpn_flutter";
+
   ///Snapshot of stream that produced by native side
-  static Stream<String> _vpnStageSnapshot() =>
-      const EventChannel(_eventChannelVpnStage).receiveBroadcastStream().cast();
+  ///
+  ///Events are either a plain stage name or a map with the stage and error details
+  static Stream<VpnStageEvent> _vpnStageSnapshot() =>
+      const EventChannel(_eventChannelVpnStage)
+          .receiveBroadcastStream()
+          .map(_eventToStageEvent);
+
+  ///Stats pushed by native sides that support streaming (Windows, Linux),
+  ///only sent when the counters change, one map per tunnel
+  Stream<Map> _vpnStatsSnapshot() => const EventChannel(_eventChannelVpnStats)
+      .receiveBroadcastStream({"interval_ms": statsInterval.inMilliseconds})
+      .cast();
+
+  ///Subscription to _vpnStatsSnapshot while connected
+  StreamSubscription<Map>? _vpnStatsSubscription;
 
   ///Timer to get vpnstatus as a loop
   ///
@@ -69,10 +95,24 @@ class OpenVPN {
   /// is a listener to see what stage the connection was
   final Function(VPNStage stage, String rawStage)? onVpnStageChanged;
 
+  /// is a listener to see every stage event with its error code and reason,
+  /// of every tunnel (see [VpnStageEvent.tunnelId])
+  final Function(VpnStageEvent event)? onVpnStageEvent;
+
+  /// how often native sides that stream stats sample them (Windows, Linux, 250ms to 5s)
+  final Duration statsInterval;
+
   /// OpenVPN's Constructions, don't forget to implement the listeners
   /// onVpnStatusChanged is a listener to see vpn status detail
   /// onVpnStageChanged is a listener to see what stage the connection was
-  OpenVPN({this.onVpnStatusChanged, this.onVpnStageChanged});
+  /// onVpnStageEvent is a listener to see stage events with error details
+  /// statsInterval is how often stats are sampled where they are streamed
+  OpenVPN({
+    this.onVpnStatusChanged,
+    this.onVpnStageChanged,
+    this.onVpnStageEvent,
+    this.statsInterval = const Duration(seconds: 1),
+  });
 
   ///This function should be called before any usage of OpenVPN
   ///All params required for iOS and macOS, make sure you read the plugin's documentation
@@ -115,7 +155,7 @@ class OpenVPN {
         status().then((value) => lastStatus?.call(value)),
         stage().then((value) {
           if (value == VPNStage.connected && _vpnStatusTimer == null) {
-            _createTimer();
+            _watchStatus();
           }
           return lastStage?.call(value);
         }),
@@ -134,20 +174,21 @@ class OpenVPN {
   ///username & password : set your username and password if your config file has auth-user-pass
   ///
   ///bypassPackages : exclude some apps to access/use the VPN Connection, it was List<String> of applications package's name (Android Only)
+  ///
+  ///byteCountInterval : how often (in seconds) openvpn pushes traffic counters (Windows and Linux Only, default 1)
+  ///
+  ///tunnelId : run several tunnels side by side, each with its own id (Windows and Linux Only).
+  ///onVpnStageChanged and onVpnStatusChanged only follow the default tunnel
   Future connect(String config, String name,
       {String? username,
       String? password,
       List<String>? bypassPackages,
+      int? byteCountInterval,
+      String tunnelId = defaultTunnel,
       bool certIsRequired = false}) {
     if (!initialized) throw ("OpenVPN need to be initialized");
     // Remove automatic addition of cert options - config should be complete
-    _tempDateTime = DateTime.now();
-
-    print('🔧 OpenVPN Plugin: About to call _channelControl.invokeMethod("connect")');
-    print('🔧 OpenVPN Plugin: Config length: ${config.length}');
-    print('🔧 OpenVPN Plugin: Name: $name');
-    print('🔧 OpenVPN Plugin: Username: $username');
-    print('🔧 OpenVPN Plugin: Password provided: ${password != null}');
+    if (tunnelId == defaultTunnel) _tempDateTime = DateTime.now();
 
     try {
       final result = _channelControl.invokeMethod("connect", {
@@ -155,43 +196,130 @@ class OpenVPN {
         "name": name,
         "username": username,
         "password": password,
-        "bypass_packages": bypassPackages ?? []
+        "bypass_packages": bypassPackages ?? [],
+        "bytecount_interval": byteCountInterval,
+        "tunnel_id": tunnelId,
       });
-      print('🔧 OpenVPN Plugin: _channelControl.invokeMethod("connect") called successfully');
       return result;
     } on PlatformException catch (e) {
-      print('❌ OpenVPN Plugin: Method channel call failed: ${e.message}');
+      developer.log('connect failed: ${e.message}', name: _logName, error: e);
       throw ArgumentError(e.message);
     }
   }
 
   ///Disconnect from VPN
-  void disconnect() {
+  void disconnect({String tunnelId = defaultTunnel}) {
+    if (tunnelId != defaultTunnel) {
+      _channelControl.invokeMethod("disconnect", {"tunnel_id": tunnelId});
+      return;
+    }
     _tempDateTime = null;
     _channelControl.invokeMethod("disconnect");
-    if (_vpnStatusTimer?.isActive ?? false) {
-      _vpnStatusTimer?.cancel();
-      _vpnStatusTimer = null;
-    }
+    _stopWatchingStatus();
+  }
+
+  ///Tunnels known to the native side with their stage and whether they are active (Windows and Linux only)
+  Future<List<Map<String, dynamic>>> tunnels() async {
+    if (!Platform.isWindows && !Platform.isLinux) return [];
+    final tunnels = await _channelControl.invokeListMethod<Map>("tunnels");
+    return (tunnels ?? [])
+        .map((tunnel) => Map<String, dynamic>.from(tunnel))
+        .toList();
+  }
+
+  ///Disconnect a tunnel and forget it, the default tunnel can't be removed (Windows and Linux only)
+  Future<bool> removeTunnel(String tunnelId) async {
+    if (!Platform.isWindows && !Platform.isLinux) return false;
+    final removed = await _channelControl
+        .invokeMethod<bool>("remove_tunnel", {"tunnel_id": tunnelId});
+    return removed ?? false;
+  }
+
+  ///Change how much the native side logs: trace, debug, info, warn, error or off (Windows and Linux only).
+  ///Release builds leave trace and debug records out entirely
+  Future<void> setLogLevel(String level) async {
+    if (!Platform.isWindows && !Platform.isLinux) return;
+    await _channelControl.invokeMethod("set_log_level", {"level": level});
+  }
+
+  ///Most recent native log records, oldest first (Windows and Linux only).
+  ///Each record has timestamp_ms, level, thread and message
+  Future<List<Map<String, dynamic>>> getLogs(
+      {int limit = 200, String? minLevel}) async {
+    if (!Platform.isWindows && !Platform.isLinux) return [];
+    final logs = await _channelControl.invokeListMethod<Map>("get_logs", {
+      "limit": limit,
+      if (minLevel != null) "min_level": minLevel,
+    });
+    return (logs ?? []).map((log) => Map<String, dynamic>.from(log)).toList();
+  }
+
+  ///Last lines printed by the tunnel's openvpn process, oldest first (Windows and Linux only).
+  ///Kept after the process exits, so a failed connect can be explained
+  Future<List<String>> openvpnOutput(
+      {String tunnelId = defaultTunnel, int limit = 200}) async {
+    if (!Platform.isWindows && !Platform.isLinux) return [];
+    final lines = await _channelControl.invokeListMethod<String>(
+        "openvpn_output", {...?_tunnelArgs(tunnelId), "limit": limit});
+    return lines ?? [];
+  }
+
+  ///Connect latency per phase over all tunnels (Windows and Linux only): for each phase
+  ///(driver_init, dns_resolve, process_start, connect, ...) the count, mean_ms,
+  ///p50_ms, p90_ms, p99_ms, max_ms and the non-empty buckets as
+  ///[upper bound in microseconds, count] pairs. With [reset] the histograms
+  ///start over after this read, so each call returns what happened since the last
+  Future<Map<String, dynamic>> metrics({bool reset = false}) async {
+    if (!Platform.isWindows && !Platform.isLinux) return {};
+    final metrics = await _channelControl
+        .invokeMapMethod<String, dynamic>("metrics", {"reset": reset});
+    return metrics ?? {};
+  }
+
+  ///Per-second throughput history of a tunnel (Windows and Linux only), kept
+  ///for the last hour whether or not anything polls [status]. Over the last
+  ///[window] it returns window_s (seconds actually covered), the
+  ///current_*, average_*, peak_* and percentile_* rates for the given
+  ///[percentile] (0-100), and series_in_bps/series_out_bps: at most [points]
+  ///averages of step_s seconds each, oldest first. Rates are bytes per
+  ///second; empty if there is no such tunnel
+  Future<Map<String, dynamic>> throughput({
+    String tunnelId = defaultTunnel,
+    Duration window = const Duration(minutes: 1),
+    double percentile = 95,
+    int points = 60,
+  }) async {
+    if (!Platform.isWindows && !Platform.isLinux) return {};
+    final throughput =
+        await _channelControl.invokeMapMethod<String, dynamic>("throughput", {
+      ...?_tunnelArgs(tunnelId),
+      "window_s": window.inSeconds,
+      "percentile": percentile,
+      "points": points,
+    });
+    return throughput ?? {};
   }
 
   ///Check if connected to vpn
-  Future<bool> isConnected() async =>
-      stage().then((value) => value == VPNStage.connected);
+  Future<bool> isConnected({String tunnelId = defaultTunnel}) async =>
+      stage(tunnelId: tunnelId).then((value) => value == VPNStage.connected);
 
   ///Get latest connection stage
-  Future<VPNStage> stage() async {
-    String? stage = await _channelControl.invokeMethod("stage");
+  Future<VPNStage> stage({String tunnelId = defaultTunnel}) async {
+    String? stage =
+        await _channelControl.invokeMethod("stage", _tunnelArgs(tunnelId));
     return _strToStage(stage ?? "disconnected");
   }
 
   ///Get latest connection status
-  Future<VpnStatus> status() {
+  Future<VpnStatus> status({String tunnelId = defaultTunnel}) {
     //Have to check if user already connected to get real data
-    return stage().then((value) async {
+    return stage(tunnelId: tunnelId).then((value) async {
       var status = VpnStatus.empty();
       if (value == VPNStage.connected) {
-        status = await _channelControl.invokeMethod("status").then((value) {
+        status = await _channelControl
+            .invokeMethod("status", _tunnelArgs(tunnelId))
+            .then((value) {
           if (value == null) return VpnStatus.empty();
 
           if (Platform.isIOS || Platform.isMacOS) {
@@ -244,79 +372,9 @@ class OpenVPN {
               packetsOut: byteOut,
             );
           } else if (Platform.isWindows || Platform.isLinux) {
-            // Desktop platforms - return mock data or parse JSON if available
-            try {
-              print('🔍 OpenVPN Plugin: Parsing Windows JSON status...');
-              print('   Raw JSON value type: ${value.runtimeType}');
-              print('   Raw JSON value: $value');
-              print('   Raw JSON value length: ${value.toString().length}');
-              
-              var data = jsonDecode(value);
-              print('   ✅ JSON decoded successfully');
-              print('   Parsed JSON type: ${data.runtimeType}');
-              print('   Parsed JSON keys: ${data.keys.toList()}');
-              
-              // Log all keys and values
-              if (data is Map) {
-                print('   All JSON fields:');
-                data.forEach((key, val) {
-                  print('     $key: $val (${val.runtimeType})');
-                });
-              }
-              
-              var connectedOn = DateTime.tryParse(data["connected_on"]?.toString() ?? "") ?? 
-                               _tempDateTime ?? 
-                               DateTime.now();
-              String byteIn = data["byte_in"]?.toString() ?? "0";
-              String byteOut = data["byte_out"]?.toString() ?? "0";
-              if (byteIn.trim().isEmpty) byteIn = "0";
-              if (byteOut.trim().isEmpty) byteOut = "0";
-              
-              // Extract speed fields from JSON (Windows C++ code provides these)
-              print('   Looking for speed_in_mbps in data...');
-              print('   data.containsKey("speed_in_mbps"): ${data.containsKey("speed_in_mbps")}');
-              print('   data["speed_in_mbps"]: ${data["speed_in_mbps"]}');
-              
-              String? speedIn = data["speed_in_mbps"]?.toString();
-              String? speedOut = data["speed_out_mbps"]?.toString();
-              
-              print('   Extracted speedIn: $speedIn (type: ${speedIn.runtimeType})');
-              print('   Extracted speedOut: $speedOut (type: ${speedOut.runtimeType})');
-              
-              // Handle null or empty string cases
-              if (speedIn != null && (speedIn == 'null' || speedIn.isEmpty)) {
-                print('   Converting speedIn from "$speedIn" to null');
-                speedIn = null;
-              }
-              if (speedOut != null && (speedOut == 'null' || speedOut.isEmpty)) {
-                print('   Converting speedOut from "$speedOut" to null');
-                speedOut = null;
-              }
-              
-              print('   Final speedIn: $speedIn');
-              print('   Final speedOut: $speedOut');
-              
-              final vpnStatus = VpnStatus(
-                connectedOn: connectedOn,
-                duration: _duration(DateTime.now().difference(connectedOn).abs()),
-                byteIn: byteIn,
-                byteOut: byteOut,
-                packetsIn: byteIn,
-                packetsOut: byteOut,
-                speedIn: speedIn,
-                speedOut: speedOut,
-              );
-              
-              print('   ✅ Created VpnStatus with speeds: speedIn=${vpnStatus.speedIn}, speedOut=${vpnStatus.speedOut}');
-              return vpnStatus;
-            } catch (e, stackTrace) {
-              print('❌ OpenVPN Plugin: ERROR parsing Windows JSON status!');
-              print('   Error: $e');
-              print('   Stack trace: $stackTrace');
-              print('   Value that failed: $value');
-              // Fallback to empty status for desktop platforms
-              return VpnStatus.empty();
-            }
+            // Desktop platforms send a map of native integers
+            if (value is! Map) return VpnStatus.empty();
+            return _statusFromMap(value);
           } else {
             throw Exception("OpenVPN not supported on this platform");
           }
@@ -331,13 +389,22 @@ class OpenVPN {
     if (Platform.isMacOS) {
       try {
         await _channelControl.invokeMethod("forceStatusCheck");
-        print('🔧 OpenVPN Plugin: Force status check triggered');
       } catch (e) {
-        print('❌ OpenVPN Plugin: Force status check failed: $e');
+        developer.log('forceStatusCheck failed', name: _logName, error: e);
       }
     }
   }
 
+  ///Hit/miss counters of the native rewritten-config cache (Windows and Linux only)
+  ///
+  ///A hit means a reconnect reused the config written for the previous connect
+  Future<Map<String, int>> configCacheStats() async {
+    if (!Platform.isWindows && !Platform.isLinux) return {};
+    final stats = await _channelControl
+        .invokeMapMethod<String, int>("config_cache_stats");
+    return stats ?? {};
+  }
+
   ///Request android permission (Return true if already granted)
   Future<bool> requestPermissionAndroid() async {
     return _channelControl
@@ -372,6 +439,11 @@ class OpenVPN {
     return output.join("\n");
   }
 
+  ///Arguments addressing a tunnel, none for the default one so that
+  ///platforms without tunnels see the same calls as before
+  static Map<String, String>? _tunnelArgs(String tunnelId) =>
+      tunnelId == defaultTunnel ? null : {"tunnel_id": tunnelId};
+
   ///Convert duration that produced by native side as Connection Time
   String _duration(Duration duration) {
     String twoDigits(int n) => n.toString().padLeft(2, "0");
@@ -380,6 +452,52 @@ class OpenVPN {
     return "${twoDigits(duration.inHours)}:$twoDigitMinutes:$twoDigitSeconds";
   }
 
+  ///Convert the stats map sent by desktop native sides
+  VpnStatus _statusFromMap(Map data) {
+    int intOf(String key) => (data[key] as num?)?.toInt() ?? 0;
+    String mbps(int bps) => (bps * 8.0 / (1024.0 * 1024.0)).toStringAsFixed(2);
+
+    final connectedOnMs = data["connected_on"] as int?;
+    final connectedOn = connectedOnMs != null
+        ? DateTime.fromMillisecondsSinceEpoch(connectedOnMs)
+        : _tempDateTime ?? DateTime.now();
+    return VpnStatus(
+      connectedOn: connectedOn,
+      duration: _duration(Duration(seconds: intOf("duration_s"))),
+      byteIn: intOf("byte_in").toString(),
+      byteOut: intOf("byte_out").toString(),
+      packetsIn: intOf("packets_in").toString(),
+      packetsOut: intOf("packets_out").toString(),
+      speedIn: mbps(intOf("speed_in_bps")),
+      speedOut: mbps(intOf("speed_out_bps")),
+      counters: TrafficCounters.fromMap(data),
+      interval: Duration(milliseconds: intOf("interval_ms")),
+      intervalCounters: TrafficCounters.fromMap(data, prefix: "interval_"),
+      linkSpeedIn: intOf("link_speed_in_bps"),
+      linkSpeedOut: intOf("link_speed_out_bps"),
+    );
+  }
+
+  ///Convert an event of the stage channel to VpnStageEvent
+  static VpnStageEvent _eventToStageEvent(dynamic event) {
+    if (event is Map) {
+      final rawStage = event["stage"]?.toString() ?? "";
+      final timestampMs = event["timestamp_ms"] as int?;
+      return VpnStageEvent(
+        stage: _strToStage(rawStage),
+        rawStage: rawStage,
+        tunnelId: event["tunnel_id"]?.toString() ?? defaultTunnel,
+        version: event["version"] as int? ?? 0,
+        timestamp:
+            timestampMs != null ? Duration(milliseconds: timestampMs) : null,
+        errorCode: event["error_code"] as int? ?? 0,
+        reason: event["reason"]?.toString() ?? "",
+      );
+    }
+    final rawStage = event?.toString() ?? "";
+    return VpnStageEvent(stage: _strToStage(rawStage), rawStage: rawStage);
+  }
+
   ///Private function to convert String to VPNStage
   static VPNStage _strToStage(String? stage) {
     if (stage == null ||
@@ -399,15 +517,14 @@ class OpenVPN {
 
   ///Initialize listener, called when you start connection and stoped while
   void _initializeListener() {
-    print('🔧 OpenVPN Plugin: Initializing listener...');
     _vpnStageSnapshot().listen((event) {
-      print('🔧 OpenVPN Plugin: Received stage event: $event');
-      var vpnStage = _strToStage(event);
-      print('🔧 OpenVPN Plugin: Converted to VPNStage: $vpnStage');
+      var vpnStage = event.stage;
+      onVpnStageEvent?.call(event);
+      // The stage callback and status watching follow the default tunnel
+      if (event.tunnelId != defaultTunnel) return;
       
       if (vpnStage != _lastStage) {
-        print('🔧 OpenVPN Plugin: Stage changed from $_lastStage to $vpnStage');
-        onVpnStageChanged?.call(vpnStage, event);
+        onVpnStageChanged?.call(vpnStage, event.rawStage);
         _lastStage = vpnStage;
       }
       
@@ -415,42 +532,56 @@ class OpenVPN {
         if (Platform.isAndroid) {
           _createTimer();
         } else if ((Platform.isIOS || Platform.isMacOS) && vpnStage == VPNStage.connected) {
-          print('🔧 OpenVPN Plugin: Creating timer for iOS/macOS connected state');
           _createTimer();
         } else if ((Platform.isWindows || Platform.isLinux) && vpnStage == VPNStage.connected) {
-          _createTimer();
+          _watchStatus();
         }
       } else {
-        print('🔧 OpenVPN Plugin: Disconnected state, cancelling timer');
-        _vpnStatusTimer?.cancel();
+        _stopWatchingStatus();
       }
     }, onError: (error) {
-      print('❌ OpenVPN Plugin: Error in stage listener: $error');
+      developer.log('Stage stream error', name: _logName, error: error);
     });
   }
 
+  ///Follow status updates, from the stats stream where the native side
+  ///pushes them and by polling status elsewhere
+  void _watchStatus() {
+    if (!Platform.isWindows && !Platform.isLinux) {
+      _createTimer();
+      return;
+    }
+    _vpnStatsSubscription ??= _vpnStatsSnapshot().listen((data) {
+      final tunnelId = data["tunnel_id"]?.toString() ?? defaultTunnel;
+      if (tunnelId != defaultTunnel) return;
+      onVpnStatusChanged?.call(_statusFromMap(data));
+    }, onError: (error) {
+      developer.log('Stats stream error', name: _logName, error: error);
+    });
+  }
+
+  ///Stop the stats stream or status timer
+  void _stopWatchingStatus() {
+    _vpnStatsSubscription?.cancel();
+    _vpnStatsSubscription = null;
+    _vpnStatusTimer?.cancel();
+    _vpnStatusTimer = null;
+  }
+
   ///Create timer to invoke status
   void _createTimer() {
     if (_vpnStatusTimer != null) {
-      print('🔧 OpenVPN Plugin: Cancelling existing timer');
       _vpnStatusTimer!.cancel();
       _vpnStatusTimer = null;
     }
     
-    print('🔧 OpenVPN Plugin: Creating new status timer');
     _vpnStatusTimer ??=
         Timer.periodic(const Duration(seconds: 1), (timer) async {
       try {
-        print('🔧 OpenVPN Plugin: Timer tick - calling status()...');
         final vpnStatus = await status();
-        print('🔧 OpenVPN Plugin: Timer status update: ${vpnStatus.toJson()}');
-        print('🔧 OpenVPN Plugin: VpnStatus speeds - speedIn=${vpnStatus.speedIn}, speedOut=${vpnStatus.speedOut}');
-        print('🔧 OpenVPN Plugin: Calling onVpnStatusChanged callback...');
         onVpnStatusChanged?.call(vpnStatus);
-        print('🔧 OpenVPN Plugin: onVpnStatusChanged callback completed');
-      } catch (e) {
-        print('❌ OpenVPN Plugin: Error getting status in timer: $e');
-        print('❌ Stack trace: ${StackTrace.current}');
+      } catch (e, stackTrace) {
+        developer.log('status failed', name: _logName, error: e, stackTrace: stackTrace);
       }
     });
   }
@@ -0,0 +1,639 @@
+#include "include/openvpn_flutter/open_v_p_n_flutter_plugin.h"
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+#include "command_executor.h"
+#include "connection_stats.h"
+#include "logger.h"
+#include "platform_dispatcher.h"
+#include "tunnel_supervisor.h"
+#include "vpn_manager.h"
+
+using namespace openvpn_flutter;
+
+#define OPEN_V_P_N_FLUTTER_PLUGIN(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), open_v_p_n_flutter_plugin_get_type(), \
+                              OpenVPNFlutterPlugin))
+
+struct _OpenVPNFlutterPlugin {
+  GObject parent_instance;
+
+  // Stage changes and connection stats, as on the other platforms
+  FlEventChannel* stage_channel;
+  FlEventChannel* stats_channel;
+  gboolean stage_listening;
+  gboolean stats_listening;
+};
+
+G_DEFINE_TYPE(OpenVPNFlutterPlugin, open_v_p_n_flutter_plugin, g_object_get_type())
+
+// Results of work done off the main loop are handed back to it here; declared
+// first so it outlives the tunnels' workers at shutdown
+static PlatformDispatcher platformDispatcher;
+
+// All tunnels; calls without a tunnel_id address the default one
+static std::unique_ptr<TunnelSupervisor<VPNManager>> supervisor = std::make_unique<TunnelSupervisor<VPNManager>>();
+
+// Blocking VPN commands run here one at a time, off the main loop; declared
+// after the supervisor so it is torn down first
+static CommandExecutor commandExecutor;
+
+static OpenVPNFlutterPlugin* pluginInstance = nullptr;
+
+// How a connect command ended, reported back to the main loop
+enum class ConnectOutcome { Started, Failed, Cancelled };
+
+// Stats stream sampling, only runs while the vpnstats channel has a listener
+static guint statsTimer = 0;
+static constexpr int kDefaultStatsIntervalMs = 1000;
+static constexpr int kMinStatsIntervalMs = 250;
+static constexpr int kMaxStatsIntervalMs = 5000;
+
+// Defaults and bounds of the throughput call
+static constexpr int64_t kDefaultThroughputWindowS = 60;
+static constexpr double kDefaultThroughputPercentile = 95.0;
+static constexpr int64_t kDefaultThroughputPoints = 60;
+static constexpr int64_t kMaxThroughputPoints = 600;
+
+// A method call answered later, from the main loop; holds a reference
+using PendingCall = std::shared_ptr<FlMethodCall>;
+
+static PendingCall Retain(FlMethodCall* method_call) {
+    return PendingCall(FL_METHOD_CALL(g_object_ref(method_call)), g_object_unref);
+}
+
+// Runs a blocking command on the executor and completes it on the main loop
+template <typename Work, typename Complete>
+static void RunCommand(const std::string& name, Work work, Complete complete) {
+    if (!platformDispatcher.canDispatch()) {
+        CancellationToken never;
+        complete(work(never));
+        return;
+    }
+    commandExecutor.submit(name, [work, complete](const CancellationToken& cancel) {
+        auto outcome = work(cancel);
+        platformDispatcher.post([complete, outcome]() { complete(outcome); });
+    });
+}
+
+// Argument lookups; args is a map or null, anything of the wrong type is absent
+static FlValue* Argument(FlValue* args, const char* key, FlValueType type) {
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+        return nullptr;
+    }
+    FlValue* value = fl_value_lookup_string(args, key);
+    return value && fl_value_get_type(value) == type ? value : nullptr;
+}
+
+static std::string StringArgument(FlValue* args, const char* key) {
+    FlValue* value = Argument(args, key, FL_VALUE_TYPE_STRING);
+    return value ? fl_value_get_string(value) : "";
+}
+
+static std::optional<int64_t> IntArgument(FlValue* args, const char* key) {
+    FlValue* value = Argument(args, key, FL_VALUE_TYPE_INT);
+    return value ? std::optional<int64_t>(fl_value_get_int(value)) : std::nullopt;
+}
+
+// tunnel_id argument of a call, the default tunnel if absent; false if malformed
+static bool TunnelIdOf(FlValue* args, std::string& tunnelId) {
+    tunnelId = VPNManager::kDefaultTunnel;
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+        return true;
+    }
+    FlValue* value = fl_value_lookup_string(args, "tunnel_id");
+    if (!value || fl_value_get_type(value) == FL_VALUE_TYPE_NULL) {
+        return true;
+    }
+    if (fl_value_get_type(value) != FL_VALUE_TYPE_STRING || !TunnelSupervisor<VPNManager>::isValidId(fl_value_get_string(value))) {
+        return false;
+    }
+    tunnelId = fl_value_get_string(value);
+    return true;
+}
+
+static FlValue* EncodeStats(const StatsSample& sample, const std::string& tunnelId) {
+    FlValue* stats = fl_value_new_map();
+    visitStats(sample, tunnelId, [stats](const char* key, const auto& value) {
+        using Value = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Value, std::nullptr_t>) {
+            fl_value_set_string_take(stats, key, fl_value_new_null());
+        } else if constexpr (std::is_same_v<Value, std::string>) {
+            fl_value_set_string_take(stats, key, fl_value_new_string(value.c_str()));
+        } else {
+            fl_value_set_string_take(stats, key, fl_value_new_int(value));
+        }
+    });
+    return stats;
+}
+
+static FlValue* EncodeStageEvent(const std::string& tunnelId, const StageEvent& event) {
+    FlValue* payload = fl_value_new_map();
+    fl_value_set_string_take(payload, "version", fl_value_new_int(kEventSchemaVersion));
+    fl_value_set_string_take(payload, "tunnel_id", fl_value_new_string(tunnelId.c_str()));
+    fl_value_set_string_take(payload, "stage", fl_value_new_string(stageName(event.stage)));
+    fl_value_set_string_take(payload, "stage_code", fl_value_new_int(static_cast<int32_t>(event.stage)));
+    fl_value_set_string_take(payload, "timestamp_ms", fl_value_new_int(event.timestampMs));
+    fl_value_set_string_take(payload, "error_code", fl_value_new_int(static_cast<int32_t>(event.error)));
+    fl_value_set_string_take(payload, "reason", fl_value_new_string(errorReason(event.error)));
+    return payload;
+}
+
+static void SendStageEvent(FlValue* event) {
+    if (pluginInstance && pluginInstance->stage_listening) {
+        fl_event_channel_send(pluginInstance->stage_channel, event, nullptr, nullptr);
+    }
+}
+
+// Pushes a sample for every tunnel whose counters changed, tagged with its tunnel_id
+static void SendStatsIfChanged() {
+  if (!pluginInstance || !pluginInstance->stats_listening) {
+    return;
+  }
+  for (const auto& tunnel : supervisor->all()) {
+    StatsSample sample;
+    if (tunnel->sampleChangedStats(sample)) {
+      g_autoptr(FlValue) stats = EncodeStats(sample, tunnel->getTunnelId());
+      fl_event_channel_send(pluginInstance->stats_channel, stats, nullptr, nullptr);
+    }
+  }
+}
+
+static gboolean StatsTimerCallback(gpointer) {
+    SendStatsIfChanged();
+    return G_SOURCE_CONTINUE;
+}
+
+static void StopStatsTimer() {
+    if (statsTimer != 0) {
+        g_source_remove(statsTimer);
+        statsTimer = 0;
+    }
+}
+
+// Idle callbacks scheduled from the monitor thread and the command executor;
+// g_idle_add is safe to call from any thread
+static gboolean DrainStatusUpdates(gpointer) {
+    supervisor->processPendingStatusUpdates();
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean DrainDispatcher(gpointer) {
+    platformDispatcher.drain();
+    return G_SOURCE_REMOVE;
+}
+
+static FlMethodErrorResponse* StageListen(FlEventChannel*, FlValue*, gpointer user_data) {
+  OPEN_V_P_N_FLUTTER_PLUGIN(user_data)->stage_listening = TRUE;
+  return nullptr;
+}
+
+static FlMethodErrorResponse* StageCancel(FlEventChannel*, FlValue*, gpointer user_data) {
+  OPEN_V_P_N_FLUTTER_PLUGIN(user_data)->stage_listening = FALSE;
+  return nullptr;
+}
+
+// Stats are pushed at the listener's rate ({"interval_ms": int}) and only when they change
+static FlMethodErrorResponse* StatsListen(FlEventChannel*, FlValue* args, gpointer user_data) {
+  int64_t intervalMs = IntArgument(args, "interval_ms").value_or(kDefaultStatsIntervalMs);
+  intervalMs = std::clamp<int64_t>(intervalMs, kMinStatsIntervalMs, kMaxStatsIntervalMs);
+
+  OPEN_V_P_N_FLUTTER_PLUGIN(user_data)->stats_listening = TRUE;
+  for (const auto& tunnel : supervisor->all()) {
+    tunnel->resetStatsStream();
+  }
+  SendStatsIfChanged();
+
+  StopStatsTimer();
+  statsTimer = g_timeout_add(static_cast<guint>(intervalMs), StatsTimerCallback, nullptr);
+  return nullptr;
+}
+
+static FlMethodErrorResponse* StatsCancel(FlEventChannel*, FlValue*, gpointer user_data) {
+  StopStatsTimer();
+  OPEN_V_P_N_FLUTTER_PLUGIN(user_data)->stats_listening = FALSE;
+  return nullptr;
+}
+
+static FlValue* EncodeMetrics(bool reset) {
+  ConnectMetrics& metrics = supervisor->metrics();
+  FlValue* phases = fl_value_new_map();
+  for (size_t i = 0; i < static_cast<size_t>(ConnectPhase::Count); i++) {
+    auto phase = static_cast<ConnectPhase>(i);
+    const LatencyHistogram& histogram = metrics.histogram(phase);
+    LatencyHistogram::Summary summary = histogram.summarize();
+    FlValue* buckets = fl_value_new_list();
+    for (const auto& [upperUs, count] : histogram.nonEmptyBuckets()) {
+      FlValue* bucket = fl_value_new_list();
+      fl_value_append_take(bucket, fl_value_new_int(static_cast<int64_t>(std::min<uint64_t>(upperUs, INT64_MAX))));
+      fl_value_append_take(bucket, fl_value_new_int(static_cast<int64_t>(count)));
+      fl_value_append_take(buckets, bucket);
+    }
+    FlValue* entry = fl_value_new_map();
+    fl_value_set_string_take(entry, "count", fl_value_new_int(static_cast<int64_t>(summary.count)));
+    fl_value_set_string_take(entry, "mean_ms", fl_value_new_float(summary.meanMs));
+    fl_value_set_string_take(entry, "p50_ms", fl_value_new_float(summary.p50Ms));
+    fl_value_set_string_take(entry, "p90_ms", fl_value_new_float(summary.p90Ms));
+    fl_value_set_string_take(entry, "p99_ms", fl_value_new_float(summary.p99Ms));
+    fl_value_set_string_take(entry, "max_ms", fl_value_new_float(summary.maxMs));
+    fl_value_set_string_take(entry, "buckets_us", buckets);
+    fl_value_set_string_take(phases, ConnectMetrics::phaseName(phase), entry);
+  }
+  if (reset) {
+    metrics.reset();
+  }
+  FlValue* payload = fl_value_new_map();
+  fl_value_set_string_take(payload, "version", fl_value_new_int(kEventSchemaVersion));
+  fl_value_set_string_take(payload, "phases", phases);
+  return payload;
+}
+
+// Per-second history of a tunnel over a window: current, average, peak and
+// percentile rates plus a series for charts. Rates are bytes per second.
+static FlValue* EncodeThroughput(const VPNManager& tunnel, FlValue* args) {
+  int64_t windowSeconds = IntArgument(args, "window_s").value_or(kDefaultThroughputWindowS);
+  windowSeconds = std::clamp<int64_t>(windowSeconds, 1, ThroughputHistory::kSeconds);
+  double percentile = kDefaultThroughputPercentile;
+  if (FlValue* value = Argument(args, "percentile", FL_VALUE_TYPE_FLOAT)) {
+    percentile = fl_value_get_float(value);
+  } else if (std::optional<int64_t> intValue = IntArgument(args, "percentile")) {
+    percentile = static_cast<double>(*intValue);
+  }
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  int64_t maxPoints = IntArgument(args, "points").value_or(kDefaultThroughputPoints);
+  maxPoints = std::clamp<int64_t>(maxPoints, 1, kMaxThroughputPoints);
+
+  const ThroughputHistory& history = tunnel.getThroughput();
+  auto now = ThroughputHistory::Clock::now();
+  Throughput current = history.current(now);
+  ThroughputHistory::Summary summary = history.summarize(windowSeconds, percentile, now);
+  std::array<Throughput, kMaxThroughputPoints> points;
+  int64_t secondsPerPoint = 0;
+  size_t count = history.series(windowSeconds, points.data(), static_cast<size_t>(maxPoints), secondsPerPoint, now);
+  FlValue* seriesIn = fl_value_new_list();
+  FlValue* seriesOut = fl_value_new_list();
+  for (size_t i = 0; i < count; i++) {
+    fl_value_append_take(seriesIn, fl_value_new_int(static_cast<int64_t>(points[i].in)));
+    fl_value_append_take(seriesOut, fl_value_new_int(static_cast<int64_t>(points[i].out)));
+  }
+
+  FlValue* payload = fl_value_new_map();
+  fl_value_set_string_take(payload, "version", fl_value_new_int(kEventSchemaVersion));
+  fl_value_set_string_take(payload, "tunnel_id", fl_value_new_string(tunnel.getTunnelId().c_str()));
+  fl_value_set_string_take(payload, "window_s", fl_value_new_int(summary.seconds));
+  fl_value_set_string_take(payload, "current_in_bps", fl_value_new_int(static_cast<int64_t>(current.in)));
+  fl_value_set_string_take(payload, "current_out_bps", fl_value_new_int(static_cast<int64_t>(current.out)));
+  fl_value_set_string_take(payload, "average_in_bps", fl_value_new_int(static_cast<int64_t>(summary.average.in)));
+  fl_value_set_string_take(payload, "average_out_bps", fl_value_new_int(static_cast<int64_t>(summary.average.out)));
+  fl_value_set_string_take(payload, "peak_in_bps", fl_value_new_int(static_cast<int64_t>(summary.peak.in)));
+  fl_value_set_string_take(payload, "peak_out_bps", fl_value_new_int(static_cast<int64_t>(summary.peak.out)));
+  fl_value_set_string_take(payload, "percentile", fl_value_new_float(percentile));
+  fl_value_set_string_take(payload, "percentile_in_bps",
+                           fl_value_new_int(static_cast<int64_t>(summary.percentile.in)));
+  fl_value_set_string_take(payload, "percentile_out_bps",
+                           fl_value_new_int(static_cast<int64_t>(summary.percentile.out)));
+  fl_value_set_string_take(payload, "step_s", fl_value_new_int(secondsPerPoint));
+  fl_value_set_string_take(payload, "series_in_bps", seriesIn);
+  fl_value_set_string_take(payload, "series_out_bps", seriesOut);
+  return payload;
+}
+
+// Called when a method is called on this plugin's channel from Dart.
+static void open_v_p_n_flutter_plugin_handle_method_call(
+    OpenVPNFlutterPlugin* self,
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  std::string tunnelId;
+  if (!TunnelIdOf(args, tunnelId)) {
+    fl_method_call_respond_error(method_call, "invalid_tunnel_id",
+                                 "tunnel_id must be 1-32 letters, digits, '-' or '_'", nullptr, nullptr);
+    return;
+  }
+
+  if (strcmp(method, "initialize") == 0) {
+    // Checks the tun device; quick enough to answer right here
+    LOG_INFO("Initializing OpenVPN Flutter plugin for Linux...");
+    std::shared_ptr<VPNManager> tunnel = supervisor->tunnel(tunnelId);
+    if (!tunnel) {
+      fl_method_call_respond_error(method_call, "too_many_tunnels",
+                                   "No more tunnels can be watched at the same time", nullptr, nullptr);
+      return;
+    }
+    if (tunnel->initialize()) {
+      LOG_INFO("Tun device available");
+      tunnel->announceStage();
+      g_autoptr(FlValue) stage = fl_value_new_string(tunnel->getStatus().c_str());
+      fl_method_call_respond_success(method_call, stage, nullptr);
+    } else {
+      LOG_ERROR("Failed to initialize the tun device");
+      fl_method_call_respond_error(method_call, "initialization_failed",
+                                   "Failed to initialize the VPN. Please ensure:\n"
+                                   "1. The tun module is loaded (/dev/net/tun exists)\n"
+                                   "2. The application may open /dev/net/tun",
+                                   nullptr, nullptr);
+    }
+
+  } else if (strcmp(method, "connect") == 0) {
+    LOG_INFO("Starting VPN connection...");
+
+    if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+      fl_method_call_respond_error(method_call, "invalid_arguments", "Invalid arguments provided", nullptr, nullptr);
+      return;
+    }
+
+    std::string config = StringArgument(args, "config");
+    std::string name = StringArgument(args, "name");
+    std::string username = StringArgument(args, "username");
+    std::string password = StringArgument(args, "password");
+    std::optional<int64_t> byteCountInterval = IntArgument(args, "bytecount_interval");
+
+    if (config.empty()) {
+      fl_method_call_respond_error(method_call, "invalid_config", "OpenVPN configuration is required", nullptr,
+                                   nullptr);
+      return;
+    }
+
+    LOG_INFO("Connecting to VPN: " << name << " (tunnel " << tunnelId << ")");
+
+    // Config rewriting, the process start and the profile hand-over all
+    // happen on the command executor
+    std::shared_ptr<VPNManager> tunnel = supervisor->tunnel(tunnelId);
+    if (!tunnel) {
+      fl_method_call_respond_error(method_call, "too_many_tunnels",
+                                   "No more tunnels can be watched at the same time", nullptr, nullptr);
+      return;
+    }
+    PendingCall pending = Retain(method_call);
+    RunCommand("connect:" + tunnelId,
+      [tunnel, config, username, password, byteCountInterval](const CancellationToken& cancel) {
+        if (byteCountInterval) {
+          tunnel->setByteCountInterval(static_cast<int>(*byteCountInterval));
+        }
+        if (tunnel->startVPN(config, username, password, &cancel)) {
+          return ConnectOutcome::Started;
+        }
+        return cancel.isCancelled() ? ConnectOutcome::Cancelled : ConnectOutcome::Failed;
+      },
+      [pending](ConnectOutcome outcome) {
+        if (outcome == ConnectOutcome::Started) {
+          LOG_INFO("VPN connection initiated successfully");
+          fl_method_call_respond_success(pending.get(), nullptr, nullptr);
+        } else if (outcome == ConnectOutcome::Cancelled) {
+          fl_method_call_respond_error(pending.get(), "connection_cancelled",
+                                       "Connect was superseded by a disconnect", nullptr, nullptr);
+        } else {
+          LOG_ERROR("Failed to start VPN connection");
+          fl_method_call_respond_error(pending.get(), "connection_failed",
+                                       "Failed to start OpenVPN connection. Possible causes:\n"
+                                       "1. OpenVPN executable not found (install the openvpn package)\n"
+                                       "2. /dev/net/tun not available\n"
+                                       "3. Invalid configuration file\n"
+                                       "4. openvpn lacks root or CAP_NET_ADMIN\n"
+                                       "5. Another VPN connection is active",
+                                       nullptr, nullptr);
+        }
+      });
+
+  } else if (strcmp(method, "disconnect") == 0) {
+    // A connect of the same tunnel still queued or starting is cancelled; the
+    // disconnect runs right after it
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      fl_method_call_respond_success(method_call, nullptr, nullptr);
+      return;
+    }
+    size_t superseded = commandExecutor.cancel("connect:" + tunnelId);
+    if (superseded > 0) {
+      LOG_INFO("Disconnect supersedes " << superseded << " pending connect(s)");
+    }
+    PendingCall pending = Retain(method_call);
+    RunCommand("disconnect:" + tunnelId,
+      [tunnel](const CancellationToken&) {
+        // Waits for the tunnel's monitor handlers and for openvpn to exit
+        tunnel->stopVPN();
+        return true;
+      },
+      [pending](bool) { fl_method_call_respond_success(pending.get(), nullptr, nullptr); });
+
+  } else if (strcmp(method, "remove_tunnel") == 0) {
+    // Stop a tunnel and forget it; the default tunnel can't be removed
+    if (tunnelId == VPNManager::kDefaultTunnel) {
+      fl_method_call_respond_error(method_call, "invalid_tunnel_id", "The default tunnel can't be removed",
+                                   nullptr, nullptr);
+      return;
+    }
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      g_autoptr(FlValue) removed = fl_value_new_bool(FALSE);
+      fl_method_call_respond_success(method_call, removed, nullptr);
+      return;
+    }
+    commandExecutor.cancel("connect:" + tunnelId);
+    PendingCall pending = Retain(method_call);
+    RunCommand("remove:" + tunnelId,
+      [tunnel](const CancellationToken&) {
+        tunnel->stopVPN();
+        return true;
+      },
+      [pending, tunnelId](bool) {
+        // Runs after the stage events the stop posted, so none of them
+        // outlives the tunnel
+        g_autoptr(FlValue) removed = fl_value_new_bool(supervisor->remove(tunnelId));
+        fl_method_call_respond_success(pending.get(), removed, nullptr);
+      });
+
+  } else if (strcmp(method, "tunnels") == 0) {
+    // Every tunnel with its current stage
+    g_autoptr(FlValue) tunnels = fl_value_new_list();
+    for (const auto& tunnel : supervisor->all()) {
+      FlValue* entry = fl_value_new_map();
+      fl_value_set_string_take(entry, "tunnel_id", fl_value_new_string(tunnel->getTunnelId().c_str()));
+      fl_value_set_string_take(entry, "stage", fl_value_new_string(tunnel->getStatus().c_str()));
+      fl_value_set_string_take(entry, "active", fl_value_new_bool(tunnel->isActive()));
+      fl_value_append_take(tunnels, entry);
+    }
+    fl_method_call_respond_success(method_call, tunnels, nullptr);
+
+  } else if (strcmp(method, "status") == 0) {
+    // Connection stats of the tunnel, null if there is no such tunnel
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      fl_method_call_respond_success(method_call, nullptr, nullptr);
+      return;
+    }
+    g_autoptr(FlValue) stats = EncodeStats(tunnel->getConnectionStats(), tunnelId);
+    fl_method_call_respond_success(method_call, stats, nullptr);
+
+  } else if (strcmp(method, "throughput") == 0) {
+    // Throughput history of the tunnel, null if there is no such tunnel
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      fl_method_call_respond_success(method_call, nullptr, nullptr);
+      return;
+    }
+    g_autoptr(FlValue) payload = EncodeThroughput(*tunnel, args);
+    fl_method_call_respond_success(method_call, payload, nullptr);
+
+  } else if (strcmp(method, "stage") == 0) {
+    // Current stage of the tunnel
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    std::string currentStage = tunnel ? tunnel->getStatus() : stageName(VpnStage::Disconnected);
+    g_autoptr(FlValue) stage = fl_value_new_string(currentStage.c_str());
+    fl_method_call_respond_success(method_call, stage, nullptr);
+
+  } else if (strcmp(method, "config_cache_stats") == 0) {
+    // Hit/miss counters of the tunnel's rewritten config cache
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    g_autoptr(FlValue) stats = fl_value_new_map();
+    fl_value_set_string_take(stats, "hits",
+                             fl_value_new_int(static_cast<int64_t>(tunnel ? tunnel->getConfigCacheHits() : 0)));
+    fl_value_set_string_take(stats, "misses",
+                             fl_value_new_int(static_cast<int64_t>(tunnel ? tunnel->getConfigCacheMisses() : 0)));
+    fl_method_call_respond_success(method_call, stats, nullptr);
+
+  } else if (strcmp(method, "openvpn_output") == 0) {
+    // Last lines the tunnel's openvpn printed, oldest first
+    size_t limit = OutputParser::kHistoryLines;
+    if (std::optional<int64_t> value = IntArgument(args, "limit")) {
+      limit = static_cast<size_t>(std::clamp<int64_t>(*value, 1, OutputParser::kHistoryLines));
+    }
+    g_autoptr(FlValue) lines = fl_value_new_list();
+    if (std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId)) {
+      for (const auto& line : tunnel->getRecentOutput(limit)) {
+        fl_value_append_take(lines, fl_value_new_string(line.c_str()));
+      }
+    }
+    fl_method_call_respond_success(method_call, lines, nullptr);
+
+  } else if (strcmp(method, "metrics") == 0) {
+    // Latency of each connect phase over every tunnel since start (or the
+    // last reset); buckets are returned too so installs can be merged
+    FlValue* reset = Argument(args, "reset", FL_VALUE_TYPE_BOOL);
+    g_autoptr(FlValue) payload = EncodeMetrics(reset && fl_value_get_bool(reset));
+    fl_method_call_respond_success(method_call, payload, nullptr);
+
+  } else if (strcmp(method, "set_log_level") == 0) {
+    // Runtime level of the native log; levels compiled out stay off
+    FlValue* levelName = Argument(args, "level", FL_VALUE_TYPE_STRING);
+    LogLevel level;
+    if (!levelName || !Logger::parseLevel(fl_value_get_string(levelName), level)) {
+      fl_method_call_respond_error(method_call, "invalid_log_level",
+                                   "level must be one of trace, debug, info, warn, error, off", nullptr, nullptr);
+      return;
+    }
+    Logger::instance().setLevel(level);
+    fl_method_call_respond_success(method_call, nullptr, nullptr);
+
+  } else if (strcmp(method, "get_logs") == 0) {
+    // Most recent native log records, oldest first
+    size_t limit = 200;
+    if (std::optional<int64_t> value = IntArgument(args, "limit")) {
+      limit = static_cast<size_t>(std::clamp<int64_t>(*value, 1, Logger::kHistoryCapacity));
+    }
+    LogLevel minLevel = LogLevel::Trace;
+    if (FlValue* value = Argument(args, "min_level", FL_VALUE_TYPE_STRING)) {
+      Logger::parseLevel(fl_value_get_string(value), minLevel);
+    }
+    g_autoptr(FlValue) records = fl_value_new_list();
+    for (const auto& record : Logger::instance().recent(limit, minLevel)) {
+      FlValue* entry = fl_value_new_map();
+      fl_value_set_string_take(entry, "timestamp_ms", fl_value_new_int(record.timestampMs));
+      fl_value_set_string_take(entry, "level", fl_value_new_string(Logger::levelName(record.level)));
+      fl_value_set_string_take(entry, "thread", fl_value_new_int(record.thread));
+      fl_value_set_string_take(entry, "message", fl_value_new_string(record.message.c_str()));
+      fl_value_append_take(records, entry);
+    }
+    fl_method_call_respond_success(method_call, records, nullptr);
+
+  } else if (strcmp(method, "request_permission") == 0) {
+    // Nothing to ask for like on Android; openvpn's own privileges are
+    // checked when connecting
+    g_autoptr(FlValue) granted = fl_value_new_bool(TRUE);
+    fl_method_call_respond_success(method_call, granted, nullptr);
+
+  } else {
+    fl_method_call_respond_not_implemented(method_call, nullptr);
+  }
+}
+
+static void open_v_p_n_flutter_plugin_dispose(GObject* object) {
+  OpenVPNFlutterPlugin* self = OPEN_V_P_N_FLUTTER_PLUGIN(object);
+  StopStatsTimer();
+  self->stage_listening = FALSE;
+  self->stats_listening = FALSE;
+  if (pluginInstance == self) {
+    pluginInstance = nullptr;
+  }
+  g_clear_object(&self->stage_channel);
+  g_clear_object(&self->stats_channel);
+  Logger::instance().flush();
+
+  G_OBJECT_CLASS(open_v_p_n_flutter_plugin_parent_class)->dispose(object);
+}
+
+static void open_v_p_n_flutter_plugin_class_init(OpenVPNFlutterPluginClass* klass) {
+  G_OBJECT_CLASS(klass)->dispose = open_v_p_n_flutter_plugin_dispose;
+}
+
+static void open_v_p_n_flutter_plugin_init(OpenVPNFlutterPlugin* self) {}
+
+static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
+                           gpointer user_data) {
+  OpenVPNFlutterPlugin* plugin = OPEN_V_P_N_FLUTTER_PLUGIN(user_data);
+  open_v_p_n_flutter_plugin_handle_method_call(plugin, method_call);
+}
+
+void open_v_p_n_flutter_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
+  OpenVPNFlutterPlugin* plugin = OPEN_V_P_N_FLUTTER_PLUGIN(
+      g_object_new(open_v_p_n_flutter_plugin_get_type(), nullptr));
+  pluginInstance = plugin;
+
+  FlBinaryMessenger* messenger = fl_plugin_registrar_get_messenger(registrar);
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+
+  g_autoptr(FlMethodChannel) channel =
+      fl_method_channel_new(messenger, "id.laskarmedia.openvpn_flutter/vpncontrol", FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel, method_call_cb,
+                                            g_object_ref(plugin),
+                                            g_object_unref);
+
+  plugin->stage_channel =
+      fl_event_channel_new(messenger, "id.laskarmedia.openvpn_flutter/vpnstage", FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(plugin->stage_channel, StageListen, StageCancel,
+                                       g_object_ref(plugin), g_object_unref);
+
+  plugin->stats_channel =
+      fl_event_channel_new(messenger, "id.laskarmedia.openvpn_flutter/vpnstats", FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(plugin->stats_channel, StatsListen, StatsCancel,
+                                       g_object_ref(plugin), g_object_unref);
+
+  // Stage updates and command results are drained on the main loop; the
+  // monitor thread and the executor schedule that with an idle source
+  supervisor->setStageListener([](const std::string& tunnelId, const StageEvent& event) {
+    g_autoptr(FlValue) payload = EncodeStageEvent(tunnelId, event);
+    SendStageEvent(payload);
+  });
+  supervisor->setStatusWakeCallback([]() {
+    g_idle_add(DrainStatusUpdates, nullptr);
+  });
+  platformDispatcher.setWakeCallback([]() {
+    g_idle_add(DrainDispatcher, nullptr);
+  });
+  supervisor->setPlatformPoster([](std::function<void()> task) {
+    platformDispatcher.post(std::move(task));
+  });
+
+  g_object_unref(plugin);
+}
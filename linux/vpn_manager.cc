@@ -0,0 +1,474 @@
+#include "vpn_manager.h"
+#include "config_rewriter.h"
+#include "logger.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <limits.h>
+#include <poll.h>
+#include <pwd.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <thread>
+
+extern char** environ;
+
+namespace openvpn_flutter {
+
+namespace {
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+constexpr int kCapNetAdmin = 12;
+
+// Waits until the child exits without reaping it. Uses a pidfd where the
+// kernel has one (5.3+), otherwise checks every few milliseconds.
+bool waitForExit(pid_t pid, int timeoutMs) {
+    int pidFd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    if (pidFd >= 0) {
+        pollfd fd{pidFd, POLLIN, 0};
+        int rc;
+        do {
+            rc = poll(&fd, 1, timeoutMs);
+        } while (rc < 0 && errno == EINTR);
+        ::close(pidFd);
+        return rc > 0;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        siginfo_t info{};
+        if (waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOHANG | WNOWAIT) != 0) {
+            return errno == ECHILD;
+        }
+        if (info.si_pid == pid) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+// Capability sets of this process from /proc/self/status ("CapAmb", ...)
+uint64_t capabilitySet(const char* name) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    std::string prefix = std::string(name) + ":";
+    while (std::getline(status, line)) {
+        if (line.compare(0, prefix.size(), prefix) == 0) {
+            return std::strtoull(line.c_str() + prefix.size(), nullptr, 16);
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+
+VPNManager::VPNManager(std::string tunnelId, TunnelServices& services)
+    : TunnelSession(std::move(tunnelId), services) {
+}
+
+VPNManager::~VPNManager() {
+    shutdownSession();
+}
+
+bool VPNManager::initialize() {
+    if (deviceChecked) {
+        return true;
+    }
+    PhaseSpan driverSpan(services.metrics, ConnectPhase::DriverInit);
+    // openvpn opens the clone device itself; only root or CAP_NET_ADMIN may
+    // attach an interface to it, which canConfigureNetwork() checks
+    int fd = open("/dev/net/tun", O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("/dev/net/tun is not usable: " << strerror(errno)
+                  << (errno == ENOENT ? " (is the tun module loaded?)" : ""));
+        return false;
+    }
+    ::close(fd);
+    // Start following link and address changes before the first device appears
+    services.adapterRegistry.start();
+    deviceChecked = true;
+    return true;
+}
+
+bool VPNManager::startVPN(const std::string& config, const std::string& username, const std::string& password,
+                          const CancellationToken* cancel) {
+    std::vector<std::string> remoteHosts;
+    if (!beginConnect(config, remoteHosts)) {
+        return false;
+    }
+
+    if (!initialize()) {
+        updateStatus(VpnStage::Error, VpnError::DriverUnavailable);
+        return false;
+    }
+    if (cancelled(cancel)) {
+        return false;
+    }
+
+    std::string openVPNPath = getOpenVPNPath();
+    if (openVPNPath.empty()) {
+        updateStatus(VpnStage::Error, VpnError::OpenVpnNotFound);
+        return false;
+    }
+    if (!canConfigureNetwork(openVPNPath)) {
+        LOG_ERROR("openvpn can't create " << deviceName() << ": run as root, or give " << openVPNPath
+                  << " CAP_NET_ADMIN (setcap cap_net_admin+ep)");
+        updateStatus(VpnStage::Error, VpnError::NotElevated);
+        return false;
+    }
+
+    // Rewrite the profile; it reaches openvpn through a socket, never a file.
+    // There is one kind of device here, so the driver part of the cache key
+    // is fixed.
+    bool hasCredentials = !username.empty() && !password.empty();
+    if (!prepareConfig(config, hasCredentials, remoteHosts, ConfigRewriter::tunRules(), 0)) {
+        updateStatus(VpnStage::Error, VpnError::ConfigWriteFailed);
+        return false;
+    }
+    if (cancelled(cancel)) {
+        clearSession();
+        return false;
+    }
+
+    // Kept in memory for the >PASSWORD: prompt only
+    if (hasCredentials) {
+        authUsername = username;
+        authPassword = password;
+    }
+
+    // Management interface for state notifications; openvpn holds until we attach
+    if (!createManagementDir()) {
+        clearSession();
+        updateStatus(VpnStage::Error, VpnError::ManagementPortUnavailable);
+        return false;
+    }
+
+    // openvpn creates the tun device under our name, so the adapter registry
+    // and the counters can find it without asking openvpn
+    std::vector<std::string> arguments = {
+        openVPNPath, "--config", "stdin", "--verb", "3",
+        "--dev", deviceName(), "--dev-type", "tun",
+        "--management", managementSocket, "unix", "--management-hold",
+    };
+    // openvpn checks the peer of every management connection too
+    // (SO_PEERCRED), which also covers an openvpn running as root
+    passwd user{};
+    passwd* found = nullptr;
+    char userBuffer[1024];
+    if (getpwuid_r(geteuid(), &user, userBuffer, sizeof(userBuffer), &found) == 0 && found) {
+        arguments.push_back("--management-client-user");
+        arguments.push_back(found->pw_name);
+    }
+    if (hasCredentials) {
+        arguments.push_back("--management-query-passwords");
+    }
+    std::ostringstream commandLine;
+    for (const auto& argument : arguments) {
+        commandLine << (&argument == &arguments.front() ? "" : " ") << argument;
+    }
+    LOG_DEBUG("Full OpenVPN command line: " << commandLine.str());
+
+    if (cancelled(cancel)) {
+        clearSession();
+        return false;
+    }
+
+    // The child's stdout and stderr come back through a non-blocking pipe; a
+    // connect without it still works, failures just take longer to show
+    outputParser.reset();
+    if (!outputPipe.open()) {
+        LOG_WARN("Could not create the output pipe, OpenVPN output is not captured");
+    }
+
+    // The profile goes to the child's stdin (--config stdin). A socket rather
+    // than a pipe, so an openvpn that dies early fails the write with EPIPE
+    // (MSG_NOSIGNAL) instead of raising SIGPIPE in the app.
+    int configSockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, configSockets) != 0) {
+        LOG_ERROR("Failed to create the config socket: " << strerror(errno));
+        outputPipe.close();
+        clearSession();
+        updateStatus(VpnStage::Error, VpnError::ConfigWriteFailed);
+        return false;
+    }
+    int configRead = configSockets[0];
+    int configWrite = configSockets[1];
+    int sendBuffer = static_cast<int>(currentConfig->size() + 4096);
+    setsockopt(configWrite, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+    // Only the descriptors dup'ed onto 0-2 survive the exec; everything else
+    // of ours is close-on-exec. Signal state is reset, Flutter's threads may
+    // block signals openvpn relies on.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, configRead, STDIN_FILENO);
+    if (outputPipe.isOpen()) {
+        posix_spawn_file_actions_adddup2(&actions, outputPipe.getChildHandle(), STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, outputPipe.getChildHandle(), STDERR_FILENO);
+    } else {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+    }
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigaddset(&signals, SIGPIPE);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGUSR2);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    std::vector<char*> argv;
+    for (auto& argument : arguments) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid = -1;
+    PhaseSpan startSpan(services.metrics, ConnectPhase::ProcessStart);
+    int spawnError = posix_spawn(&pid, openVPNPath.c_str(), &actions, &attributes, argv.data(), environ);
+    startSpan.finish();
+    processStartedAt = std::chrono::steady_clock::now();
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    ::close(configRead);
+    // The pipe reports end of output once the child's copy is the last one
+    outputPipe.closeChildHandle();
+
+    if (spawnError != 0) {
+        LOG_ERROR("Failed to start OpenVPN: " << strerror(spawnError));
+        ::close(configWrite);
+        outputPipe.close();
+        clearSession();
+        updateStatus(VpnStage::Error, VpnError::ProcessStartFailed);
+        return false;
+    }
+
+    // EOF on the socket ends the profile
+    bool delivered = false;
+    {
+        PhaseSpan writeSpan(services.metrics, ConnectPhase::ConfigWrite);
+        const std::string& profile = *currentConfig;
+        size_t written = 0;
+        while (written < profile.size()) {
+            ssize_t chunk = send(configWrite, profile.data() + written, profile.size() - written, MSG_NOSIGNAL);
+            if (chunk < 0 && errno == EINTR) {
+                continue;
+            }
+            if (chunk <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(chunk);
+        }
+        delivered = written == profile.size();
+    }
+    ::close(configWrite);
+
+    if (!delivered) {
+        LOG_ERROR("Failed to pass the config to OpenVPN: " << strerror(errno));
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        outputPipe.close();
+        clearSession();
+        updateStatus(VpnStage::Error, VpnError::ConfigWriteFailed);
+        return false;
+    }
+
+    processId = pid;
+    // The shared monitor waits on the process's pidfd
+    return watchProcess(processId);
+}
+
+bool VPNManager::hasProcess() const {
+    return processId >= 0;
+}
+
+void VPNManager::terminateProcess() {
+    if (processId < 0) {
+        removeManagementDir();
+        return;
+    }
+    // SIGTERM lets openvpn remove its routes and the device; an exited child
+    // is still a zombie here, so the pid can't belong to anyone else
+    LOG_DEBUG("stopVPN: Terminating OpenVPN process " << processId);
+    PhaseSpan terminateSpan(services.metrics, ConnectPhase::ProcessStop);
+    kill(processId, SIGTERM);
+    if (!waitForExit(processId, kStopTimeoutMs)) {
+        LOG_WARN("OpenVPN did not exit within " << kStopTimeoutMs << " ms, killing it");
+        kill(processId, SIGKILL);
+    }
+    int status = 0;
+    while (waitpid(processId, &status, 0) < 0 && errno == EINTR) {
+    }
+    terminateSpan.finish();
+    processId = -1;
+    removeManagementDir();
+}
+
+void VPNManager::signalProcess(bool kill) {
+    // Not reaped before stopVPN, so the pid is still ours
+    if (processId >= 0) {
+        ::kill(processId, kill ? SIGKILL : SIGTERM);
+    }
+}
+
+bool VPNManager::createManagementDir() {
+    removeManagementDir();
+    // XDG_RUNTIME_DIR is the user's own already; mkdtemp makes the directory 0700
+    std::string base = "/tmp";
+    if (const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR"); runtimeDir && *runtimeDir) {
+        base = runtimeDir;
+    }
+    std::string pattern = base + "/openvpn_flutter-XXXXXX";
+    if (!mkdtemp(pattern.data())) {
+        LOG_ERROR("Failed to create a directory for the OpenVPN management socket in " << base << ": "
+                  << strerror(errno));
+        return false;
+    }
+    managementDir = pattern;
+    managementSocket = managementDir + "/management";
+    return true;
+}
+
+void VPNManager::removeManagementDir() {
+    if (managementDir.empty()) {
+        return;
+    }
+    // openvpn unlinks its socket when it exits cleanly, not when killed
+    unlink(managementSocket.c_str());
+    if (rmdir(managementDir.c_str()) != 0) {
+        LOG_WARN("Failed to remove " << managementDir << ": " << strerror(errno));
+    }
+    managementDir.clear();
+    managementSocket.clear();
+}
+
+bool VPNManager::connectManagement() {
+    // openvpn creates the socket with mode 0777 (umask cleared around bind);
+    // narrow it to 0600 where it is ours. The directory keeps everyone else
+    // out either way.
+    if (chmod(managementSocket.c_str(), 0600) != 0 && errno == ENOENT) {
+        return false;
+    }
+    return management.connectUnix(managementSocket);
+}
+
+std::string VPNManager::exitStatus() {
+    // Left a zombie for stopVPN to reap, so the pid stays ours until then
+    siginfo_t info{};
+    waitid(P_PID, static_cast<id_t>(processId), &info, WEXITED | WNOHANG | WNOWAIT);
+    return (info.si_code == CLD_EXITED ? "code " : "signal ") + std::to_string(info.si_status);
+}
+
+BinaryLocator& VPNManager::binaries() {
+    // Shared by all tunnels; the manifest goes to the user's cache directory,
+    // the app's own directory is usually not writable once installed
+    std::call_once(services.binaryLocatorOnce, [this] {
+        std::string appDir = getAppDirectory();
+        std::string cacheDir;
+        if (const char* xdgCache = std::getenv("XDG_CACHE_HOME"); xdgCache && *xdgCache) {
+            cacheDir = xdgCache;
+        } else if (const char* home = std::getenv("HOME"); home && *home) {
+            cacheDir = std::string(home) + "/.cache";
+        } else {
+            cacheDir = appDir;
+        }
+        auto& binaryLocator = services.binaryLocator;
+        binaryLocator = std::make_unique<BinaryLocator>(appDir, cacheDir + "/openvpn_flutter_binaries.manifest");
+
+        // A bundled openvpn wins over the distribution's
+        binaryLocator->setSearchDirectories("openvpn", {
+            appDir + "/lib/openvpn_bundle/bin",
+            appDir + "/openvpn_bundle/bin",
+            appDir + "/bin",
+            appDir,
+            "/usr/sbin",
+            "/usr/local/sbin",
+            "/sbin",
+            "/usr/bin",
+            "/usr/local/bin"
+        });
+    });
+    return *services.binaryLocator;
+}
+
+std::string VPNManager::getOpenVPNPath() {
+    std::string path = binaries().locate("openvpn");
+    if (path.empty()) {
+        LOG_ERROR("OpenVPN executable not found, install the openvpn package or bundle it next to the app");
+    }
+    return path;
+}
+
+bool VPNManager::canConfigureNetwork(const std::string& openVPNPath) {
+    if (geteuid() == 0) {
+        return true;
+    }
+    // Capabilities of ours don't survive the exec unless they are ambient;
+    // file capabilities or a setuid-root binary bring their own
+    if (capabilitySet("CapAmb") & (uint64_t(1) << kCapNetAdmin)) {
+        return true;
+    }
+    if (getxattr(openVPNPath.c_str(), "security.capability", nullptr, 0) > 0) {
+        return true;
+    }
+    struct stat info;
+    return stat(openVPNPath.c_str(), &info) == 0 && (info.st_mode & S_ISUID) && info.st_uid == 0;
+}
+
+std::string VPNManager::deviceName() const {
+    // IFNAMSIZ leaves 15 characters, tunnel ids may have 32: other tunnels
+    // get a hash of their id. The "tun" prefix marks them as Tun adapters.
+    if (tunnelId == kDefaultTunnel) {
+        return "tun-flutter";
+    }
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : tunnelId) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "tun-fl-%08x", hash);
+    return name;
+}
+
+std::string VPNManager::getAppDirectory() {
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) {
+        return ".";
+    }
+    std::string exe(path, static_cast<size_t>(length));
+    size_t slash = exe.find_last_of('/');
+    return slash == std::string::npos ? "." : exe.substr(0, slash);
+}
+
+const AdapterInfo* VPNManager::findAdapter(const AdapterSnapshot& adapters) const {
+    // The registry follows RTM_NEWLINK/RTM_DELLINK, so finding the device is
+    // a lookup in the current snapshot; openvpn recreates it on every restart
+    return adapters.findByName(deviceName());
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <string>
+
+#include "adapter_registry.h"
+#include "binary_locator.h"
+#include "command_executor.h"
+#include "tunnel_session.h"
+
+namespace openvpn_flutter {
+
+// One tunnel: its own openvpn process on a tun device of its own. The session
+// (stages, management interface, counters) is shared with Windows; this adds
+// the process, the device and finding openvpn.
+class VPNManager : public TunnelSession {
+private:
+    pid_t processId = -1; // Not reaped until stopped, so the pid can't be reused
+
+    // The management interface is a unix socket in a directory only we can
+    // enter, so no other local user can attach or squat on it
+    std::string managementDir;
+    std::string managementSocket;
+
+    // /dev/net/tun was found usable; checked once
+    std::atomic<bool> deviceChecked{false};
+
+    // How long openvpn gets to take its routes down after SIGTERM
+    static constexpr int kStopTimeoutMs = 5000;
+
+public:
+    VPNManager(std::string tunnelId, TunnelServices& services);
+    ~VPNManager() override;
+
+    // Checks that /dev/net/tun can be opened; blocks briefly the first time
+    bool initialize();
+    // Blocks (process start); the plugin runs it on its command executor.
+    // Stage events reach the listener through the platform poster.
+    bool startVPN(const std::string& config, const std::string& username = "", const std::string& password = "",
+                  const CancellationToken* cancel = nullptr);
+
+protected:
+    bool hasProcess() const override;
+    void terminateProcess() override;
+    void signalProcess(bool kill) override;
+    std::string exitStatus() override;
+    const AdapterInfo* findAdapter(const AdapterSnapshot& adapters) const override;
+    bool connectManagement() override;
+
+private:
+    bool createManagementDir();
+    void removeManagementDir();
+    BinaryLocator& binaries();
+    std::string getOpenVPNPath();
+    bool canConfigureNetwork(const std::string& openVPNPath);
+    std::string deviceName() const;
+
+    static std::string getAppDirectory();
+};
+
+} // namespace openvpn_flutter
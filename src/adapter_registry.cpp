@@ -0,0 +1,555 @@
+#include "adapter_registry.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <cerrno>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace openvpn_flutter {
+
+namespace {
+
+std::vector<AdapterInfo>::iterator findAdapter(std::vector<AdapterInfo>& adapters, uint32_t index) {
+    return std::find_if(adapters.begin(), adapters.end(),
+                        [index](const AdapterInfo& adapter) { return adapter.index == index; });
+}
+
+// Each change helper edits the list in place and returns false if nothing changed
+
+bool changeAddress(std::vector<AdapterInfo>& adapters, uint32_t index, const AdapterAddress& address,
+                   bool removed) {
+    auto it = findAdapter(adapters, index);
+    if (it == adapters.end()) {
+        return false;
+    }
+    auto existing = std::find(it->addresses.begin(), it->addresses.end(), address);
+    if (removed == (existing == it->addresses.end())) {
+        return false;  // Already in the requested state
+    }
+    if (removed) {
+        it->addresses.erase(existing);
+    } else {
+        it->addresses.push_back(address);
+    }
+    return true;
+}
+
+#ifdef _WIN32
+std::string toUtf8(const wchar_t* text) {
+    if (!text || !*text) {
+        return "";
+    }
+    int size = WideCharToMultiByte(CP_UTF8, 0, text, -1, NULL, 0, NULL, NULL);
+    if (size <= 1) {
+        return "";
+    }
+    std::string result(static_cast<size_t>(size - 1), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, text, -1, &result[0], size, NULL, NULL);
+    return result;
+}
+
+// Same "{XXXXXXXX-...}" form as IP_ADAPTER_ADDRESSES::AdapterName
+std::string guidString(const GUID& guid) {
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "{%08lX-%04hX-%04hX-%02X%02X-%02X%02X%02X%02X%02X%02X}",
+             guid.Data1, guid.Data2, guid.Data3,
+             guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+             guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+    return buffer;
+}
+
+bool toAdapterAddress(const SOCKADDR* sockaddr, AdapterAddress& address) {
+    if (!sockaddr) {
+        return false;
+    }
+    if (sockaddr->sa_family == AF_INET) {
+        address.family = 4;
+        memcpy(address.bytes, &reinterpret_cast<const SOCKADDR_IN*>(sockaddr)->sin_addr, 4);
+        return true;
+    }
+    if (sockaddr->sa_family == AF_INET6) {
+        address.family = 6;
+        memcpy(address.bytes, &reinterpret_cast<const SOCKADDR_IN6*>(sockaddr)->sin6_addr, 16);
+        return true;
+    }
+    return false;
+}
+
+void CALLBACK onInterfaceChange(PVOID context, PMIB_IPINTERFACE_ROW row, MIB_NOTIFICATION_TYPE type) {
+    if (row) {
+        static_cast<AdapterRegistry*>(context)->applyInterface(row->InterfaceIndex);
+    }
+}
+
+void CALLBACK onAddressChange(PVOID context, PMIB_UNICASTIPADDRESS_ROW row, MIB_NOTIFICATION_TYPE type) {
+    if (!row || type == MibParameterNotification) {
+        return;
+    }
+    AdapterAddress address;
+    if (toAdapterAddress(reinterpret_cast<const SOCKADDR*>(&row->Address), address)) {
+        static_cast<AdapterRegistry*>(context)->applyAddress(row->InterfaceIndex, address,
+                                                             type == MibDeleteInstance);
+    }
+}
+#else
+// Netlink messages are read into a buffer of this size
+constexpr size_t kNetlinkBufferSize = 16384;
+
+int openNetlink(uint32_t groups) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    local.nl_groups = groups;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool changeLink(std::vector<AdapterInfo>& adapters, const nlmsghdr* header) {
+    const ifinfomsg* message = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+    uint32_t index = static_cast<uint32_t>(message->ifi_index);
+    auto it = findAdapter(adapters, index);
+    if (header->nlmsg_type == RTM_DELLINK) {
+        if (it == adapters.end()) {
+            return false;
+        }
+        adapters.erase(it);
+        return true;
+    }
+
+    std::string name;
+    int payload = static_cast<int>(IFLA_PAYLOAD(header));
+    for (const rtattr* attr = IFLA_RTA(message); RTA_OK(attr, payload); attr = RTA_NEXT(attr, payload)) {
+        if (attr->rta_type == IFLA_IFNAME) {
+            name = static_cast<const char*>(RTA_DATA(attr));
+        }
+    }
+    bool up = (message->ifi_flags & IFF_UP) && (message->ifi_flags & IFF_RUNNING);
+
+    if (it == adapters.end()) {
+        it = adapters.insert(adapters.end(), AdapterInfo());
+        it->index = index;
+    } else if (it->up == up && (name.empty() || it->name == name)) {
+        return false;
+    }
+    if (!name.empty()) {
+        it->name = name;
+        it->description = name;
+        it->alias = name;
+        it->kind = AdapterRegistry::classify(name);
+    }
+    it->up = up;
+    return true;
+}
+
+bool parseAddress(const nlmsghdr* header, uint32_t& index, AdapterAddress& address) {
+    const ifaddrmsg* message = static_cast<const ifaddrmsg*>(NLMSG_DATA(header));
+    size_t length = message->ifa_family == AF_INET ? 4 : message->ifa_family == AF_INET6 ? 16 : 0;
+    if (length == 0) {
+        return false;
+    }
+
+    // IFA_LOCAL is the local end of point-to-point links, otherwise IFA_ADDRESS
+    const rtattr* chosen = nullptr;
+    int payload = static_cast<int>(IFA_PAYLOAD(header));
+    for (const rtattr* attr = IFA_RTA(message); RTA_OK(attr, payload); attr = RTA_NEXT(attr, payload)) {
+        if (attr->rta_type == IFA_LOCAL || (attr->rta_type == IFA_ADDRESS && !chosen)) {
+            chosen = attr;
+        }
+    }
+    if (!chosen || RTA_PAYLOAD(chosen) < length) {
+        return false;
+    }
+    index = message->ifa_index;
+    address.family = message->ifa_family == AF_INET ? 4 : 6;
+    memcpy(address.bytes, RTA_DATA(chosen), length);
+    return true;
+}
+
+// Applies every link/address message in buffer. Sets done at the end of a dump.
+bool changeFromMessages(std::vector<AdapterInfo>& adapters, const char* buffer, size_t size, bool& done) {
+    bool changed = false;
+    int remaining = static_cast<int>(size);
+    for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer); NLMSG_OK(header, remaining);
+         header = NLMSG_NEXT(header, remaining)) {
+        switch (header->nlmsg_type) {
+            case NLMSG_DONE:
+            case NLMSG_ERROR:
+                done = true;
+                return changed;
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                changed |= changeLink(adapters, header);
+                break;
+            case RTM_NEWADDR:
+            case RTM_DELADDR: {
+                uint32_t index = 0;
+                AdapterAddress address;
+                if (parseAddress(header, index, address)) {
+                    changed |= changeAddress(adapters, index, address, header->nlmsg_type == RTM_DELADDR);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return changed;
+}
+
+bool dump(std::vector<AdapterInfo>& adapters, int fd, uint16_t type, std::vector<char>& buffer) {
+    struct {
+        nlmsghdr header;
+        rtgenmsg message;
+    } request{};
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = 1;
+    request.message.rtgen_family = AF_UNSPEC;
+    if (send(fd, &request, sizeof(request), 0) < 0) {
+        return false;
+    }
+
+    bool done = false;
+    while (!done) {
+        ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        changeFromMessages(adapters, buffer.data(), static_cast<size_t>(received), done);
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+bool AdapterAddress::operator==(const AdapterAddress& other) const {
+    return family == other.family && memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+const AdapterInfo* AdapterSnapshot::findByIndex(uint32_t index) const {
+    for (const AdapterInfo& adapter : adapters) {
+        if (adapter.index == index) {
+            return &adapter;
+        }
+    }
+    return nullptr;
+}
+
+const AdapterInfo* AdapterSnapshot::findByName(const std::string& name) const {
+    for (const AdapterInfo& adapter : adapters) {
+        if (adapter.name == name) {
+            return &adapter;
+        }
+    }
+    return nullptr;
+}
+
+const AdapterInfo* AdapterSnapshot::findByAlias(const std::string& alias) const {
+    for (const AdapterInfo& adapter : adapters) {
+        if (adapter.alias == alias) {
+            return &adapter;
+        }
+    }
+    return nullptr;
+}
+
+AdapterRegistry::AdapterRegistry()
+    : current(std::make_shared<AdapterSnapshot>()) {
+}
+
+AdapterRegistry::~AdapterRegistry() {
+    stop();
+}
+
+AdapterKind AdapterRegistry::classify(const std::string& description) {
+    auto contains = [&description](const char* text) {
+        return description.find(text) != std::string::npos;
+    };
+    if (contains("TAP-Windows") || contains("TAP-Win32")) {
+        return AdapterKind::TapWindows;
+    }
+    if (contains("Wintun") || contains("WinTun")) {
+        return AdapterKind::Wintun;
+    }
+    if (contains("Data Channel Offload")) {
+        return AdapterKind::OpenVpnDco;
+    }
+    if (contains("OpenVPN")) {
+        return AdapterKind::OpenVpn;
+    }
+#ifndef _WIN32
+    if (description.compare(0, 3, "tun") == 0 || description.compare(0, 3, "tap") == 0) {
+        return AdapterKind::Tun;
+    }
+#endif
+    return AdapterKind::Other;
+}
+
+bool AdapterRegistry::start() {
+    if (started) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lifecycle(lifecycleMutex);
+    if (started) {
+        return true;
+    }
+
+    // Subscribe before enumerating so no change in between is lost
+#ifdef _WIN32
+    {
+        // Callbacks wait behind writerMutex until the initial list is published
+        std::lock_guard<std::mutex> lock(writerMutex);
+        HANDLE interfaceHandle = NULL;
+        HANDLE addressHandle = NULL;
+        if (NotifyIpInterfaceChange(AF_UNSPEC, onInterfaceChange, this, FALSE, &interfaceHandle) != NO_ERROR) {
+            LOG_ERROR("NotifyIpInterfaceChange failed, adapter list will not update");
+            interfaceHandle = NULL;
+        }
+        if (NotifyUnicastIpAddressChange(AF_UNSPEC, onAddressChange, this, FALSE, &addressHandle) != NO_ERROR) {
+            LOG_ERROR("NotifyUnicastIpAddressChange failed, adapter addresses will not update");
+            addressHandle = NULL;
+        }
+        interfaceNotification = interfaceHandle;
+        addressNotification = addressHandle;
+
+        std::vector<AdapterInfo> adapters;
+        if (!enumerate(adapters)) {
+            LOG_ERROR("Failed to enumerate network adapters");
+        }
+        publish(std::move(adapters));
+    }
+#else
+    netlinkSocket = openNetlink(RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR);
+    if (netlinkSocket < 0) {
+        LOG_ERROR("Failed to subscribe to netlink, adapter list will not update");
+    }
+    resync();
+    if (netlinkSocket >= 0) {
+        stopSignal.reset();
+        listenerThread = std::thread(&AdapterRegistry::listen, this);
+    }
+#endif
+    started = true;
+    return true;
+}
+
+void AdapterRegistry::stop() {
+    std::lock_guard<std::mutex> lifecycle(lifecycleMutex);
+    if (!started) {
+        return;
+    }
+#ifdef _WIN32
+    // Waits for callbacks in progress, so writerMutex must not be held here
+    if (interfaceNotification) {
+        CancelMibChangeNotify2(static_cast<HANDLE>(interfaceNotification));
+        interfaceNotification = nullptr;
+    }
+    if (addressNotification) {
+        CancelMibChangeNotify2(static_cast<HANDLE>(addressNotification));
+        addressNotification = nullptr;
+    }
+#else
+    stopSignal.set();
+    if (listenerThread.joinable()) {
+        listenerThread.join();
+    }
+    if (netlinkSocket >= 0) {
+        ::close(netlinkSocket);
+        netlinkSocket = -1;
+    }
+#endif
+    started = false;
+}
+
+std::shared_ptr<const AdapterSnapshot> AdapterRegistry::snapshot() const {
+    return std::atomic_load(&current);
+}
+
+uint64_t AdapterRegistry::generation() const {
+    return currentGeneration.load(std::memory_order_acquire);
+}
+
+void AdapterRegistry::publish(std::vector<AdapterInfo> adapters) {
+    auto next = std::make_shared<AdapterSnapshot>();
+    next->generation = currentGeneration.load(std::memory_order_relaxed) + 1;
+    next->adapters = std::move(adapters);
+    uint64_t nextGeneration = next->generation;
+    std::atomic_store(&current, std::shared_ptr<const AdapterSnapshot>(std::move(next)));
+    currentGeneration.store(nextGeneration, std::memory_order_release);
+}
+
+template <typename Mutate>
+void AdapterRegistry::update(Mutate&& mutate) {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    std::vector<AdapterInfo> adapters = std::atomic_load(&current)->adapters;
+    if (mutate(adapters)) {
+        publish(std::move(adapters));
+    }
+}
+
+#ifdef _WIN32
+void AdapterRegistry::applyInterface(uint32_t index) {
+    // One row for the interface that changed, no full enumeration
+    MIB_IF_ROW2 row;
+    ZeroMemory(&row, sizeof(row));
+    row.InterfaceIndex = index;
+    bool exists = GetIfEntry2(&row) == NO_ERROR;
+
+    update([&](std::vector<AdapterInfo>& adapters) {
+        auto it = findAdapter(adapters, index);
+        if (!exists) {
+            if (it == adapters.end()) {
+                return false;
+            }
+            adapters.erase(it);
+            return true;
+        }
+        if (it == adapters.end()) {
+            it = adapters.insert(adapters.end(), AdapterInfo());
+            it->index = index;
+        }
+        it->name = guidString(row.InterfaceGuid);
+        it->description = toUtf8(row.Description);
+        it->alias = toUtf8(row.Alias);
+        it->kind = classify(it->description);
+        it->up = row.OperStatus == IfOperStatusUp;
+        return true;
+    });
+}
+
+void AdapterRegistry::applyAddress(uint32_t index, const AdapterAddress& address, bool removed) {
+    update([&](std::vector<AdapterInfo>& adapters) {
+        return changeAddress(adapters, index, address, removed);
+    });
+}
+#else
+void AdapterRegistry::resync() {
+    std::vector<AdapterInfo> adapters;
+    if (!enumerate(adapters)) {
+        LOG_ERROR("Failed to enumerate network adapters");
+    }
+    std::lock_guard<std::mutex> lock(writerMutex);
+    publish(std::move(adapters));
+}
+
+void AdapterRegistry::listen() {
+    WaitSet waitSet;
+    int socketSource = waitSet.addSocket(netlinkSocket);
+    int stopSource = waitSet.addSignal(stopSignal);
+    std::vector<char> buffer(kNetlinkBufferSize);
+
+    while (true) {
+        int fired = waitSet.wait(WaitSet::kInfinite);
+        if (fired == stopSource || fired == WaitSet::kFailed) {
+            break;
+        }
+        if (fired != socketSource) {
+            continue;
+        }
+
+        // Everything queued so far becomes one new snapshot
+        bool overrun = false;
+        update([&](std::vector<AdapterInfo>& adapters) {
+            bool changed = false;
+            while (true) {
+                ssize_t received = recv(netlinkSocket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received < 0) {
+                    overrun = errno == ENOBUFS;
+                    break;
+                }
+                bool done = false;
+                changed |= changeFromMessages(adapters, buffer.data(), static_cast<size_t>(received), done);
+            }
+            return changed;
+        });
+
+        if (overrun) {
+            // The kernel dropped notifications; start over from a full dump
+            resync();
+        }
+    }
+}
+#endif
+
+bool AdapterRegistry::enumerate(std::vector<AdapterInfo>& adapters) {
+#ifdef _WIN32
+    // Recommended starting size; retried if the adapter list grows meanwhile
+    ULONG bufferSize = 15 * 1024;
+    std::vector<char> buffer;
+    ULONG flags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER;
+    ULONG result = ERROR_BUFFER_OVERFLOW;
+    for (int attempt = 0; attempt < 3 && result == ERROR_BUFFER_OVERFLOW; attempt++) {
+        buffer.resize(bufferSize);
+        result = GetAdaptersAddresses(AF_UNSPEC, flags, NULL,
+                                      reinterpret_cast<PIP_ADAPTER_ADDRESSES>(buffer.data()), &bufferSize);
+    }
+    if (result != NO_ERROR) {
+        return false;
+    }
+
+    for (PIP_ADAPTER_ADDRESSES adapter = reinterpret_cast<PIP_ADAPTER_ADDRESSES>(buffer.data());
+         adapter != NULL; adapter = adapter->Next) {
+        AdapterInfo info;
+        info.index = adapter->IfIndex ? adapter->IfIndex : adapter->Ipv6IfIndex;
+        info.name = adapter->AdapterName ? adapter->AdapterName : "";
+        info.description = toUtf8(adapter->Description);
+        info.alias = toUtf8(adapter->FriendlyName);
+        info.kind = classify(info.description);
+        info.up = adapter->OperStatus == IfOperStatusUp;
+        for (PIP_ADAPTER_UNICAST_ADDRESS unicast = adapter->FirstUnicastAddress; unicast != NULL;
+             unicast = unicast->Next) {
+            AdapterAddress address;
+            if (toAdapterAddress(unicast->Address.lpSockaddr, address)) {
+                info.addresses.push_back(address);
+            }
+        }
+        adapters.push_back(std::move(info));
+    }
+    return true;
+#else
+    int fd = openNetlink(0);
+    if (fd < 0) {
+        return false;
+    }
+    std::vector<char> buffer(kNetlinkBufferSize);
+    // Links first so addresses have an adapter to attach to
+    bool ok = dump(adapters, fd, RTM_GETLINK, buffer) && dump(adapters, fd, RTM_GETADDR, buffer);
+    ::close(fd);
+    return ok;
+#endif
+}
+
+} // namespace openvpn_flutter
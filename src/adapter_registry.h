@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wait_set.h"
+
+namespace openvpn_flutter {
+
+enum class AdapterKind : uint8_t {
+    Other,
+    TapWindows,
+    Wintun,
+    OpenVpnDco,
+    OpenVpn,  // Other adapter whose description mentions OpenVPN
+    Tun       // Linux tun/tap device
+};
+
+// Unicast address assigned to an adapter
+struct AdapterAddress {
+    uint8_t family = 0;  // 4 or 6
+    uint8_t bytes[16] = {};
+
+    bool operator==(const AdapterAddress& other) const;
+};
+
+struct AdapterInfo {
+    uint32_t index = 0;          // IfIndex / ifindex
+    std::string name;            // AdapterName GUID on Windows, interface name on Linux
+    std::string description;     // UTF-8; same as name on Linux
+    std::string alias;           // UTF-8 friendly name ("OpenVPN-Flutter"); same as name on Linux
+    AdapterKind kind = AdapterKind::Other;
+    bool up = false;
+    std::vector<AdapterAddress> addresses;
+
+    bool isVpn() const { return kind != AdapterKind::Other; }
+    bool hasAddress() const { return !addresses.empty(); }
+};
+
+// Immutable view of all adapters; a new one is published on every change
+struct AdapterSnapshot {
+    uint64_t generation = 0;
+    std::vector<AdapterInfo> adapters;
+
+    const AdapterInfo* findByIndex(uint32_t index) const;
+    const AdapterInfo* findByName(const std::string& name) const;
+    const AdapterInfo* findByAlias(const std::string& alias) const;
+};
+
+// Network adapters, enumerated once and then kept current from change
+// notifications (NotifyIpInterfaceChange/NotifyUnicastIpAddressChange on
+// Windows, an RTMGRP_LINK/IFADDR netlink subscription on Linux).
+//
+// Readers never enumerate: snapshot() hands out the current immutable
+// snapshot. Callers on a hot path keep the snapshot they got and only fetch a
+// new one when generation() has moved, which is a single atomic load.
+class AdapterRegistry {
+private:
+    std::shared_ptr<const AdapterSnapshot> current;
+    std::atomic<uint64_t> currentGeneration{0};
+    std::mutex writerMutex;  // Serializes notification callbacks and start/stop
+    std::mutex lifecycleMutex; // start() may race from several worker threads
+    std::atomic<bool> started{false};
+
+#ifdef _WIN32
+    void* interfaceNotification = nullptr;
+    void* addressNotification = nullptr;
+#else
+    int netlinkSocket = -1;
+    StopSignal stopSignal;
+    std::thread listenerThread;
+    void listen();
+    void resync();
+#endif
+
+    template <typename Mutate>
+    void update(Mutate&& mutate);
+    void publish(std::vector<AdapterInfo> adapters);
+    bool enumerate(std::vector<AdapterInfo>& adapters);
+
+public:
+    AdapterRegistry();
+    ~AdapterRegistry();
+
+    AdapterRegistry(const AdapterRegistry&) = delete;
+    AdapterRegistry& operator=(const AdapterRegistry&) = delete;
+
+    // Enumerate once and subscribe to changes; does nothing if already started.
+    // Safe to call from any thread.
+    bool start();
+    void stop();
+
+    std::shared_ptr<const AdapterSnapshot> snapshot() const;
+    uint64_t generation() const;
+
+#ifdef _WIN32
+    // Change handlers, called from the notification callbacks
+    void applyInterface(uint32_t index);
+    void applyAddress(uint32_t index, const AdapterAddress& address, bool removed);
+#endif
+
+    static AdapterKind classify(const std::string& description);
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,166 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+
+struct Benchmark {
+    const char* name;
+    openvpn_flutter::bench::Function function;
+};
+
+std::vector<Benchmark>& registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+} // namespace
+
+// Every heap allocation of the process goes through here, so a benchmark can
+// report how many its loop made
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace openvpn_flutter {
+namespace bench {
+
+State::State(uint64_t iterations) : iterations(iterations), remaining(iterations) {}
+
+void State::start() {
+    started = true;
+    startAllocations = allocationCount();
+    startTime = Clock::now();
+}
+
+void State::stop() {
+    stopTime = Clock::now();
+    stopAllocations = allocationCount();
+}
+
+uint64_t State::getIterations() const {
+    return iterations;
+}
+
+std::chrono::nanoseconds State::elapsed() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(stopTime - startTime);
+}
+
+uint64_t State::allocations() const {
+    return stopAllocations - startAllocations;
+}
+
+void State::skip(const char* reason) {
+    skipReason = reason;
+}
+
+const char* State::skipped() const {
+    return skipReason;
+}
+
+int registerBenchmark(const char* name, Function function) {
+    registry().push_back(Benchmark{name, function});
+    return static_cast<int>(registry().size());
+}
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+} // namespace bench
+} // namespace openvpn_flutter
+
+int main(int argc, char** argv) {
+    using namespace openvpn_flutter;
+    using namespace std::chrono;
+
+    std::string filter;
+    double minTimeSeconds = 0.5;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--min-time=", 11) == 0) {
+            minTimeSeconds = std::atof(argv[i] + 11);
+        } else if (std::strcmp(argv[i], "--help") == 0) {
+            std::printf("usage: %s [--min-time=SECONDS] [NAME_FILTER]\n", argv[0]);
+            return 0;
+        } else {
+            filter = argv[i];
+        }
+    }
+    auto minTime = duration_cast<nanoseconds>(duration<double>(minTimeSeconds > 0 ? minTimeSeconds : 0.5));
+
+    // Benchmarks measure the code, not the log writer
+    Logger::instance().setLevel(LogLevel::Off);
+
+    std::printf("%-36s %14s %14s %12s\n", "Benchmark", "Iterations", "ns/op", "allocs/op");
+    for (const auto& benchmark : registry()) {
+        if (!filter.empty() && std::string(benchmark.name).find(filter) == std::string::npos) {
+            continue;
+        }
+
+        // Grow the iteration count until a run is long enough to time, then
+        // size the measured run to take about minTime
+        uint64_t iterations = 1;
+        const char* skipReason = nullptr;
+        while (true) {
+            bench::State probe(iterations);
+            benchmark.function(probe);
+            if ((skipReason = probe.skipped()) != nullptr) {
+                break;
+            }
+            if (probe.elapsed() >= minTime / 10 || iterations >= 1000000000) {
+                double perOp = static_cast<double>(probe.elapsed().count()) / static_cast<double>(iterations);
+                double target = perOp > 0 ? static_cast<double>(minTime.count()) / perOp : 1e9;
+                iterations = std::max<uint64_t>(iterations, static_cast<uint64_t>(std::min(target, 1e9)));
+                break;
+            }
+            iterations *= 10;
+        }
+        if (skipReason) {
+            std::printf("%-36s skipped: %s\n", benchmark.name, skipReason);
+            continue;
+        }
+
+        bench::State state(iterations);
+        benchmark.function(state);
+        double nsPerOp = static_cast<double>(state.elapsed().count()) / static_cast<double>(iterations);
+        double allocsPerOp = static_cast<double>(state.allocations()) / static_cast<double>(iterations);
+        std::printf("%-36s %14llu %14.1f %12.2f\n", benchmark.name,
+                    static_cast<unsigned long long>(iterations), nsPerOp, allocsPerOp);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace openvpn_flutter {
+namespace bench {
+
+// Passed to every benchmark. The body repeats its operation while
+// keepRunning() is true; timing and allocation counting start at the first
+// call, so setup before the loop is not measured:
+//
+//   void BM_Something(State& state) {
+//       Fixture fixture;
+//       while (state.keepRunning()) {
+//           doNotOptimize(fixture.run());
+//       }
+//   }
+//   BENCHMARK(BM_Something);
+class State {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t iterations;
+    uint64_t remaining;
+    bool started = false;
+    Clock::time_point startTime;
+    Clock::time_point stopTime;
+    uint64_t startAllocations = 0;
+    uint64_t stopAllocations = 0;
+    const char* skipReason = nullptr;
+
+    void start();
+    void stop();
+
+public:
+    explicit State(uint64_t iterations);
+
+    bool keepRunning() {
+        if (remaining > 0) {
+            if (!started) {
+                start();
+            }
+            remaining--;
+            return true;
+        }
+        stop();
+        return false;
+    }
+
+    uint64_t getIterations() const;
+    std::chrono::nanoseconds elapsed() const;
+    uint64_t allocations() const;
+
+    // Call instead of looping when the benchmark can't run here (missing
+    // privileges or devices); it is reported as skipped
+    void skip(const char* reason);
+    const char* skipped() const;
+};
+
+using Function = void (*)(State& state);
+
+// Called through BENCHMARK() at static initialization
+int registerBenchmark(const char* name, Function function);
+
+// Heap allocations made by any thread so far (global operator new is counted)
+uint64_t allocationCount();
+
+// Keeps the compiler from dropping a computation whose result is unused
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+    const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+} // namespace bench
+} // namespace openvpn_flutter
+
+#define OPENVPN_FLUTTER_BENCH_CONCAT_(a, b) a##b
+#define OPENVPN_FLUTTER_BENCH_CONCAT(a, b) OPENVPN_FLUTTER_BENCH_CONCAT_(a, b)
+#define BENCHMARK(function)                                                                    \
+    static const int OPENVPN_FLUTTER_BENCH_CONCAT(benchRegistered_, __LINE__) =                \
+        ::openvpn_flutter::bench::registerBenchmark(#function, function)
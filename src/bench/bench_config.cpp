@@ -0,0 +1,150 @@
+#include "bench.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "config_cache.h"
+#include "config_rewriter.h"
+
+namespace openvpn_flutter {
+namespace bench {
+
+namespace {
+
+// A typical provider profile: a handful of directives, three remotes and the
+// inline certificates and keys that make up most of its size
+std::string sampleProfile() {
+    std::string profile =
+        "client\n"
+        "dev tun\n"
+        "proto udp\n"
+        "remote vpn1.example.com 1194\n"
+        "remote vpn2.example.com 1194\n"
+        "remote vpn3.example.com 443 tcp\n"
+        "resolv-retry infinite\n"
+        "nobind\n"
+        "persist-key\n"
+        "persist-tun\n"
+        "remote-cert-tls server\n"
+        "cipher AES-256-GCM\n"
+        "auth SHA256\n"
+        "verb 3\n";
+    const std::string base64Line = "MIIDSzCCAjOgAwIBAgIUB3fVh7u9Qn1YZ0JZk1c2tQ2m8XAwDQYJKoZIhvcNAQELBQAwFjEU\n";
+    for (const char* block : {"ca", "cert", "key", "tls-auth"}) {
+        profile += std::string("<") + block + ">\n-----BEGIN DATA-----\n";
+        for (int i = 0; i < 20; i++) {
+            profile += base64Line;
+        }
+        profile += std::string("-----END DATA-----\n</") + block + ">\n";
+    }
+    return profile;
+}
+
+// A profile of several megabytes: a large CA bundle inline, a few hundred
+// fallback <connection> blocks and CRLF line ends, like exported enterprise
+// profiles. Shows the rewriter stays linear and copies untouched spans whole.
+std::string largeProfile() {
+    std::string profile =
+        "client\r\n"
+        "dev tun\r\n"
+        "persist-tun\r\n"
+        "windows-driver tap-windows6\r\n"
+        "remote vpn1.example.com 1194\r\n"
+        "verb 3\r\n";
+    for (int i = 0; i < 300; i++) {
+        profile += "<connection>\r\nremote fallback" + std::to_string(i) + ".example.com 443 tcp\r\n</connection>\r\n";
+    }
+    const std::string base64Line = "MIIDSzCCAjOgAwIBAgIUB3fVh7u9Qn1YZ0JZk1c2tQ2m8XAwDQYJKoZIhvcNAQELBQAwFjEU\r\n";
+    profile += "<ca>\r\n";
+    while (profile.size() < 4 * 1024 * 1024) {
+        profile += "-----BEGIN CERTIFICATE-----\r\n";
+        for (int i = 0; i < 25; i++) {
+            profile += base64Line;
+        }
+        profile += "-----END CERTIFICATE-----\r\n";
+    }
+    profile += "</ca>\r\n";
+    return profile;
+}
+
+void BM_ConfigRewriteWinTun(State& state) {
+    std::string profile = sampleProfile();
+    ConfigRewriter rewriter(ConfigRewriter::wintunRules());
+    RewriteResult result;
+    while (state.keepRunning()) {
+        doNotOptimize(rewriter.rewrite(profile, &result));
+    }
+}
+BENCHMARK(BM_ConfigRewriteWinTun);
+
+void BM_ConfigRewriteTap(State& state) {
+    std::string profile = sampleProfile();
+    ConfigRewriter rewriter(ConfigRewriter::baseRules());
+    while (state.keepRunning()) {
+        doNotOptimize(rewriter.rewrite(profile));
+    }
+}
+BENCHMARK(BM_ConfigRewriteTap);
+
+void BM_ConfigRewriteWinTunLarge(State& state) {
+    std::string profile = largeProfile();
+    ConfigRewriter rewriter(ConfigRewriter::wintunRules());
+    RewriteResult result;
+    while (state.keepRunning()) {
+        doNotOptimize(rewriter.rewrite(profile, &result));
+    }
+}
+BENCHMARK(BM_ConfigRewriteWinTunLarge);
+
+void BM_ConfigRemoteHostsLarge(State& state) {
+    std::string profile = largeProfile();
+    while (state.keepRunning()) {
+        doNotOptimize(ConfigRewriter::remoteHosts(profile));
+    }
+}
+BENCHMARK(BM_ConfigRemoteHostsLarge);
+
+void BM_ConfigCacheKeyLarge(State& state) {
+    std::string profile = largeProfile();
+    while (state.keepRunning()) {
+        doNotOptimize(ConfigCache::makeKey(profile, 0, ConfigRewriter::kRuleVersion, true, ""));
+    }
+}
+BENCHMARK(BM_ConfigCacheKeyLarge);
+
+void BM_ConfigPinRemotes(State& state) {
+    std::string profile = sampleProfile();
+    std::map<std::string, std::vector<std::string>> addresses = {
+        {"vpn1.example.com", {"192.0.2.10", "192.0.2.11"}},
+        {"vpn2.example.com", {"198.51.100.7"}},
+        {"vpn3.example.com", {"203.0.113.5", "2001:db8::5"}},
+    };
+    ConfigRewriter pinner({ConfigRewriter::resolvedRemoteRule(addresses)});
+    while (state.keepRunning()) {
+        doNotOptimize(pinner.rewrite(profile));
+    }
+}
+BENCHMARK(BM_ConfigPinRemotes);
+
+void BM_ConfigRemoteHosts(State& state) {
+    std::string profile = sampleProfile();
+    while (state.keepRunning()) {
+        doNotOptimize(ConfigRewriter::remoteHosts(profile));
+    }
+}
+BENCHMARK(BM_ConfigRemoteHosts);
+
+void BM_ConfigCacheKey(State& state) {
+    std::string profile = sampleProfile();
+    std::string resolved = "vpn1.example.com 192.0.2.10 192.0.2.11\nvpn2.example.com 198.51.100.7\n";
+    while (state.keepRunning()) {
+        doNotOptimize(ConfigCache::makeKey(profile, 0, ConfigRewriter::kRuleVersion, true, resolved));
+    }
+}
+BENCHMARK(BM_ConfigCacheKey);
+
+} // namespace
+
+} // namespace bench
+} // namespace openvpn_flutter
@@ -0,0 +1,56 @@
+#include "bench.h"
+
+#include <chrono>
+#include <string>
+
+#include "latency_metrics.h"
+#include "output_parser.h"
+
+namespace openvpn_flutter {
+namespace bench {
+
+namespace {
+
+// openvpn prints a few dozen lines per connect at verb 3; every one of them
+// goes through the matcher on the monitor thread
+void BM_OutputMatchLine(State& state) {
+    const OutputMatcher& matcher = OutputMatcher::openvpn();
+    std::string line = "2024-05-01 12:00:00 Outgoing Data Channel: Cipher 'AES-256-GCM' initialized with 256 bit key";
+    while (state.keepRunning()) {
+        doNotOptimize(matcher.match(line.data(), line.size()));
+    }
+}
+BENCHMARK(BM_OutputMatchLine);
+
+void BM_OutputParserFeed(State& state) {
+    OutputParser parser;
+    std::string chunk =
+        "2024-05-01 12:00:00 TCP/UDP: Preserving recently used remote address: [AF_INET]192.0.2.10:1194\n"
+        "2024-05-01 12:00:00 UDP link local: (not bound)\n"
+        "2024-05-01 12:00:01 Initialization Sequence Completed\n";
+    size_t connected = 0;
+    OutputParser::LineHandler onLine = [&connected](const std::string&, OutputEvent event) {
+        connected += event == OutputEvent::Connected;
+    };
+    while (state.keepRunning()) {
+        parser.feed(chunk.data(), chunk.size(), onLine);
+    }
+    doNotOptimize(connected);
+}
+BENCHMARK(BM_OutputParserFeed);
+
+void BM_LatencyHistogramRecord(State& state) {
+    LatencyHistogram histogram;
+    int64_t micros = 1;
+    while (state.keepRunning()) {
+        histogram.record(std::chrono::microseconds(micros));
+        micros = micros * 3 % 1000003;
+    }
+    doNotOptimize(histogram.summarize());
+}
+BENCHMARK(BM_LatencyHistogramRecord);
+
+} // namespace
+
+} // namespace bench
+} // namespace openvpn_flutter
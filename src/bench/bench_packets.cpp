@@ -0,0 +1,163 @@
+#include "bench.h"
+
+#include <cstring>
+
+#include "memory_packet_ring.h"
+#include "packet_pump.h"
+#include "tun_packet_ring.h"
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace openvpn_flutter {
+namespace bench {
+
+namespace {
+
+// Full-size tunnel packets, as a 1500 byte MTU leaves them after openvpn's overhead
+constexpr uint32_t kPacketSize = 1400;
+constexpr size_t kBurst = 32;
+
+// IPv4/UDP header in front of zeros; enough for describePacket()
+void fillPacket(uint8_t* packet, uint32_t size) {
+    memset(packet, 0, size);
+    packet[0] = 0x45;
+    packet[2] = static_cast<uint8_t>(size >> 8);
+    packet[3] = static_cast<uint8_t>(size);
+    packet[8] = 64;
+    packet[9] = 17;
+}
+
+// A burst from the OS through the pump to a sink, all in memory: the cost of
+// the ring and pump themselves, per burst of kBurst packets
+void BM_PacketPumpMemoryBurst32(State& state) {
+    MemoryPacketRing ring;
+    uint64_t udpBytes = 0;
+    PacketPump pump(ring, [&udpBytes](const Packet* packets, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            udpBytes += packets[i].protocol == 17 ? packets[i].size : 0;
+        }
+    });
+    uint8_t packet[kPacketSize];
+    fillPacket(packet, kPacketSize);
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < kBurst; i++) {
+            ring.inject(packet, kPacketSize);
+        }
+        while (pump.pumpOnce() > 0) {
+        }
+    }
+    doNotOptimize(udpBytes);
+}
+BENCHMARK(BM_PacketPumpMemoryBurst32);
+
+// Writing one packet toward the OS in place and the OS taking it
+void BM_MemoryRingSend(State& state) {
+    MemoryPacketRing ring;
+    uint64_t sent = 0;
+    size_t pending = 0;
+    while (state.keepRunning()) {
+        uint8_t* packet = ring.allocateSend(kPacketSize);
+        fillPacket(packet, kPacketSize);
+        ring.send(packet);
+        if (++pending == kBurst) {
+            sent += ring.drainSent([](const Packet&) {});
+            pending = 0;
+        }
+    }
+    doNotOptimize(sent);
+}
+BENCHMARK(BM_MemoryRingSend);
+
+#ifdef __linux__
+
+// A tun device with 198.18.0.1/24 (benchmarking range) on it, up, so that
+// datagrams to 198.18.0.0/24 leave through it
+bool openBenchDevice(TunPacketRing& ring) {
+    if (!ring.open("ofbench%d")) {
+        return false;
+    }
+    int control = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (control < 0) {
+        return false;
+    }
+    ifreq request{};
+    strncpy(request.ifr_name, ring.getName().c_str(), IFNAMSIZ - 1);
+    sockaddr_in* address = reinterpret_cast<sockaddr_in*>(&request.ifr_addr);
+    address->sin_family = AF_INET;
+    inet_pton(AF_INET, "198.18.0.1", &address->sin_addr);
+    bool configured = ioctl(control, SIOCSIFADDR, &request) == 0;
+    inet_pton(AF_INET, "255.255.255.0", &address->sin_addr);
+    configured = configured && ioctl(control, SIOCSIFNETMASK, &request) == 0;
+    configured = configured && ioctl(control, SIOCGIFFLAGS, &request) == 0;
+    request.ifr_flags |= IFF_UP | IFF_RUNNING;
+    configured = configured && ioctl(control, SIOCSIFFLAGS, &request) == 0;
+    ::close(control);
+    return configured;
+}
+
+// Datagrams sent by a local socket come out of the device: the kernel's UDP
+// send and routing plus the ring's reads, per burst of kBurst packets
+void BM_TunRingLoopbackBurst32(State& state) {
+    TunPacketRing ring;
+    if (!openBenchDevice(ring)) {
+        state.skip("needs CAP_NET_ADMIN and /dev/net/tun");
+        return;
+    }
+    int sender = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(9);
+    inet_pton(AF_INET, "198.18.0.2", &target.sin_addr);
+    uint8_t payload[kPacketSize - 28] = {};
+
+    uint64_t received = 0;
+    PacketPump pump(ring, [&received](const Packet*, size_t count) { received += count; });
+    // Router solicitations and the like arrive right after the device comes up
+    while (ring.waitReadable(50)) {
+        pump.pumpOnce();
+    }
+    received = 0;
+
+    uint64_t expected = 0;
+    while (state.keepRunning()) {
+        for (size_t i = 0; i < kBurst; i++) {
+            sendto(sender, payload, sizeof(payload), 0, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+        }
+        expected += kBurst;
+        while (received < expected && ring.waitReadable(100)) {
+            pump.pumpOnce();
+        }
+    }
+    ::close(sender);
+    doNotOptimize(received);
+}
+BENCHMARK(BM_TunRingLoopbackBurst32);
+
+// One packet written into the device; the kernel takes and drops it
+void BM_TunRingSend(State& state) {
+    TunPacketRing ring;
+    if (!openBenchDevice(ring)) {
+        state.skip("needs CAP_NET_ADMIN and /dev/net/tun");
+        return;
+    }
+    while (state.keepRunning()) {
+        uint8_t* packet = ring.allocateSend(kPacketSize);
+        fillPacket(packet, kPacketSize);
+        ring.send(packet);
+    }
+}
+BENCHMARK(BM_TunRingSend);
+
+#endif // __linux__
+
+} // namespace
+
+} // namespace bench
+} // namespace openvpn_flutter
@@ -0,0 +1,252 @@
+#include "bench.h"
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant>
+
+#include "connection_stats.h"
+#include "interface_counters.h"
+#include "seqlock.h"
+#include "throughput_history.h"
+
+namespace openvpn_flutter {
+namespace bench {
+
+namespace {
+
+// Same shape as flutter::EncodableMap (std::map of std::variant values, strings
+// held by value), which is not available outside a Flutter build; it allocates
+// the way the real map does, which is what this measures
+using MapValue = std::variant<std::monostate, int32_t, int64_t, std::string>;
+using MapLike = std::map<MapValue, MapValue>;
+
+StatsSample sampleStats() {
+    StatsSample sample;
+    sample.active = true;
+    sample.connectedOnMs = 1700000000000;
+    sample.sampledAtMs = 1700003600000;
+    sample.durationSeconds = 3600;
+    sample.speedIn = 1250000;
+    sample.speedOut = 64000;
+    sample.counters.bytesIn = 1234567890;
+    sample.counters.bytesOut = 98765432;
+    sample.counters.unicastPacketsIn = 881834;
+    sample.counters.unicastPacketsOut = 70546;
+    sample.counters.nonUnicastPacketsIn = 12;
+    sample.counters.discardsIn = 3;
+    sample.counters.linkSpeedIn = 100000000000;
+    sample.counters.linkSpeedOut = 100000000000;
+    sample.interval.bytesIn = 1250000;
+    sample.interval.bytesOut = 64000;
+    sample.interval.unicastPacketsIn = 893;
+    sample.interval.unicastPacketsOut = 46;
+    sample.intervalMs = 1000;
+    return sample;
+}
+
+void BM_StatsEncodeMap(State& state) {
+    StatsSample sample = sampleStats();
+    std::string tunnelId = "default";
+    while (state.keepRunning()) {
+        MapLike stats;
+        visitStats(sample, tunnelId, [&stats](const char* key, const auto& value) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::nullptr_t>) {
+                stats[MapValue(std::string(key))] = MapValue();
+            } else {
+                stats[MapValue(std::string(key))] = MapValue(value);
+            }
+        });
+        doNotOptimize(stats);
+    }
+}
+BENCHMARK(BM_StatsEncodeMap);
+
+void BM_StatsEncodeJson(State& state) {
+    StatsSample sample = sampleStats();
+    std::string tunnelId = "default";
+    std::string json;
+    json.reserve(512);
+    while (state.keepRunning()) {
+        json.clear();
+        json += '{';
+        visitStats(sample, tunnelId, [&json](const char* key, const auto& value) {
+            using Value = std::decay_t<decltype(value)>;
+            if (json.size() > 1) {
+                json += ',';
+            }
+            json += '"';
+            json += key;
+            json += "\":";
+            if constexpr (std::is_same_v<Value, std::nullptr_t>) {
+                json += "null";
+            } else if constexpr (std::is_same_v<Value, std::string>) {
+                json += '"';
+                json += value;
+                json += '"';
+            } else {
+                char number[24];
+                int length = std::snprintf(number, sizeof(number), "%" PRId64, static_cast<int64_t>(value));
+                json.append(number, static_cast<size_t>(length));
+            }
+        });
+        json += '}';
+        doNotOptimize(json);
+    }
+}
+BENCHMARK(BM_StatsEncodeJson);
+
+void BM_StatsChanged(State& state) {
+    StatsSample previous = sampleStats();
+    StatsSample current = previous;
+    while (state.keepRunning()) {
+        current.counters.bytesIn++;
+        doNotOptimize(statsChanged(previous, current));
+    }
+}
+BENCHMARK(BM_StatsChanged);
+
+// One reading a second, as >BYTECOUNT: pushes them
+void BM_ThroughputRecord(State& state) {
+    ThroughputHistory history;
+    auto now = ThroughputHistory::Clock::time_point{} + std::chrono::hours(1);
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    while (state.keepRunning()) {
+        now += std::chrono::seconds(1);
+        bytesIn += 125000;
+        bytesOut += 8000;
+        history.record(bytesIn, bytesOut, now);
+    }
+    doNotOptimize(history.current(now));
+}
+BENCHMARK(BM_ThroughputRecord);
+
+// A full hour of varied traffic, read back the ways the throughput call does
+ThroughputHistory::Clock::time_point fillHour(ThroughputHistory& history) {
+    auto now = ThroughputHistory::Clock::time_point{} + std::chrono::hours(1);
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    history.record(bytesIn, bytesOut, now);
+    for (uint64_t second = 0; second < ThroughputHistory::kSeconds; second++) {
+        now += std::chrono::milliseconds(700 + second % 600);
+        bytesIn += 100000 + (second * 7919) % 900000;
+        bytesOut += 5000 + (second * 104729) % 60000;
+        history.record(bytesIn, bytesOut, now);
+    }
+    return now;
+}
+
+void BM_ThroughputCurrent(State& state) {
+    ThroughputHistory history;
+    auto now = fillHour(history);
+    while (state.keepRunning()) {
+        doNotOptimize(history.current(now));
+    }
+}
+BENCHMARK(BM_ThroughputCurrent);
+
+void BM_ThroughputSummarizeHour(State& state) {
+    ThroughputHistory history;
+    auto now = fillHour(history);
+    while (state.keepRunning()) {
+        doNotOptimize(history.summarize(ThroughputHistory::kSeconds, 95.0, now));
+    }
+}
+BENCHMARK(BM_ThroughputSummarizeHour);
+
+void BM_ThroughputSeriesHour(State& state) {
+    ThroughputHistory history;
+    auto now = fillHour(history);
+    std::array<Throughput, 120> points;
+    int64_t secondsPerPoint = 0;
+    while (state.keepRunning()) {
+        doNotOptimize(history.series(ThroughputHistory::kSeconds, points.data(), points.size(), secondsPerPoint, now));
+    }
+}
+BENCHMARK(BM_ThroughputSeriesHour);
+
+// The per-tick counter path behind a source: read, rebase on the session's
+// baseline, interval since the previous sample
+void BM_SessionCountersFakeSource(State& state) {
+    FakeCounterSource source;
+    SessionCounters session;
+    StatsSample previous = sampleStats();
+    source.addTraffic(7, 1000, 100, 1400);
+    while (state.keepRunning()) {
+        source.addTraffic(7, 893, 46, 1400);
+        InterfaceCounters raw;
+        source.read(7, raw);
+        StatsSample current = previous;
+        current.sampledAtMs += 1000;
+        current.counters = session.update(raw);
+        measureInterval(previous, current);
+        previous = current;
+    }
+    doNotOptimize(previous.interval.bytesIn);
+}
+BENCHMARK(BM_SessionCountersFakeSource);
+
+// One reading of the OS's counters for the loopback interface (a netlink
+// round trip on Linux, GetIfEntry2 on Windows)
+void BM_SystemCounterSourceRead(State& state) {
+    SystemCounterSource source;
+    // lo on Linux, Loopback Pseudo-Interface 1 on Windows
+    constexpr uint32_t kLoopbackIndex = 1;
+    InterfaceCounters counters;
+    if (!source.read(kLoopbackIndex, counters)) {
+        state.skip("loopback counters not readable");
+        return;
+    }
+    while (state.keepRunning()) {
+        source.read(kLoopbackIndex, counters);
+    }
+    doNotOptimize(counters.bytesIn);
+}
+BENCHMARK(BM_SystemCounterSourceRead);
+
+// What a status call costs now: a copy of the sampler's latest snapshot
+void BM_StatsSnapshotLoad(State& state) {
+    SeqLock<StatsSample> latest(sampleStats());
+    while (state.keepRunning()) {
+        doNotOptimize(latest.load());
+    }
+}
+BENCHMARK(BM_StatsSnapshotLoad);
+
+// The same while another thread publishes as fast as it can, far more often
+// than the sampler's once a second; every copy must be one whole sample
+void BM_StatsSnapshotLoadContended(State& state) {
+    SeqLock<StatsSample> latest(sampleStats());
+    std::atomic<bool> stop{false};
+    std::thread writer([&latest, &stop] {
+        StatsSample sample = sampleStats();
+        while (!stop.load(std::memory_order_relaxed)) {
+            sample.counters.bytesIn++;
+            sample.counters.bytesOut = sample.counters.bytesIn;
+            latest.store(sample);
+        }
+    });
+    uint64_t torn = 0;
+    while (state.keepRunning()) {
+        StatsSample sample = latest.load();
+        torn += sample.counters.bytesIn != sample.counters.bytesOut && sample.counters.bytesIn != 1234567890;
+    }
+    stop = true;
+    writer.join();
+    if (torn != 0) {
+        std::fprintf(stderr, "BM_StatsSnapshotLoadContended: %" PRIu64 " torn reads\n", torn);
+    }
+}
+BENCHMARK(BM_StatsSnapshotLoadContended);
+
+} // namespace
+
+} // namespace bench
+} // namespace openvpn_flutter
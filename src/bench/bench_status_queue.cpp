@@ -0,0 +1,134 @@
+#include "bench.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "status_queue.h"
+#include "vpn_stage.h"
+
+namespace openvpn_flutter {
+namespace bench {
+
+namespace {
+
+// The queue StatusQueue replaced: every push and drain takes one mutex, and
+// the consumer delivers while holding it
+class MutexStatusQueue {
+private:
+    std::mutex mutex;
+    std::deque<StageEvent> pending;
+
+public:
+    bool push(const StageEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(event);
+        return true;
+    }
+
+    void drain(const std::function<void(const StageEvent&)>& deliver) {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!pending.empty()) {
+            deliver(pending.front());
+            pending.pop_front();
+        }
+    }
+};
+
+// The monitor thread (this one) pushes stage changes while the platform
+// thread drains all the time, the worst case for contention
+template <typename Queue>
+void runContended(State& state, Queue& queue) {
+    std::atomic<bool> stop{false};
+    size_t delivered = 0;
+    std::thread consumer([&queue, &stop, &delivered]() {
+        auto count = [&delivered](const StageEvent&) { delivered++; };
+        while (!stop.load(std::memory_order_acquire)) {
+            queue.drain(count);
+        }
+        queue.drain(count);
+    });
+
+    StageEvent events[2] = {makeStageEvent(VpnStage::Connecting), makeStageEvent(VpnStage::Connected)};
+    size_t i = 0;
+    while (state.keepRunning()) {
+        doNotOptimize(queue.push(events[i++ & 1]));
+    }
+    stop.store(true, std::memory_order_release);
+    consumer.join();
+    doNotOptimize(delivered);
+}
+
+// One stage change travelling from the monitor thread to the platform thread
+void BM_StatusQueuePushDrain(State& state) {
+    StatusQueue queue;
+    int wakes = 0;
+    queue.setWakeCallback([&wakes]() { wakes++; });
+    StageEvent events[2] = {makeStageEvent(VpnStage::Connecting), makeStageEvent(VpnStage::Connected)};
+    size_t delivered = 0;
+    size_t i = 0;
+    while (state.keepRunning()) {
+        queue.push(events[i++ & 1]);
+        queue.drain([&delivered](const StageEvent&) { delivered++; });
+    }
+    doNotOptimize(delivered);
+    doNotOptimize(wakes);
+}
+BENCHMARK(BM_StatusQueuePushDrain);
+
+void BM_MutexQueuePushDrain(State& state) {
+    MutexStatusQueue queue;
+    StageEvent events[2] = {makeStageEvent(VpnStage::Connecting), makeStageEvent(VpnStage::Connected)};
+    size_t delivered = 0;
+    size_t i = 0;
+    while (state.keepRunning()) {
+        queue.push(events[i++ & 1]);
+        queue.drain([&delivered](const StageEvent&) { delivered++; });
+    }
+    doNotOptimize(delivered);
+}
+BENCHMARK(BM_MutexQueuePushDrain);
+
+void BM_StatusQueueContended(State& state) {
+    StatusQueue queue;
+    queue.setWakeCallback([]() {});
+    runContended(state, queue);
+}
+BENCHMARK(BM_StatusQueueContended);
+
+void BM_MutexQueueContended(State& state) {
+    MutexStatusQueue queue;
+    runContended(state, queue);
+}
+BENCHMARK(BM_MutexQueueContended);
+
+// A repeated stage is dropped on the producer side
+void BM_StatusQueuePushDuplicate(State& state) {
+    StatusQueue queue;
+    queue.setWakeCallback([]() {});
+    StageEvent event = makeStageEvent(VpnStage::Connected);
+    queue.push(event);
+    while (state.keepRunning()) {
+        doNotOptimize(queue.push(event));
+    }
+}
+BENCHMARK(BM_StatusQueuePushDuplicate);
+
+void BM_SpscRingPushPop(State& state) {
+    SpscRing<StageEvent, 64> ring;
+    StageEvent event = makeStageEvent(VpnStage::AssignIp);
+    StageEvent out;
+    while (state.keepRunning()) {
+        ring.push(event);
+        ring.pop(out);
+        doNotOptimize(out);
+    }
+}
+BENCHMARK(BM_SpscRingPushPop);
+
+} // namespace
+
+} // namespace bench
+} // namespace openvpn_flutter
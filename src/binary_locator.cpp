@@ -0,0 +1,211 @@
+#include "binary_locator.h"
+#include "logger.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr const char* kManifestMagic = "openvpn_flutter-binaries";
+
+} // namespace
+
+BinaryLocator::BinaryLocator(std::string baseDirectory, std::string manifestPath)
+    : baseDirectory(std::move(baseDirectory)), manifestPath(std::move(manifestPath)) {
+}
+
+BinaryLocator::~BinaryLocator() {
+    if (revalidationThread.joinable()) {
+        revalidationThread.join();
+    }
+}
+
+void BinaryLocator::setSearchDirectories(std::vector<std::string> directories) {
+    std::lock_guard<std::mutex> lock(mutex);
+    defaultDirectories = std::move(directories);
+}
+
+void BinaryLocator::setSearchDirectories(const std::string& filename, std::vector<std::string> directories) {
+    std::lock_guard<std::mutex> lock(mutex);
+    fileDirectories[filename] = std::move(directories);
+}
+
+bool BinaryLocator::statFile(const std::string& path, uint64_t& size, int64_t& mtime) {
+    std::error_code ec;
+    std::filesystem::path file(path);
+    if (!std::filesystem::is_regular_file(file, ec) || ec) {
+        return false;
+    }
+    size = std::filesystem::file_size(file, ec);
+    if (ec) {
+        return false;
+    }
+    auto written = std::filesystem::last_write_time(file, ec);
+    if (ec) {
+        return false;
+    }
+    mtime = static_cast<int64_t>(written.time_since_epoch().count());
+    return true;
+}
+
+std::string BinaryLocator::locate(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded) {
+        loadManifest();
+    }
+
+    auto it = entries.find(filename);
+    if (it != entries.end()) {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if (statFile(it->second.path, size, mtime)) {
+            if (size != it->second.size || mtime != it->second.mtime) {
+                // Same location, file was updated in place
+                it->second.size = size;
+                it->second.mtime = mtime;
+                saveManifest();
+            }
+            return it->second.path;
+        }
+
+        // Recorded path is gone; the bundle may have moved, so check the rest too
+        LOG_INFO("Bundled " << filename << " moved from " << it->second.path << ", searching again");
+        entries.erase(it);
+        if (!revalidating.exchange(true)) {
+            if (revalidationThread.joinable()) {
+                revalidationThread.join();
+            }
+            revalidationThread = std::thread(&BinaryLocator::revalidate, this);
+        }
+    }
+
+    Entry entry;
+    std::string path = probe(filename, entry);
+    if (!path.empty()) {
+        entries[filename] = entry;
+        saveManifest();
+    }
+    return path;
+}
+
+std::string BinaryLocator::probe(const std::string& filename, Entry& entry) {
+    auto custom = fileDirectories.find(filename);
+    const std::vector<std::string>& directories =
+        custom != fileDirectories.end() ? custom->second : defaultDirectories;
+
+    for (const std::string& directory : directories) {
+        std::string candidate = (std::filesystem::path(directory) / filename).string();
+        if (statFile(candidate, entry.size, entry.mtime)) {
+            LOG_DEBUG("Found " << filename << " at: " << candidate);
+            entry.path = candidate;
+            return candidate;
+        }
+    }
+
+    LOG_WARN(filename << " not found in any expected location");
+    return "";
+}
+
+void BinaryLocator::revalidate() {
+    std::vector<std::string> stale;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [filename, entry] : entries) {
+            uint64_t size = 0;
+            int64_t mtime = 0;
+            if (!statFile(entry.path, size, mtime) || size != entry.size || mtime != entry.mtime) {
+                stale.push_back(filename);
+            }
+        }
+    }
+
+    // Re-lock per file so locate() is never held up for the whole pass
+    for (const std::string& filename : stale) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry entry;
+        if (probe(filename, entry).empty()) {
+            entries.erase(filename);
+        } else {
+            entries[filename] = entry;
+        }
+    }
+
+    if (!stale.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        saveManifest();
+    }
+    revalidating = false;
+}
+
+void BinaryLocator::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    loaded = true;
+    std::error_code ec;
+    std::filesystem::remove(manifestPath, ec);
+}
+
+void BinaryLocator::loadManifest() {
+    loaded = true;
+    std::ifstream in(manifestPath, std::ios::binary);
+    if (!in) {
+        return;
+    }
+
+    std::string magic;
+    int version = 0;
+    std::string header;
+    if (!std::getline(in, header)) {
+        return;
+    }
+    std::istringstream headerStream(header);
+    headerStream >> magic >> version;
+    if (magic != kManifestMagic || version != kManifestVersion) {
+        return;
+    }
+
+    // Entries are only meaningful for the directory they were resolved from
+    std::string base;
+    if (!std::getline(in, base) || base != baseDirectory) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        // filename \t size \t mtime \t path
+        size_t first = line.find('\t');
+        size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+        size_t third = second == std::string::npos ? second : line.find('\t', second + 1);
+        if (third == std::string::npos) {
+            continue;
+        }
+        Entry entry;
+        try {
+            entry.size = std::stoull(line.substr(first + 1, second - first - 1));
+            entry.mtime = std::stoll(line.substr(second + 1, third - second - 1));
+        } catch (const std::exception&) {
+            continue;
+        }
+        entry.path = line.substr(third + 1);
+        entries[line.substr(0, first)] = std::move(entry);
+    }
+}
+
+void BinaryLocator::saveManifest() {
+    // Best effort; without a writable app directory lookups just stay in memory
+    std::ofstream out(manifestPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return;
+    }
+    out << kManifestMagic << ' ' << kManifestVersion << '\n' << baseDirectory << '\n';
+    for (const auto& [filename, entry] : entries) {
+        out << filename << '\t' << entry.size << '\t' << entry.mtime << '\t' << entry.path << '\n';
+    }
+}
+
+} // namespace openvpn_flutter
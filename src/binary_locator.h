@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace openvpn_flutter {
+
+// Resolves bundled binaries (openvpn.exe, tapctl.exe, wintun.dll, ...) once and
+// remembers where they were found in a small manifest next to the app, keyed
+// by file name and validated by size and modification time.
+//
+// A lookup is a map hit plus one stat of the recorded path. The candidate
+// directories are only probed for files not in the manifest, or when the
+// recorded path disappeared; in that case the other entries are re-validated
+// on a background thread so the next lookups are O(1) again.
+class BinaryLocator {
+private:
+    struct Entry {
+        std::string path;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    std::string baseDirectory;  // Manifest is only valid for this directory
+    std::string manifestPath;
+
+    std::mutex mutex;
+    bool loaded = false;
+    std::unordered_map<std::string, Entry> entries;
+    std::vector<std::string> defaultDirectories;
+    std::unordered_map<std::string, std::vector<std::string>> fileDirectories;
+
+    std::thread revalidationThread;
+    std::atomic<bool> revalidating{false};
+
+    void loadManifest();  // mutex held
+    void saveManifest();  // mutex held
+    std::string probe(const std::string& filename, Entry& entry);  // mutex held
+    void revalidate();
+
+    static bool statFile(const std::string& path, uint64_t& size, int64_t& mtime);
+
+public:
+    static constexpr int kManifestVersion = 1;
+
+    BinaryLocator(std::string baseDirectory, std::string manifestPath);
+    ~BinaryLocator();
+
+    BinaryLocator(const BinaryLocator&) = delete;
+    BinaryLocator& operator=(const BinaryLocator&) = delete;
+
+    // Directories probed in order, for every file or for one specific file
+    void setSearchDirectories(std::vector<std::string> directories);
+    void setSearchDirectories(const std::string& filename, std::vector<std::string> directories);
+
+    // Full path of filename, or empty if it is not in any search directory
+    std::string locate(const std::string& filename);
+    // Forget everything and delete the manifest
+    void clear();
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,50 @@
+#include "command_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace openvpn_flutter {
+
+void CommandExecutor::forget(const std::shared_ptr<CancellationToken>& token) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                 [&token](const Pending& entry) { return entry.token == token; }),
+                  pending.end());
+}
+
+bool CommandExecutor::submit(const std::string& name, Command command) {
+    auto token = std::make_shared<CancellationToken>();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(Pending{name, token});
+    }
+
+    bool queued = worker.submit([this, token, command = std::move(command)]() {
+        command(*token);
+        forget(token);
+    });
+    if (!queued) {
+        forget(token);
+    }
+    return queued;
+}
+
+size_t CommandExecutor::cancel(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const Pending& entry : pending) {
+        if (entry.name == name && !entry.token->isCancelled()) {
+            entry.token->cancel();
+            ++count;
+        }
+    }
+    return count;
+}
+
+void CommandExecutor::shutdown() {
+    worker.shutdown();
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.clear();
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "worker_pool.h"
+
+namespace openvpn_flutter {
+
+// Set by whoever supersedes a command; the command polls it between steps
+class CancellationToken {
+private:
+    std::atomic<bool> cancelled{false};
+
+public:
+    void cancel() { cancelled.store(true, std::memory_order_release); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_acquire); }
+};
+
+// Runs VPN commands (connect, disconnect, ...) one at a time, in submission
+// order, on a thread of its own. A command that is cancelled still runs so it
+// can complete its method result; it is expected to check its token and bail
+// out early.
+class CommandExecutor {
+private:
+    struct Pending {
+        std::string name;
+        std::shared_ptr<CancellationToken> token;
+    };
+
+    std::mutex mutex;
+    std::vector<Pending> pending; // Queued or running
+    WorkerPool worker{1};
+
+    void forget(const std::shared_ptr<CancellationToken>& token);
+
+public:
+    using Command = std::function<void(const CancellationToken& cancel)>;
+
+    // Queue a command; returns false once the executor is shut down
+    bool submit(const std::string& name, Command command);
+
+    // Cancel every queued or running command with this name; returns how many
+    size_t cancel(const std::string& name);
+
+    // Drop queued commands and wait for the running one
+    void shutdown();
+};
+
+} // namespace openvpn_flutter
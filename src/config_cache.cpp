@@ -0,0 +1,91 @@
+#include "config_cache.h"
+
+#include <cstring>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr uint64_t kSeed = 0x9E3779B97F4A7C15ull;
+constexpr uint64_t kMultiplier = 0xFF51AFD7ED558CCDull;
+
+uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Word-at-a-time mixing hash. Not cryptographic; it only has to tell
+// profiles apart quickly, even when they are several megabytes long.
+uint64_t mix(uint64_t h, std::string_view data) {
+    const char* p = data.data();
+    size_t remaining = data.size();
+    while (remaining >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        h = rotl(h ^ (word * kMultiplier), 29) * kSeed;
+        p += 8;
+        remaining -= 8;
+    }
+    uint64_t tail = 0;
+    if (remaining > 0) {
+        std::memcpy(&tail, p, remaining);
+    }
+    h = rotl(h ^ (tail * kMultiplier), 29) * kSeed;
+    // Length separates fields so ("ab", "c") and ("a", "bc") differ
+    return h ^ static_cast<uint64_t>(data.size());
+}
+
+} // namespace
+
+uint64_t ConfigCache::makeKey(std::string_view config,
+                              int driver,
+                              int ruleVersion,
+                              bool queryCredentials,
+                              std::string_view resolvedRemotes) {
+    uint64_t h = kSeed ^ (static_cast<uint64_t>(driver) << 32) ^ static_cast<uint64_t>(ruleVersion);
+    h ^= queryCredentials ? kMultiplier : 0;
+    h = mix(h, config);
+    h = mix(h, resolvedRemotes);
+    return finalize(h);
+}
+
+std::shared_ptr<const std::string> ConfigCache::lookup(uint64_t cacheKey) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!output || key != cacheKey) {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    return output;
+}
+
+void ConfigCache::store(uint64_t cacheKey, std::shared_ptr<const std::string> rewritten) {
+    std::lock_guard<std::mutex> lock(mutex);
+    key = cacheKey;
+    output = std::move(rewritten);
+}
+
+void ConfigCache::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    key = 0;
+    output.reset();
+}
+
+uint64_t ConfigCache::getHits() const {
+    return hits.load();
+}
+
+uint64_t ConfigCache::getMisses() const {
+    return misses.load();
+}
+
+} // namespace openvpn_flutter
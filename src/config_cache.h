@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace openvpn_flutter {
+
+// Remembers the last rewritten profile so that reconnecting with the same
+// config, driver, rule version and resolved remotes hands openvpn the same
+// bytes again instead of parsing and rewriting the profile. Nothing is kept on
+// disk and credentials are not part of the profile.
+class ConfigCache {
+private:
+    mutable std::mutex mutex;
+    uint64_t key = 0;
+    std::shared_ptr<const std::string> output;  // Exact bytes given to openvpn
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+public:
+    // Fast 64-bit content hash over all inputs that affect the written profile
+    static uint64_t makeKey(std::string_view config,
+                            int driver,
+                            int ruleVersion,
+                            bool queryCredentials,
+                            std::string_view resolvedRemotes = {});
+
+    // The cached profile if `cacheKey` matches the stored entry, nullptr
+    // otherwise. Counts a hit or a miss.
+    std::shared_ptr<const std::string> lookup(uint64_t cacheKey);
+    void store(uint64_t cacheKey, std::shared_ptr<const std::string> rewritten);
+    void invalidate();
+
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,422 @@
+#include "config_rewriter.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+// A matched line and the rule that applies to it
+struct LineEdit {
+    size_t begin;  // Offset of the line in the config
+    size_t end;    // Offset just past the line terminator
+    std::string_view eol;
+    size_t rule;
+    std::string text{};  // Replacement produced by a Transform rule
+};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f';
+}
+
+bool startsWith(std::string_view value, std::string_view prefix) {
+    return value.size() >= prefix.size() && value.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Scan the profile once and collect the lines that need an edit.
+// InsertAfter rules are resolved here so that the emit pass never looks back.
+template <typename MatchFn>
+std::vector<LineEdit> planEdits(std::string_view config,
+                                const std::vector<RewriteRule>& rules,
+                                MatchFn matchRule,
+                                RewriteResult& result) {
+    std::vector<LineEdit> edits;
+    std::vector<size_t> firstAnchor(rules.size(), std::string_view::npos);
+    std::vector<bool> present(rules.size(), false);
+    std::string_view openBlock;
+
+    size_t pos = 0;
+    while (pos < config.size()) {
+        size_t newline = config.find('\n', pos);
+        size_t lineEnd = newline == std::string_view::npos ? config.size() : newline;
+        size_t next = newline == std::string_view::npos ? config.size() : newline + 1;
+        size_t textEnd = lineEnd;
+        if (textEnd > pos && config[textEnd - 1] == '\r') {
+            textEnd--;
+        }
+
+        ConfigLine line = ConfigRewriter::tokenizeLine(config.substr(pos, textEnd - pos), openBlock);
+        result.lines++;
+
+        if (line.kind == ConfigLine::Kind::Directive) {
+            int ruleIndex = matchRule(line);
+            if (ruleIndex >= 0) {
+                size_t index = static_cast<size_t>(ruleIndex);
+                if (rules[index].action == RewriteAction::Keep) {
+                    present[index] = true;
+                } else if (rules[index].action == RewriteAction::InsertAfter) {
+                    present[index] = true;
+                    if (firstAnchor[index] == std::string_view::npos) {
+                        firstAnchor[index] = edits.size();
+                        edits.push_back({pos, next, config.substr(textEnd, next - textEnd), index});
+                    } else if (rules[index].group == 0) {
+                        edits.push_back({pos, next, config.substr(textEnd, next - textEnd), index});
+                    }
+                } else if (rules[index].action == RewriteAction::Transform) {
+                    std::string text;
+                    if (rules[index].transform && rules[index].transform(line, text)) {
+                        edits.push_back({pos, next, config.substr(textEnd, next - textEnd), index, std::move(text)});
+                    }
+                } else {
+                    edits.push_back({pos, next, config.substr(textEnd, next - textEnd), index});
+                }
+            }
+        }
+        pos = next;
+    }
+
+    // Within a group only the earliest listed rule that is present applies
+    std::vector<bool> keep(edits.size(), true);
+    std::vector<size_t> prepends;
+    std::map<int, size_t> winners;
+    for (size_t i = 0; i < rules.size(); i++) {
+        const RewriteRule& rule = rules[i];
+        bool counts = rule.action == RewriteAction::Prepend || present[i];
+        if (!counts) {
+            continue;
+        }
+        if (rule.group != 0 && !winners.emplace(rule.group, i).second) {
+            if (firstAnchor[i] != std::string_view::npos) {
+                keep[firstAnchor[i]] = false;
+            }
+            continue;
+        }
+        if (rule.action == RewriteAction::Prepend) {
+            prepends.push_back(i);
+        }
+    }
+
+    std::vector<LineEdit> planned;
+    planned.reserve(prepends.size() + edits.size());
+    for (size_t rule : prepends) {
+        planned.push_back({0, 0, std::string_view(), rule});
+    }
+    for (size_t i = 0; i < edits.size(); i++) {
+        if (keep[i]) {
+            planned.push_back(std::move(edits[i]));
+        }
+    }
+    return planned;
+}
+
+// Write the original buffer with the planned edits applied. Untouched lines are
+// copied as contiguous spans, so a profile without edits is a single write.
+template <typename Sink>
+void emitEdits(std::string_view config,
+               const std::vector<RewriteRule>& rules,
+               const std::vector<LineEdit>& edits,
+               Sink& sink,
+               RewriteResult& result) {
+    // Added lines end the way the profile's first line does
+    size_t firstNewline = config.find('\n');
+    std::string_view newline = firstNewline != std::string_view::npos && firstNewline > 0 &&
+                                       config[firstNewline - 1] == '\r'
+                                   ? std::string_view("\r\n")
+                                   : std::string_view("\n");
+
+    size_t cursor = 0;
+    for (const auto& edit : edits) {
+        const RewriteRule& rule = rules[edit.rule];
+        std::string_view eol = edit.eol.empty() ? newline : edit.eol;
+
+        switch (rule.action) {
+            case RewriteAction::Drop:
+                sink(config.substr(cursor, edit.begin - cursor));
+                result.dropped++;
+                break;
+            case RewriteAction::Replace:
+                sink(config.substr(cursor, edit.begin - cursor));
+                sink(rule.text);
+                sink(edit.eol);
+                result.replaced++;
+                break;
+            case RewriteAction::InsertAfter:
+                sink(config.substr(cursor, edit.end - cursor));
+                if (edit.eol.empty()) {
+                    sink(eol);
+                }
+                sink(rule.text);
+                sink(edit.eol);
+                result.inserted++;
+                break;
+            case RewriteAction::Transform:
+                sink(config.substr(cursor, edit.begin - cursor));
+                sink(edit.text);
+                sink(edit.eol);
+                result.replaced++;
+                break;
+            case RewriteAction::Prepend:
+                sink(rule.text);
+                sink(newline);
+                result.inserted++;
+                break;
+            case RewriteAction::Keep:
+                break;
+        }
+        cursor = edit.end;
+    }
+    sink(config.substr(cursor));
+}
+
+// Dotted quad or anything with a ':' (IPv6); neither needs resolving
+bool isAddressLiteral(std::string_view host) {
+    if (host.find(':') != std::string_view::npos) {
+        return true;
+    }
+    return !host.empty() && std::all_of(host.begin(), host.end(), [](char c) {
+        return (c >= '0' && c <= '9') || c == '.';
+    });
+}
+
+} // namespace
+
+ConfigRewriter::ConfigRewriter(std::vector<RewriteRule> rules) : rules(std::move(rules)) {}
+
+void ConfigRewriter::addRule(RewriteRule rule) {
+    rules.push_back(std::move(rule));
+}
+
+const std::vector<RewriteRule>& ConfigRewriter::getRules() const {
+    return rules;
+}
+
+bool ConfigRewriter::write(std::string_view config, std::ostream& out, RewriteResult* result) const {
+    RewriteResult local;
+    RewriteResult& stats = result ? *result : local;
+    stats = RewriteResult{};
+
+    auto edits = planEdits(config, rules, [this](const ConfigLine& line) { return matchRule(line); }, stats);
+    auto sink = [&out](std::string_view chunk) {
+        if (!chunk.empty()) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        }
+    };
+    emitEdits(config, rules, edits, sink, stats);
+    return static_cast<bool>(out);
+}
+
+std::string ConfigRewriter::rewrite(std::string_view config, RewriteResult* result) const {
+    RewriteResult local;
+    RewriteResult& stats = result ? *result : local;
+    stats = RewriteResult{};
+
+    auto edits = planEdits(config, rules, [this](const ConfigLine& line) { return matchRule(line); }, stats);
+
+    std::string output;
+    output.reserve(config.size() + 64);
+    auto sink = [&output](std::string_view chunk) { output.append(chunk.data(), chunk.size()); };
+    emitEdits(config, rules, edits, sink, stats);
+    return output;
+}
+
+ConfigLine ConfigRewriter::tokenizeLine(std::string_view text, std::string_view& openBlock) {
+    ConfigLine line;
+    line.text = text;
+
+    size_t pos = 0;
+    while (pos < text.size() && isSpace(text[pos])) {
+        pos++;
+    }
+    std::string_view trimmed = text.substr(pos);
+
+    // Inside an inline block only the closing tag is meaningful
+    if (!openBlock.empty()) {
+        if (startsWith(trimmed, "</") && trimmed.size() >= openBlock.size() + 3 &&
+            trimmed.compare(2, openBlock.size(), openBlock) == 0 && trimmed[openBlock.size() + 2] == '>') {
+            line.kind = ConfigLine::Kind::BlockEnd;
+            line.name = openBlock;
+            openBlock = std::string_view();
+        } else {
+            line.kind = ConfigLine::Kind::BlockBody;
+        }
+        return line;
+    }
+
+    if (trimmed.empty()) {
+        line.kind = ConfigLine::Kind::Blank;
+        return line;
+    }
+
+    if (trimmed[0] == '#' || trimmed[0] == ';') {
+        line.kind = ConfigLine::Kind::Comment;
+        return line;
+    }
+
+    if (trimmed[0] == '<') {
+        size_t close = trimmed.find('>');
+        if (close != std::string_view::npos && close > 1 && trimmed[1] != '/') {
+            line.kind = ConfigLine::Kind::BlockStart;
+            line.name = trimmed.substr(1, close - 1);
+            openBlock = line.name;
+            return line;
+        }
+    }
+
+    // Directive: keyword followed by arguments. Quoted arguments may contain
+    // whitespace, and an unquoted '#' or ';' starting a token begins a comment.
+    line.kind = ConfigLine::Kind::Directive;
+    bool haveName = false;
+    while (pos < text.size()) {
+        while (pos < text.size() && isSpace(text[pos])) {
+            pos++;
+        }
+        if (pos >= text.size() || text[pos] == '#' || text[pos] == ';') {
+            break;
+        }
+
+        std::string_view token;
+        char quote = text[pos];
+        if (quote == '"' || quote == '\'') {
+            size_t start = ++pos;
+            while (pos < text.size() && text[pos] != quote) {
+                if (quote == '"' && text[pos] == '\\' && pos + 1 < text.size()) {
+                    pos++;
+                }
+                pos++;
+            }
+            token = text.substr(start, pos - start);
+            if (pos < text.size()) {
+                pos++;  // Closing quote
+            }
+        } else {
+            size_t start = pos;
+            while (pos < text.size() && !isSpace(text[pos])) {
+                pos++;
+            }
+            token = text.substr(start, pos - start);
+        }
+
+        if (!haveName) {
+            line.name = token;
+            haveName = true;
+        } else if (line.argCount < ConfigLine::kMaxArgs) {
+            line.args[line.argCount++] = token;
+        }
+    }
+    return line;
+}
+
+int ConfigRewriter::matchRule(const ConfigLine& line) const {
+    for (size_t i = 0; i < rules.size(); i++) {
+        const RewriteRule& rule = rules[i];
+        if (rule.action == RewriteAction::Prepend || line.name != rule.directive) {
+            continue;
+        }
+        if (!rule.argPrefix.empty() &&
+            (line.argCount == 0 || !startsWith(line.args[0], rule.argPrefix))) {
+            continue;
+        }
+        return static_cast<int>(i);
+    }
+    return -1;
+}
+
+std::vector<RewriteRule> ConfigRewriter::baseRules() {
+    return {
+        // Deprecated option rejected by OpenVPN 2.6
+        {RewriteAction::Drop, "client-cert-not-required", "", ""},
+    };
+}
+
+std::vector<RewriteRule> ConfigRewriter::wintunRules() {
+    auto rules = baseRules();
+    rules.insert(rules.end(), {
+        // 'windows-driver wintun' is REQUIRED for OpenVPN 2.6.14+ WinTun; one
+        // the profile has already stays where it is
+        {RewriteAction::Keep, "windows-driver", "wintun", "", 1},
+        // dev/dev-type are given on the command line, another 'windows-driver'
+        // is replaced by ours and 'persist-tun' may conflict with WinTun
+        {RewriteAction::Drop, "dev", "tap", ""},
+        {RewriteAction::Drop, "dev-type", "", ""},
+        {RewriteAction::Drop, "windows-driver", "", ""},
+        {RewriteAction::Drop, "persist-tun", "", ""},
+        {RewriteAction::InsertAfter, "dev", "tun", "windows-driver wintun", 1},
+        {RewriteAction::InsertAfter, "remote", "", "windows-driver wintun", 1},
+        // <connection> bodies are never matched, so a profile whose remotes
+        // are all in blocks gets it at the top
+        {RewriteAction::Prepend, "", "", "windows-driver wintun", 1},
+    });
+    return rules;
+}
+
+std::vector<RewriteRule> ConfigRewriter::tunRules() {
+    auto rules = baseRules();
+    rules.insert(rules.end(), {
+        // The device is created by name on the command line (--dev, --dev-type)
+        {RewriteAction::Drop, "dev", "", ""},
+        {RewriteAction::Drop, "dev-type", "", ""},
+        {RewriteAction::Drop, "dev-node", "", ""},
+        {RewriteAction::Drop, "windows-driver", "", ""},
+    });
+    return rules;
+}
+
+std::vector<std::string> ConfigRewriter::remoteHosts(std::string_view config) {
+    std::vector<std::string> hosts;
+    std::string_view openBlock;
+    size_t pos = 0;
+    while (pos < config.size()) {
+        size_t newline = config.find('\n', pos);
+        size_t lineEnd = newline == std::string_view::npos ? config.size() : newline;
+        size_t next = newline == std::string_view::npos ? config.size() : newline + 1;
+        if (lineEnd > pos && config[lineEnd - 1] == '\r') {
+            lineEnd--;
+        }
+        ConfigLine line = tokenizeLine(config.substr(pos, lineEnd - pos), openBlock);
+        pos = next;
+        if (line.kind != ConfigLine::Kind::Directive) {
+            continue;
+        }
+
+        // The name is resolved by the proxy or randomized per attempt
+        if (line.name == "http-proxy" || line.name == "socks-proxy" || line.name == "remote-random-hostname") {
+            return {};
+        }
+        if (line.name != "remote" || line.argCount == 0 || isAddressLiteral(line.args[0])) {
+            continue;
+        }
+        std::string host(line.args[0]);
+        if (std::find(hosts.begin(), hosts.end(), host) == hosts.end()) {
+            hosts.push_back(std::move(host));
+        }
+    }
+    return hosts;
+}
+
+RewriteRule ConfigRewriter::resolvedRemoteRule(std::map<std::string, std::vector<std::string>> addresses) {
+    RewriteRule rule{RewriteAction::Transform, "remote", "", ""};
+    rule.transform = [addresses = std::move(addresses)](const ConfigLine& line, std::string& text) {
+        if (line.argCount == 0) {
+            return false;
+        }
+        auto it = addresses.find(std::string(line.args[0]));
+        if (it == addresses.end() || it->second.empty()) {
+            return false;
+        }
+        // Port and protocol stay as they were, the address replaces the name
+        std::string rest;
+        for (size_t i = 1; i < line.argCount; i++) {
+            rest += ' ';
+            rest.append(line.args[i].data(), line.args[i].size());
+        }
+        for (const auto& address : it->second) {
+            text += "remote " + address + rest + "\n";
+        }
+        text.append(line.text.data(), line.text.size());
+        return true;
+    };
+    return rule;
+}
+
+} // namespace openvpn_flutter
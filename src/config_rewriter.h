@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace openvpn_flutter {
+
+// What the rewriter does with a directive line that matches a rule
+enum class RewriteAction {
+    Drop,        // Remove the line
+    Replace,     // Replace the line with the rule text
+    InsertAfter, // Keep the line and add the rule text right after it
+    Transform,   // Replace the line with what `transform` produces, if it does
+    Keep,        // Leave the line as is; it only counts as present for its group
+    Prepend      // Add the rule text before the first line; matches no line
+};
+
+struct ConfigLine;
+
+// Declarative rewrite rule. A rule matches a directive line when the keyword
+// is equal to `directive` and (if set) the first argument starts with `argPrefix`.
+struct RewriteRule {
+    RewriteAction action;
+    std::string directive;
+    std::string argPrefix;
+    std::string text;
+    // Of the InsertAfter, Keep and Prepend rules sharing a non-zero group only
+    // the earliest listed one present in the profile applies (a Prepend rule
+    // always is), so the group's text goes in at most once: after that rule's
+    // anchor, at the top, or not at all when a Keep rule found it already there.
+    int group = 0;
+    // Transform rules only: fill `text` and return true to replace the line,
+    // return false to keep it as is
+    std::function<bool(const ConfigLine& line, std::string& text)> transform = nullptr;
+};
+
+// A tokenized profile line. Views point into the original config buffer.
+struct ConfigLine {
+    enum class Kind {
+        Blank,
+        Comment,
+        Directive,
+        BlockStart,
+        BlockBody,
+        BlockEnd
+    };
+
+    static constexpr size_t kMaxArgs = 4;
+
+    Kind kind = Kind::Blank;
+    std::string_view text;  // Full line without the terminator
+    std::string_view eol;   // "\n", "\r\n" or empty for the last line
+    std::string_view name;  // Directive keyword or inline block tag
+    std::array<std::string_view, kMaxArgs> args{};
+    size_t argCount = 0;
+};
+
+// Counters describing what a rewrite did, for logging
+struct RewriteResult {
+    size_t lines = 0;
+    size_t dropped = 0;
+    size_t replaced = 0;
+    size_t inserted = 0;
+};
+
+// Directive-aware OpenVPN profile rewriter.
+//
+// The profile is tokenized in a single pass (comments, quoted arguments and
+// inline <tag>...</tag> blocks are understood, block bodies are never matched),
+// then written to the output stream as contiguous spans of the original buffer.
+// Nothing is erased or shifted in place, so the cost is linear in the profile size.
+class ConfigRewriter {
+private:
+    std::vector<RewriteRule> rules;
+
+public:
+    // Bump whenever the built-in rule sets below change meaning
+    static constexpr int kRuleVersion = 2;
+
+    ConfigRewriter() = default;
+    explicit ConfigRewriter(std::vector<RewriteRule> rules);
+
+    void addRule(RewriteRule rule);
+    const std::vector<RewriteRule>& getRules() const;
+
+    // Rewrite `config` into `out`. Returns false if the stream failed.
+    bool write(std::string_view config, std::ostream& out, RewriteResult* result = nullptr) const;
+    std::string rewrite(std::string_view config, RewriteResult* result = nullptr) const;
+
+    // Tokenize a single line (without terminator). `openBlock` carries the
+    // inline block state between consecutive calls.
+    static ConfigLine tokenizeLine(std::string_view text, std::string_view& openBlock);
+
+    // Rules applied to every profile
+    static std::vector<RewriteRule> baseRules();
+    // Rules for the WinTun driver: 'dev tap', 'dev-type', 'persist-tun' and any
+    // other 'windows-driver' are dropped. Unless the profile has 'windows-driver
+    // wintun' already, it is inserted after 'dev tun', else after the first
+    // top-level 'remote', else at the top (profiles with <connection> blocks only)
+    static std::vector<RewriteRule> wintunRules();
+    // Rules for a Linux tun device named on the command line: 'dev',
+    // 'dev-type', 'dev-node' and 'windows-driver' are dropped
+    static std::vector<RewriteRule> tunRules();
+
+    // Host names of the top-level 'remote' lines worth resolving ahead of
+    // openvpn, without duplicates and IP literals. Empty when the profile
+    // leaves resolution to openvpn on purpose (proxies, remote-random-hostname).
+    static std::vector<std::string> remoteHosts(std::string_view config);
+    // Expands 'remote <host> [port] [proto]' into one line per resolved address,
+    // followed by the original line so openvpn can still fall back to the name
+    static RewriteRule resolvedRemoteRule(std::map<std::string, std::vector<std::string>> addresses);
+
+private:
+    int matchRule(const ConfigLine& line) const;
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,28 @@
+#include "connection_stats.h"
+
+namespace openvpn_flutter {
+
+bool statsChanged(const StatsSample& previous, const StatsSample& current) {
+    return previous.active != current.active ||
+           previous.connectedOnMs != current.connectedOnMs ||
+           previous.speedIn != current.speedIn ||
+           previous.speedOut != current.speedOut ||
+           previous.counters != current.counters;
+}
+
+void measureInterval(const StatsSample& previous, StatsSample& current) {
+    if (!current.active) {
+        current.interval = InterfaceCounters{};
+        current.intervalMs = 0;
+        return;
+    }
+    if (!previous.active || previous.connectedOnMs != current.connectedOnMs) {
+        current.interval = current.counters;
+        current.intervalMs = current.sampledAtMs - current.connectedOnMs;
+        return;
+    }
+    current.interval = countersDelta(previous.counters, current.counters);
+    current.intervalMs = current.sampledAtMs - previous.sampledAtMs;
+}
+
+} // namespace openvpn_flutter
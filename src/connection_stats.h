@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "interface_counters.h"
+#include "vpn_stage.h"
+
+namespace openvpn_flutter {
+
+// One reading of a tunnel's counters, as sent to Dart
+struct StatsSample {
+    bool active = false;
+    int64_t connectedOnMs = 0;
+    int64_t sampledAtMs = 0; // Same clock as connectedOnMs
+    int64_t durationSeconds = 0;
+    int64_t speedIn = 0;  // bytes per second, see ThroughputHistory::current()
+    int64_t speedOut = 0; // bytes per second
+    // Totals since the connect. Bytes are openvpn's own count once the
+    // management interface pushes one, everything else is the tunnel
+    // interface's.
+    InterfaceCounters counters;
+    // Growth of the totals since the previous sample its consumer got
+    InterfaceCounters interval;
+    int64_t intervalMs = 0;
+};
+
+// Whether Dart would show something different; duration alone is not a
+// change, Dart derives it from connected_on
+bool statsChanged(const StatsSample& previous, const StatsSample& current);
+
+// Fills current's interval from the previous sample handed to the same
+// consumer (the stats stream, or status calls); against a sample of another
+// session, or none, the interval starts at the connect
+void measureInterval(const StatsSample& previous, StatsSample& current);
+
+// Calls field(key, value) for every entry of the stats map, in a fixed order.
+// Values are int32_t, int64_t, std::string or nullptr (connected_on while
+// disconnected); each platform turns them into its own map type. Counters are
+// 64-bit, so they stay exact on the Dart side.
+template <typename Field>
+void visitStats(const StatsSample& sample, const std::string& tunnelId, Field&& field) {
+    field("version", kEventSchemaVersion);
+    field("tunnel_id", tunnelId);
+    // Wall-clock milliseconds since the Unix epoch, null while disconnected
+    if (sample.active) {
+        field("connected_on", sample.connectedOnMs);
+    } else {
+        field("connected_on", nullptr);
+    }
+    field("duration_s", sample.durationSeconds);
+    const InterfaceCounters& counters = sample.counters;
+    field("byte_in", static_cast<int64_t>(counters.bytesIn));
+    field("byte_out", static_cast<int64_t>(counters.bytesOut));
+    field("packets_in", static_cast<int64_t>(counters.packetsIn()));
+    field("packets_out", static_cast<int64_t>(counters.packetsOut()));
+    field("speed_in_bps", sample.speedIn);
+    field("speed_out_bps", sample.speedOut);
+    field("unicast_packets_in", static_cast<int64_t>(counters.unicastPacketsIn));
+    field("unicast_packets_out", static_cast<int64_t>(counters.unicastPacketsOut));
+    field("non_unicast_packets_in", static_cast<int64_t>(counters.nonUnicastPacketsIn));
+    field("non_unicast_packets_out", static_cast<int64_t>(counters.nonUnicastPacketsOut));
+    field("errors_in", static_cast<int64_t>(counters.errorsIn));
+    field("errors_out", static_cast<int64_t>(counters.errorsOut));
+    field("discards_in", static_cast<int64_t>(counters.discardsIn));
+    field("discards_out", static_cast<int64_t>(counters.discardsOut));
+    // Bits per second, 0 if the driver reports none
+    field("link_speed_in_bps", static_cast<int64_t>(counters.linkSpeedIn));
+    field("link_speed_out_bps", static_cast<int64_t>(counters.linkSpeedOut));
+
+    // Growth since the previous sample this consumer got
+    const InterfaceCounters& interval = sample.interval;
+    field("interval_ms", sample.intervalMs);
+    field("interval_byte_in", static_cast<int64_t>(interval.bytesIn));
+    field("interval_byte_out", static_cast<int64_t>(interval.bytesOut));
+    field("interval_packets_in", static_cast<int64_t>(interval.packetsIn()));
+    field("interval_packets_out", static_cast<int64_t>(interval.packetsOut()));
+    field("interval_unicast_packets_in", static_cast<int64_t>(interval.unicastPacketsIn));
+    field("interval_unicast_packets_out", static_cast<int64_t>(interval.unicastPacketsOut));
+    field("interval_non_unicast_packets_in", static_cast<int64_t>(interval.nonUnicastPacketsIn));
+    field("interval_non_unicast_packets_out", static_cast<int64_t>(interval.nonUnicastPacketsOut));
+    field("interval_errors_in", static_cast<int64_t>(interval.errorsIn));
+    field("interval_errors_out", static_cast<int64_t>(interval.errorsOut));
+    field("interval_discards_in", static_cast<int64_t>(interval.discardsIn));
+    field("interval_discards_out", static_cast<int64_t>(interval.discardsOut));
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,242 @@
+#include "dns_cache.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <windns.h>
+#pragma comment(lib, "dnsapi.lib")
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr uint32_t kDefaultTtlSeconds = 60;
+
+void addUnique(std::vector<std::string>& addresses, std::string address) {
+    if (std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+        addresses.push_back(std::move(address));
+    }
+}
+
+} // namespace
+
+DnsCache::DnsCache() : DnsCache(&DnsCache::systemResolve) {}
+
+DnsCache::DnsCache(Resolver resolver, TimeSource clock) : resolver(std::move(resolver)), clock(std::move(clock)) {}
+
+DnsCache::~DnsCache() {
+    shutdown();
+}
+
+bool DnsCache::wantsLookup(const Entry& entry, Clock::time_point now) const {
+    if (entry.resolving || now < entry.failedUntil) {
+        return false;
+    }
+    if (entry.addresses.empty()) {
+        return true;
+    }
+    // Refresh ahead once the answer is in the last fifth of its lifetime
+    auto refreshAt = entry.expires - (entry.expires - entry.fetched) / 5;
+    return now >= refreshAt;
+}
+
+void DnsCache::startLookup(const std::string& host, Entry& entry) {
+    if (!entry.addresses.empty()) {
+        refreshes++;
+    }
+    entry.resolving = true;
+    bool queued = pool.submit([this, host]() {
+        complete(host, resolver(host));
+    });
+    if (!queued) {
+        entry.resolving = false;
+    }
+}
+
+void DnsCache::complete(const std::string& host, DnsAnswer answer) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(host);
+    if (it == entries.end()) {
+        return;  // Cleared while the lookup ran
+    }
+    Entry& entry = it->second;
+    entry.resolving = false;
+    auto now = clock();
+    if (answer.ok && !answer.addresses.empty()) {
+        if (answer.addresses.size() > kMaxAddresses) {
+            answer.addresses.resize(kMaxAddresses);
+        }
+        auto ttl = std::clamp(std::chrono::seconds(answer.ttlSeconds), std::chrono::seconds(kMinTtl),
+                              std::chrono::seconds(kMaxTtl));
+        entry.addresses = std::move(answer.addresses);
+        entry.fetched = now;
+        entry.expires = now + ttl;
+        entry.failedUntil = Clock::time_point();
+        LOG_DEBUG("Resolved " << host << " to " << entry.addresses.size() << " address(es), ttl "
+                  << ttl.count() << "s");
+    } else {
+        entry.failedUntil = now + kNegativeTtl;
+        LOG_WARN("Could not resolve " << host
+                 << (entry.addresses.empty() ? "" : ", keeping the expired answer"));
+    }
+    resolved.notify_all();
+}
+
+void DnsCache::prefetch(const std::vector<std::string>& hosts) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = clock();
+    for (const auto& host : hosts) {
+        Entry& entry = entries[host];
+        if (wantsLookup(entry, now)) {
+            startLookup(host, entry);
+        }
+    }
+}
+
+std::map<std::string, std::vector<std::string>> DnsCache::resolve(const std::vector<std::string>& hosts,
+                                                                  std::chrono::milliseconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+    auto now = clock();
+    for (const auto& host : hosts) {
+        Entry& entry = entries[host];
+        bool fresh = !entry.addresses.empty() && now < entry.expires;
+        if (fresh) {
+            hits++;
+        } else {
+            misses++;
+        }
+        if (wantsLookup(entry, now)) {
+            startLookup(host, entry);
+        }
+    }
+
+    // Only names without a fresh answer are worth waiting for; refreshes of
+    // fresh ones finish in the background
+    resolved.wait_until(lock, deadline, [this, &hosts]() {
+        auto current = clock();
+        for (const auto& host : hosts) {
+            auto it = entries.find(host);
+            if (it != entries.end() && it->second.resolving &&
+                (it->second.addresses.empty() || current >= it->second.expires)) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    std::map<std::string, std::vector<std::string>> result;
+    now = clock();
+    for (const auto& host : hosts) {
+        auto it = entries.find(host);
+        if (it != entries.end() && !it->second.addresses.empty() && now < it->second.expires + kMaxStale) {
+            result[host] = it->second.addresses;
+        }
+    }
+    return result;
+}
+
+void DnsCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    resolved.notify_all();
+}
+
+void DnsCache::shutdown() {
+    pool.shutdown();
+    // Lookups that were still queued will never complete
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& [host, entry] : entries) {
+        entry.resolving = false;
+    }
+    resolved.notify_all();
+}
+
+size_t DnsCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+uint64_t DnsCache::getHits() const {
+    return hits.load();
+}
+
+uint64_t DnsCache::getMisses() const {
+    return misses.load();
+}
+
+uint64_t DnsCache::getRefreshes() const {
+    return refreshes.load();
+}
+
+DnsAnswer DnsCache::systemResolve(const std::string& host) {
+    DnsAnswer answer;
+#ifdef _WIN32
+    uint32_t ttl = UINT32_MAX;
+    for (WORD type : {DNS_TYPE_A, DNS_TYPE_AAAA}) {
+        PDNS_RECORD records = nullptr;
+        if (DnsQuery_A(host.c_str(), type, DNS_QUERY_STANDARD, nullptr, &records, nullptr) != 0 || !records) {
+            continue;
+        }
+        // CNAMEs in the chain are skipped, only the final records count
+        for (PDNS_RECORD record = records; record; record = record->pNext) {
+            if (record->wType != type || record->Flags.S.Section != DnsSectionAnswer) {
+                continue;
+            }
+            char text[INET6_ADDRSTRLEN] = {};
+            if (type == DNS_TYPE_A) {
+                IN_ADDR address;
+                address.S_un.S_addr = record->Data.A.IpAddress;
+                inet_ntop(AF_INET, &address, text, sizeof(text));
+            } else {
+                inet_ntop(AF_INET6, &record->Data.AAAA.Ip6Address, text, sizeof(text));
+            }
+            addUnique(answer.addresses, text);
+            ttl = std::min<uint32_t>(ttl, record->dwTtl);
+        }
+        DnsRecordListFree(records, DnsFreeRecordList);
+    }
+    answer.ttlSeconds = answer.addresses.empty() ? 0 : ttl;
+#else
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &results) == 0) {
+        std::vector<std::string> v6;
+        for (addrinfo* info = results; info; info = info->ai_next) {
+            char text[INET6_ADDRSTRLEN] = {};
+            if (info->ai_family == AF_INET) {
+                inet_ntop(AF_INET, &reinterpret_cast<sockaddr_in*>(info->ai_addr)->sin_addr, text, sizeof(text));
+                addUnique(answer.addresses, text);
+            } else if (info->ai_family == AF_INET6) {
+                inet_ntop(AF_INET6, &reinterpret_cast<sockaddr_in6*>(info->ai_addr)->sin6_addr, text, sizeof(text));
+                addUnique(v6, text);
+            }
+        }
+        freeaddrinfo(results);
+        for (auto& address : v6) {
+            answer.addresses.push_back(std::move(address));
+        }
+    }
+    answer.ttlSeconds = kDefaultTtlSeconds;
+#endif
+    answer.ok = !answer.addresses.empty();
+    return answer;
+}
+
+} // namespace openvpn_flutter
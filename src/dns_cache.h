@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "worker_pool.h"
+
+namespace openvpn_flutter {
+
+// What a resolver returned for one host name
+struct DnsAnswer {
+    bool ok = false;
+    std::vector<std::string> addresses;  // Textual, IPv4 before IPv6
+    uint32_t ttlSeconds = 0;
+};
+
+// Resolves the 'remote' host names of a profile before openvpn starts, so the
+// child connects to addresses instead of paying resolver latency itself.
+//
+// Names are looked up in parallel on a small pool and kept for their TTL
+// (clamped to [kMinTtl, kMaxTtl]); failures are remembered for kNegativeTtl.
+// An answer in the last fifth of its lifetime is still served and refreshed in
+// the background, and an expired one is served if refreshing it fails.
+class DnsCache {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Resolver = std::function<DnsAnswer(const std::string& host)>;
+    // Time the TTLs are measured in; waiting for lookups always takes real time
+    using TimeSource = std::function<Clock::time_point()>;
+
+    static constexpr std::chrono::seconds kMinTtl{5};
+    static constexpr std::chrono::seconds kMaxTtl{3600};
+    static constexpr std::chrono::seconds kNegativeTtl{30};
+    static constexpr std::chrono::hours kMaxStale{24};
+    static constexpr size_t kMaxAddresses = 4;
+
+private:
+    struct Entry {
+        std::vector<std::string> addresses;  // Last good answer, possibly expired
+        Clock::time_point fetched;
+        Clock::time_point expires;
+        Clock::time_point failedUntil;       // Don't retry before this
+        bool resolving = false;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable resolved;
+    std::map<std::string, Entry> entries;
+    Resolver resolver;
+    TimeSource clock;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> refreshes{0};
+
+    // Last so queued lookups are gone before the entries they complete
+    WorkerPool pool{4};
+
+    // Both called with the mutex held
+    void startLookup(const std::string& host, Entry& entry);
+    bool wantsLookup(const Entry& entry, Clock::time_point now) const;
+    void complete(const std::string& host, DnsAnswer answer);
+
+public:
+    // Uses systemResolve()
+    DnsCache();
+    explicit DnsCache(Resolver resolver, TimeSource clock = &Clock::now);
+    ~DnsCache();
+
+    DnsCache(const DnsCache&) = delete;
+    DnsCache& operator=(const DnsCache&) = delete;
+
+    // Start looking up the names that are not cached, without waiting
+    void prefetch(const std::vector<std::string>& hosts);
+
+    // Addresses for each name, waiting at most `timeout` for lookups that are
+    // not cached yet. Names that failed or did not resolve in time are left
+    // out; their lookups keep running and land in the cache for next time.
+    std::map<std::string, std::vector<std::string>> resolve(const std::vector<std::string>& hosts,
+                                                            std::chrono::milliseconds timeout);
+
+    void clear();
+    // Drop queued lookups and wait for running ones
+    void shutdown();
+
+    size_t size() const;
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getRefreshes() const;
+
+    // A and AAAA lookup with record TTLs (DnsQuery on Windows); getaddrinfo
+    // elsewhere, which reports no TTL, so a minute is assumed
+    static DnsAnswer systemResolve(const std::string& host);
+};
+
+} // namespace openvpn_flutter
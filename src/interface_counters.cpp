@@ -0,0 +1,280 @@
+#include "interface_counters.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <cerrno>
+#include <cstring>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace openvpn_flutter {
+
+namespace {
+
+// The running totals of InterfaceCounters; the link speeds are not in here
+constexpr uint64_t InterfaceCounters::*kTotals[] = {
+    &InterfaceCounters::bytesIn, &InterfaceCounters::bytesOut,
+    &InterfaceCounters::unicastPacketsIn, &InterfaceCounters::unicastPacketsOut,
+    &InterfaceCounters::nonUnicastPacketsIn, &InterfaceCounters::nonUnicastPacketsOut,
+    &InterfaceCounters::errorsIn, &InterfaceCounters::errorsOut,
+    &InterfaceCounters::discardsIn, &InterfaceCounters::discardsOut,
+};
+
+#ifndef _WIN32
+
+// Room for one RTM_NEWLINK message with all its attributes
+constexpr size_t kBufferSize = 16384;
+
+// rx_packets includes multicast; the kernel has no transmit-side multicast
+// count, so everything sent is counted as unicast. Neither structure carries
+// a link speed (a tun device has none).
+template <typename LinkStats>
+void copyStats(const LinkStats& source, InterfaceCounters& counters) {
+    counters = InterfaceCounters{};
+    counters.bytesIn = source.rx_bytes;
+    counters.bytesOut = source.tx_bytes;
+    counters.nonUnicastPacketsIn = source.multicast;
+    counters.unicastPacketsIn = source.rx_packets >= source.multicast ? source.rx_packets - source.multicast : 0;
+    counters.unicastPacketsOut = source.tx_packets;
+    counters.errorsIn = source.rx_errors;
+    counters.errorsOut = source.tx_errors;
+    counters.discardsIn = source.rx_dropped;
+    counters.discardsOut = source.tx_dropped;
+}
+
+// Fills counters from an RTM_NEWLINK message; IFLA_STATS64 is preferred,
+// older kernels only have the 32-bit IFLA_STATS
+bool parseLink(const nlmsghdr* header, InterfaceCounters& counters) {
+    const ifinfomsg* message = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+    const rtattr* stats32 = nullptr;
+    int payload = static_cast<int>(IFLA_PAYLOAD(header));
+    for (const rtattr* attr = IFLA_RTA(message); RTA_OK(attr, payload); attr = RTA_NEXT(attr, payload)) {
+        if (attr->rta_type == IFLA_STATS64 && RTA_PAYLOAD(attr) >= sizeof(rtnl_link_stats64)) {
+            // Attributes are only 4-byte aligned
+            rtnl_link_stats64 source;
+            memcpy(&source, RTA_DATA(attr), sizeof(source));
+            copyStats(source, counters);
+            return true;
+        }
+        if (attr->rta_type == IFLA_STATS && RTA_PAYLOAD(attr) >= sizeof(rtnl_link_stats)) {
+            stats32 = attr;
+        }
+    }
+    if (stats32) {
+        rtnl_link_stats source;
+        memcpy(&source, RTA_DATA(stats32), sizeof(source));
+        copyStats(source, counters);
+        return true;
+    }
+    return false;
+}
+
+#endif
+
+} // namespace
+
+bool InterfaceCounters::operator==(const InterfaceCounters& other) const {
+    for (auto total : kTotals) {
+        if (this->*total != other.*total) {
+            return false;
+        }
+    }
+    return linkSpeedIn == other.linkSpeedIn && linkSpeedOut == other.linkSpeedOut;
+}
+
+InterfaceCounters countersDelta(const InterfaceCounters& previous, const InterfaceCounters& current) {
+    InterfaceCounters delta;
+    for (auto total : kTotals) {
+        delta.*total = current.*total >= previous.*total ? current.*total - previous.*total : current.*total;
+    }
+    delta.linkSpeedIn = current.linkSpeedIn;
+    delta.linkSpeedOut = current.linkSpeedOut;
+    return delta;
+}
+
+#ifdef _WIN32
+
+SystemCounterSource::~SystemCounterSource() = default;
+
+bool SystemCounterSource::read(uint32_t index, InterfaceCounters& counters) {
+    MIB_IF_ROW2 row;
+    ZeroMemory(&row, sizeof(row));
+    row.InterfaceIndex = index;
+    if (GetIfEntry2(&row) != NO_ERROR) {
+        return false;
+    }
+    counters.bytesIn = row.InOctets;
+    counters.bytesOut = row.OutOctets;
+    counters.unicastPacketsIn = row.InUcastPkts;
+    counters.unicastPacketsOut = row.OutUcastPkts;
+    counters.nonUnicastPacketsIn = row.InNUcastPkts;
+    counters.nonUnicastPacketsOut = row.OutNUcastPkts;
+    counters.errorsIn = row.InErrors;
+    counters.errorsOut = row.OutErrors;
+    counters.discardsIn = row.InDiscards;
+    counters.discardsOut = row.OutDiscards;
+    counters.linkSpeedIn = row.ReceiveLinkSpeed;
+    counters.linkSpeedOut = row.TransmitLinkSpeed;
+    return true;
+}
+
+#else
+
+SystemCounterSource::~SystemCounterSource() {
+    if (netlinkSocket >= 0) {
+        ::close(netlinkSocket);
+    }
+}
+
+bool SystemCounterSource::openSocket() {
+    if (netlinkSocket >= 0) {
+        return true;
+    }
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open a netlink socket for interface counters: " << strerror(errno));
+        return false;
+    }
+    sockaddr_nl local{};
+    local.nl_family = AF_NETLINK;
+    timeval timeout{0, kReplyTimeoutMs * 1000};
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        LOG_ERROR("Failed to set up the netlink socket for interface counters: " << strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    netlinkSocket = fd;
+    buffer.resize(kBufferSize);
+    return true;
+}
+
+bool SystemCounterSource::read(uint32_t index, InterfaceCounters& counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!openSocket()) {
+        return false;
+    }
+
+    struct {
+        nlmsghdr header;
+        ifinfomsg message;
+    } request{};
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST;
+    request.header.nlmsg_seq = ++sequence;
+    request.message.ifi_family = AF_UNSPEC;
+    request.message.ifi_index = static_cast<int>(index);
+    if (send(netlinkSocket, &request, sizeof(request), 0) < 0) {
+        return false;
+    }
+
+    // Answers to earlier requests that timed out may still be queued; skip them
+    while (true) {
+        ssize_t received = recv(netlinkSocket, buffer.data(), buffer.size(), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        int remaining = static_cast<int>(received);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer.data()); NLMSG_OK(header, remaining);
+             header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_seq != request.header.nlmsg_seq) {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                return false;  // ENODEV once the interface is gone
+            }
+            if (header->nlmsg_type == RTM_NEWLINK) {
+                return parseLink(header, counters);
+            }
+        }
+    }
+}
+
+#endif
+
+void FakeCounterSource::set(uint32_t index, const InterfaceCounters& counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+    interfaces[index] = counters;
+}
+
+void FakeCounterSource::addTraffic(uint32_t index, uint64_t packetsIn, uint64_t packetsOut, uint32_t packetSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    InterfaceCounters& counters = interfaces[index];
+    counters.unicastPacketsIn += packetsIn;
+    counters.unicastPacketsOut += packetsOut;
+    counters.bytesIn += packetsIn * packetSize;
+    counters.bytesOut += packetsOut * packetSize;
+}
+
+void FakeCounterSource::remove(uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    interfaces.erase(index);
+}
+
+bool FakeCounterSource::read(uint32_t index, InterfaceCounters& counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = interfaces.find(index);
+    if (it == interfaces.end()) {
+        return false;
+    }
+    counters = it->second;
+    return true;
+}
+
+void SessionCounters::reset() {
+    hasBaseline = false;
+    baseline = InterfaceCounters{};
+    previous = InterfaceCounters{};
+    carried = InterfaceCounters{};
+    totals = InterfaceCounters{};
+}
+
+const InterfaceCounters& SessionCounters::update(const InterfaceCounters& raw) {
+    // The first reading of a session is its zero
+    if (!hasBaseline) {
+        hasBaseline = true;
+        baseline = raw;
+        previous = raw;
+    }
+    bool recreated = false;
+    for (auto total : kTotals) {
+        recreated = recreated || raw.*total < previous.*total;
+    }
+    previous = raw;
+    if (recreated) {
+        // A new interface counts from zero; keep what the old one had
+        carried = totals;
+        baseline = InterfaceCounters{};
+    }
+    for (auto total : kTotals) {
+        totals.*total = carried.*total + (raw.*total - baseline.*total);
+    }
+    totals.linkSpeedIn = raw.linkSpeedIn;
+    totals.linkSpeedOut = raw.linkSpeedOut;
+    return totals;
+}
+
+const InterfaceCounters& SessionCounters::getTotals() const {
+    return totals;
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace openvpn_flutter {
+
+// Kernel counters of one network interface, the same set on every platform:
+// MIB_IF_ROW2 on Windows, rtnl_link_stats64 on Linux. All are running totals
+// except the link speeds, which are gauges.
+struct InterfaceCounters {
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t unicastPacketsIn = 0;
+    uint64_t unicastPacketsOut = 0;
+    uint64_t nonUnicastPacketsIn = 0;  // Broadcast and multicast
+    uint64_t nonUnicastPacketsOut = 0;
+    uint64_t errorsIn = 0;
+    uint64_t errorsOut = 0;
+    uint64_t discardsIn = 0;  // Dropped without an error (no buffer, filtered)
+    uint64_t discardsOut = 0;
+    uint64_t linkSpeedIn = 0;  // bits per second, 0 if the driver reports none
+    uint64_t linkSpeedOut = 0;
+
+    uint64_t packetsIn() const { return unicastPacketsIn + nonUnicastPacketsIn; }
+    uint64_t packetsOut() const { return unicastPacketsOut + nonUnicastPacketsOut; }
+
+    bool operator==(const InterfaceCounters& other) const;
+    bool operator!=(const InterfaceCounters& other) const { return !(*this == other); }
+};
+
+// How much each total grew from previous to current; a total that went down
+// (the interface was recreated) counts from zero. Link speeds are current's.
+InterfaceCounters countersDelta(const InterfaceCounters& previous, const InterfaceCounters& current);
+
+// Where interface counters come from, by interface index. Implementations are
+// safe to call from any thread.
+class CounterSource {
+public:
+    virtual ~CounterSource() = default;
+
+    // False if the interface is gone or its counters can't be read
+    virtual bool read(uint32_t index, InterfaceCounters& counters) = 0;
+};
+
+// The OS's counters. On Windows a GetIfEntry2 call; on Linux an RTM_GETLINK
+// request for the ifindex over a netlink socket opened once and reused,
+// rather than parsing /proc/net/dev or sysfs for every sample.
+class SystemCounterSource : public CounterSource {
+private:
+#ifndef _WIN32
+    std::mutex mutex;
+    int netlinkSocket = -1;
+    uint32_t sequence = 0;
+    std::vector<char> buffer;
+
+    bool openSocket();  // mutex held
+#endif
+
+public:
+    // How long a Linux read waits for the kernel's answer
+    static constexpr int kReplyTimeoutMs = 200;
+
+    SystemCounterSource() = default;
+    ~SystemCounterSource() override;
+
+    SystemCounterSource(const SystemCounterSource&) = delete;
+    SystemCounterSource& operator=(const SystemCounterSource&) = delete;
+
+    bool read(uint32_t index, InterfaceCounters& counters) override;
+};
+
+// Counters set by hand, for driving the stats path without a tunnel
+class FakeCounterSource : public CounterSource {
+private:
+    std::mutex mutex;
+    std::map<uint32_t, InterfaceCounters> interfaces;
+
+public:
+    void set(uint32_t index, const InterfaceCounters& counters);
+    // Adds unicast traffic of packetSize-byte packets to the interface
+    void addTraffic(uint32_t index, uint64_t packetsIn, uint64_t packetsOut, uint32_t packetSize);
+    void remove(uint32_t index);
+
+    bool read(uint32_t index, InterfaceCounters& counters) override;
+};
+
+// One session's view of an interface whose counters don't start at zero: a
+// kept WinTun or TAP adapter carries earlier sessions' traffic, and the
+// interface may be recreated mid-session (counters back to zero). Fed raw
+// readings, it keeps totals since reset(). Not thread-safe.
+class SessionCounters {
+private:
+    bool hasBaseline = false;
+    InterfaceCounters baseline;  // Raw reading the totals are relative to
+    InterfaceCounters previous;  // Last raw reading
+    InterfaceCounters carried;   // Totals from before the interface was recreated
+    InterfaceCounters totals;
+
+public:
+    void reset();
+    // Returns the session totals including this reading
+    const InterfaceCounters& update(const InterfaceCounters& raw);
+    const InterfaceCounters& getTotals() const;
+};
+
+} // namespace openvpn_flutter
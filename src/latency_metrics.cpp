@@ -0,0 +1,168 @@
+#include "latency_metrics.h"
+
+#include <algorithm>
+
+namespace openvpn_flutter {
+
+// LatencyHistogram
+
+size_t LatencyHistogram::bucketOf(uint64_t micros) {
+    if (micros < kSubBuckets) {
+        return static_cast<size_t>(micros);
+    }
+    // Position of the highest set bit picks the power of two, the two bits
+    // below it the quarter within it
+    size_t msb = 0;
+    for (uint64_t v = micros; v > 1; v >>= 1) {
+        msb++;
+    }
+    size_t sub = static_cast<size_t>((micros >> (msb - 2)) & (kSubBuckets - 1));
+    return std::min(kSubBuckets * (msb - 1) + sub, kBuckets - 1);
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    size_t msb = bucket / kSubBuckets + 1;
+    uint64_t sub = bucket % kSubBuckets;
+    return (kSubBuckets + sub) << (msb - 2);
+}
+
+void LatencyHistogram::record(std::chrono::microseconds elapsed) {
+    uint64_t micros = elapsed.count() > 0 ? static_cast<uint64_t>(elapsed.count()) : 0;
+    buckets[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalUs.fetch_add(micros, std::memory_order_relaxed);
+    uint64_t previous = maxUs.load(std::memory_order_relaxed);
+    while (micros > previous && !maxUs.compare_exchange_weak(previous, micros, std::memory_order_relaxed)) {
+    }
+}
+
+double LatencyHistogram::percentileUs(const std::array<uint64_t, kBuckets>& counts, uint64_t total,
+                                      double quantile, uint64_t observedMax) const {
+    // Rank of the sample we are after, 1-based
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.999999);
+    rank = std::clamp<uint64_t>(rank, 1, total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        if (seen + counts[i] >= rank) {
+            double lower = static_cast<double>(bucketLowerBound(i));
+            double upper = i + 1 < kBuckets ? static_cast<double>(bucketLowerBound(i + 1))
+                                            : static_cast<double>(observedMax);
+            double fraction = static_cast<double>(rank - seen) / static_cast<double>(counts[i]);
+            return std::min(lower + (upper - lower) * fraction, static_cast<double>(observedMax));
+        }
+        seen += counts[i];
+    }
+    return static_cast<double>(observedMax);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summarize() const {
+    // Concurrent records may land between the loads; the summary is still
+    // consistent with the bucket copy because the total is taken from it
+    std::array<uint64_t, kBuckets> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    Summary summary;
+    if (total == 0) {
+        return summary;
+    }
+    uint64_t observedMax = maxUs.load(std::memory_order_relaxed);
+    uint64_t recorded = count.load(std::memory_order_relaxed);
+    summary.count = total;
+    summary.meanMs = recorded > 0 ? static_cast<double>(totalUs.load(std::memory_order_relaxed)) / recorded / 1000.0 : 0;
+    summary.p50Ms = percentileUs(counts, total, 0.50, observedMax) / 1000.0;
+    summary.p90Ms = percentileUs(counts, total, 0.90, observedMax) / 1000.0;
+    summary.p99Ms = percentileUs(counts, total, 0.99, observedMax) / 1000.0;
+    summary.maxMs = static_cast<double>(observedMax) / 1000.0;
+    return summary;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> LatencyHistogram::nonEmptyBuckets() const {
+    std::vector<std::pair<uint64_t, uint64_t>> result;
+    for (size_t i = 0; i < kBuckets; i++) {
+        uint64_t n = buckets[i].load(std::memory_order_relaxed);
+        if (n > 0) {
+            uint64_t upper = i + 1 < kBuckets ? bucketLowerBound(i + 1) : UINT64_MAX;
+            result.emplace_back(upper, n);
+        }
+    }
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count = 0;
+    totalUs = 0;
+    maxUs = 0;
+}
+
+// ConnectMetrics
+
+void ConnectMetrics::record(ConnectPhase phase, std::chrono::steady_clock::duration elapsed) {
+    if (phase < ConnectPhase::Count) {
+        phases[static_cast<size_t>(phase)].record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed));
+    }
+}
+
+const LatencyHistogram& ConnectMetrics::histogram(ConnectPhase phase) const {
+    return phases[static_cast<size_t>(phase)];
+}
+
+void ConnectMetrics::reset() {
+    for (auto& phase : phases) {
+        phase.reset();
+    }
+}
+
+const char* ConnectMetrics::phaseName(ConnectPhase phase) {
+    switch (phase) {
+        case ConnectPhase::DriverInit: return "driver_init";
+        case ConnectPhase::WinTunInit: return "wintun_init";
+        case ConnectPhase::AdapterPrepare: return "adapter_prepare";
+        case ConnectPhase::AdapterRecreate: return "adapter_recreate";
+        case ConnectPhase::TapInit: return "tap_init";
+        case ConnectPhase::DnsResolve: return "dns_resolve";
+        case ConnectPhase::ConfigPrepare: return "config_prepare";
+        case ConnectPhase::ProcessStart: return "process_start";
+        case ConnectPhase::ConfigWrite: return "config_write";
+        case ConnectPhase::ManagementAttach: return "management_attach";
+        case ConnectPhase::Connect: return "connect";
+        case ConnectPhase::Reconnect: return "reconnect";
+        case ConnectPhase::Disconnect: return "disconnect";
+        case ConnectPhase::ProcessStop: return "process_stop";
+        case ConnectPhase::Count: break;
+    }
+    return "unknown";
+}
+
+// PhaseSpan
+
+PhaseSpan::PhaseSpan(ConnectMetrics& metrics, ConnectPhase phase)
+    : metrics(&metrics), phase(phase), started(std::chrono::steady_clock::now()) {}
+
+PhaseSpan::~PhaseSpan() {
+    finish();
+}
+
+void PhaseSpan::finish() {
+    if (metrics) {
+        metrics->record(phase, std::chrono::steady_clock::now() - started);
+        metrics = nullptr;
+    }
+}
+
+void PhaseSpan::dismiss() {
+    metrics = nullptr;
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace openvpn_flutter {
+
+// Steps of bringing a tunnel up or down that are timed. Values index the
+// histograms; names are what the metrics call reports.
+enum class ConnectPhase : uint8_t {
+    DriverInit,        // startVPN waiting for the driver choice (probes, installs)
+    WinTunInit,        // wintun.dll load and the tunnel's adapter
+    AdapterPrepare,    // Health check of the warm adapter, tapctl when rebuilt
+    AdapterRecreate,   // AdapterPrepare of the connects that rebuilt the adapter
+    TapInit,           // TAP-Windows fallback: tapinstall / adapter creation
+    DnsResolve,        // Waiting for the 'remote' names
+    ConfigPrepare,     // Rewriting the profile (or the cache hit)
+    ProcessStart,      // CreateProcess of openvpn.exe
+    ConfigWrite,       // Piping the profile to the child
+    ManagementAttach,  // Process start until the management interface answers
+    Connect,           // Connect requested until Connected
+    Reconnect,         // Reconnecting until Connected again
+    Disconnect,        // stopVPN as a whole
+    ProcessStop,       // Terminating openvpn.exe and waiting for it
+    Count
+};
+
+// Latencies in fixed buckets: four per power of two of microseconds (at most
+// 25% wide), from 1 us to ~8 minutes, where the last bucket also takes
+// anything longer. Recording is a few relaxed atomic increments, so spans can
+// be timed on any thread; percentiles are interpolated within their bucket.
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 4;
+    static constexpr size_t kBuckets = 112;
+
+    struct Summary {
+        uint64_t count = 0;
+        double meanMs = 0;
+        double p50Ms = 0;
+        double p90Ms = 0;
+        double p99Ms = 0;
+        double maxMs = 0;
+    };
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalUs{0};
+    std::atomic<uint64_t> maxUs{0};
+
+    double percentileUs(const std::array<uint64_t, kBuckets>& counts, uint64_t total, double quantile,
+                        uint64_t observedMax) const;
+
+public:
+    void record(std::chrono::microseconds elapsed);
+    Summary summarize() const;
+    // (upper bound in microseconds, count) of every bucket that is not empty,
+    // for merging histograms of many installs
+    std::vector<std::pair<uint64_t, uint64_t>> nonEmptyBuckets() const;
+    void reset();
+
+    static size_t bucketOf(uint64_t micros);
+    static uint64_t bucketLowerBound(size_t bucket);
+};
+
+// One histogram per phase, shared by every tunnel
+class ConnectMetrics {
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(ConnectPhase::Count)> phases;
+
+public:
+    void record(ConnectPhase phase, std::chrono::steady_clock::duration elapsed);
+    const LatencyHistogram& histogram(ConnectPhase phase) const;
+    void reset();
+
+    static const char* phaseName(ConnectPhase phase);
+};
+
+// Times a phase from construction until finish() or destruction, whichever
+// comes first; dismiss() drops it, for attempts that say nothing about latency
+class PhaseSpan {
+private:
+    ConnectMetrics* metrics;
+    ConnectPhase phase;
+    std::chrono::steady_clock::time_point started;
+
+public:
+    PhaseSpan(ConnectMetrics& metrics, ConnectPhase phase);
+    ~PhaseSpan();
+
+    PhaseSpan(const PhaseSpan&) = delete;
+    PhaseSpan& operator=(const PhaseSpan&) = delete;
+
+    void finish();
+    void dismiss();
+};
+
+} // namespace openvpn_flutter
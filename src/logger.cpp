@@ -0,0 +1,297 @@
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr auto kWriterInterval = std::chrono::milliseconds(100);
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+int64_t steadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void printRecord(const LogRecord& record) {
+    std::time_t seconds = static_cast<std::time_t>(record.timestampMs / 1000);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    std::ostream& out = record.level >= LogLevel::Warn ? std::cerr : std::cout;
+    out << Logger::levelName(record.level)[0] << ' ' << std::put_time(&local, "%H:%M:%S") << '.'
+        << std::setw(3) << std::setfill('0') << (record.timestampMs % 1000) << std::setfill(' ')
+        << " t" << record.thread << "  " << record.message << '\n';
+}
+
+} // namespace
+
+// Single producer (the owning thread), single consumer (whoever holds drainMutex)
+struct Logger::Ring {
+    std::array<LogRecord, kRingCapacity> slots;
+    std::atomic<size_t> head{0};  // Next slot to read
+    std::atomic<size_t> tail{0};  // Next slot to write
+    uint32_t thread = 0;
+    std::atomic<bool> orphaned{false};  // Owning thread exited
+
+    bool push(LogRecord&& record) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= kRingCapacity) {
+            return false;
+        }
+        slots[t % kRingCapacity] = std::move(record);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Fn>
+    void consume(Fn&& fn) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        for (; h != t; h++) {
+            fn(std::move(slots[h % kRingCapacity]));
+        }
+        head.store(h, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+Logger::Logger() : sink(printRecord) {}
+
+Logger& Logger::instance() {
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Ring& Logger::threadRing() {
+    // Marks the ring orphaned on thread exit; the writer frees it once drained
+    struct Owner {
+        std::shared_ptr<Ring> ring;
+        ~Owner() {
+            if (ring) {
+                ring->orphaned = true;
+            }
+        }
+    };
+    thread_local Owner owner;
+    if (!owner.ring) {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        ring->thread = nextThread++;
+        rings.push_back(ring);
+        owner.ring = std::move(ring);
+    }
+    return *owner.ring;
+}
+
+void Logger::setLevel(LogLevel level) {
+    minLevel.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() const {
+    return static_cast<LogLevel>(minLevel.load(std::memory_order_relaxed));
+}
+
+void Logger::write(LogLevel level, std::string message, uint32_t suppressed) {
+    LogRecord record;
+    record.timestampMs = nowMs();
+    record.level = level;
+    record.message = std::move(message);
+    if (suppressed > 0) {
+        record.message += " (" + std::to_string(suppressed) + " more from here suppressed, logged too often)";
+    }
+
+    Ring& ring = threadRing();
+    record.thread = ring.thread;
+
+    if (!running.load(std::memory_order_acquire)) {
+        // Before the writer starts or after shutdown: print right away
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        if (!stopping && !writer.joinable()) {
+            writer = std::thread(&Logger::run, this);
+            running = true;
+        } else if (stopping) {
+            std::lock_guard<std::mutex> drainLock(drainMutex);
+            emit(std::move(record));
+            return;
+        }
+    }
+
+    if (!ring.push(std::move(record))) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (!running.load(std::memory_order_acquire)) {
+        drain();  // Raced with shutdown(), nobody else will
+    } else if (level >= LogLevel::Error) {
+        wake.notify_one();
+    }
+}
+
+void Logger::setSink(Sink newSink) {
+    std::lock_guard<std::mutex> lock(drainMutex);
+    sink = newSink ? std::move(newSink) : Sink(printRecord);
+}
+
+void Logger::run() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    while (!stopping) {
+        wake.wait_for(lock, kWriterInterval);
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+}
+
+void Logger::drain() {
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    std::vector<std::shared_ptr<Ring>> current;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        current = rings;
+    }
+
+    // Rings are drained one after the other, so records of different threads
+    // may come out of order by up to one writer interval
+    for (const auto& ring : current) {
+        ring->consume([this](LogRecord&& record) { emit(std::move(record)); });
+    }
+
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        LogRecord record;
+        record.timestampMs = nowMs();
+        record.level = LogLevel::Warn;
+        record.message = std::to_string(lost) + " log record(s) dropped, a thread's buffer was full";
+        emit(std::move(record));
+    }
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    for (size_t i = 0; i < rings.size();) {
+        if (rings[i]->orphaned && rings[i]->empty()) {
+            rings[i] = rings.back();
+            rings.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void Logger::emit(LogRecord record) {
+    // Called with drainMutex held
+    if (record.level == lastRecord.level && record.message == lastRecord.message) {
+        repeats++;
+        return;
+    }
+    auto deliver = [this](const LogRecord& delivered) {
+        sink(delivered);
+        std::lock_guard<std::mutex> lock(historyMutex);
+        history.push_back(delivered);
+        if (history.size() > kHistoryCapacity) {
+            history.pop_front();
+        }
+    };
+    if (repeats > 0) {
+        LogRecord summary = lastRecord;
+        summary.timestampMs = record.timestampMs;
+        summary.message = "(previous message repeated " + std::to_string(repeats) + " more time(s))";
+        deliver(summary);
+        repeats = 0;
+    }
+    deliver(record);
+    lastRecord = std::move(record);
+}
+
+void Logger::flush() {
+    drain();
+    std::cout.flush();
+}
+
+std::vector<LogRecord> Logger::recent(size_t maxCount, LogLevel level) {
+    drain();
+    std::vector<LogRecord> result;
+    std::lock_guard<std::mutex> lock(historyMutex);
+    for (auto it = history.rbegin(); it != history.rend() && result.size() < maxCount; ++it) {
+        if (it->level >= level) {
+            result.push_back(*it);
+        }
+    }
+    return std::vector<LogRecord>(result.rbegin(), result.rend());
+}
+
+uint64_t Logger::getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    running = false;
+    flush();
+}
+
+bool LogSite::admit(uint32_t& suppressedBefore) {
+    // Each record moves the full-again time on by an interval; the bucket is
+    // empty once that is more than a burst ahead of now
+    constexpr int64_t kIntervalMs = 1000 / kPerSecond;
+    constexpr int64_t kToleranceMs = (kBurst - 1) * kIntervalMs;
+    int64_t now = steadyMs();
+    int64_t next = nextMs.load(std::memory_order_relaxed);
+    do {
+        if (next - now > kToleranceMs) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!nextMs.compare_exchange_weak(next, std::max(next, now) + kIntervalMs, std::memory_order_relaxed));
+    suppressedBefore = suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace: return "trace";
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warn: return "warn";
+        case LogLevel::Error: return "error";
+        case LogLevel::Off: return "off";
+    }
+    return "info";
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    for (int i = static_cast<int>(LogLevel::Trace); i <= static_cast<int>(LogLevel::Off); i++) {
+        if (name == levelName(static_cast<LogLevel>(i))) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace openvpn_flutter {
+
+enum class LogLevel : int {
+    Trace = 0,
+    Debug = 1,
+    Info = 2,
+    Warn = 3,
+    Error = 4,
+    Off = 5
+};
+
+// Levels below this are compiled out entirely (release builds strip Debug)
+#ifndef OPENVPN_FLUTTER_LOG_MIN_LEVEL
+#define OPENVPN_FLUTTER_LOG_MIN_LEVEL 1
+#endif
+
+struct LogRecord {
+    int64_t timestampMs = 0;  // Wall clock, milliseconds since the epoch
+    LogLevel level = LogLevel::Info;
+    uint32_t thread = 0;      // Small per-process thread number, not the OS id
+    std::string message;
+};
+
+// Process-wide logger. Writers format on their own thread and push the record
+// into a ring owned by that thread (single producer, single consumer, no lock);
+// a background writer drains every ring, prints the records and keeps the most
+// recent ones for get_logs. A record that repeats the previous one is counted
+// instead of printed, and summarized once something else is logged. Each
+// LOG_* statement is also rate limited on its own, see LogSite.
+class Logger {
+public:
+    using Sink = std::function<void(const LogRecord& record)>;
+
+    static constexpr size_t kRingCapacity = 256;  // Per thread
+    static constexpr size_t kHistoryCapacity = 1000;
+
+private:
+    struct Ring;
+
+    std::atomic<int> minLevel{static_cast<int>(LogLevel::Info)};
+
+    std::mutex ringsMutex;  // Registration and draining only, never the hot path
+    std::vector<std::shared_ptr<Ring>> rings;
+    uint32_t nextThread = 1;
+
+    std::mutex drainMutex;  // Makes whoever drains the single consumer
+    Sink sink;
+    LogRecord lastRecord;
+    uint32_t repeats = 0;
+
+    mutable std::mutex historyMutex;
+    std::deque<LogRecord> history;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::atomic<bool> running{false};
+    std::thread writer;
+    std::atomic<uint64_t> dropped{0};
+
+    Logger();
+    Ring& threadRing();
+    void run();
+    void drain();
+    void emit(LogRecord record);
+
+public:
+    // Never destroyed, so it stays usable from static destructors
+    static Logger& instance();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+    void setLevel(LogLevel level);
+    LogLevel getLevel() const;
+
+    // suppressed: records of the same call site LogSite held back before this one
+    void write(LogLevel level, std::string message, uint32_t suppressed = 0);
+
+    // Replace the default sink (stdout, stderr for warnings and errors)
+    void setSink(Sink newSink);
+
+    // Print everything queued so far, on the calling thread
+    void flush();
+    // Most recent records at or above `level`, oldest first
+    std::vector<LogRecord> recent(size_t maxCount, LogLevel level = LogLevel::Trace);
+    // Records lost because a thread's ring was full
+    uint64_t getDropped() const;
+
+    // Stop the writer thread after a final flush; later records are printed
+    // synchronously
+    void shutdown();
+
+    static const char* levelName(LogLevel level);
+    static bool parseLevel(const std::string& name, LogLevel& level);
+};
+
+// Token bucket of one LOG_* statement, so that a line logged in a loop (or
+// with a changing number in it) cannot fill the rings and push everything
+// else out of the history: a burst of kBurst records, then kPerSecond.
+// Records over the limit are not formatted; the next one written says how
+// many were held back. Lives as a static in the logging macro.
+class LogSite {
+public:
+    static constexpr int64_t kBurst = 200;
+    static constexpr int64_t kPerSecond = 20;
+
+private:
+    std::atomic<int64_t> nextMs{0};  // When the bucket is full again (GCRA)
+    std::atomic<uint32_t> suppressed{0};
+
+public:
+    // Whether a record may be written now, and how many were not since the
+    // last one that was
+    bool admit(uint32_t& suppressedBefore);
+};
+
+} // namespace openvpn_flutter
+
+// Stream-style logging: LOG_INFO("Connected to " << host << ":" << port);
+// The message is only formatted when its level is enabled and the statement
+// is within its rate limit.
+#define OPENVPN_FLUTTER_LOG(level, stream)                                                   \
+    do {                                                                                     \
+        if constexpr (static_cast<int>(level) >= OPENVPN_FLUTTER_LOG_MIN_LEVEL) {            \
+            auto& logger_ = ::openvpn_flutter::Logger::instance();                           \
+            static ::openvpn_flutter::LogSite logSite_;                                      \
+            uint32_t logSuppressed_ = 0;                                                     \
+            if (logger_.enabled(level) && logSite_.admit(logSuppressed_)) {                  \
+                std::ostringstream logStream_;                                               \
+                logStream_ << stream;                                                        \
+                logger_.write(level, logStream_.str(), logSuppressed_);                      \
+            }                                                                                \
+        }                                                                                    \
+    } while (0)
+
+#define LOG_TRACE(stream) OPENVPN_FLUTTER_LOG(::openvpn_flutter::LogLevel::Trace, stream)
+#define LOG_DEBUG(stream) OPENVPN_FLUTTER_LOG(::openvpn_flutter::LogLevel::Debug, stream)
+#define LOG_INFO(stream) OPENVPN_FLUTTER_LOG(::openvpn_flutter::LogLevel::Info, stream)
+#define LOG_WARN(stream) OPENVPN_FLUTTER_LOG(::openvpn_flutter::LogLevel::Warn, stream)
+#define LOG_ERROR(stream) OPENVPN_FLUTTER_LOG(::openvpn_flutter::LogLevel::Error, stream)
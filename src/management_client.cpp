@@ -0,0 +1,416 @@
+#include "management_client.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace openvpn_flutter {
+
+namespace {
+
+#ifdef _WIN32
+const SocketHandle kInvalidSocket = static_cast<SocketHandle>(INVALID_SOCKET);
+
+void closeSocket(SocketHandle s) {
+    closesocket(static_cast<SOCKET>(s));
+}
+
+bool wouldBlock() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+bool setNonBlocking(SocketHandle s) {
+    u_long mode = 1;
+    return ioctlsocket(static_cast<SOCKET>(s), FIONBIO, &mode) == 0;
+}
+
+// Not inherited by the processes started later (the next tunnel's openvpn)
+SocketHandle openStreamSocket(int family, int protocol) {
+    return static_cast<SocketHandle>(
+        WSASocketW(family, SOCK_STREAM, protocol, nullptr, 0, WSA_FLAG_OVERLAPPED | WSA_FLAG_NO_HANDLE_INHERIT));
+}
+#else
+const SocketHandle kInvalidSocket = -1;
+
+void closeSocket(SocketHandle s) {
+    ::close(s);
+}
+
+bool wouldBlock() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+bool setNonBlocking(SocketHandle s) {
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Not inherited by the processes started later (the next tunnel's openvpn)
+SocketHandle openStreamSocket(int family, int protocol) {
+    return socket(family, SOCK_STREAM | SOCK_CLOEXEC, protocol);
+}
+#endif
+
+// Split a comma separated notification payload
+std::vector<std::string_view> splitFields(std::string_view payload) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    while (true) {
+        size_t comma = payload.find(',', start);
+        if (comma == std::string_view::npos) {
+            fields.push_back(payload.substr(start));
+            break;
+        }
+        fields.push_back(payload.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return fields;
+}
+
+bool startsWith(std::string_view value, std::string_view prefix) {
+    return value.size() >= prefix.size() && value.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Sent without a line end when the interface has a password file
+constexpr std::string_view kPasswordPrompt = "ENTER PASSWORD:";
+
+} // namespace
+
+ManagementClient::ManagementClient() : sock(kInvalidSocket) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+ManagementClient::~ManagementClient() {
+    close();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool ManagementClient::connect(const std::string& host, uint16_t port) {
+    close();
+
+    SocketHandle s = openStreamSocket(AF_INET, IPPROTO_TCP);
+    if (s == kInvalidSocket) {
+        return false;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+        closeSocket(s);
+        return false;
+    }
+
+    // Loopback connects complete or get refused immediately, so a blocking
+    // connect is fine; the socket switches to non-blocking for reads
+#ifdef _WIN32
+    int rc = ::connect(static_cast<SOCKET>(s), reinterpret_cast<sockaddr*>(&address), sizeof(address));
+#else
+    int rc = ::connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+#endif
+    if (rc != 0 || !setNonBlocking(s)) {
+        closeSocket(s);
+        return false;
+    }
+
+    int noDelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+    sock = s;
+    connected = true;
+    readBuffer.clear();
+    discardingLine = false;
+    return true;
+}
+
+#ifndef _WIN32
+bool ManagementClient::connectUnix(const std::string& path) {
+    close();
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    SocketHandle s = openStreamSocket(AF_UNIX, 0);
+    if (s == kInvalidSocket) {
+        return false;
+    }
+    if (::connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !setNonBlocking(s)) {
+        closeSocket(s);
+        return false;
+    }
+
+    sock = s;
+    connected = true;
+    readBuffer.clear();
+    discardingLine = false;
+    return true;
+}
+#endif
+
+void ManagementClient::setPassword(std::string value) {
+    password = std::move(value);
+}
+
+void ManagementClient::close() {
+    if (sock != kInvalidSocket) {
+        closeSocket(sock);
+        sock = kInvalidSocket;
+    }
+    // readBuffer is left alone: close() may run from inside feed()
+    connected = false;
+}
+
+bool ManagementClient::isConnected() const {
+    return connected;
+}
+
+SocketHandle ManagementClient::getSocket() const {
+    return sock;
+}
+
+bool ManagementClient::sendCommand(std::string_view command) {
+    if (!connected) {
+        return false;
+    }
+
+    std::string line(command);
+    line += '\n';
+    size_t sent = 0;
+    int retries = 0;
+    while (sent < line.size()) {
+#ifdef _WIN32
+        int n = send(static_cast<SOCKET>(sock), line.data() + sent, static_cast<int>(line.size() - sent), 0);
+#else
+        ssize_t n = send(sock, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+#endif
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        // Commands are tiny; a full send buffer on loopback is transient
+        if (n < 0 && wouldBlock() && ++retries < 100) {
+            continue;
+        }
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ManagementClient::sendCredentials(std::string_view realm, std::string_view username, std::string_view password) {
+    std::string quotedRealm = quoteArgument(realm);
+    return sendCommand("username " + quotedRealm + " " + quoteArgument(username)) &&
+           sendCommand("password " + quotedRealm + " " + quoteArgument(password));
+}
+
+bool ManagementClient::pump() {
+    if (!connected) {
+        return false;
+    }
+
+    char buffer[4096];
+    while (true) {
+#ifdef _WIN32
+        int n = recv(static_cast<SOCKET>(sock), buffer, sizeof(buffer), 0);
+#else
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+#endif
+        if (n > 0) {
+            feed(std::string_view(buffer, static_cast<size_t>(n)));
+            if (!connected) {
+                return false;
+            }
+            continue;
+        }
+        if (n < 0 && wouldBlock()) {
+            return true;
+        }
+        // Orderly shutdown or hard error
+        close();
+        return false;
+    }
+}
+
+void ManagementClient::feed(std::string_view data) {
+    if (discardingLine) {
+        size_t newline = data.find('\n');
+        if (newline == std::string_view::npos) {
+            return;
+        }
+        data.remove_prefix(newline + 1);
+        discardingLine = false;
+    }
+    readBuffer.append(data.data(), data.size());
+
+    size_t start = 0;
+    size_t newline;
+    while ((newline = readBuffer.find('\n', start)) != std::string::npos) {
+        size_t end = newline;
+        if (end > start && readBuffer[end - 1] == '\r') {
+            end--;
+        }
+        handleLine(std::string_view(readBuffer).substr(start, end - start));
+        start = newline + 1;
+    }
+    readBuffer.erase(0, start);
+
+    // The prompt is the only thing openvpn sends until it has the password
+    if (startsWith(readBuffer, kPasswordPrompt)) {
+        readBuffer.erase(0, kPasswordPrompt.size());
+        sendCommand(password);
+    }
+    if (readBuffer.size() > kMaxLineLength) {
+        readBuffer.clear();
+        discardingLine = true;
+    }
+}
+
+void ManagementClient::handleLine(std::string_view line) {
+    // Only real-time notifications (">TYPE:payload") drive the client;
+    // command replies (SUCCESS:/ERROR:/END) are informational
+    if (line.empty() || line[0] != '>') {
+        return;
+    }
+
+    if (startsWith(line, ">STATE:")) {
+        StateNotification notification;
+        if (parseStateLine(line.substr(7), notification) && onState) {
+            onState(notification);
+        }
+    } else if (startsWith(line, ">BYTECOUNT:")) {
+        // >BYTECOUNT:{BYTES_IN},{BYTES_OUT}
+        std::string payload(line.substr(11));
+        char* end = nullptr;
+        uint64_t bytesIn = std::strtoull(payload.c_str(), &end, 10);
+        if (end && *end == ',' && onByteCount) {
+            uint64_t bytesOut = std::strtoull(end + 1, nullptr, 10);
+            onByteCount(bytesIn, bytesOut);
+        }
+    } else if (startsWith(line, ">HOLD:")) {
+        // openvpn is waiting for us (--management-hold), let it continue
+        sendCommand("hold release");
+    } else if (startsWith(line, ">PASSWORD:")) {
+        // >PASSWORD:Need 'Auth' username/password
+        // >PASSWORD:Verification Failed: 'Auth'
+        std::string_view payload = line.substr(10);
+        bool failed = startsWith(payload, "Verification Failed:");
+        if (!failed && !startsWith(payload, "Need ")) {
+            return;  // Auth tokens and the like
+        }
+        size_t open = payload.find('\'');
+        size_t close = open == std::string_view::npos ? open : payload.find('\'', open + 1);
+        if (close != std::string_view::npos && onPassword) {
+            onPassword(std::string(payload.substr(open + 1, close - open - 1)), failed);
+        }
+    } else if (startsWith(line, ">FATAL:")) {
+        if (onFatal) {
+            onFatal(std::string(line.substr(7)));
+        }
+    }
+}
+
+bool ManagementClient::parseStateLine(std::string_view payload, StateNotification& notification) {
+    auto fields = splitFields(payload);
+    if (fields.size() < 2) {
+        return false;
+    }
+
+    notification.timestamp = std::strtoll(std::string(fields[0]).c_str(), nullptr, 10);
+    notification.name = std::string(fields[1]);
+    notification.state = parseState(fields[1]);
+    notification.description = fields.size() > 2 ? std::string(fields[2]) : std::string();
+    notification.localIp = fields.size() > 3 ? std::string(fields[3]) : std::string();
+    notification.remoteIp = fields.size() > 4 ? std::string(fields[4]) : std::string();
+    return true;
+}
+
+ManagementState ManagementClient::parseState(std::string_view name) {
+    if (name == "CONNECTING") return ManagementState::Connecting;
+    if (name == "WAIT") return ManagementState::Wait;
+    if (name == "AUTH") return ManagementState::Auth;
+    if (name == "GET_CONFIG") return ManagementState::GetConfig;
+    if (name == "ASSIGN_IP") return ManagementState::AssignIp;
+    if (name == "ADD_ROUTES") return ManagementState::AddRoutes;
+    if (name == "CONNECTED") return ManagementState::Connected;
+    if (name == "RECONNECTING") return ManagementState::Reconnecting;
+    if (name == "EXITING") return ManagementState::Exiting;
+    if (name == "RESOLVE") return ManagementState::Resolve;
+    if (name == "TCP_CONNECT") return ManagementState::TcpConnect;
+    if (name == "AUTH_PENDING") return ManagementState::AuthPending;
+    return ManagementState::Unknown;
+}
+
+std::string ManagementClient::quoteArgument(std::string_view value) {
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    quoted += '"';
+    return quoted;
+}
+
+uint16_t ManagementClient::findFreePort() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    uint16_t port = 0;
+    SocketHandle s = openStreamSocket(AF_INET, IPPROTO_TCP);
+    if (s != kInvalidSocket) {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+#ifdef _WIN32
+        int length = sizeof(address);
+        if (bind(static_cast<SOCKET>(s), reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+            getsockname(static_cast<SOCKET>(s), reinterpret_cast<sockaddr*>(&address), &length) == 0) {
+            port = ntohs(address.sin_port);
+        }
+#else
+        socklen_t length = sizeof(address);
+        if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+            getsockname(s, reinterpret_cast<sockaddr*>(&address), &length) == 0) {
+            port = ntohs(address.sin_port);
+        }
+#endif
+        closeSocket(s);
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return port;
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace openvpn_flutter {
+
+// Native socket handle (SOCKET on Windows, file descriptor elsewhere)
+#ifdef _WIN32
+using SocketHandle = std::uintptr_t;
+#else
+using SocketHandle = int;
+#endif
+
+// OpenVPN connection states reported by `>STATE:` notifications
+enum class ManagementState {
+    Unknown,
+    Connecting,
+    Wait,
+    Auth,
+    GetConfig,
+    AssignIp,
+    AddRoutes,
+    Connected,
+    Reconnecting,
+    Exiting,
+    Resolve,
+    TcpConnect,
+    AuthPending
+};
+
+struct StateNotification {
+    ManagementState state = ManagementState::Unknown;
+    std::string name;         // Raw state name, e.g. "CONNECTED"
+    std::string description;  // e.g. "SUCCESS" or the reconnect reason
+    std::string localIp;
+    std::string remoteIp;
+    int64_t timestamp = 0;
+};
+
+// Client for the OpenVPN management interface (openvpn --management).
+//
+// The client never blocks on reads: the owner calls pump() whenever the socket
+// is readable (or periodically) and notifications are dispatched to the
+// callbacks on the calling thread. It is portable so it can be exercised
+// against a local fake management server on Linux.
+class ManagementClient {
+private:
+    SocketHandle sock;
+    bool connected = false;
+    std::string readBuffer;
+    // A line grew past kMaxLineLength; the rest of it is skipped
+    bool discardingLine = false;
+    // Sent when openvpn asks for it (--management ... pw-file)
+    std::string password;
+
+public:
+    std::function<void(const StateNotification&)> onState;
+    std::function<void(const std::string&)> onFatal;
+    // Totals pushed by `bytecount N` every N seconds
+    std::function<void(uint64_t bytesIn, uint64_t bytesOut)> onByteCount;
+    // `>PASSWORD:` prompts (--management-query-passwords): openvpn needs the
+    // credentials of `realm` (e.g. "Auth"), or the server rejected them
+    std::function<void(const std::string& realm, bool verificationFailed)> onPassword;
+
+    // Longest line kept; openvpn's own lines are far shorter, a peer that
+    // never ends one must not grow the buffer without bound
+    static constexpr size_t kMaxLineLength = 64 * 1024;
+
+    ManagementClient();
+    ~ManagementClient();
+
+    ManagementClient(const ManagementClient&) = delete;
+    ManagementClient& operator=(const ManagementClient&) = delete;
+
+    // Try to attach to a management interface listening on host:port.
+    // Fails immediately if nothing is listening yet.
+    bool connect(const std::string& host, uint16_t port);
+#ifndef _WIN32
+    // Same for a unix socket (--management <path> unix)
+    bool connectUnix(const std::string& path);
+#endif
+    // Answer to the ENTER PASSWORD: prompt of a management interface that
+    // has a password file; set before connecting
+    void setPassword(std::string value);
+    void close();
+    bool isConnected() const;
+    SocketHandle getSocket() const;
+
+    // Send a single command line (without terminator)
+    bool sendCommand(std::string_view command);
+    // Answer a `>PASSWORD:Need '<realm>' username/password` prompt
+    bool sendCredentials(std::string_view realm, std::string_view username, std::string_view password);
+
+    // Read everything that is available and dispatch complete lines.
+    // Returns false once the connection has been closed.
+    bool pump();
+
+    // Feed raw protocol bytes, as if received from the socket
+    void feed(std::string_view data);
+
+    static bool parseStateLine(std::string_view payload, StateNotification& notification);
+    static ManagementState parseState(std::string_view name);
+    // Double-quoted command argument, backslashes and '"' escaped
+    static std::string quoteArgument(std::string_view value);
+
+    // Ask the OS for a currently unused loopback TCP port
+    static uint16_t findFreePort();
+
+private:
+    void handleLine(std::string_view line);
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,120 @@
+#include "memory_packet_ring.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr uint32_t kHeaderSize = sizeof(uint32_t);
+
+uint32_t recordSize(uint32_t size, uint32_t alignment) {
+    return (kHeaderSize + size + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+MemoryPacketRing::Queue::Queue(uint32_t capacity)
+    : buffer(new uint8_t[capacity + recordSize(kMaxPacketSize, kAlignment)]), capacity(capacity) {
+}
+
+uint8_t* MemoryPacketRing::Queue::allocate(uint32_t size) {
+    if (size == 0 || size > kMaxPacketSize) {
+        return nullptr;
+    }
+    uint32_t length = recordSize(size, kAlignment);
+    if (reserved + length - head.load(std::memory_order_acquire) > capacity) {
+        return nullptr;
+    }
+    uint8_t* record = buffer.get() + (reserved & (capacity - 1));
+    memcpy(record, &size, kHeaderSize);
+    reserved += length;
+    return record + kHeaderSize;
+}
+
+void MemoryPacketRing::Queue::publish(const uint8_t* packet) {
+    // Packets are published in the order they were allocated
+    uint32_t size;
+    memcpy(&size, packet - kHeaderSize, kHeaderSize);
+    tail.store(tail.load(std::memory_order_relaxed) + recordSize(size, kAlignment), std::memory_order_release);
+}
+
+size_t MemoryPacketRing::Queue::read(Packet* packets, size_t maxCount) {
+    uint64_t cursor = head.load(std::memory_order_relaxed);
+    uint64_t end = tail.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (count < maxCount && cursor != end) {
+        const uint8_t* record = buffer.get() + (cursor & (capacity - 1));
+        uint32_t size;
+        memcpy(&size, record, kHeaderSize);
+        packets[count].data = record + kHeaderSize;
+        packets[count].size = size;
+        count++;
+        cursor += recordSize(size, kAlignment);
+    }
+    readEnd = cursor;
+    return count;
+}
+
+void MemoryPacketRing::Queue::release() {
+    head.store(readEnd, std::memory_order_release);
+}
+
+MemoryPacketRing::MemoryPacketRing(uint32_t capacity) : inbound(capacity), outbound(capacity) {
+}
+
+size_t MemoryPacketRing::receive(Packet* packets, size_t maxCount) {
+    return inbound.read(packets, maxCount);
+}
+
+void MemoryPacketRing::release(const Packet*, size_t) {
+    inbound.release();
+}
+
+uint8_t* MemoryPacketRing::allocateSend(uint32_t size) {
+    return outbound.allocate(size);
+}
+
+void MemoryPacketRing::send(uint8_t* packet) {
+    outbound.publish(packet);
+}
+
+bool MemoryPacketRing::waitReadable(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(waitMutex);
+    // Announce the wait before looking again, so inject() either sees it or
+    // its packet is seen here
+    waiting.store(true);
+    auto ready = [this]() {
+        return woken || inbound.head.load(std::memory_order_relaxed) != inbound.tail.load();
+    };
+    bool signalled = readable.wait_for(lock, std::chrono::milliseconds(timeoutMs), ready);
+    waiting.store(false);
+    bool wasWoken = woken;
+    woken = false;
+    return signalled && !wasWoken;
+}
+
+void MemoryPacketRing::wake() {
+    std::lock_guard<std::mutex> lock(waitMutex);
+    woken = true;
+    readable.notify_all();
+}
+
+bool MemoryPacketRing::inject(const uint8_t* data, uint32_t size) {
+    uint8_t* packet = inbound.allocate(size);
+    if (!packet) {
+        return false;
+    }
+    memcpy(packet, data, size);
+    inbound.publish(packet);
+    // Only a sleeping receiver costs the lock
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        readable.notify_one();
+    }
+    return true;
+}
+
+} // namespace openvpn_flutter
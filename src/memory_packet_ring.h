@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "packet_ring.h"
+
+namespace openvpn_flutter {
+
+// PacketRing in process memory, laid out like a WinTun ring: each packet is
+// a 4-byte size and its payload, 16-byte aligned, in a power-of-two buffer
+// with room for one more maximum-size packet past its end so that a packet
+// never wraps. inject() and drainSent() play the OS's side, so the pump and
+// its sinks can be run and benchmarked without a device.
+class MemoryPacketRing : public PacketRing {
+public:
+    static constexpr uint32_t kMaxPacketSize = 0xFFFF;
+    static constexpr uint32_t kDefaultCapacity = 1 << 20;
+
+private:
+    static constexpr uint32_t kAlignment = 16;
+
+    // One direction: a single producer and a single consumer
+    struct Queue {
+        std::unique_ptr<uint8_t[]> buffer;
+        uint32_t capacity = 0;
+        alignas(64) std::atomic<uint64_t> head{0}; // Consumer: first byte not released
+        alignas(64) std::atomic<uint64_t> tail{0}; // Producer: first byte not published
+        alignas(64) uint64_t reserved = 0;         // Producer: end of allocated packets
+        uint64_t readEnd = 0;                      // Consumer: end of the last receive
+
+        explicit Queue(uint32_t capacity);
+        uint8_t* allocate(uint32_t size);
+        void publish(const uint8_t* packet);
+        size_t read(Packet* packets, size_t maxCount);
+        void release();
+    };
+
+    Queue inbound;  // OS to process
+    Queue outbound; // Process to OS
+
+    std::mutex waitMutex;
+    std::condition_variable readable;
+    std::atomic<bool> waiting{false};
+    bool woken = false;
+
+public:
+    explicit MemoryPacketRing(uint32_t capacity = kDefaultCapacity);
+
+    size_t receive(Packet* packets, size_t maxCount) override;
+    void release(const Packet* packets, size_t count) override;
+    uint8_t* allocateSend(uint32_t size) override;
+    void send(uint8_t* packet) override;
+    bool waitReadable(int timeoutMs) override;
+    void wake() override;
+
+    // The OS's side: queue a packet for receive(), false if the ring is full
+    bool inject(const uint8_t* data, uint32_t size);
+    // The OS's side: takes every packet sent so far, visit(const Packet&) each
+    template <typename Visit>
+    size_t drainSent(Visit&& visit) {
+        Packet packets[64];
+        size_t total = 0;
+        while (size_t count = outbound.read(packets, 64)) {
+            for (size_t i = 0; i < count; i++) {
+                visit(packets[i]);
+            }
+            outbound.release();
+            total += count;
+        }
+        return total;
+    }
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,164 @@
+#include "output_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr uint16_t kNoNode = 0xFFFF;
+
+} // namespace
+
+// OutputMatcher
+
+OutputMatcher::OutputMatcher(const std::vector<Phrase>& phrases) {
+    for (const auto& phrase : phrases) {
+        for (const char* c = phrase.text; *c; c++) {
+            uint8_t byte = static_cast<uint8_t>(*c);
+            if (symbols[byte] == kOtherSymbol) {
+                symbols[byte] = static_cast<uint8_t>(symbolCount++);
+            }
+        }
+    }
+
+    // Trie of the phrases
+    next.assign(symbolCount, kNoNode);
+    matched.assign(1, OutputEvent::None);
+    for (const auto& phrase : phrases) {
+        size_t node = 0;
+        for (const char* c = phrase.text; *c; c++) {
+            size_t slot = node * symbolCount + symbols[static_cast<uint8_t>(*c)];
+            if (next[slot] == kNoNode) {
+                next[slot] = static_cast<uint16_t>(matched.size());
+                next.resize(next.size() + symbolCount, kNoNode);
+                matched.push_back(OutputEvent::None);
+            }
+            node = next[slot];
+        }
+        matched[node] = std::max(matched[node], phrase.event);
+    }
+
+    // Breadth first, so a node's failure link is finished before its children;
+    // missing edges borrow the failure link's, which turns the trie into a DFA
+    std::vector<uint16_t> fail(matched.size(), 0);
+    std::queue<uint16_t> pending;
+    for (size_t s = 0; s < symbolCount; s++) {
+        uint16_t& child = next[s];
+        if (child == kNoNode) {
+            child = 0;
+        } else {
+            pending.push(child);
+        }
+    }
+    while (!pending.empty()) {
+        uint16_t node = pending.front();
+        pending.pop();
+        matched[node] = std::max(matched[node], matched[fail[node]]);
+        for (size_t s = 0; s < symbolCount; s++) {
+            uint16_t& child = next[node * symbolCount + s];
+            uint16_t fallback = next[fail[node] * symbolCount + s];
+            if (child == kNoNode) {
+                child = fallback;
+            } else {
+                fail[child] = fallback;
+                pending.push(child);
+            }
+        }
+    }
+}
+
+OutputEvent OutputMatcher::match(const char* data, size_t size) const {
+    OutputEvent best = OutputEvent::None;
+    size_t node = 0;
+    for (size_t i = 0; i < size; i++) {
+        node = next[node * symbolCount + symbols[static_cast<uint8_t>(data[i])]];
+        best = std::max(best, matched[node]);
+    }
+    return best;
+}
+
+const OutputMatcher& OutputMatcher::openvpn() {
+    static const OutputMatcher matcher({
+        {"Initialization Sequence Completed", OutputEvent::Connected},
+        {"Initialization Sequence Completed With Errors", OutputEvent::ConnectedWithErrors},
+        {"AUTH_FAILED", OutputEvent::AuthFailed},
+        {"TLS Error", OutputEvent::TlsError},
+        {"route addition failed", OutputEvent::RouteError},
+        {"route add command failed", OutputEvent::RouteError},
+    });
+    return matcher;
+}
+
+// OutputParser
+
+OutputParser::OutputParser(const OutputMatcher& matcher) : matcher(matcher) {
+    partial.reserve(kMaxLineLength);
+}
+
+void OutputParser::feed(const char* data, size_t size, const LineHandler& handler) {
+    const char* end = data + size;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<size_t>(end - data)));
+        const char* segmentEnd = newline ? newline : end;
+        size_t room = kMaxLineLength - std::min(partial.size(), kMaxLineLength);
+        partial.append(data, std::min(room, static_cast<size_t>(segmentEnd - data)));
+        if (!newline) {
+            break;
+        }
+        finishLine(handler);
+        data = newline + 1;
+    }
+}
+
+void OutputParser::finish(const LineHandler& handler) {
+    finishLine(handler);
+}
+
+void OutputParser::finishLine(const LineHandler& handler) {
+    if (!partial.empty() && partial.back() == '\r') {
+        partial.pop_back();
+    }
+    if (partial.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (history.size() < kHistoryLines) {
+            history.resize(kHistoryLines);
+        }
+        history[historyNext].assign(partial);
+        historyNext = (historyNext + 1) % kHistoryLines;
+        historySize = std::min(historySize + 1, kHistoryLines);
+        lineCount++;
+    }
+    OutputEvent event = matcher.match(partial.data(), partial.size());
+    if (handler) {
+        handler(partial, event);
+    }
+    partial.clear();
+}
+
+void OutputParser::reset() {
+    partial.clear();
+}
+
+std::vector<std::string> OutputParser::recent(size_t maxCount) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = std::min(maxCount, historySize);
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (size_t i = count; i > 0; i--) {
+        lines.push_back(history[(historyNext + kHistoryLines - i) % kHistoryLines]);
+    }
+    return lines;
+}
+
+uint64_t OutputParser::getLineCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lineCount;
+}
+
+} // namespace openvpn_flutter
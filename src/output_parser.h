@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace openvpn_flutter {
+
+// Log lines of openvpn that mean something for the connection stage
+enum class OutputEvent : uint8_t {
+    None,
+    Connected,            // Initialization Sequence Completed
+    ConnectedWithErrors,  // ... With Errors (usually a route that failed)
+    AuthFailed,           // AUTH_FAILED pushed by the server
+    TlsError,             // TLS handshake did not complete
+    RouteError            // A route could not be added
+};
+
+// Finds every known phrase of a line in one pass: the phrases are compiled
+// once into an Aho-Corasick automaton over a compact alphabet, so a line costs
+// one table lookup per byte whatever the number of phrases.
+class OutputMatcher {
+private:
+    static constexpr uint8_t kOtherSymbol = 0;  // Bytes that appear in no phrase
+
+    uint8_t symbols[256] = {};        // Byte -> symbol
+    size_t symbolCount = 1;
+    std::vector<uint16_t> next;       // Node * symbolCount + symbol -> node
+    std::vector<OutputEvent> matched; // Strongest event ending at each node
+
+public:
+    struct Phrase {
+        const char* text;
+        OutputEvent event;
+    };
+
+    // When phrases overlap the event listed last in OutputEvent wins
+    explicit OutputMatcher(const std::vector<Phrase>& phrases);
+
+    OutputEvent match(const char* data, size_t size) const;
+
+    // The phrases openvpn prints for the events above
+    static const OutputMatcher& openvpn();
+};
+
+// Splits the child's output into lines, keeps the last kHistoryLines of them
+// and reports the event of each line. feed() is called from one thread at a
+// time; recent() may be called from any.
+class OutputParser {
+public:
+    static constexpr size_t kHistoryLines = 200;
+    static constexpr size_t kMaxLineLength = 1024;  // Longer lines are cut
+
+    using LineHandler = std::function<void(const std::string& line, OutputEvent event)>;
+
+private:
+    const OutputMatcher& matcher;
+    std::string partial;  // Line still missing its newline
+
+    mutable std::mutex mutex;
+    std::vector<std::string> history;  // Ring, reused so lines keep their capacity
+    size_t historyNext = 0;
+    size_t historySize = 0;
+    uint64_t lineCount = 0;
+
+    void finishLine(const LineHandler& handler);
+
+public:
+    explicit OutputParser(const OutputMatcher& matcher = OutputMatcher::openvpn());
+
+    OutputParser(const OutputParser&) = delete;
+    OutputParser& operator=(const OutputParser&) = delete;
+
+    // Calls handler for every completed line
+    void feed(const char* data, size_t size, const LineHandler& handler);
+    // The pipe closed: a last line without newline still counts
+    void finish(const LineHandler& handler);
+
+    // Start over for a new process; the history is kept until lines replace it
+    void reset();
+
+    // Most recent lines, oldest first
+    std::vector<std::string> recent(size_t maxCount = kHistoryLines) const;
+    uint64_t getLineCount() const;
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,215 @@
+#include "output_pipe.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <string>
+
+namespace openvpn_flutter {
+
+namespace {
+
+#ifdef _WIN32
+const NativeHandle kNoHandle = NULL;
+
+void closeNative(NativeHandle& handle) {
+    if (handle) {
+        CloseHandle(handle);
+        handle = NULL;
+    }
+}
+#else
+const NativeHandle kNoHandle = -1;
+
+void closeNative(NativeHandle& handle) {
+    if (handle >= 0) {
+        ::close(handle);
+        handle = -1;
+    }
+}
+#endif
+
+} // namespace
+
+OutputPipe::OutputPipe() : readEnd(kNoHandle), writeEnd(kNoHandle), readEvent(kNoHandle) {}
+
+OutputPipe::~OutputPipe() {
+    close();
+}
+
+bool OutputPipe::open() {
+    close();
+    buffer.resize(kReadSize);
+    closed = false;
+#ifdef _WIN32
+    // Unique per pipe; the first-instance flag makes sure nobody else owns it
+    static std::atomic<unsigned> counter{0};
+    std::string name = "\\\\.\\pipe\\openvpn_flutter_output_" + std::to_string(GetCurrentProcessId()) + "_" +
+                       std::to_string(counter++);
+    HANDLE server = CreateNamedPipeA(name.c_str(), PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                     PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                     1, 0, 64 * 1024, 0, NULL);
+    if (server == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    readEnd = server;
+
+    SECURITY_ATTRIBUTES inheritable = {sizeof(inheritable), NULL, TRUE};
+    HANDLE client = CreateFileA(name.c_str(), GENERIC_WRITE, 0, &inheritable, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    readEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (client == INVALID_HANDLE_VALUE || !readEvent) {
+        if (client != INVALID_HANDLE_VALUE) {
+            CloseHandle(client);
+        }
+        close();
+        return false;
+    }
+    writeEnd = client;
+
+    auto* request = new OVERLAPPED();
+    request->hEvent = readEvent;
+    overlapped = request;
+#else
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        return false;
+    }
+    // The child's copy loses O_CLOEXEC when it is dup2'ed onto stdout
+    readEnd = fds[0];
+    writeEnd = fds[1];
+    fcntl(readEnd, F_SETFL, fcntl(readEnd, F_GETFL) | O_NONBLOCK);
+#endif
+    // Nothing can arrive before the child starts, but the read has to be
+    // queued for the handle to become signalled
+    return startRead();
+}
+
+void OutputPipe::close() {
+#ifdef _WIN32
+    if (pending) {
+        // The buffer must outlive the read: wait for the cancellation to land
+        auto* request = static_cast<OVERLAPPED*>(overlapped);
+        DWORD transferred = 0;
+        CancelIoEx(readEnd, request);
+        GetOverlappedResult(readEnd, request, &transferred, TRUE);
+    }
+    delete static_cast<OVERLAPPED*>(overlapped);
+    overlapped = nullptr;
+    closeNative(readEvent);
+#endif
+    pending = false;
+    closeNative(readEnd);
+    closeNative(writeEnd);
+}
+
+bool OutputPipe::startRead() {
+#ifdef _WIN32
+    // A read that completes right away still signals the event and is
+    // collected by read() like any other
+    BOOL ok = ReadFile(readEnd, buffer.data(), static_cast<DWORD>(buffer.size()), NULL,
+                       static_cast<OVERLAPPED*>(overlapped));
+    if (ok || GetLastError() == ERROR_IO_PENDING) {
+        pending = true;
+        return true;
+    }
+    closed = true;
+    return false;
+#else
+    pending = true;
+    return true;
+#endif
+}
+
+bool OutputPipe::read(const DataHandler& handler, int waitMs) {
+    if (closed || readEnd == kNoHandle) {
+        return false;
+    }
+#ifdef _WIN32
+    if (!pending && !startRead()) {
+        return false;
+    }
+    auto* request = static_cast<OVERLAPPED*>(overlapped);
+    while (true) {
+        DWORD transferred = 0;
+        BOOL ok = waitMs > 0 ? GetOverlappedResultEx(readEnd, request, &transferred, static_cast<DWORD>(waitMs), FALSE)
+                             : GetOverlappedResult(readEnd, request, &transferred, FALSE);
+        if (!ok) {
+            DWORD error = GetLastError();
+            if (error == ERROR_IO_INCOMPLETE || error == WAIT_TIMEOUT) {
+                return true;  // Still in flight, the event fires when it lands
+            }
+            pending = false;
+            closed = true;  // ERROR_BROKEN_PIPE: the child and its copies are gone
+            return false;
+        }
+        pending = false;
+        if (transferred > 0 && handler) {
+            handler(buffer.data(), transferred);
+        }
+        if (!startRead()) {
+            return false;
+        }
+    }
+#else
+    while (true) {
+        ssize_t count = ::read(readEnd, buffer.data(), buffer.size());
+        if (count > 0) {
+            if (handler) {
+                handler(buffer.data(), static_cast<size_t>(count));
+            }
+            continue;
+        }
+        if (count == 0) {
+            pending = false;
+            closed = true;
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            closed = true;
+            return false;
+        }
+        if (waitMs <= 0) {
+            return true;
+        }
+        pollfd fd{readEnd, POLLIN, 0};
+        if (poll(&fd, 1, waitMs) <= 0) {
+            return true;
+        }
+    }
+#endif
+}
+
+NativeHandle OutputPipe::getChildHandle() const {
+    return writeEnd;
+}
+
+void OutputPipe::closeChildHandle() {
+    closeNative(writeEnd);
+}
+
+NativeHandle OutputPipe::getReadHandle() const {
+#ifdef _WIN32
+    return readEvent;
+#else
+    return readEnd;
+#endif
+}
+
+bool OutputPipe::isOpen() const {
+    return readEnd != kNoHandle && !closed;
+}
+
+} // namespace openvpn_flutter
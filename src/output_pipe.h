@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "wait_set.h"
+
+namespace openvpn_flutter {
+
+// Carries a child's stdout and stderr back to us. The child gets a plain,
+// inheritable write end; we read the other end asynchronously: overlapped
+// reads on a named pipe on Windows (anonymous pipes can't do overlapped I/O),
+// a non-blocking pipe elsewhere. getReadHandle() becomes signalled when a read
+// has completed, so the pipe can sit in a WaitSet next to the process.
+class OutputPipe {
+public:
+    using DataHandler = std::function<void(const char* data, size_t size)>;
+
+    static constexpr size_t kReadSize = 4096;
+
+private:
+    NativeHandle readEnd;
+    NativeHandle writeEnd;
+    NativeHandle readEvent;  // Signalled by the overlapped read (Windows)
+    void* overlapped = nullptr;
+    bool pending = false;    // A read is in flight
+    bool closed = false;     // The child's end is gone, everything was read
+    std::vector<char> buffer;
+
+    bool startRead();
+
+public:
+    OutputPipe();
+    ~OutputPipe();
+
+    OutputPipe(const OutputPipe&) = delete;
+    OutputPipe& operator=(const OutputPipe&) = delete;
+
+    bool open();
+    // Cancels the read in flight and closes both ends
+    void close();
+
+    // For the child's stdout/stderr; close our copy once the child has it
+    NativeHandle getChildHandle() const;
+    void closeChildHandle();
+
+    NativeHandle getReadHandle() const;
+
+    // Hands everything that arrived to handler and queues the next read.
+    // waitMs > 0 waits that long for a read in flight (the final drain after
+    // the child exited). Returns false once the child's end is closed.
+    bool read(const DataHandler& handler, int waitMs = 0);
+
+    bool isOpen() const;
+};
+
+} // namespace openvpn_flutter
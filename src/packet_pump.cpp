@@ -0,0 +1,98 @@
+#include "packet_pump.h"
+#include "logger.h"
+
+#include <chrono>
+#include <utility>
+
+namespace openvpn_flutter {
+
+void describePacket(Packet& packet) {
+    packet.ipVersion = 0;
+    packet.protocol = 0;
+    if (packet.size == 0) {
+        return;
+    }
+    uint8_t version = packet.data[0] >> 4;
+    if (version == 4 && packet.size >= 20) {
+        packet.ipVersion = 4;
+        packet.protocol = packet.data[9];
+    } else if (version == 6 && packet.size >= 40) {
+        packet.ipVersion = 6;
+        packet.protocol = packet.data[6];
+    }
+}
+
+PacketPump::PacketPump(PacketRing& ring, PacketSink sink) : ring(ring), sink(std::move(sink)) {
+}
+
+PacketPump::~PacketPump() {
+    stop();
+}
+
+void PacketPump::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    thread = std::thread(&PacketPump::run, this);
+}
+
+void PacketPump::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    ring.wake();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    LOG_DEBUG("Packet pump stopped after " << packets.load() << " packets in " << batches.load() << " batches");
+}
+
+bool PacketPump::isRunning() const {
+    return running;
+}
+
+void PacketPump::run() {
+    LOG_DEBUG("Packet pump started");
+    while (running.load(std::memory_order_relaxed)) {
+        if (pumpOnce() == 0) {
+            waits.fetch_add(1, std::memory_order_relaxed);
+            ring.waitReadable(kIdleWaitMs);
+        }
+    }
+}
+
+size_t PacketPump::pumpOnce() {
+    size_t count = ring.receive(batch, kBatchSize);
+    if (count == 0) {
+        return 0;
+    }
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    uint64_t batchBytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        describePacket(batch[i]);
+        batch[i].receivedNs = now;
+        batchBytes += batch[i].size;
+    }
+    if (sink) {
+        sink(batch, count);
+    }
+    ring.release(batch, count);
+
+    // One writer; relaxed stores keep the counters readable from any thread
+    packets.store(packets.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    bytes.store(bytes.load(std::memory_order_relaxed) + batchBytes, std::memory_order_relaxed);
+    batches.store(batches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return count;
+}
+
+PacketPump::Counters PacketPump::getCounters() const {
+    Counters counters;
+    counters.packets = packets.load(std::memory_order_relaxed);
+    counters.bytes = bytes.load(std::memory_order_relaxed);
+    counters.batches = batches.load(std::memory_order_relaxed);
+    counters.waits = waits.load(std::memory_order_relaxed);
+    return counters;
+}
+
+} // namespace openvpn_flutter
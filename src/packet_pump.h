@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "packet_ring.h"
+
+namespace openvpn_flutter {
+
+// Gets every batch the pump takes off its ring, on the pump thread. The
+// packets are released when it returns; a sink that keeps one copies it.
+using PacketSink = std::function<void(const Packet* packets, size_t count)>;
+
+// Moves packets from a ring to a sink (an in-process protocol engine, a pcap
+// tap) on a thread of its own: takes up to kBatchSize packets per receive
+// without copying them, tags them, hands the batch over and releases it, and
+// sleeps on the ring's read event when it runs dry.
+class PacketPump {
+public:
+    static constexpr size_t kBatchSize = 64;
+    // Longest sleep on an idle ring; stop() wakes the ring anyway
+    static constexpr int kIdleWaitMs = 1000;
+
+    struct Counters {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint64_t batches = 0;
+        uint64_t waits = 0; // Times the ring ran dry
+    };
+
+private:
+    PacketRing& ring;
+    PacketSink sink;
+    Packet batch[kBatchSize];
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> waits{0};
+
+    void run();
+
+public:
+    PacketPump(PacketRing& ring, PacketSink sink);
+    ~PacketPump();
+
+    PacketPump(const PacketPump&) = delete;
+    PacketPump& operator=(const PacketPump&) = delete;
+
+    void start();
+    // Returns once the pump thread is gone; the ring may be closed after
+    void stop();
+    bool isRunning() const;
+
+    // One receive, sink and release on the calling thread, instead of the
+    // pump thread; returns the number of packets
+    size_t pumpOnce();
+
+    Counters getCounters() const;
+};
+
+} // namespace openvpn_flutter
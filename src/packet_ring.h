@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace openvpn_flutter {
+
+// One packet taken off a ring. data points into the ring's own memory and
+// stays valid until the packet is released.
+struct Packet {
+    const uint8_t* data = nullptr;
+    uint32_t size = 0;
+    uint8_t ipVersion = 0;  // 4 or 6, 0 if the packet is not IP
+    uint8_t protocol = 0;   // IPPROTO_* of the IPv4 header or the IPv6 next header
+    int64_t receivedNs = 0; // steady_clock, when its batch was taken off the ring
+};
+
+// Fills ipVersion and protocol from the packet's IP header
+void describePacket(Packet& packet);
+
+// Packet queues between the OS and the process for one layer 3 device: a
+// WinTun session, a Linux tun device, or memory for benchmarks. One thread
+// receives and one thread sends; wake() may be called from any thread.
+class PacketRing {
+public:
+    virtual ~PacketRing() = default;
+
+    // Takes up to maxCount packets the OS has queued, without copying them;
+    // fills data and size only. Returns 0 if none are waiting.
+    virtual size_t receive(Packet* packets, size_t maxCount) = 0;
+    // Gives the packets of the last receive() back, before the next receive()
+    virtual void release(const Packet* packets, size_t count) = 0;
+
+    // Room for one packet to the OS, nullptr if the ring is full or size is
+    // too large; fill it and pass it to send()
+    virtual uint8_t* allocateSend(uint32_t size) = 0;
+    virtual void send(uint8_t* packet) = 0;
+
+    // Blocks until packets may be waiting, wake() is called or timeoutMs
+    // passes; false if nothing became readable
+    virtual bool waitReadable(int timeoutMs) = 0;
+    virtual void wake() = 0;
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,99 @@
+#include "pcap_writer.h"
+#include "logger.h"
+
+#include <chrono>
+
+namespace openvpn_flutter {
+
+namespace {
+
+constexpr uint32_t kPcapMagic = 0xa1b2c3d4; // Microsecond timestamps, written in host order
+constexpr uint32_t kLinkTypeRaw = 101;
+constexpr size_t kWriteBuffer = 1 << 16;
+
+struct FileHeader {
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLength;
+    uint32_t linkType;
+};
+
+struct RecordHeader {
+    uint32_t seconds;
+    uint32_t microseconds;
+    uint32_t capturedLength;
+    uint32_t originalLength;
+};
+
+} // namespace
+
+PcapWriter::PcapWriter(uint32_t snapLength) : snapLength(snapLength) {
+}
+
+PcapWriter::~PcapWriter() {
+    close();
+}
+
+bool PcapWriter::open(const std::string& path) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Failed to create capture file " << path);
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, kWriteBuffer);
+    FileHeader header{kPcapMagic, 2, 4, 0, 0, snapLength, kLinkTypeRaw};
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    using namespace std::chrono;
+    wallOffsetNs = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count() -
+                   duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    written = 0;
+    LOG_INFO("Capturing packets to " << path);
+    return true;
+}
+
+void PcapWriter::close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+        LOG_INFO("Capture closed after " << written << " packets");
+    }
+}
+
+bool PcapWriter::isOpen() const {
+    return file != nullptr;
+}
+
+void PcapWriter::write(const Packet* packets, size_t count) {
+    if (!file) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const Packet& packet = packets[i];
+        int64_t wallNs = packet.receivedNs + wallOffsetNs;
+        RecordHeader record;
+        record.seconds = static_cast<uint32_t>(wallNs / 1000000000);
+        record.microseconds = static_cast<uint32_t>(wallNs % 1000000000 / 1000);
+        record.capturedLength = packet.size < snapLength ? packet.size : snapLength;
+        record.originalLength = packet.size;
+        std::fwrite(&record, sizeof(record), 1, file);
+        std::fwrite(packet.data, 1, record.capturedLength, file);
+    }
+    written += count;
+}
+
+void PcapWriter::flush() {
+    if (file) {
+        std::fflush(file);
+    }
+}
+
+uint64_t PcapWriter::packetCount() const {
+    return written;
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "packet_ring.h"
+
+namespace openvpn_flutter {
+
+// Packet sink that writes a pcap file (LINKTYPE_RAW, packets start at the IP
+// header) for Wireshark or tcpdump -r. Bind it to a pump with
+//   PacketPump pump(ring, [&tap](const Packet* p, size_t n) { tap.write(p, n); });
+// Writes are buffered; call it from one thread.
+class PcapWriter {
+private:
+    FILE* file = nullptr;
+    uint32_t snapLength;
+    int64_t wallOffsetNs = 0; // system_clock minus steady_clock at open
+    uint64_t written = 0;
+
+public:
+    static constexpr uint32_t kDefaultSnapLength = 0xFFFF;
+
+    explicit PcapWriter(uint32_t snapLength = kDefaultSnapLength);
+    ~PcapWriter();
+
+    PcapWriter(const PcapWriter&) = delete;
+    PcapWriter& operator=(const PcapWriter&) = delete;
+
+    // Truncates the file and writes the header
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    void write(const Packet* packets, size_t count);
+    void flush();
+    uint64_t packetCount() const;
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,41 @@
+#include "platform_dispatcher.h"
+
+#include <utility>
+
+namespace openvpn_flutter {
+
+void PlatformDispatcher::setWakeCallback(std::function<void()> callback) {
+    wake = std::move(callback);
+}
+
+bool PlatformDispatcher::canDispatch() const {
+    return static_cast<bool>(wake);
+}
+
+void PlatformDispatcher::post(std::function<void()> task) {
+    bool needsWake;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(task));
+        needsWake = !wakePending;
+        wakePending = true;
+    }
+    // One wake-up per batch; drain() takes everything posted until then
+    if (needsWake && wake) {
+        wake();
+    }
+}
+
+void PlatformDispatcher::drain() {
+    std::deque<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.swap(pending);
+        wakePending = false;
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+} // namespace openvpn_flutter
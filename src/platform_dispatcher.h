@@ -0,0 +1,30 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace openvpn_flutter {
+
+// Runs closures on the platform thread. Workers post() results here; the wake
+// callback (a posted window message in the plugin) schedules drain() on the
+// platform thread, where method results and event sinks may be used.
+class PlatformDispatcher {
+private:
+    std::mutex mutex;
+    std::deque<std::function<void()>> pending;
+    std::function<void()> wake;
+    bool wakePending = false;
+
+public:
+    // Set once on the platform thread before anything is posted
+    void setWakeCallback(std::function<void()> callback);
+    bool canDispatch() const;
+
+    // Any thread
+    void post(std::function<void()> task);
+    // Platform thread: run everything posted so far
+    void drain();
+};
+
+} // namespace openvpn_flutter
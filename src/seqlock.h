@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace openvpn_flutter {
+
+// Latest value of a small trivially copyable T, written by one thread and
+// read by any number of others without locks. The writer bumps a sequence
+// number to odd, stores the value and bumps it to even; a reader copies the
+// value between two reads of the sequence and keeps the copy only if both
+// were the same even number, so it never sees half of one write and half of
+// another. Reads never block and writes never wait for readers; a reader
+// only copies again if it overlapped a write.
+//
+// The value is held in relaxed atomic words rather than a plain T, so
+// concurrent copying is not a data race.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock holds trivially copyable values");
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence{0};
+    std::array<std::atomic<uint64_t>, kWords> words{};
+
+public:
+    SeqLock() { store(T{}); }
+    explicit SeqLock(const T& value) { store(value); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // One writer at a time
+    void store(const T& value) {
+        uint64_t buffer[kWords] = {};
+        memcpy(buffer, &value, sizeof(T));
+        uint64_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t buffer[kWords];
+        while (true) {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kWords; i++) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t after = sequence.load(std::memory_order_relaxed);
+            if (before == after && (before & 1) == 0) {
+                break;
+            }
+        }
+        T value;
+        memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+};
+
+} // namespace openvpn_flutter
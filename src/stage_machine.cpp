@@ -0,0 +1,183 @@
+#include "stage_machine.h"
+#include "logger.h"
+
+#include <utility>
+
+namespace openvpn_flutter {
+
+StageMachine::StageMachine(std::string tunnelId, ConnectMetrics& metrics, Emit emit)
+    : tunnelId(std::move(tunnelId)), metrics(metrics), emit(std::move(emit)) {
+}
+
+void StageMachine::connectRequested() {
+    connectRequestedAt = Clock::now();
+    timingConnect = false;
+    timingReconnect = false;
+}
+
+void StageMachine::processStarted() {
+    connected = false;
+    connecting = true;
+    connectDeadline = Clock::now() + kConnectTimeout;
+    timingConnect = true;
+    tlsFailed = false;
+}
+
+void StageMachine::reset() {
+    connected = false;
+    connecting = false;
+}
+
+void StageMachine::onManagementState(const StateNotification& notification) {
+    LOG_INFO("OpenVPN state: " << notification.name
+             << (notification.description.empty() ? "" : " (" + notification.description + ")"));
+
+    switch (notification.state) {
+        case ManagementState::Connected:
+            recordConnected();
+            connecting = false;
+            connected = true;
+            LOG_INFO("VPN connection established successfully, local IP: " << notification.localIp
+                     << ", " << std::chrono::duration_cast<std::chrono::milliseconds>(
+                            Clock::now() - connectRequestedAt).count()
+                     << " ms after connect was requested");
+            break;
+        case ManagementState::Reconnecting:
+            // Connection lost, openvpn is retrying on its own
+            if (connected && !timingReconnect.exchange(true)) {
+                reconnectStartedAt = Clock::now();
+            }
+            connected = false;
+            connecting = true;
+            connectDeadline = Clock::now() + kConnectTimeout;
+            tlsFailed = false;
+            break;
+        case ManagementState::Exiting:
+            connected = false;
+            connecting = false;
+            break;
+        default:
+            break;
+    }
+
+    VpnStage stage;
+    if (stageForState(notification.state, stage)) {
+        emit(stage, VpnError::None);
+    }
+}
+
+void StageMachine::onOutput(const std::string& line, OutputEvent event) {
+    switch (event) {
+        case OutputEvent::Connected:
+        case OutputEvent::ConnectedWithErrors:
+            if (event == OutputEvent::ConnectedWithErrors) {
+                LOG_WARN("OpenVPN connected with errors (tunnel " << tunnelId << ")");
+            }
+            // The management interface reports the same; whichever comes first counts
+            recordConnected();
+            if (connecting) {
+                connecting = false;
+                connected = true;
+                emit(VpnStage::Connected, VpnError::None);
+            }
+            break;
+        case OutputEvent::AuthFailed:
+            LOG_ERROR("OpenVPN authentication failed (tunnel " << tunnelId << "): " << line);
+            onAuthFailed();
+            break;
+        case OutputEvent::TlsError:
+            // openvpn retries on its own and may still connect; the connect
+            // deadline decides when the attempt has failed
+            if (connecting) {
+                LOG_ERROR("OpenVPN TLS handshake failed (tunnel " << tunnelId << "): " << line);
+                tlsFailed = true;
+            } else {
+                LOG_WARN("OpenVPN TLS error (tunnel " << tunnelId << "): " << line);
+            }
+            break;
+        case OutputEvent::RouteError:
+            LOG_WARN("OpenVPN could not add a route (tunnel " << tunnelId << "): " << line);
+            break;
+        case OutputEvent::None:
+            break;
+    }
+}
+
+void StageMachine::onFatal() {
+    connected = false;
+    connecting = false;
+    emit(VpnStage::Error, VpnError::FatalError);
+}
+
+void StageMachine::onAuthFailed() {
+    connected = false;
+    connecting = false;
+    emit(VpnStage::Error, VpnError::AuthFailed);
+}
+
+void StageMachine::onExit(bool waitFailed) {
+    connected = false;
+    connecting = false;
+    if (waitFailed) {
+        emit(VpnStage::Error, VpnError::WaitFailed);
+    } else {
+        emit(VpnStage::Disconnected, VpnError::None);
+    }
+}
+
+bool StageMachine::checkDeadline(Clock::time_point now) {
+    if (connecting && now > connectDeadline) {
+        LOG_ERROR("VPN connection timeout (tunnel " << tunnelId << ")");
+        connected = false;
+        connecting = false;
+        emit(VpnStage::Error, tlsFailed ? VpnError::TlsError : VpnError::ConnectTimeout);
+        return false;
+    }
+    return true;
+}
+
+bool StageMachine::isConnected() const {
+    return connected;
+}
+
+bool StageMachine::isConnecting() const {
+    return connecting;
+}
+
+bool StageMachine::isActive() const {
+    return connected || connecting;
+}
+
+StageMachine::Clock::time_point StageMachine::deadline() const {
+    return connectDeadline;
+}
+
+void StageMachine::recordConnected() {
+    auto now = Clock::now();
+    if (timingConnect.exchange(false)) {
+        metrics.record(ConnectPhase::Connect, now - connectRequestedAt);
+    }
+    if (timingReconnect.exchange(false)) {
+        metrics.record(ConnectPhase::Reconnect, now - reconnectStartedAt);
+    }
+}
+
+bool StageMachine::stageForState(ManagementState state, VpnStage& stage) {
+    switch (state) {
+        case ManagementState::Connecting: stage = VpnStage::Connecting; return true;
+        case ManagementState::Reconnecting: stage = VpnStage::Connecting; return true;
+        case ManagementState::TcpConnect: stage = VpnStage::TcpConnect; return true;
+        case ManagementState::Resolve: stage = VpnStage::Resolve; return true;
+        case ManagementState::Wait: stage = VpnStage::WaitConnection; return true;
+        case ManagementState::Auth: stage = VpnStage::Authenticating; return true;
+        case ManagementState::AuthPending: stage = VpnStage::Authenticating; return true;
+        case ManagementState::GetConfig: stage = VpnStage::GetConfig; return true;
+        case ManagementState::AssignIp: stage = VpnStage::AssignIp; return true;
+        case ManagementState::AddRoutes: stage = VpnStage::AssignIp; return true;
+        case ManagementState::Connected: stage = VpnStage::Connected; return true;
+        case ManagementState::Exiting: stage = VpnStage::Exiting; return true;
+        default: return false;
+    }
+}
+
+} // namespace openvpn_flutter
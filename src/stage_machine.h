@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include "latency_metrics.h"
+#include "management_client.h"
+#include "output_parser.h"
+#include "vpn_stage.h"
+
+namespace openvpn_flutter {
+
+// Connection flags of one tunnel and the stages they produce, shared by the
+// platform backends. The command thread starts and resets a session; the
+// monitor thread feeds it management states, openvpn's output, fatal errors,
+// the connect deadline and the process exit. Stages raised on the monitor
+// thread go out through emit (the tunnel's status queue).
+class StageMachine {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Emit = std::function<void(VpnStage stage, VpnError error)>;
+
+    static constexpr std::chrono::seconds kConnectTimeout{30};
+
+private:
+    std::string tunnelId;  // For log lines only
+    ConnectMetrics& metrics;
+    Emit emit;
+
+    std::atomic<bool> connected{false};
+    std::atomic<bool> connecting{false};
+    Clock::time_point connectRequestedAt;
+    Clock::time_point reconnectStartedAt;
+    Clock::time_point connectDeadline;
+    // Set until the connect (or reconnect) has been timed; Connected is
+    // reported by both the management interface and openvpn's output
+    std::atomic<bool> timingConnect{false};
+    std::atomic<bool> timingReconnect{false};
+    // A TLS handshake of this attempt failed; openvpn retries, so it only
+    // names the error once the deadline gives up on the attempt
+    std::atomic<bool> tlsFailed{false};
+
+    void recordConnected();
+
+public:
+    StageMachine(std::string tunnelId, ConnectMetrics& metrics, Emit emit);
+
+    StageMachine(const StageMachine&) = delete;
+    StageMachine& operator=(const StageMachine&) = delete;
+
+    // Command thread: a connect was requested, before any slow step
+    void connectRequested();
+    // Command thread: openvpn is running; arms the deadline and the connect timer
+    void processStarted();
+    // Command thread: stopped, or the start failed
+    void reset();
+
+    // Monitor thread
+    void onManagementState(const StateNotification& notification);
+    void onOutput(const std::string& line, OutputEvent event);
+    void onFatal();
+    void onAuthFailed();
+    // Reports Disconnected, or WaitFailed if the process could not be waited on
+    void onExit(bool waitFailed);
+    // Returns false once a connect outlived its deadline: the attempt is
+    // over (not active anymore) and reported as ConnectTimeout, or TlsError
+    // if handshakes failed. The caller stops openvpn.
+    bool checkDeadline(Clock::time_point now);
+
+    bool isConnected() const;
+    bool isConnecting() const;
+    bool isActive() const;
+    Clock::time_point deadline() const;
+
+    static bool stageForState(ManagementState state, VpnStage& stage);
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,62 @@
+#include "status_queue.h"
+
+#include <utility>
+
+namespace openvpn_flutter {
+
+void StatusQueue::setWakeCallback(std::function<void()> callback) {
+    wake = std::move(callback);
+}
+
+bool StatusQueue::push(const StageEvent& event) {
+    if (hasLastPushed && lastPushed.sameAs(event)) {
+        return false;
+    }
+    hasLastPushed = true;
+    lastPushed = event;
+
+    latest.store(event);
+    if (!ring.push(event)) {
+        // Consumer is far behind; it will catch up with `latest`
+        overflowed.store(true, std::memory_order_release);
+    }
+
+    if (!wakePending.exchange(true, std::memory_order_acq_rel) && wake) {
+        wake();
+    }
+    return true;
+}
+
+void StatusQueue::resetProducer() {
+    hasLastPushed = false;
+}
+
+void StatusQueue::drain(const std::function<void(const StageEvent&)>& deliver) {
+    // Re-arm first so a push racing with this drain wakes us again
+    wakePending.store(false, std::memory_order_release);
+
+    bool delivered = false;
+    StageEvent last;
+    StageEvent event;
+    while (ring.pop(event)) {
+        deliver(event);
+        delivered = true;
+        last = event;
+    }
+
+    if (overflowed.exchange(false, std::memory_order_acq_rel)) {
+        StageEvent newest = latest.load();
+        if (!delivered || !newest.sameAs(last)) {
+            deliver(newest);
+        }
+    }
+}
+
+void StatusQueue::clear() {
+    StageEvent event;
+    while (ring.pop(event)) {
+    }
+    overflowed.store(false, std::memory_order_release);
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+#include "seqlock.h"
+#include "vpn_stage.h"
+
+namespace openvpn_flutter {
+
+// Bounded single-producer/single-consumer ring. push() may only be called
+// from one thread at a time and pop() from another; neither ever blocks.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    alignas(64) std::atomic<size_t> head{0};  // Next slot to read (consumer)
+    alignas(64) std::atomic<size_t> tail{0};  // Next slot to write (producer)
+    alignas(64) T slots[Capacity];
+
+public:
+    bool push(const T& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[currentTail & (Capacity - 1)] = value;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+// Stage events from the monitor thread to the platform thread.
+//
+// Consecutive duplicates are coalesced on the producer side, and the consumer
+// is woken through a callback (a posted window message in the plugin) only when
+// the queue goes from idle to pending, so an idle tunnel causes no wake-ups.
+class StatusQueue {
+private:
+    SpscRing<StageEvent, 64> ring;
+    std::function<void()> wake;
+    std::atomic<bool> wakePending{false};
+
+    // Producer side
+    bool hasLastPushed = false;
+    StageEvent lastPushed;
+
+    // Newest event, delivered after a drain if the ring ever overflowed. A
+    // SeqLock since std::atomic of 16 bytes takes a lock on most targets.
+    SeqLock<StageEvent> latest;
+    std::atomic<bool> overflowed{false};
+
+public:
+    // Set before any producer runs
+    void setWakeCallback(std::function<void()> callback);
+
+    // Producer: queue an event, returns false if it repeats the previous one
+    bool push(const StageEvent& event);
+    // Producer: forget coalescing state, called before a new producer thread starts
+    void resetProducer();
+
+    // Consumer: deliver everything pending, in order
+    void drain(const std::function<void(const StageEvent&)>& deliver);
+    // Consumer: drop everything pending
+    void clear();
+};
+
+} // namespace openvpn_flutter
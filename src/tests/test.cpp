@@ -0,0 +1,86 @@
+#include "test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+
+namespace {
+
+struct Test {
+    const char* suite;
+    const char* name;
+    openvpn_flutter::test::Function function;
+};
+
+std::vector<Test>& registry() {
+    static std::vector<Test> tests;
+    return tests;
+}
+
+int failures = 0;  // Of the running test
+
+} // namespace
+
+namespace openvpn_flutter {
+namespace test {
+
+int registerTest(const char* suite, const char* name, Function function) {
+    registry().push_back(Test{suite, name, function});
+    return static_cast<int>(registry().size());
+}
+
+void fail(const char* file, int line, const std::string& message) {
+    failures++;
+    std::printf("  %s:%d: %s\n", file, line, message.c_str());
+}
+
+} // namespace test
+} // namespace openvpn_flutter
+
+int main(int argc, char** argv) {
+    using namespace openvpn_flutter;
+
+    // Runs every suite, or the one named on the command line
+    const char* suite = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            std::printf("usage: %s [SUITE]\n", argv[0]);
+            return 0;
+        }
+        suite = argv[i];
+    }
+
+    // Failures are reported by the tests, not by the code's own logging
+    Logger::instance().setLevel(LogLevel::Off);
+
+    int run = 0;
+    int failed = 0;
+    for (const auto& test : registry()) {
+        if (suite && std::strcmp(test.suite, suite) != 0) {
+            continue;
+        }
+        std::printf("[ RUN  ] %s.%s\n", test.suite, test.name);
+        std::fflush(stdout);
+        failures = 0;
+        try {
+            test.function();
+        } catch (const test::Abort&) {
+        } catch (const std::exception& e) {
+            test::fail(__FILE__, __LINE__, std::string("unexpected exception: ") + e.what());
+        }
+        std::printf("[ %s ] %s.%s\n", failures == 0 ? " OK " : "FAIL", test.suite, test.name);
+        run++;
+        failed += failures > 0 ? 1 : 0;
+    }
+
+    if (run == 0) {
+        std::printf("No tests in suite %s\n", suite ? suite : "(any)");
+        return 1;
+    }
+    std::printf("%d test(s), %d failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
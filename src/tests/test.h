@@ -0,0 +1,84 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace openvpn_flutter {
+namespace test {
+
+// Unit tests of the core library. Self-contained like the benchmarks; each
+// test is a function registered under a suite, and CTest runs one suite per
+// test so a failure names the module:
+//
+//   TEST(config_rewriter, drops_tap) {
+//       ConfigRewriter rewriter(ConfigRewriter::wintunRules());
+//       EXPECT_EQ(rewriter.rewrite("dev tap\n"), "windows-driver wintun\n");
+//   }
+//
+// EXPECT_* records a failure and carries on; REQUIRE ends the test.
+using Function = void (*)();
+
+// Called through TEST() at static initialization
+int registerTest(const char* suite, const char* name, Function function);
+
+// Records a failure of the running test
+void fail(const char* file, int line, const std::string& message);
+
+// Thrown by REQUIRE to leave the running test
+struct Abort {};
+
+template <typename T>
+std::string describe(const T& value) {
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+template <typename T>
+std::string describe(const std::vector<T>& values) {
+    std::string text = "{";
+    for (size_t i = 0; i < values.size(); i++) {
+        text += (i == 0 ? "" : ", ") + describe(values[i]);
+    }
+    return text + "}";
+}
+
+} // namespace test
+} // namespace openvpn_flutter
+
+#define OPENVPN_FLUTTER_TEST_CONCAT_(a, b) a##b
+#define OPENVPN_FLUTTER_TEST_CONCAT(a, b) OPENVPN_FLUTTER_TEST_CONCAT_(a, b)
+#define TEST(suite, name)                                                                      \
+    static void suite##_##name();                                                              \
+    static const int OPENVPN_FLUTTER_TEST_CONCAT(testRegistered_, __LINE__) =                  \
+        ::openvpn_flutter::test::registerTest(#suite, #name, suite##_##name);                  \
+    static void suite##_##name()
+
+#define EXPECT_TRUE(condition)                                                                 \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            ::openvpn_flutter::test::fail(__FILE__, __LINE__, "expected " #condition);         \
+        }                                                                                      \
+    } while (0)
+
+#define EXPECT_EQ(actual, expected)                                                            \
+    do {                                                                                       \
+        const auto& actualValue = (actual);                                                    \
+        const auto& expectedValue = (expected);                                                \
+        if (!(actualValue == expectedValue)) {                                                 \
+            ::openvpn_flutter::test::fail(__FILE__, __LINE__,                                  \
+                                          #actual " is " +                                     \
+                                              ::openvpn_flutter::test::describe(actualValue) + \
+                                              ", expected " +                                  \
+                                              ::openvpn_flutter::test::describe(expectedValue)); \
+        }                                                                                      \
+    } while (0)
+
+#define REQUIRE(condition)                                                                     \
+    do {                                                                                       \
+        if (!(condition)) {                                                                    \
+            ::openvpn_flutter::test::fail(__FILE__, __LINE__, "required " #condition);         \
+            throw ::openvpn_flutter::test::Abort{};                                            \
+        }                                                                                      \
+    } while (0)
@@ -0,0 +1,173 @@
+#include "test.h"
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "config_rewriter.h"
+
+using namespace openvpn_flutter;
+
+namespace {
+
+std::string wintun(const std::string& profile, RewriteResult* result = nullptr) {
+    return ConfigRewriter(ConfigRewriter::wintunRules()).rewrite(profile, result);
+}
+
+ConfigLine tokenize(std::string_view text) {
+    std::string_view openBlock;
+    return ConfigRewriter::tokenizeLine(text, openBlock);
+}
+
+} // namespace
+
+TEST(config_rewriter, untouched_profile_is_copied) {
+    ConfigRewriter rewriter(ConfigRewriter::baseRules());
+    std::string profile = "client\nremote vpn.example.com 1194\n# comment\n\nverb 3";
+    RewriteResult result;
+    EXPECT_EQ(rewriter.rewrite(profile, &result), profile);
+    EXPECT_EQ(result.lines, size_t(5));
+    EXPECT_EQ(result.dropped + result.replaced + result.inserted, size_t(0));
+}
+
+TEST(config_rewriter, comments_are_never_matched) {
+    std::string profile = "# dev tap\n; dev-type tap\n  # persist-tun\ndev tun\n";
+    EXPECT_EQ(wintun(profile), "# dev tap\n; dev-type tap\n  # persist-tun\ndev tun\nwindows-driver wintun\n");
+}
+
+TEST(config_rewriter, trailing_comment_ends_the_arguments) {
+    ConfigLine line = tokenize("remote vpn.example.com 1194 # primary ; really");
+    EXPECT_TRUE(line.kind == ConfigLine::Kind::Directive);
+    EXPECT_EQ(line.name, "remote");
+    EXPECT_EQ(line.argCount, size_t(2));
+    EXPECT_EQ(line.args[1], "1194");
+    EXPECT_EQ(wintun("dev tap # the old driver\nremote a\n"), "remote a\nwindows-driver wintun\n");
+}
+
+TEST(config_rewriter, quoted_arguments) {
+    ConfigLine line = tokenize("  auth-user-pass \"C:\\\\My Files\\\\auth.txt\" 'a # b'");
+    EXPECT_EQ(line.name, "auth-user-pass");
+    EXPECT_EQ(line.argCount, size_t(2));
+    EXPECT_EQ(line.args[0], "C:\\\\My Files\\\\auth.txt");
+    EXPECT_EQ(line.args[1], "a # b");
+
+    // The argument prefix is matched against the unquoted value
+    EXPECT_EQ(wintun("dev \"tap\"\ndev \"tun\"\n"), "dev \"tun\"\nwindows-driver wintun\n");
+}
+
+TEST(config_rewriter, inline_block_bodies_are_never_matched) {
+    std::string profile =
+        "client\n"
+        "<ca>\n"
+        "dev tap\n"
+        "remote not-a-directive\n"
+        "</ca>\n"
+        "remote vpn.example.com\n";
+    EXPECT_EQ(wintun(profile),
+              "client\n<ca>\ndev tap\nremote not-a-directive\n</ca>\nremote vpn.example.com\nwindows-driver wintun\n");
+    EXPECT_EQ(ConfigRewriter::remoteHosts(profile), std::vector<std::string>{"vpn.example.com"});
+
+    std::string_view openBlock;
+    EXPECT_TRUE(ConfigRewriter::tokenizeLine("<tls-auth>", openBlock).kind == ConfigLine::Kind::BlockStart);
+    EXPECT_TRUE(ConfigRewriter::tokenizeLine("</ca>", openBlock).kind == ConfigLine::Kind::BlockBody);
+    EXPECT_TRUE(ConfigRewriter::tokenizeLine("  </tls-auth>", openBlock).kind == ConfigLine::Kind::BlockEnd);
+    EXPECT_TRUE(openBlock.empty());
+}
+
+TEST(config_rewriter, crlf_line_ends_are_kept) {
+    RewriteResult result;
+    std::string rewritten = wintun("client\r\ndev tap\r\ndev tun\r\npersist-tun\r\nremote a\r\n", &result);
+    EXPECT_EQ(rewritten, "client\r\ndev tun\r\nwindows-driver wintun\r\nremote a\r\n");
+    EXPECT_EQ(result.dropped, size_t(2));
+    EXPECT_EQ(result.inserted, size_t(1));
+
+    // A last line without a terminator gets one before the inserted line
+    EXPECT_EQ(wintun("client\r\ndev tun"), "client\r\ndev tun\r\nwindows-driver wintun");
+}
+
+TEST(config_rewriter, inserts_after_dev_tun_before_remote) {
+    EXPECT_EQ(wintun("remote a\ndev tun\nremote b\n"), "remote a\ndev tun\nwindows-driver wintun\nremote b\n");
+}
+
+TEST(config_rewriter, inserts_after_the_first_remote_without_dev_tun) {
+    RewriteResult result;
+    EXPECT_EQ(wintun("client\nremote a\nremote b\n", &result), "client\nremote a\nwindows-driver wintun\nremote b\n");
+    EXPECT_EQ(result.inserted, size_t(1));
+}
+
+TEST(config_rewriter, inserts_at_the_top_without_an_anchor) {
+    EXPECT_EQ(wintun("client\nverb 3\n"), "windows-driver wintun\nclient\nverb 3\n");
+    EXPECT_EQ(wintun("client\r\n"), "windows-driver wintun\r\nclient\r\n");
+    EXPECT_EQ(wintun(""), "windows-driver wintun\n");
+}
+
+TEST(config_rewriter, connection_blocks) {
+    // Options in a <connection> block are the block's own; nothing may be
+    // inserted in there, so the profile gets the driver at the top
+    std::string profile =
+        "client\n"
+        "<connection>\n"
+        "remote a 1194 udp\n"
+        "dev tap\n"
+        "</connection>\n"
+        "<connection>\n"
+        "remote b 443 tcp\n"
+        "</connection>\n";
+    RewriteResult result;
+    EXPECT_EQ(wintun(profile, &result), "windows-driver wintun\n" + profile);
+    EXPECT_EQ(result.inserted, size_t(1));
+    EXPECT_EQ(result.dropped, size_t(0));
+    // Each block connects to its own remote; those are left to openvpn
+    EXPECT_TRUE(ConfigRewriter::remoteHosts(profile).empty());
+}
+
+TEST(config_rewriter, existing_wintun_driver_is_kept) {
+    RewriteResult result;
+    std::string profile = "client\nwindows-driver wintun\ndev tun\nremote a\n";
+    EXPECT_EQ(wintun(profile, &result), profile);
+    EXPECT_EQ(result.inserted, size_t(0));
+    EXPECT_EQ(result.dropped, size_t(0));
+
+    // Kept even where no rule would have inserted it
+    std::string late = "client\nremote a\nverb 3\nwindows-driver wintun\n";
+    EXPECT_EQ(wintun(late), late);
+}
+
+TEST(config_rewriter, other_windows_driver_is_replaced) {
+    EXPECT_EQ(wintun("client\nwindows-driver tap-windows6\ndev-type tap\nremote a\n"),
+              "client\nremote a\nwindows-driver wintun\n");
+}
+
+TEST(config_rewriter, tun_rules_drop_device_lines) {
+    ConfigRewriter rewriter(ConfigRewriter::tunRules());
+    RewriteResult result;
+    EXPECT_EQ(rewriter.rewrite("client\ndev tun0\ndev-type tun\ndev-node /dev/net/tun\nwindows-driver wintun\n"
+                               "client-cert-not-required\nremote a\n",
+                               &result),
+              "client\nremote a\n");
+    EXPECT_EQ(result.dropped, size_t(5));
+}
+
+TEST(config_rewriter, write_matches_rewrite) {
+    std::string profile = "client\r\ndev tap\r\n<ca>\r\nabc\r\n</ca>\r\nremote a\r\n";
+    ConfigRewriter rewriter(ConfigRewriter::wintunRules());
+    std::ostringstream out;
+    EXPECT_TRUE(rewriter.write(profile, out));
+    EXPECT_EQ(out.str(), rewriter.rewrite(profile));
+}
+
+TEST(config_rewriter, remote_hosts) {
+    EXPECT_EQ(ConfigRewriter::remoteHosts("remote a 1194\nremote 192.0.2.1\nremote 2001:db8::1\nremote a 443\n"
+                                          "remote b\n"),
+              (std::vector<std::string>{"a", "b"}));
+    // The proxy resolves the name
+    EXPECT_TRUE(ConfigRewriter::remoteHosts("remote a\nhttp-proxy proxy.example.com 8080\n").empty());
+}
+
+TEST(config_rewriter, resolved_remotes_keep_port_and_protocol) {
+    std::map<std::string, std::vector<std::string>> addresses = {{"a", {"192.0.2.1", "2001:db8::1"}}};
+    ConfigRewriter pinner({ConfigRewriter::resolvedRemoteRule(addresses)});
+    EXPECT_EQ(pinner.rewrite("remote a 1194 udp\r\nremote b\r\n"),
+              "remote 192.0.2.1 1194 udp\nremote 2001:db8::1 1194 udp\nremote a 1194 udp\r\nremote b\r\n");
+}
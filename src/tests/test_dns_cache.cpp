@@ -0,0 +1,207 @@
+#include "test.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dns_cache.h"
+
+using namespace openvpn_flutter;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Stands in for the system resolver: answers from a table, counts queries
+// and can hold them until released
+class StubResolver {
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    bool holding = false;
+    std::map<std::string, DnsAnswer> answers;
+
+public:
+    std::atomic<int> queries{0};
+
+    void answer(const std::string& host, std::vector<std::string> addresses, uint32_t ttlSeconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        answers[host] = DnsAnswer{true, std::move(addresses), ttlSeconds};
+    }
+
+    void fail(const std::string& host) {
+        std::lock_guard<std::mutex> lock(mutex);
+        answers[host] = DnsAnswer{};
+    }
+
+    void hold() {
+        std::lock_guard<std::mutex> lock(mutex);
+        holding = true;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex);
+        holding = false;
+        released.notify_all();
+    }
+
+    DnsAnswer resolve(const std::string& host) {
+        std::unique_lock<std::mutex> lock(mutex);
+        queries++;
+        released.wait(lock, [this]() { return !holding; });
+        return answers[host];
+    }
+
+    DnsCache::Resolver function() {
+        return [this](const std::string& host) { return resolve(host); };
+    }
+
+    // Lookups in the background (refreshes, late answers) are awaited here
+    bool waitForQueries(int count) {
+        for (int i = 0; i < 500 && queries < count; i++) {
+            std::this_thread::sleep_for(2ms);
+        }
+        return queries >= count;
+    }
+};
+
+// Time the cache sees, moved forward by the test
+class FakeClock {
+private:
+    DnsCache::Clock::time_point start = DnsCache::Clock::now();
+    std::atomic<int64_t> elapsedMs{0};
+
+public:
+    void advance(std::chrono::milliseconds by) {
+        elapsedMs += by.count();
+    }
+
+    DnsCache::TimeSource function() {
+        return [this]() { return start + std::chrono::milliseconds(elapsedMs.load()); };
+    }
+};
+
+using Addresses = std::map<std::string, std::vector<std::string>>;
+
+} // namespace
+
+TEST(dns_cache, answers_are_kept_for_their_ttl) {
+    StubResolver resolver;
+    FakeClock clock;
+    resolver.answer("vpn.example.com", {"192.0.2.1", "2001:db8::1"}, 60);
+    DnsCache cache(resolver.function(), clock.function());
+
+    Addresses expected = {{"vpn.example.com", {"192.0.2.1", "2001:db8::1"}}};
+    EXPECT_EQ(cache.resolve({"vpn.example.com"}, 1s).size(), size_t(1));
+    EXPECT_TRUE(cache.resolve({"vpn.example.com"}, 1s) == expected);
+    EXPECT_EQ(resolver.queries.load(), 1);
+    EXPECT_EQ(cache.getMisses(), uint64_t(1));
+    EXPECT_EQ(cache.getHits(), uint64_t(1));
+
+    // In the last fifth of the TTL the answer is served and refreshed behind it
+    resolver.answer("vpn.example.com", {"192.0.2.2"}, 60);
+    clock.advance(50s);
+    EXPECT_TRUE(cache.resolve({"vpn.example.com"}, 1s) == expected);
+    EXPECT_TRUE(resolver.waitForQueries(2));
+    EXPECT_EQ(cache.getRefreshes(), uint64_t(1));
+
+    // Past the refreshed answer's TTL the name is looked up again, and waited for
+    resolver.answer("vpn.example.com", {"192.0.2.3"}, 60);
+    clock.advance(61s);
+    Addresses refreshed = {{"vpn.example.com", {"192.0.2.3"}}};
+    EXPECT_TRUE(cache.resolve({"vpn.example.com"}, 1s) == refreshed);
+    EXPECT_EQ(resolver.queries.load(), 3);
+    EXPECT_EQ(cache.getMisses(), uint64_t(2));
+}
+
+TEST(dns_cache, ttl_is_clamped) {
+    StubResolver resolver;
+    FakeClock clock;
+    resolver.answer("a", {"192.0.2.1", "192.0.2.2", "192.0.2.3", "192.0.2.4", "192.0.2.5"}, 0);
+    DnsCache cache(resolver.function(), clock.function());
+
+    // Kept for kMinTtl, not zero, and at most kMaxAddresses of it
+    EXPECT_EQ(cache.resolve({"a"}, 1s)["a"].size(), DnsCache::kMaxAddresses);
+    clock.advance(3s);
+    cache.resolve({"a"}, 1s);
+    EXPECT_EQ(resolver.queries.load(), 1);
+    clock.advance(DnsCache::kMinTtl);
+    cache.resolve({"a"}, 1s);
+    EXPECT_EQ(resolver.queries.load(), 2);
+}
+
+TEST(dns_cache, failures_are_remembered) {
+    StubResolver resolver;
+    FakeClock clock;
+    resolver.fail("missing.example.com");
+    DnsCache cache(resolver.function(), clock.function());
+
+    EXPECT_TRUE(cache.resolve({"missing.example.com"}, 1s).empty());
+    // Not asked again until the negative TTL is over
+    clock.advance(DnsCache::kNegativeTtl - 1s);
+    EXPECT_TRUE(cache.resolve({"missing.example.com"}, 1s).empty());
+    EXPECT_EQ(resolver.queries.load(), 1);
+    clock.advance(2s);
+    EXPECT_TRUE(cache.resolve({"missing.example.com"}, 1s).empty());
+    EXPECT_EQ(resolver.queries.load(), 2);
+}
+
+TEST(dns_cache, expired_answer_outlives_a_failed_refresh) {
+    StubResolver resolver;
+    FakeClock clock;
+    resolver.answer("a", {"192.0.2.1"}, 10);
+    DnsCache cache(resolver.function(), clock.function());
+    cache.resolve({"a"}, 1s);
+
+    resolver.fail("a");
+    clock.advance(11s);
+    Addresses stale = {{"a", {"192.0.2.1"}}};
+    EXPECT_TRUE(cache.resolve({"a"}, 1s) == stale);
+    EXPECT_EQ(resolver.queries.load(), 2);
+
+    // Only for kMaxStale
+    clock.advance(DnsCache::kMaxStale);
+    EXPECT_TRUE(cache.resolve({"a"}, 1s).empty());
+}
+
+TEST(dns_cache, concurrent_lookups_of_a_host_share_one_query) {
+    StubResolver resolver;
+    resolver.answer("vpn.example.com", {"192.0.2.1"}, 60);
+    resolver.hold();
+    DnsCache cache(resolver.function());
+
+    std::vector<std::thread> threads;
+    std::vector<Addresses> results(8);
+    for (size_t i = 0; i < results.size(); i++) {
+        threads.emplace_back([&cache, &results, i]() { results[i] = cache.resolve({"vpn.example.com"}, 5s); });
+    }
+    EXPECT_TRUE(resolver.waitForQueries(1));
+    std::this_thread::sleep_for(50ms);
+    resolver.release();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(resolver.queries.load(), 1);
+    for (const auto& result : results) {
+        EXPECT_TRUE(result == (Addresses{{"vpn.example.com", {"192.0.2.1"}}}));
+    }
+}
+
+TEST(dns_cache, slow_lookup_lands_for_next_time) {
+    StubResolver resolver;
+    resolver.answer("slow.example.com", {"192.0.2.9"}, 60);
+    resolver.hold();
+    DnsCache cache(resolver.function());
+
+    // Not waited for past the timeout, but not cancelled either
+    EXPECT_TRUE(cache.resolve({"slow.example.com"}, 20ms).empty());
+    resolver.release();
+    auto result = cache.resolve({"slow.example.com"}, 1s);
+    EXPECT_EQ(result["slow.example.com"], std::vector<std::string>{"192.0.2.9"});
+    EXPECT_EQ(resolver.queries.load(), 1);
+}
@@ -0,0 +1,62 @@
+#include "test.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+
+using namespace openvpn_flutter;
+
+namespace {
+
+constexpr auto kInterval = std::chrono::milliseconds(1000 / LogSite::kPerSecond);
+
+} // namespace
+
+TEST(logger, site_allows_a_burst_then_its_rate) {
+    LogSite site;
+    uint32_t suppressed = 0;
+    int admitted = 0;
+    for (int i = 0; i < 3 * LogSite::kBurst; i++) {
+        admitted += site.admit(suppressed);
+    }
+    // A record or two more if the loop straddled an interval
+    EXPECT_TRUE(admitted >= LogSite::kBurst && admitted <= LogSite::kBurst + 2);
+    EXPECT_EQ(suppressed, uint32_t(0));
+
+    std::this_thread::sleep_for(2 * kInterval);
+    REQUIRE(site.admit(suppressed));
+    EXPECT_EQ(suppressed, uint32_t(3 * LogSite::kBurst - admitted));
+}
+
+TEST(logger, flooding_statement_leaves_the_others_alone) {
+    std::vector<std::string> messages;
+    Logger& logger = Logger::instance();
+    LogLevel level = logger.getLevel();
+    logger.setLevel(LogLevel::Warn);
+    logger.setSink([&messages](const LogRecord& record) { messages.push_back(record.message); });
+
+    auto flood = [](int count) {
+        for (int i = 0; i < count; i++) {
+            LOG_WARN("retrying, attempt " << i);
+        }
+    };
+    flood(3 * LogSite::kBurst);
+    LOG_WARN("something else");
+    logger.flush();
+    REQUIRE(messages.size() >= size_t(LogSite::kBurst) + 1 && messages.size() <= size_t(LogSite::kBurst) + 3);
+    EXPECT_EQ(messages.back(), "something else");
+
+    // The next record let through says how many were held back
+    std::this_thread::sleep_for(2 * kInterval);
+    messages.clear();
+    flood(1);
+    logger.flush();
+    REQUIRE(messages.size() == 1);
+    EXPECT_TRUE(messages[0].find("more from here suppressed") != std::string::npos);
+
+    logger.setSink(nullptr);
+    logger.setLevel(level);
+}
@@ -0,0 +1,260 @@
+#include "test.h"
+
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#include "management_client.h"
+
+using namespace openvpn_flutter;
+
+TEST(management_client, overlong_line_is_skipped) {
+    ManagementClient client;
+    std::vector<std::pair<uint64_t, uint64_t>> counts;
+    client.onByteCount = [&counts](uint64_t bytesIn, uint64_t bytesOut) { counts.emplace_back(bytesIn, bytesOut); };
+
+    // Nothing of the long line is kept, across reads, up to its end
+    std::string chunk(ManagementClient::kMaxLineLength / 2 + 1, 'x');
+    client.feed(">BYTECOUNT:7,");
+    client.feed(chunk);
+    client.feed(chunk);
+    client.feed(chunk);
+    client.feed("8\r\n>BYTECOUNT:1,2\r\n");
+    REQUIRE(counts.size() == 1);
+    EXPECT_EQ(counts[0].first, uint64_t(1));
+    EXPECT_EQ(counts[0].second, uint64_t(2));
+}
+
+#ifndef _WIN32
+
+namespace {
+
+// openvpn's side of a management unix socket (--management <path> unix)
+class FakeServer {
+private:
+    std::string dir;
+    int listener = -1;
+    int peer = -1;
+
+public:
+    std::string path;
+
+    FakeServer() {
+        char pattern[] = "/tmp/openvpn_flutter_test-XXXXXX";
+        if (!mkdtemp(pattern)) {
+            return;
+        }
+        dir = pattern;
+        path = dir + "/management";
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 1) != 0) {
+            ::close(listener);
+            listener = -1;
+        }
+    }
+
+    ~FakeServer() {
+        disconnect();
+        if (listener >= 0) {
+            ::close(listener);
+            unlink(path.c_str());
+        }
+        if (!dir.empty()) {
+            rmdir(dir.c_str());
+        }
+    }
+
+    bool listening() const {
+        return listener >= 0;
+    }
+
+    bool accept() {
+        peer = ::accept(listener, nullptr, nullptr);
+        return peer >= 0;
+    }
+
+    void disconnect() {
+        if (peer >= 0) {
+            ::close(peer);
+            peer = -1;
+        }
+    }
+
+    bool send(const std::string& data) {
+        return ::send(peer, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size());
+    }
+
+    // What the client sent, once it is `lines` lines or after a second
+    std::string receive(size_t lines) {
+        std::string received;
+        size_t newlines = 0;
+        while (newlines < lines) {
+            pollfd readable{peer, POLLIN, 0};
+            if (poll(&readable, 1, 1000) <= 0) {
+                break;
+            }
+            char buffer[256];
+            ssize_t n = recv(peer, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                break;
+            }
+            for (ssize_t i = 0; i < n; i++) {
+                newlines += buffer[i] == '\n';
+            }
+            received.append(buffer, static_cast<size_t>(n));
+        }
+        return received;
+    }
+};
+
+// A client attached to a fresh fake server
+#define ATTACH(server, client)                        \
+    FakeServer server;                                \
+    REQUIRE(server.listening());                      \
+    ManagementClient client;                          \
+    REQUIRE(client.connectUnix(server.path));         \
+    REQUIRE(server.accept())
+
+} // namespace
+
+TEST(management_client, hold_is_released) {
+    ATTACH(server, client);
+    REQUIRE(server.send(">INFO:OpenVPN Management Interface Version 5 -- type 'help' for more info\r\n"
+                        ">HOLD:Waiting for hold release:0\r\n"));
+    EXPECT_TRUE(client.pump());
+    EXPECT_EQ(server.receive(1), "hold release\n");
+}
+
+TEST(management_client, state_notifications) {
+    ATTACH(server, client);
+    std::vector<StateNotification> states;
+    client.onState = [&states](const StateNotification& notification) { states.push_back(notification); };
+
+    REQUIRE(server.send(">STATE:1700000000,CONNECTED,SUCCESS,10.8.0.2,203.0.113.1,1194,,\r\n"
+                        ">STATE:1700000042,RECONNECTING,ping-restart,,,,,\r\n"
+                        "SUCCESS: real-time state notification set to ON\r\n"));
+    EXPECT_TRUE(client.pump());
+    REQUIRE(states.size() == 2);
+    EXPECT_TRUE(states[0].state == ManagementState::Connected);
+    EXPECT_EQ(states[0].timestamp, int64_t(1700000000));
+    EXPECT_EQ(states[0].description, "SUCCESS");
+    EXPECT_EQ(states[0].localIp, "10.8.0.2");
+    EXPECT_EQ(states[0].remoteIp, "203.0.113.1");
+    EXPECT_TRUE(states[1].state == ManagementState::Reconnecting);
+    EXPECT_EQ(states[1].description, "ping-restart");
+}
+
+TEST(management_client, byte_counts) {
+    ATTACH(server, client);
+    std::vector<std::pair<uint64_t, uint64_t>> counts;
+    client.onByteCount = [&counts](uint64_t bytesIn, uint64_t bytesOut) { counts.emplace_back(bytesIn, bytesOut); };
+
+    REQUIRE(server.send(">BYTECOUNT:1234,5678\r\n>BYTECOUNT:9"));
+    EXPECT_TRUE(client.pump());
+    // The second line is completed by the next read
+    REQUIRE(server.send("000000000,1\r\n"));
+    EXPECT_TRUE(client.pump());
+    REQUIRE(counts.size() == 2);
+    EXPECT_EQ(counts[0].first, uint64_t(1234));
+    EXPECT_EQ(counts[0].second, uint64_t(5678));
+    EXPECT_EQ(counts[1].first, uint64_t(9000000000));
+    EXPECT_EQ(counts[1].second, uint64_t(1));
+}
+
+TEST(management_client, credentials_are_answered) {
+    ATTACH(server, client);
+    std::vector<std::pair<std::string, bool>> prompts;
+    client.onPassword = [&](const std::string& realm, bool verificationFailed) {
+        prompts.emplace_back(realm, verificationFailed);
+        if (!verificationFailed) {
+            client.sendCredentials(realm, "user", "p\"w\\");
+        }
+    };
+
+    REQUIRE(server.send(">PASSWORD:Need 'Auth' username/password\r\n"));
+    EXPECT_TRUE(client.pump());
+    EXPECT_EQ(server.receive(2), "username \"Auth\" \"user\"\npassword \"Auth\" \"p\\\"w\\\\\"\n");
+
+    REQUIRE(server.send(">PASSWORD:Auth-Token:abc\r\n>PASSWORD:Verification Failed: 'Auth'\r\n"));
+    EXPECT_TRUE(client.pump());
+    REQUIRE(prompts.size() == 2);
+    EXPECT_EQ(prompts[0].first, "Auth");
+    EXPECT_TRUE(!prompts[0].second);
+    EXPECT_EQ(prompts[1].first, "Auth");
+    EXPECT_TRUE(prompts[1].second);
+}
+
+TEST(management_client, management_password_is_sent) {
+    FakeServer server;
+    REQUIRE(server.listening());
+    ManagementClient client;
+    client.setPassword("secret");
+    REQUIRE(client.connectUnix(server.path));
+    REQUIRE(server.accept());
+
+    // The prompt has no line end, and may arrive in pieces
+    REQUIRE(server.send("ENTER PASS"));
+    EXPECT_TRUE(client.pump());
+    REQUIRE(server.send("WORD:"));
+    EXPECT_TRUE(client.pump());
+    EXPECT_EQ(server.receive(1), "secret\n");
+
+    REQUIRE(server.send("SUCCESS: password is correct\r\n>HOLD:Waiting for hold release:0\r\n"));
+    EXPECT_TRUE(client.pump());
+    EXPECT_EQ(server.receive(1), "hold release\n");
+}
+
+TEST(management_client, sockets_are_not_inherited) {
+    ATTACH(server, unixClient);
+    EXPECT_TRUE(fcntl(unixClient.getSocket(), F_GETFD) & FD_CLOEXEC);
+
+    // The TCP path, as on Windows, against a loopback listener
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener >= 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    REQUIRE(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+    REQUIRE(listen(listener, 1) == 0);
+    REQUIRE(getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+    ManagementClient tcpClient;
+    bool connected = tcpClient.connect("127.0.0.1", ntohs(address.sin_port));
+    EXPECT_TRUE(connected);
+    if (connected) {
+        EXPECT_TRUE(fcntl(tcpClient.getSocket(), F_GETFD) & FD_CLOEXEC);
+    }
+    ::close(listener);
+}
+
+TEST(management_client, fatal_and_close) {
+    ATTACH(server, client);
+    std::string fatal;
+    client.onFatal = [&fatal](const std::string& message) { fatal = message; };
+
+    REQUIRE(server.send(">FATAL:Cannot open TUN/TAP dev\r\n"));
+    EXPECT_TRUE(client.pump());
+    EXPECT_EQ(fatal, "Cannot open TUN/TAP dev");
+
+    server.disconnect();
+    EXPECT_TRUE(!client.pump());
+    EXPECT_TRUE(!client.isConnected());
+}
+
+#endif
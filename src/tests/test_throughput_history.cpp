@@ -0,0 +1,141 @@
+#include "test.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "throughput_history.h"
+
+using namespace openvpn_flutter;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Whole seconds from here on, so readings land where the tests say
+const ThroughputHistory::Clock::time_point kStart = ThroughputHistory::Clock::time_point{} + 1h;
+
+// One reading a second, second i carrying bytes[i] in and a tenth of it out
+ThroughputHistory::Clock::time_point recordSeconds(ThroughputHistory& history, const uint64_t* bytes,
+                                                   size_t count) {
+    auto now = kStart;
+    uint64_t totalIn = 0;
+    uint64_t totalOut = 0;
+    history.record(totalIn, totalOut, now);
+    for (size_t i = 0; i < count; i++) {
+        now += 1s;
+        totalIn += bytes[i];
+        totalOut += bytes[i] / 10;
+        history.record(totalIn, totalOut, now);
+    }
+    return now;
+}
+
+bool within(uint64_t actual, uint64_t expected, double tolerance) {
+    double difference = static_cast<double>(actual) - static_cast<double>(expected);
+    return difference <= static_cast<double>(expected) * tolerance &&
+           -difference <= static_cast<double>(expected) * tolerance;
+}
+
+} // namespace
+
+TEST(throughput_history, readings_are_spread_over_the_seconds_they_span) {
+    ThroughputHistory history;
+    history.record(0, 0, kStart + 500ms);
+    // 2 s of traffic from the middle of a second: half, all, half of it
+    history.record(2000, 200, kStart + 2500ms);
+    history.record(3000, 300, kStart + 3500ms);
+
+    // The second of the last reading is still filling up
+    std::array<Throughput, 10> points;
+    int64_t secondsPerPoint = 0;
+    size_t count = history.series(60, points.data(), points.size(), secondsPerPoint, kStart + 3500ms);
+    REQUIRE(count == 3);
+    EXPECT_EQ(secondsPerPoint, int64_t(1));
+    EXPECT_EQ(points[0].in, uint64_t(500));
+    EXPECT_EQ(points[1].in, uint64_t(1000));
+    EXPECT_EQ(points[2].in, uint64_t(1000));
+    EXPECT_EQ(points[0].out, uint64_t(50));
+    EXPECT_EQ(points[2].out, uint64_t(100));
+}
+
+TEST(throughput_history, long_gap_keeps_its_last_hour) {
+    ThroughputHistory history;
+    history.record(0, 0, kStart);
+    // Two hours in one reading: only the second hour's share is kept
+    int64_t seconds = 2 * static_cast<int64_t>(ThroughputHistory::kSeconds);
+    history.record(static_cast<uint64_t>(seconds) * 1000, 0, kStart + std::chrono::seconds(seconds));
+
+    ThroughputHistory::Summary summary =
+        history.summarize(ThroughputHistory::kSeconds, 50.0, kStart + std::chrono::seconds(seconds + 1));
+    EXPECT_EQ(summary.seconds, int64_t(ThroughputHistory::kSeconds));
+    EXPECT_EQ(summary.average.in, uint64_t(1000));
+    EXPECT_EQ(summary.peak.in, uint64_t(1000));
+}
+
+TEST(throughput_history, stale_history_counts_as_idle) {
+    ThroughputHistory history;
+    history.record(0, 0, kStart);
+    history.record(10000, 1000, kStart + 10s);
+
+    // Within kStaleMs of the last reading the history ends at its second
+    ThroughputHistory::Summary summary = history.summarize(60, 50.0, kStart + 12s);
+    EXPECT_EQ(summary.seconds, int64_t(10));
+    EXPECT_EQ(summary.average.in, uint64_t(1000));
+    EXPECT_EQ(history.current(kStart + 12s).in, uint64_t(1000));
+
+    // Past it, the seconds since saw nothing
+    summary = history.summarize(60, 50.0, kStart + 20s);
+    EXPECT_EQ(summary.seconds, int64_t(20));
+    EXPECT_EQ(summary.average.in, uint64_t(500));
+    EXPECT_EQ(summary.peak.in, uint64_t(1000));
+    EXPECT_EQ(history.current(kStart + 20s).in, uint64_t(0));
+
+    // Nothing at all before the first reading
+    ThroughputHistory empty;
+    EXPECT_EQ(empty.summarize(60, 50.0, kStart).seconds, int64_t(0));
+    EXPECT_EQ(empty.current(kStart).in, uint64_t(0));
+}
+
+TEST(throughput_history, series_buckets_end_at_the_newest_second) {
+    uint64_t bytes[10] = {100, 200, 300, 400, 500, 600, 700, 800, 900, 1000};
+    ThroughputHistory history;
+    auto now = recordSeconds(history, bytes, 10);
+
+    // 10 s in at most 4 points: 3 s each, the oldest one short
+    std::array<Throughput, 4> points;
+    int64_t secondsPerPoint = 0;
+    size_t count = history.series(10, points.data(), points.size(), secondsPerPoint, now);
+    REQUIRE(count == 4);
+    EXPECT_EQ(secondsPerPoint, int64_t(3));
+    EXPECT_EQ(points[0].in, uint64_t(100));
+    EXPECT_EQ(points[1].in, uint64_t(300));
+    EXPECT_EQ(points[2].in, uint64_t(600));
+    EXPECT_EQ(points[3].in, uint64_t(900));
+
+    // A window longer than the history is cut to it
+    count = history.series(3600, points.data(), points.size(), secondsPerPoint, now);
+    EXPECT_EQ(count, size_t(4));
+    EXPECT_EQ(secondsPerPoint, int64_t(3));
+
+    EXPECT_EQ(history.series(10, points.data(), 0, secondsPerPoint, now), size_t(0));
+    EXPECT_EQ(secondsPerPoint, int64_t(0));
+}
+
+TEST(throughput_history, large_counts_are_close) {
+    uint64_t bytes[100];
+    for (size_t i = 0; i < 100; i++) {
+        bytes[i] = (i + 1) * 1234567;
+    }
+    ThroughputHistory history;
+    auto now = recordSeconds(history, bytes, 100);
+
+    // Counts above 2047 are rounded to 11 significant bits
+    ThroughputHistory::Summary summary = history.summarize(100, 95.0, now);
+    EXPECT_EQ(summary.seconds, int64_t(100));
+    EXPECT_TRUE(within(summary.percentile.in, 95 * 1234567, 0.0005));
+    EXPECT_TRUE(within(summary.peak.in, 100 * 1234567, 0.0005));
+    EXPECT_TRUE(within(summary.average.in, 50 * 1234567 + 617283, 0.0005));
+    EXPECT_TRUE(within(summary.percentile.out, 95 * 123456, 0.0005));
+    EXPECT_EQ(history.summarize(100, 0.0, now).percentile.in, history.summarize(1000, 1.0, now).percentile.in);
+    EXPECT_TRUE(within(history.current(now).in, 99 * 1234567, 0.0005));
+}
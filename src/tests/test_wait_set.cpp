@@ -0,0 +1,153 @@
+#include "test.h"
+
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "wait_set.h"
+
+using namespace openvpn_flutter;
+
+TEST(wait_set, stop_signal_wakes_the_wait) {
+    StopSignal signal;
+    WaitSet waitSet;
+    int id = waitSet.addSignal(signal);
+    REQUIRE(id >= 0);
+    EXPECT_EQ(waitSet.wait(0), WaitSet::kTimeout);
+
+    std::thread setter([&signal]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        signal.set();
+    });
+    EXPECT_EQ(waitSet.wait(5000), id);
+    setter.join();
+
+    // Manually reset: it stays signalled until reset
+    EXPECT_EQ(waitSet.wait(0), id);
+    signal.reset();
+    EXPECT_EQ(waitSet.wait(20), WaitSet::kTimeout);
+}
+
+TEST(wait_set, removed_sources_are_not_reported) {
+    StopSignal first;
+    StopSignal second;
+    WaitSet waitSet;
+    int firstId = waitSet.addSignal(first);
+    int secondId = waitSet.addSignal(second);
+    first.set();
+    second.set();
+    waitSet.remove(firstId);
+    EXPECT_EQ(waitSet.wait(0), secondId);
+}
+
+TEST(wait_set, sources_are_capped) {
+    StopSignal signal;
+    WaitSet waitSet;
+    for (size_t i = 0; i < WaitSet::kMaxSources; i++) {
+        REQUIRE(waitSet.addSignal(signal) >= 0);
+    }
+    EXPECT_EQ(waitSet.addSignal(signal), WaitSet::kFailed);
+}
+
+#ifndef _WIN32
+
+namespace {
+
+// A child that exits with code after delayMs
+pid_t spawnChild(int delayMs, int code) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        usleep(static_cast<useconds_t>(delayMs) * 1000);
+        _exit(code);
+    }
+    return pid;
+}
+
+// Waits for the child's exit through the set, then checks it is still
+// there for its owner to reap
+void expectExitSeen(WaitSet& waitSet) {
+    pid_t pid = spawnChild(100, 3);
+    REQUIRE(pid > 0);
+    int id = waitSet.addProcess(pid);
+    REQUIRE(id >= 0);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(waitSet.wait(5000), id);
+    EXPECT_TRUE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    // Still reported until removed
+    EXPECT_EQ(waitSet.wait(0), id);
+    waitSet.remove(id);
+    EXPECT_EQ(waitSet.wait(0), WaitSet::kTimeout);
+
+    int status = 0;
+    EXPECT_EQ(waitpid(pid, &status, WNOHANG), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 3);
+}
+
+} // namespace
+
+TEST(wait_set, child_exit_through_pidfd) {
+    WaitSet waitSet;
+    expectExitSeen(waitSet);
+}
+
+TEST(wait_set, child_exit_without_pidfd) {
+    WaitSet waitSet;
+    waitSet.disablePidFd();
+    expectExitSeen(waitSet);
+}
+
+TEST(wait_set, running_child_times_out) {
+    pid_t pid = spawnChild(5000, 0);
+    REQUIRE(pid > 0);
+    for (bool pidFd : {true, false}) {
+        WaitSet waitSet;
+        if (!pidFd) {
+            waitSet.disablePidFd();
+        }
+        REQUIRE(waitSet.addProcess(pid) >= 0);
+        // Longer than the fallback's polling interval
+        EXPECT_EQ(waitSet.wait(250), WaitSet::kTimeout);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+TEST(wait_set, exit_wakes_a_wait_with_other_sources) {
+    StopSignal signal;
+    int sockets[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+    WaitSet waitSet;
+    waitSet.disablePidFd();
+    int signalId = waitSet.addSignal(signal);
+    int socketId = waitSet.addSocket(sockets[0]);
+    pid_t pid = spawnChild(100, 0);
+    REQUIRE(pid > 0);
+    int processId = waitSet.addProcess(pid);
+
+    // The socket blocks forever otherwise; the polled child still gets seen
+    EXPECT_EQ(waitSet.wait(WaitSet::kInfinite), processId);
+    waitSet.remove(processId);
+    waitpid(pid, nullptr, 0);
+
+    REQUIRE(write(sockets[1], "x", 1) == 1);
+    EXPECT_EQ(waitSet.wait(1000), socketId);
+    char byte;
+    REQUIRE(read(sockets[0], &byte, 1) == 1);
+
+    signal.set();
+    EXPECT_EQ(waitSet.wait(1000), signalId);
+
+    waitSet.clear();
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+#endif
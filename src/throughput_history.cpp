@@ -0,0 +1,279 @@
+#include "throughput_history.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace openvpn_flutter {
+
+namespace {
+
+// A code is the top kMantissaBits of the count and how far they were shifted
+constexpr int kMantissaBits = 11;
+constexpr uint16_t kMantissaMask = (1u << kMantissaBits) - 1;
+constexpr int kMaxShift = 31;
+
+} // namespace
+
+int64_t ThroughputHistory::toMs(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+uint16_t ThroughputHistory::encode(uint64_t bytes) {
+    if (bytes <= kMantissaMask) {
+        return static_cast<uint16_t>(bytes);
+    }
+    // Shifted so the highest set bit is the mantissa's top one, rounded to nearest
+    int shift = 0;
+    for (uint64_t v = bytes; v > kMantissaMask; v >>= 1) {
+        shift++;
+    }
+    if (shift > kMaxShift) {
+        return UINT16_MAX;
+    }
+    uint64_t mantissa = (bytes + (uint64_t(1) << (shift - 1))) >> shift;
+    if (mantissa > kMantissaMask) {
+        mantissa >>= 1;
+        shift++;
+    }
+    if (shift > kMaxShift) {
+        return UINT16_MAX;
+    }
+    return static_cast<uint16_t>(shift << kMantissaBits | mantissa);
+}
+
+uint64_t ThroughputHistory::decode(uint16_t code) {
+    return static_cast<uint64_t>(code & kMantissaMask) << (code >> kMantissaBits);
+}
+
+void ThroughputHistory::advanceTo(int64_t second) {
+    if (second <= newestSecond) {
+        return;
+    }
+    // Slots being reused still hold the previous hour
+    int64_t from = std::max(newestSecond + 1, second - static_cast<int64_t>(kSeconds) + 1);
+    for (int64_t cleared = from; cleared <= second; cleared++) {
+        size_t slot = static_cast<size_t>(cleared) % kSeconds;
+        bytesIn[slot] = 0;
+        bytesOut[slot] = 0;
+    }
+    newestSecond = second;
+}
+
+void ThroughputHistory::add(int64_t second, uint64_t in, uint64_t out) {
+    advanceTo(second);
+    if (second <= newestSecond - static_cast<int64_t>(kSeconds)) {
+        return;
+    }
+    size_t slot = static_cast<size_t>(second) % kSeconds;
+    bytesIn[slot] = encode(decode(bytesIn[slot]) + in);
+    bytesOut[slot] = encode(decode(bytesOut[slot]) + out);
+}
+
+void ThroughputHistory::spread(int64_t fromMs, int64_t toMs, uint64_t in, uint64_t out) {
+    if (toMs <= fromMs) {
+        add(fromMs / 1000, in, out);
+        return;
+    }
+    // Only the last hour of a longer gap fits; the share from before it is dropped
+    constexpr int64_t kRingMs = static_cast<int64_t>(kSeconds) * 1000;
+    if (toMs - fromMs > kRingMs) {
+        double kept = static_cast<double>(kRingMs) / static_cast<double>(toMs - fromMs);
+        in = static_cast<uint64_t>(static_cast<double>(in) * kept);
+        out = static_cast<uint64_t>(static_cast<double>(out) * kept);
+        fromMs = toMs - kRingMs;
+    }
+
+    double span = static_cast<double>(toMs - fromMs);
+    uint64_t remainingIn = in;
+    uint64_t remainingOut = out;
+    int64_t lastSecond = (toMs - 1) / 1000;
+    for (int64_t second = fromMs / 1000; second < lastSecond; second++) {
+        int64_t overlap = std::min(toMs, (second + 1) * 1000) - std::max(fromMs, second * 1000);
+        double share = static_cast<double>(overlap) / span;
+        uint64_t shareIn = std::min(remainingIn, static_cast<uint64_t>(static_cast<double>(in) * share));
+        uint64_t shareOut = std::min(remainingOut, static_cast<uint64_t>(static_cast<double>(out) * share));
+        add(second, shareIn, shareOut);
+        remainingIn -= shareIn;
+        remainingOut -= shareOut;
+    }
+    // Rounding leftovers go to the newest second
+    add(lastSecond, remainingIn, remainingOut);
+}
+
+int64_t ThroughputHistory::lastCompleteSecond(int64_t nowMs) const {
+    if (!hasReading) {
+        return firstSecond - 1;
+    }
+    // The second of the last reading is still filling up, unless nothing
+    // has fed the history for a while
+    if (nowMs - lastMs > kStaleMs) {
+        return nowMs / 1000 - 1;
+    }
+    return lastMs / 1000 - 1;
+}
+
+bool ThroughputHistory::window(int64_t windowSeconds, int64_t nowMs, int64_t& first, int64_t& last) const {
+    last = lastCompleteSecond(nowMs);
+    first = std::max({last - windowSeconds + 1, firstSecond, last - static_cast<int64_t>(kSeconds) + 1});
+    return windowSeconds > 0 && last >= first;
+}
+
+uint16_t ThroughputHistory::codeAt(const Ring& ring, int64_t second) const {
+    // Seconds past the newest one saw no bytes (yet)
+    if (second > newestSecond || second <= newestSecond - static_cast<int64_t>(kSeconds)) {
+        return 0;
+    }
+    return ring[static_cast<size_t>(second) % kSeconds];
+}
+
+Throughput ThroughputHistory::at(int64_t second) const {
+    return Throughput{decode(codeAt(bytesIn, second)), decode(codeAt(bytesOut, second))};
+}
+
+uint64_t ThroughputHistory::percentileOf(const Ring& ring, int64_t first, int64_t last, double percentile) const {
+    uint64_t count = static_cast<uint64_t>(last - first + 1);
+    double rank = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(count));
+    uint64_t wanted = rank < 1.0 ? 1 : std::min(static_cast<uint64_t>(rank), count);
+
+    // Codes sort like the counts, so the wanted one is found a byte at a time
+    // by counting, without copying or reordering the window
+    std::array<uint32_t, 256> histogram{};
+    for (int64_t second = first; second <= last; second++) {
+        histogram[codeAt(ring, second) >> 8]++;
+    }
+    uint64_t below = 0;
+    size_t high = 0;
+    while (below + histogram[high] < wanted) {
+        below += histogram[high++];
+    }
+    histogram.fill(0);
+    for (int64_t second = first; second <= last; second++) {
+        uint16_t code = codeAt(ring, second);
+        if ((code >> 8) == high) {
+            histogram[code & 0xff]++;
+        }
+    }
+    size_t low = 0;
+    while (below + histogram[low] < wanted) {
+        below += histogram[low++];
+    }
+    return decode(static_cast<uint16_t>(high << 8 | low));
+}
+
+void ThroughputHistory::record(uint64_t totalIn, uint64_t totalOut, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t nowMs = toMs(now);
+    if (!hasReading || totalIn < lastBytesIn || totalOut < lastBytesOut) {
+        // The first reading, or a new session's, is only the baseline
+        if (!hasReading) {
+            hasReading = true;
+            firstSecond = nowMs / 1000;
+        }
+        advanceTo(nowMs / 1000);
+    } else {
+        spread(lastMs, std::max(nowMs, lastMs), totalIn - lastBytesIn, totalOut - lastBytesOut);
+    }
+    lastMs = std::max(nowMs, lastMs);
+    lastBytesIn = totalIn;
+    lastBytesOut = totalOut;
+}
+
+void ThroughputHistory::rebase(uint64_t totalIn, uint64_t totalOut, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t nowMs = toMs(now);
+    if (!hasReading) {
+        hasReading = true;
+        firstSecond = nowMs / 1000;
+    }
+    advanceTo(nowMs / 1000);
+    lastMs = std::max(nowMs, lastMs);
+    lastBytesIn = totalIn;
+    lastBytesOut = totalOut;
+}
+
+void ThroughputHistory::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // The slots are cleared as the next session's seconds reach them
+    hasReading = false;
+    lastMs = 0;
+    lastBytesIn = 0;
+    lastBytesOut = 0;
+    firstSecond = 0;
+    newestSecond = -1;
+}
+
+Throughput ThroughputHistory::current(Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t first = 0;
+    int64_t last = 0;
+    if (!window(kCurrentSeconds, toMs(now), first, last)) {
+        return Throughput{};
+    }
+    Throughput total;
+    for (int64_t second = first; second <= last; second++) {
+        Throughput value = at(second);
+        total.in += value.in;
+        total.out += value.out;
+    }
+    uint64_t seconds = static_cast<uint64_t>(last - first + 1);
+    return Throughput{total.in / seconds, total.out / seconds};
+}
+
+ThroughputHistory::Summary ThroughputHistory::summarize(int64_t windowSeconds, double percentile,
+                                                        Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Summary summary;
+    int64_t first = 0;
+    int64_t last = 0;
+    if (!window(windowSeconds, toMs(now), first, last)) {
+        return summary;
+    }
+
+    Throughput total;
+    for (int64_t second = first; second <= last; second++) {
+        Throughput value = at(second);
+        total.in += value.in;
+        total.out += value.out;
+        summary.peak.in = std::max(summary.peak.in, value.in);
+        summary.peak.out = std::max(summary.peak.out, value.out);
+    }
+    summary.seconds = last - first + 1;
+    summary.average.in = total.in / static_cast<uint64_t>(summary.seconds);
+    summary.average.out = total.out / static_cast<uint64_t>(summary.seconds);
+    summary.percentile.in = percentileOf(bytesIn, first, last, percentile);
+    summary.percentile.out = percentileOf(bytesOut, first, last, percentile);
+    return summary;
+}
+
+size_t ThroughputHistory::series(int64_t windowSeconds, Throughput* points, size_t maxPoints,
+                                 int64_t& secondsPerPoint, Clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    secondsPerPoint = 0;
+    int64_t first = 0;
+    int64_t last = 0;
+    if (maxPoints == 0 || !window(windowSeconds, toMs(now), first, last)) {
+        return 0;
+    }
+
+    // Buckets end at the newest second, so only the oldest one can be short
+    int64_t seconds = last - first + 1;
+    int64_t maxCount = static_cast<int64_t>(maxPoints);
+    secondsPerPoint = (seconds + maxCount - 1) / maxCount;
+    size_t count = static_cast<size_t>((seconds + secondsPerPoint - 1) / secondsPerPoint);
+    int64_t bucketStart = last + 1 - static_cast<int64_t>(count) * secondsPerPoint;
+    for (size_t i = 0; i < count; i++, bucketStart += secondsPerPoint) {
+        int64_t from = std::max(bucketStart, first);
+        int64_t to = bucketStart + secondsPerPoint - 1;
+        Throughput total;
+        for (int64_t second = from; second <= to; second++) {
+            Throughput value = at(second);
+            total.in += value.in;
+            total.out += value.out;
+        }
+        uint64_t covered = static_cast<uint64_t>(to - from + 1);
+        points[i] = Throughput{total.in / covered, total.out / covered};
+    }
+    return count;
+}
+
+} // namespace openvpn_flutter
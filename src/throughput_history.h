@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace openvpn_flutter {
+
+// Bytes per second in each direction
+struct Throughput {
+    uint64_t in = 0;
+    uint64_t out = 0;
+};
+
+// The last hour of a tunnel's traffic at one second resolution, in a fixed
+// ring of two 16-bit counts per second (~14 KiB). Counts are log-scaled:
+// exact below 2048 bytes, within 0.05% above. It is fed running byte totals
+// whenever they are read; the bytes between two readings are spread over the
+// seconds they span, so the history does not depend on how often, or how
+// regularly, anyone reads it. Queries cover the last complete seconds and
+// never allocate. Safe to use from any thread.
+class ThroughputHistory {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kSeconds = 3600;
+    // A reading this old means nothing is feeding the history any more (the
+    // tunnel is down or stalled); the seconds since count as idle
+    static constexpr int64_t kStaleMs = 5000;
+    // Seconds averaged by current()
+    static constexpr int64_t kCurrentSeconds = 3;
+
+    struct Summary {
+        int64_t seconds = 0;  // Seconds of history the window actually covered
+        Throughput average;
+        Throughput peak;      // Busiest single second
+        Throughput percentile;
+    };
+
+private:
+    using Ring = std::array<uint16_t, kSeconds>;
+
+    mutable std::mutex mutex;
+    Ring bytesIn{};
+    Ring bytesOut{};
+    bool hasReading = false;
+    int64_t lastMs = 0;        // Time of the last reading
+    uint64_t lastBytesIn = 0;  // Totals of the last reading
+    uint64_t lastBytesOut = 0;
+    int64_t firstSecond = 0;   // First second with history
+    int64_t newestSecond = -1; // Last second any bytes were put in
+
+    static int64_t toMs(Clock::time_point time);
+    // Bytes to and from the 16-bit form, which sorts like the bytes do
+    static uint16_t encode(uint64_t bytes);
+    static uint64_t decode(uint16_t code);
+    void advanceTo(int64_t second);  // mutex held
+    void add(int64_t second, uint64_t in, uint64_t out);  // mutex held
+    void spread(int64_t fromMs, int64_t toMs, uint64_t in, uint64_t out);  // mutex held
+    // Last second a query covers, or firstSecond - 1 if there is none yet
+    int64_t lastCompleteSecond(int64_t nowMs) const;  // mutex held
+    // First and last second of the window ending at the last complete second
+    bool window(int64_t windowSeconds, int64_t nowMs, int64_t& first, int64_t& last) const;  // mutex held
+    uint16_t codeAt(const Ring& ring, int64_t second) const;  // mutex held
+    Throughput at(int64_t second) const;  // mutex held
+    // Nearest-rank percentile of one direction over [first, last]
+    uint64_t percentileOf(const Ring& ring, int64_t first, int64_t last, double percentile) const;  // mutex held
+
+public:
+    // Running totals as of now; a total that went down starts a new baseline
+    void record(uint64_t totalIn, uint64_t totalOut, Clock::time_point now);
+    // Makes these totals the baseline without counting anything, when the
+    // totals switch to another source
+    void rebase(uint64_t totalIn, uint64_t totalOut, Clock::time_point now);
+    void reset();
+
+    // Average over the last few complete seconds, steady enough to display
+    Throughput current(Clock::time_point now) const;
+    // Average, peak and the given percentile (0-100) of the per-second
+    // throughput over the last windowSeconds
+    Summary summarize(int64_t windowSeconds, double percentile, Clock::time_point now) const;
+    // The last windowSeconds in at most maxPoints averaged buckets, oldest
+    // first; returns how many were written and the seconds in each
+    size_t series(int64_t windowSeconds, Throughput* points, size_t maxPoints, int64_t& secondsPerPoint,
+                  Clock::time_point now) const;
+};
+
+} // namespace openvpn_flutter
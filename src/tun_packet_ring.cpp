@@ -0,0 +1,131 @@
+#include "tun_packet_ring.h"
+
+#ifdef __linux__
+
+#include "logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/if_tun.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace openvpn_flutter {
+
+TunPacketRing::TunPacketRing(uint32_t mtu)
+    : slotSize(mtu), slots(new uint8_t[kSlots * static_cast<size_t>(mtu)]), sendBuffer(new uint8_t[mtu]) {
+}
+
+TunPacketRing::~TunPacketRing() {
+    close();
+}
+
+bool TunPacketRing::open(const std::string& requestedName) {
+    close();
+    if (requestedName.size() >= IFNAMSIZ) {
+        LOG_ERROR("Tun device name too long: " << requestedName);
+        return false;
+    }
+    int device = ::open("/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (device < 0) {
+        LOG_ERROR("Failed to open /dev/net/tun: " << strerror(errno));
+        return false;
+    }
+    ifreq request{};
+    request.ifr_flags = IFF_TUN | IFF_NO_PI;
+    memcpy(request.ifr_name, requestedName.c_str(), requestedName.size());
+    if (ioctl(device, TUNSETIFF, &request) != 0) {
+        LOG_ERROR("Failed to create tun device " << requestedName << ": " << strerror(errno));
+        ::close(device);
+        return false;
+    }
+    fd = device;
+    name = request.ifr_name;
+    LOG_INFO("Tun device " << name << " opened");
+    return true;
+}
+
+void TunPacketRing::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool TunPacketRing::isOpen() const {
+    return fd >= 0;
+}
+
+const std::string& TunPacketRing::getName() const {
+    return name;
+}
+
+int TunPacketRing::getHandle() const {
+    return fd;
+}
+
+size_t TunPacketRing::receive(Packet* packets, size_t maxCount) {
+    if (maxCount > kSlots) {
+        maxCount = kSlots;
+    }
+    size_t count = 0;
+    while (count < maxCount) {
+        uint8_t* slot = slots.get() + count * slotSize;
+        ssize_t received = ::read(fd, slot, slotSize);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break; // EAGAIN once the device is drained
+        }
+        packets[count].data = slot;
+        packets[count].size = static_cast<uint32_t>(received);
+        count++;
+    }
+    return count;
+}
+
+void TunPacketRing::release(const Packet*, size_t) {
+    // The slots are reused by the next receive()
+}
+
+uint8_t* TunPacketRing::allocateSend(uint32_t size) {
+    if (size == 0 || size > slotSize) {
+        return nullptr;
+    }
+    sendSize = size;
+    return sendBuffer.get();
+}
+
+void TunPacketRing::send(uint8_t* packet) {
+    // One write per packet, the device takes no more; a full queue drops it
+    // like a full WinTun ring would
+    ssize_t written;
+    do {
+        written = ::write(fd, packet, sendSize);
+    } while (written < 0 && errno == EINTR);
+}
+
+bool TunPacketRing::waitReadable(int timeoutMs) {
+    pollfd fds[2] = {{fd, POLLIN, 0}, {wakeSignal.getHandle(), POLLIN, 0}};
+    int ready;
+    do {
+        ready = poll(fds, 2, timeoutMs);
+    } while (ready < 0 && errno == EINTR);
+    if (ready > 0 && (fds[1].revents & POLLIN)) {
+        wakeSignal.reset();
+        return false;
+    }
+    return ready > 0 && (fds[0].revents & POLLIN);
+}
+
+void TunPacketRing::wake() {
+    wakeSignal.set();
+}
+
+} // namespace openvpn_flutter
+
+#endif // __linux__
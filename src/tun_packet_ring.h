@@ -0,0 +1,58 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "packet_ring.h"
+#include "wait_set.h"
+
+namespace openvpn_flutter {
+
+// PacketRing over a Linux tun device (IFF_TUN | IFF_NO_PI). The kernel has
+// no shared ring for tun, so receive() reads packets into slots of its own,
+// up to kSlots per call until the device runs dry, and hands those out
+// without a further copy. Creating the device takes CAP_NET_ADMIN.
+class TunPacketRing : public PacketRing {
+public:
+    static constexpr size_t kSlots = 64;
+
+private:
+    int fd = -1;
+    std::string name;
+    uint32_t slotSize;
+    std::unique_ptr<uint8_t[]> slots;      // kSlots received packets
+    std::unique_ptr<uint8_t[]> sendBuffer; // One packet being sent
+    uint32_t sendSize = 0;
+    StopSignal wakeSignal;
+
+public:
+    // mtu bounds the packets either way; longer ones are truncated on read
+    explicit TunPacketRing(uint32_t mtu = 1500);
+    ~TunPacketRing() override;
+
+    TunPacketRing(const TunPacketRing&) = delete;
+    TunPacketRing& operator=(const TunPacketRing&) = delete;
+
+    // Creates or attaches to the device; "tun%d" lets the kernel pick a number
+    bool open(const std::string& requestedName);
+    void close();
+    bool isOpen() const;
+    // As the kernel named it
+    const std::string& getName() const;
+    int getHandle() const;
+
+    size_t receive(Packet* packets, size_t maxCount) override;
+    void release(const Packet* packets, size_t count) override;
+    uint8_t* allocateSend(uint32_t size) override;
+    void send(uint8_t* packet) override;
+    bool waitReadable(int timeoutMs) override;
+    void wake() override;
+};
+
+} // namespace openvpn_flutter
+
+#endif // __linux__
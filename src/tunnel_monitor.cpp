@@ -0,0 +1,299 @@
+#include "tunnel_monitor.h"
+#include "logger.h"
+
+#include <utility>
+#include <vector>
+
+namespace openvpn_flutter {
+
+namespace {
+
+enum class EventKind { Exit, Readable, Timer, Output };
+
+struct SourceOwner {
+    int watch;
+    EventKind kind;
+};
+
+} // namespace
+
+TunnelMonitor::~TunnelMonitor() {
+    shutdown();
+}
+
+int TunnelMonitor::watch(ProcessHandle process, Handlers handlers) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+        return kNoWatch;
+    }
+    if (watches.size() >= kMaxWatches) {
+        LOG_ERROR("Tunnel monitor is full (" << watches.size() << " watches)");
+        return kNoWatch;
+    }
+    int id = nextId++;
+    Watch& entry = watches[id];
+    entry.process = process;
+    entry.handlers = std::move(handlers);
+    if (!thread.joinable()) {
+        thread = std::thread(&TunnelMonitor::run, this);
+    }
+    signalChange();
+    return id;
+}
+
+void TunnelMonitor::unwatch(int id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (std::this_thread::get_id() == thread.get_id()) {
+        // From a handler; the dispatch loop drops the watch once the handler returns
+        auto it = watches.find(id);
+        if (it != watches.end()) {
+            it->second.removed = true;
+        }
+        return;
+    }
+    handlerDone.wait(lock, [this, id] { return dispatching != id; });
+    if (watches.erase(id) > 0) {
+        signalChange();
+        awaitRebuild(lock);
+    }
+}
+
+void TunnelMonitor::setSocket(int id, SocketHandle socket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = watches.find(id);
+    if (it == watches.end() || (it->second.hasSocket && it->second.socket == socket)) {
+        return;
+    }
+    it->second.hasSocket = true;
+    it->second.socket = socket;
+    signalChange();
+}
+
+void TunnelMonitor::clearSocket(int id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = watches.find(id);
+    if (it == watches.end() || !it->second.hasSocket) {
+        return;
+    }
+    it->second.hasSocket = false;
+    signalChange();
+    awaitRebuild(lock);
+}
+
+void TunnelMonitor::setOutput(int id, NativeHandle output) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = watches.find(id);
+    if (it == watches.end() || (it->second.hasOutput && it->second.output == output)) {
+        return;
+    }
+    it->second.hasOutput = true;
+    it->second.output = output;
+    signalChange();
+}
+
+void TunnelMonitor::clearOutput(int id) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = watches.find(id);
+    if (it == watches.end() || !it->second.hasOutput) {
+        return;
+    }
+    it->second.hasOutput = false;
+    signalChange();
+    awaitRebuild(lock);
+}
+
+void TunnelMonitor::setTimer(int id, Clock::time_point when) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = watches.find(id);
+    if (it == watches.end()) {
+        return;
+    }
+    bool earlier = !it->second.hasTimer || when < it->second.timer;
+    it->second.hasTimer = true;
+    it->second.timer = when;
+    // Only an earlier deadline shortens the wait in progress
+    if (earlier && std::this_thread::get_id() != thread.get_id()) {
+        wake.set();
+    }
+}
+
+void TunnelMonitor::clearTimer(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = watches.find(id);
+    if (it != watches.end()) {
+        it->second.hasTimer = false;
+    }
+}
+
+size_t TunnelMonitor::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return watches.size();
+}
+
+void TunnelMonitor::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    rebuilt.notify_all();
+    wake.set();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void TunnelMonitor::signalChange() {
+    // Called with the mutex held; the monitor rebuilds its WaitSet on wake-up
+    changed = true;
+    changeCount++;
+    if (std::this_thread::get_id() != thread.get_id()) {
+        wake.set();
+    }
+}
+
+void TunnelMonitor::awaitRebuild(std::unique_lock<std::mutex>& lock) {
+    // The monitor thread rebuilds before its next wait anyway. Anyone else
+    // waits until the wait in progress, which may still include a handle the
+    // caller is about to close, has returned and the WaitSet was rebuilt.
+    if (std::this_thread::get_id() == thread.get_id()) {
+        return;
+    }
+    uint64_t target = changeCount;
+    rebuilt.wait(lock, [this, target] { return builtCount >= target || stopping; });
+}
+
+void TunnelMonitor::run() {
+    WaitSet waitSet;
+    std::vector<SourceOwner> owners; // Indexed by WaitSet source id
+    int wakeSource = WaitSet::kFailed;
+
+    auto own = [&owners](int source, SourceOwner owner) {
+        if (source < 0) {
+            LOG_ERROR("Tunnel monitor cannot wait on another source of watch " << owner.watch);
+            return;
+        }
+        if (owners.size() <= static_cast<size_t>(source)) {
+            owners.resize(static_cast<size_t>(source) + 1, SourceOwner{kNoWatch, EventKind::Exit});
+        }
+        owners[static_cast<size_t>(source)] = owner;
+    };
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Runs one handler without the lock; unwatch() from other threads waits
+    // for it, so the handlers stay valid while they run
+    auto dispatch = [this, &lock](int id, EventKind kind, bool waitFailed) {
+        auto it = watches.find(id);
+        if (it == watches.end() || it->second.removed) {
+            return;
+        }
+        Handlers& handlers = it->second.handlers;
+        dispatching = id;
+        lock.unlock();
+        bool keep = false;
+        switch (kind) {
+            case EventKind::Exit:
+                if (handlers.onExit) {
+                    handlers.onExit(waitFailed);
+                }
+                break;
+            case EventKind::Readable:
+                keep = !handlers.onReadable || handlers.onReadable();
+                break;
+            case EventKind::Timer:
+                keep = !handlers.onTimer || handlers.onTimer();
+                break;
+            case EventKind::Output:
+                keep = !handlers.onOutput || handlers.onOutput();
+                break;
+        }
+        lock.lock();
+        dispatching = kNoWatch;
+        handlerDone.notify_all();
+        it = watches.find(id);
+        if (it != watches.end() && (!keep || it->second.removed)) {
+            watches.erase(it);
+            signalChange();
+        }
+    };
+
+    changed = true;
+    while (!stopping) {
+        if (changed) {
+            // Only rebuilt when a watch, socket or pipe came or went, not per wait
+            waitSet.clear();
+            owners.clear();
+            wakeSource = waitSet.addSignal(wake);
+            for (const auto& [id, entry] : watches) {
+                own(waitSet.addProcess(entry.process), SourceOwner{id, EventKind::Exit});
+                if (entry.hasSocket) {
+                    own(waitSet.addSocket(entry.socket), SourceOwner{id, EventKind::Readable});
+                }
+                if (entry.hasOutput) {
+                    own(waitSet.addHandle(entry.output), SourceOwner{id, EventKind::Output});
+                }
+            }
+            changed = false;
+            builtCount = changeCount;
+            rebuilt.notify_all();
+        }
+
+        int timeoutMs = WaitSet::kInfinite;
+        auto now = Clock::now();
+        for (const auto& [id, entry] : watches) {
+            if (!entry.hasTimer) {
+                continue;
+            }
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(entry.timer - now).count();
+            int ms = remaining > 0 ? static_cast<int>(remaining) : 0;
+            if (timeoutMs == WaitSet::kInfinite || ms < timeoutMs) {
+                timeoutMs = ms;
+            }
+        }
+
+        lock.unlock();
+        int fired = waitSet.wait(timeoutMs);
+        lock.lock();
+        if (stopping) {
+            break;
+        }
+
+        if (fired == wakeSource) {
+            // Reset under the lock: any change after this sets it again
+            wake.reset();
+            continue;
+        }
+
+        if (fired == WaitSet::kFailed) {
+            // Can't tell which handle broke the wait; every tunnel gets told
+            LOG_ERROR("Tunnel monitor wait failed, dropping " << watches.size() << " watch(es)");
+            std::vector<int> ids;
+            for (const auto& [id, entry] : watches) {
+                ids.push_back(id);
+            }
+            for (int id : ids) {
+                dispatch(id, EventKind::Exit, true);
+            }
+            continue;
+        }
+
+        if (fired >= 0 && static_cast<size_t>(fired) < owners.size() && owners[fired].watch != kNoWatch) {
+            dispatch(owners[fired].watch, owners[fired].kind, false);
+        }
+
+        // Timers that are due, whatever woke the wait
+        now = Clock::now();
+        std::vector<int> due;
+        for (auto& [id, entry] : watches) {
+            if (entry.hasTimer && entry.timer <= now) {
+                entry.hasTimer = false;
+                due.push_back(id);
+            }
+        }
+        for (int id : due) {
+            dispatch(id, EventKind::Timer, false);
+        }
+    }
+}
+
+} // namespace openvpn_flutter
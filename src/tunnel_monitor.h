@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "management_client.h"
+#include "wait_set.h"
+
+namespace openvpn_flutter {
+
+// One thread watching the openvpn processes and management sockets of every
+// tunnel. Each tunnel registers a watch with its process, and optionally a
+// socket, an output pipe and a timer; the monitor blocks on all of them in a
+// single WaitSet and calls the tunnel back when its process exits, its socket
+// or pipe becomes readable or its timer is due. Handlers run on the monitor
+// thread, one at a time.
+//
+// A process, socket or pipe taken out of the monitor (unwatch, clearSocket,
+// clearOutput) is out of the WaitSet by the time the call returns, so the
+// caller may close it right away.
+class TunnelMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Handlers {
+        // The process exited, or waiting failed (waitFailed); the watch is removed
+        std::function<void(bool waitFailed)> onExit;
+        // Return false to stop watching
+        std::function<bool()> onReadable;
+        // The timer is cleared before this runs; re-arm it from the handler
+        std::function<bool()> onTimer;
+        // The output handle is signalled; the handler resets it by reading
+        std::function<bool()> onOutput;
+    };
+
+    static constexpr int kNoWatch = -1;
+    // A watch takes up to three WaitSet sources (process, socket, output) and
+    // the wake-up signal takes one; 21 watches on Windows
+    static constexpr size_t kSourcesPerWatch = 3;
+    static constexpr size_t kMaxWatches = (WaitSet::kMaxSources - 1) / kSourcesPerWatch;
+
+private:
+    struct Watch {
+        ProcessHandle process;
+        bool hasSocket = false;
+        SocketHandle socket = SocketHandle();
+        bool hasOutput = false;
+        NativeHandle output = NativeHandle();
+        bool hasTimer = false;
+        Clock::time_point timer;
+        Handlers handlers;
+        bool removed = false; // unwatch() from its own handler
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable handlerDone;
+    std::condition_variable rebuilt;
+    std::map<int, Watch> watches;
+    int nextId = 0;
+    int dispatching = kNoWatch; // Watch whose handler runs right now
+    bool changed = false;       // Sources differ from the WaitSet
+    uint64_t changeCount = 0;   // Source changes so far
+    uint64_t builtCount = 0;    // Source changes the WaitSet includes
+    bool stopping = false;
+    StopSignal wake;
+    std::thread thread;
+
+    void run();
+    void signalChange();
+    void awaitRebuild(std::unique_lock<std::mutex>& lock);
+
+public:
+    TunnelMonitor() = default;
+    ~TunnelMonitor();
+
+    TunnelMonitor(const TunnelMonitor&) = delete;
+    TunnelMonitor& operator=(const TunnelMonitor&) = delete;
+
+    // Starts the monitor thread on first use. Returns kNoWatch once
+    // kMaxWatches processes are watched, or after shutdown().
+    int watch(ProcessHandle process, Handlers handlers);
+    // After this returns none of the watch's handlers runs anymore and the
+    // monitor no longer waits on its process. May be called from a handler,
+    // including for its own watch.
+    void unwatch(int id);
+
+    void setSocket(int id, SocketHandle socket);
+    void clearSocket(int id);
+    void setOutput(int id, NativeHandle output);
+    void clearOutput(int id);
+    void setTimer(int id, Clock::time_point when);
+    void clearTimer(int id);
+
+    size_t size() const;
+    void shutdown();
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,534 @@
+#include "tunnel_session.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <string.h>
+#endif
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+// Overwrite before release so the secrets don't linger in freed memory
+void wipe(std::string& secret) {
+#ifdef _WIN32
+    SecureZeroMemory(secret.data(), secret.size());
+#else
+    explicit_bzero(secret.data(), secret.size());
+#endif
+    secret.clear();
+}
+
+} // namespace
+
+TunnelSession::TunnelSession(std::string tunnelId, TunnelServices& services)
+    : tunnelId(std::move(tunnelId)), services(services),
+      stages(this->tunnelId, services.metrics,
+             [this](VpnStage stage, VpnError error) { updateStatusThreadSafe(stage, error); }) {
+    management.onState = [this](const StateNotification& notification) {
+        stages.onManagementState(notification);
+    };
+    management.onByteCount = [this](uint64_t bytesIn, uint64_t bytesOut) {
+        managementBytesIn = bytesIn;
+        managementBytesOut = bytesOut;
+        // Pushed every byteCountInterval whether or not anyone reads stats,
+        // which keeps the history going. Until the first push the totals
+        // came from the interface, so that one only sets the baseline.
+        if (hasManagementByteCount.exchange(true)) {
+            throughput.record(bytesIn, bytesOut, ThroughputHistory::Clock::now());
+        } else {
+            throughput.rebase(bytesIn, bytesOut, ThroughputHistory::Clock::now());
+        }
+    };
+    management.onFatal = [this](const std::string& message) {
+        LOG_ERROR("OpenVPN fatal error: " << message);
+        stages.onFatal();
+    };
+    management.onPassword = [this](const std::string& realm, bool verificationFailed) {
+        if (verificationFailed) {
+            LOG_ERROR("OpenVPN credentials rejected (" << realm << ")");
+            stages.onAuthFailed();
+        } else if (realm == "Auth" && !authUsername.empty()) {
+            management.sendCredentials(realm, authUsername, authPassword);
+        } else {
+            LOG_ERROR("OpenVPN asked for '" << realm << "' credentials, none available");
+        }
+    };
+}
+
+TunnelSession::~TunnelSession() = default;
+
+void TunnelSession::shutdownSession() {
+    // Nothing is drained on the platform thread anymore, and this may not be
+    // the platform thread: stop without reporting stages
+    platformPost = nullptr;
+    stageListener = nullptr;
+    stopVPN();
+    configCache.invalidate();
+}
+
+const std::string& TunnelSession::getTunnelId() const {
+    return tunnelId;
+}
+
+bool TunnelSession::isActive() const {
+    return stages.isActive();
+}
+
+void TunnelSession::setStageListener(StageListener listener) {
+    stageListener = std::move(listener);
+}
+
+void TunnelSession::announceStage() {
+    deliverStageEvent(makeStageEvent(currentStage));
+}
+
+bool TunnelSession::beginConnect(const std::string& config, std::vector<std::string>& remoteHosts) {
+    // Stale updates of the previous session must not override "connecting"
+    runOnPlatform([this]() { statusQueue.clear(); });
+
+    if (stages.isActive()) {
+        LOG_INFO("startVPN: Already connected or connecting, returning false");
+        return false;
+    }
+    // openvpn may still run after an error it reported itself
+    stopWatching();
+    terminateProcess();
+
+    stages.connectRequested();
+
+    // Resolve the 'remote' names while the platform prepares the device;
+    // prepareConfig picks the answers up
+    remoteHosts = ConfigRewriter::remoteHosts(config);
+    services.dnsCache.prefetch(remoteHosts);
+    return true;
+}
+
+bool TunnelSession::cancelled(const CancellationToken* cancel) {
+    if (cancel && cancel->isCancelled()) {
+        LOG_INFO("startVPN: Cancelled, not starting OpenVPN");
+        return true;
+    }
+    return false;
+}
+
+bool TunnelSession::watchProcess(ProcessHandle process) {
+    // Arms the connect deadline and timer before the monitor sees the process
+    stages.processStarted();
+    abandoned = false;
+    killAt = std::chrono::steady_clock::time_point();
+
+    // Counters of the previous session are not valid anymore
+    managementBytesIn = 0;
+    managementBytesOut = 0;
+    hasManagementByteCount = false;
+
+    // Stats belong to the sampler on the monitor thread once the process is
+    // watched
+    connectionStartTime = std::chrono::system_clock::now();
+    resetSpeedTracking();
+    nextStatsSample = std::chrono::steady_clock::now();
+
+    updateStatus(VpnStage::Connecting);
+
+    // Hand the process to the shared monitor; the first timer attaches to the
+    // management interface right away
+    statusQueue.resetProducer();
+    monitorWatch = services.monitor.watch(process, {
+        [this](bool waitFailed) { onProcessExit(waitFailed); },
+        [this]() { return onManagementReadable(); },
+        [this]() { return onMonitorTimer(); },
+        [this]() { return onOutputReadable(); }
+    });
+    if (monitorWatch == TunnelMonitor::kNoWatch) {
+        LOG_ERROR("Cannot watch the OpenVPN process of tunnel " << tunnelId);
+        stopVPN();
+        updateStatus(VpnStage::Error, VpnError::InternalError);
+        return false;
+    }
+    if (outputPipe.isOpen()) {
+        services.monitor.setOutput(monitorWatch, outputPipe.getReadHandle());
+    }
+    services.monitor.setTimer(monitorWatch, std::chrono::steady_clock::now());
+    return true;
+}
+
+void TunnelSession::stopVPN() {
+    LOG_DEBUG("stopVPN: Starting disconnect process...");
+    // Only a stop that has something to tear down says anything about latency
+    PhaseSpan stopSpan(services.metrics, ConnectPhase::Disconnect);
+    if (!hasProcess() && monitorWatch == TunnelMonitor::kNoWatch) {
+        stopSpan.dismiss();
+    }
+
+    stopWatching();
+    terminateProcess();
+    stages.reset();
+
+    // Nothing samples this tunnel anymore
+    resetSpeedTracking();
+    latestStats.store(StatsSample{});
+
+    // Pending updates of the monitor thread would override the final stage
+    runOnPlatform([this]() {
+        statusQueue.clear();
+    });
+    updateStatus(VpnStage::Disconnected);
+
+    clearSession();
+    LOG_INFO("stopVPN: Disconnect complete, ready for new connection");
+}
+
+void TunnelSession::stopWatching() {
+    // Waits if one of the tunnel's handlers is running
+    if (monitorWatch != TunnelMonitor::kNoWatch) {
+        services.monitor.unwatch(monitorWatch);
+        monitorWatch = TunnelMonitor::kNoWatch;
+    }
+    management.close();
+    outputPipe.close();
+}
+
+void TunnelSession::resetSpeedTracking() {
+    throughput.reset();
+    sessionCounters.reset();
+}
+
+std::string TunnelSession::getStatus() {
+    return stageName(currentStage);
+}
+
+StatsSample TunnelSession::takeStatsSample() {
+    auto now = std::chrono::system_clock::now();
+    StatsSample sample;
+
+    InterfaceCounters counters = getTrafficCounters();
+    sample.active = (counters.bytesIn > 0 || counters.bytesOut > 0) || stages.isActive();
+    if (!sample.active) {
+        return sample;
+    }
+
+    // Until openvpn pushes its totals, the samples feed the history
+    if (!hasManagementByteCount) {
+        throughput.record(counters.bytesIn, counters.bytesOut, ThroughputHistory::Clock::now());
+    }
+    Throughput speed = throughput.current(ThroughputHistory::Clock::now());
+
+    sample.connectedOnMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        connectionStartTime.time_since_epoch()).count();
+    sample.sampledAtMs = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    sample.durationSeconds = std::chrono::duration_cast<std::chrono::seconds>(now - connectionStartTime).count();
+    sample.speedIn = static_cast<int64_t>(speed.in);
+    sample.speedOut = static_cast<int64_t>(speed.out);
+    sample.counters = counters;
+    return sample;
+}
+
+StatsSample TunnelSession::getConnectionStats() {
+    // The sampler did the work; this is a copy of its latest snapshot
+    StatsSample sample = latestStats.load();
+    measureInterval(polledStats, sample);
+    polledStats = sample;
+    return sample;
+}
+
+const ThroughputHistory& TunnelSession::getThroughput() const {
+    return throughput;
+}
+
+bool TunnelSession::sampleChangedStats(StatsSample& stats) {
+    StatsSample sample = latestStats.load();
+    measureInterval(hasPublishedStats ? publishedStats : StatsSample{}, sample);
+    if (hasPublishedStats && !statsChanged(publishedStats, sample)) {
+        return false;
+    }
+    hasPublishedStats = true;
+    publishedStats = sample;
+    stats = sample;
+    return true;
+}
+
+void TunnelSession::resetStatsStream() {
+    hasPublishedStats = false;
+}
+
+void TunnelSession::onProcessExit(bool waitFailed) {
+    // Whatever openvpn printed last usually explains the exit, so it goes first
+    if (outputPipe.isOpen()) {
+        drainOutput(kOutputDrainMs);
+    }
+    if (waitFailed) {
+        LOG_ERROR("Error monitoring OpenVPN process (tunnel " << tunnelId << ")");
+    } else {
+        LOG_INFO("OpenVPN process exited with " << exitStatus() << " (tunnel " << tunnelId << ")");
+    }
+    stages.onExit(waitFailed);
+    management.close();
+    // The tunnel is gone; its stats stop here
+    latestStats.store(StatsSample{});
+}
+
+bool TunnelSession::onManagementReadable() {
+    if (!management.pump()) {
+        LOG_INFO("OpenVPN management interface closed");
+    }
+    rearmMonitor();
+    return true;
+}
+
+bool TunnelSession::onMonitorTimer() {
+    // Attach to the management interface as soon as openvpn opens it;
+    // from then on >STATE: notifications drive the stage machine
+    if (!abandoned && !management.isConnected() && connectManagement()) {
+        services.metrics.record(ConnectPhase::ManagementAttach, std::chrono::steady_clock::now() - processStartedAt);
+        LOG_INFO("Attached to the OpenVPN management interface of tunnel " << tunnelId);
+        management.sendCommand("state on");
+        management.sendCommand("bytecount " + std::to_string(byteCountInterval));
+    }
+    // Stats are sampled here at a fixed cadence, whoever reads them
+    auto now = std::chrono::steady_clock::now();
+    if (now >= nextStatsSample) {
+        latestStats.store(takeStatsSample());
+        nextStatsSample = now + std::chrono::milliseconds(kStatsSampleMs);
+    }
+    rearmMonitor();
+    return true;
+}
+
+bool TunnelSession::onOutputReadable() {
+    drainOutput(0);
+    return true;
+}
+
+void TunnelSession::drainOutput(int waitMs) {
+    auto onLine = [this](const std::string& line, OutputEvent event) {
+        LOG_DEBUG("openvpn[" << tunnelId << "]: " << line);
+        stages.onOutput(line, event);
+    };
+    bool open = outputPipe.read([this, &onLine](const char* data, size_t size) {
+        outputParser.feed(data, size, onLine);
+    }, waitMs);
+    if (!open) {
+        outputParser.finish(onLine);
+        services.monitor.clearOutput(monitorWatch);
+    }
+}
+
+void TunnelSession::rearmMonitor() {
+    auto now = std::chrono::steady_clock::now();
+    if (!abandoned && !stages.checkDeadline(now)) {
+        // Nothing waits for this attempt anymore. The watch stays, so the
+        // exit is seen (Disconnected) and the stats run until then.
+        abandoned = true;
+        if (management.isConnected()) {
+            // Lets openvpn take its routes down on every platform
+            management.sendCommand("signal SIGTERM");
+        } else {
+            signalProcess(false);
+        }
+        management.close();
+        killAt = now + std::chrono::milliseconds(kExitGraceMs);
+    } else if (abandoned && killAt != std::chrono::steady_clock::time_point() && now >= killAt) {
+        LOG_WARN("OpenVPN did not exit within " << kExitGraceMs << " ms of the timeout, killing it (tunnel "
+                 << tunnelId << ")");
+        signalProcess(true);
+        killAt = std::chrono::steady_clock::time_point();
+    }
+
+    if (management.isConnected()) {
+        services.monitor.setSocket(monitorWatch, management.getSocket());
+    } else {
+        services.monitor.clearSocket(monitorWatch);
+    }
+
+    // The next stats sample, or sooner if attaching or connecting needs it
+    auto next = nextStatsSample;
+    if (abandoned) {
+        if (killAt != std::chrono::steady_clock::time_point()) {
+            next = (std::min)(next, killAt);
+        }
+    } else if (!management.isConnected()) {
+        // openvpn has not opened the management interface yet
+        next = (std::min)(next, now + std::chrono::milliseconds(kManagementRetryMs));
+    } else if (stages.isConnecting()) {
+        next = (std::min)(next, stages.deadline());
+    }
+    services.monitor.setTimer(monitorWatch, next);
+}
+
+const AdapterSnapshot& TunnelSession::currentAdapters() {
+    // Only refetch the snapshot when the registry has published a newer one
+    services.adapterRegistry.start();
+    if (!adapterSnapshot || adapterSnapshot->generation != services.adapterRegistry.generation()) {
+        adapterSnapshot = services.adapterRegistry.snapshot();
+    }
+    return *adapterSnapshot;
+}
+
+void TunnelSession::updateStatus(VpnStage stage, VpnError error) {
+    // Called from commands; the listener is only called on the main thread
+    StageEvent event = makeStageEvent(stage, error);
+    runOnPlatform([this, event]() { deliverStageEvent(event); });
+}
+
+void TunnelSession::setPlatformPoster(std::function<void(std::function<void()>)> post) {
+    platformPost = std::move(post);
+}
+
+void TunnelSession::runOnPlatform(std::function<void()> task) {
+    if (platformPost) {
+        platformPost(std::move(task));
+    } else {
+        task();
+    }
+}
+
+void TunnelSession::updateStatusThreadSafe(VpnStage stage, VpnError error) {
+    // Only the monitor thread produces; the platform thread is woken to drain
+    statusQueue.push(makeStageEvent(stage, error));
+}
+
+void TunnelSession::deliverStageEvent(const StageEvent& event) {
+    currentStage = event.stage;
+    if (stageListener) {
+        stageListener(tunnelId, event);
+    }
+}
+
+void TunnelSession::setStatusWakeCallback(std::function<void()> callback) {
+    statusQueue.setWakeCallback(std::move(callback));
+}
+
+void TunnelSession::processPendingStatusUpdates() {
+    statusQueue.drain([this](const StageEvent& event) {
+        deliverStageEvent(event);
+    });
+}
+
+bool TunnelSession::prepareConfig(const std::string& config, bool queryCredentials,
+                                  const std::vector<std::string>& remoteHosts,
+                                  const std::vector<RewriteRule>& deviceRules, int driverKey) {
+    try {
+        // Resolved 'remote' names are written into the profile, so openvpn
+        // connects without a lookup of its own; unresolved ones stay names
+        std::map<std::string, std::vector<std::string>> remoteAddresses;
+        if (!remoteHosts.empty()) {
+            PhaseSpan dnsSpan(services.metrics, ConnectPhase::DnsResolve);
+            remoteAddresses = services.dnsCache.resolve(remoteHosts, kDnsResolveBudget);
+        }
+        PhaseSpan prepareSpan(services.metrics, ConnectPhase::ConfigPrepare);
+        std::string resolvedKey;
+        for (const auto& [host, addresses] : remoteAddresses) {
+            resolvedKey += host;
+            for (const auto& address : addresses) {
+                resolvedKey += ' ' + address;
+            }
+            resolvedKey += '\n';
+        }
+
+        // Reconnecting with the same profile, driver and resolved addresses
+        // reuses the profile rewritten last time
+        uint64_t cacheKey = ConfigCache::makeKey(config, driverKey, ConfigRewriter::kRuleVersion, queryCredentials,
+                                                 resolvedKey);
+        currentConfig = configCache.lookup(cacheKey);
+        if (currentConfig) {
+            LOG_INFO("Reusing cached config (" << currentConfig->size() << " bytes, hits: "
+                     << configCache.getHits() << ", misses: " << configCache.getMisses() << ")");
+            return true;
+        }
+
+        // Names are expanded in a pass of their own: device rules may anchor
+        // on 'remote' lines too, and a line only ever matches one rule
+        std::string pinnedConfig;
+        if (!remoteAddresses.empty()) {
+            ConfigRewriter pinner({ConfigRewriter::resolvedRemoteRule(remoteAddresses)});
+            RewriteResult pinResult;
+            pinnedConfig = pinner.rewrite(config, &pinResult);
+            LOG_INFO("Pinned " << pinResult.replaced << " 'remote' line(s) to resolved addresses ("
+                     << remoteAddresses.size() << " of " << remoteHosts.size() << " name(s) resolved)");
+        }
+
+        // The device is named on the command line, so the rules take the
+        // profile's own device lines out in a single pass
+        ConfigRewriter rewriter(deviceRules);
+        RewriteResult rewriteResult;
+        std::string modifiedConfig = rewriter.rewrite(remoteAddresses.empty() ? std::string_view(config) : pinnedConfig,
+                                                      &rewriteResult);
+        LOG_DEBUG("Rewrote config (" << rewriteResult.lines << " lines): "
+                  << rewriteResult.dropped << " dropped, "
+                  << rewriteResult.replaced << " replaced, "
+                  << rewriteResult.inserted << " inserted");
+
+        // Without a file argument openvpn asks over the management interface
+        // (--management-query-passwords); the last 'auth-user-pass' wins
+        if (queryCredentials) {
+            modifiedConfig += "\nauth-user-pass\n";
+        }
+
+        currentConfig = std::make_shared<const std::string>(std::move(modifiedConfig));
+        configCache.store(cacheKey, currentConfig);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+void TunnelSession::clearSession() {
+    currentConfig.reset();
+    wipe(authUsername);
+    wipe(authPassword);
+}
+
+uint64_t TunnelSession::getConfigCacheHits() const {
+    return configCache.getHits();
+}
+
+uint64_t TunnelSession::getConfigCacheMisses() const {
+    return configCache.getMisses();
+}
+
+std::vector<std::string> TunnelSession::getRecentOutput(size_t maxLines) const {
+    return outputParser.recent(maxLines);
+}
+
+void TunnelSession::setByteCountInterval(int seconds) {
+    // The management interface accepts whole seconds
+    byteCountInterval = seconds < 1 ? 1 : seconds;
+}
+
+InterfaceCounters TunnelSession::getTrafficCounters() {
+    InterfaceCounters counters = getInterfaceCounters();
+    // Pushed by openvpn itself, so only this tunnel's payload is counted. The
+    // adapter's byte counters are only a fallback until the first >BYTECOUNT:
+    // arrives (or if the management interface is unavailable); packets,
+    // errors and drops always come from the adapter.
+    if (hasManagementByteCount) {
+        counters.bytesIn = managementBytesIn.load();
+        counters.bytesOut = managementBytesOut.load();
+    }
+    return counters;
+}
+
+InterfaceCounters TunnelSession::getInterfaceCounters() {
+    // Only this tunnel's adapter; other tunnels have adapters of their own.
+    // The adapter may be kept or recreated across sessions (a warm WinTun
+    // adapter, openvpn restarting on Linux), which the session counters carry
+    // across.
+    const AdapterInfo* adapter = findAdapter(currentAdapters());
+    InterfaceCounters raw;
+    if (adapter && services.counterSource->read(adapter->index, raw)) {
+        sessionCounters.update(raw);
+    }
+    return sessionCounters.getTotals();
+}
+
+} // namespace openvpn_flutter
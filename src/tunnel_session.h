@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "adapter_registry.h"
+#include "binary_locator.h"
+#include "command_executor.h"
+#include "config_cache.h"
+#include "config_rewriter.h"
+#include "connection_stats.h"
+#include "dns_cache.h"
+#include "interface_counters.h"
+#include "latency_metrics.h"
+#include "management_client.h"
+#include "output_parser.h"
+#include "output_pipe.h"
+#include "seqlock.h"
+#include "stage_machine.h"
+#include "status_queue.h"
+#include "throughput_history.h"
+#include "tunnel_monitor.h"
+
+namespace openvpn_flutter {
+
+// Services every tunnel shares: one monitor thread for all openvpn processes,
+// one adapter registry, the source of interface counters, the binary locator
+// (with its manifest), the cache of resolved 'remote' names and the connect
+// latency histograms
+struct TunnelServices {
+    ConnectMetrics metrics;
+    TunnelMonitor monitor;
+    AdapterRegistry adapterRegistry;
+    std::unique_ptr<CounterSource> counterSource = std::make_unique<SystemCounterSource>();
+    DnsCache dnsCache;
+    std::unique_ptr<BinaryLocator> binaryLocator;
+    std::once_flag binaryLocatorOnce;
+};
+
+// The part of a tunnel that is the same on every desktop platform: the stage
+// machine and its events, the management interface, openvpn's output, the
+// rewritten profile and its cache, and the stats sampled on the monitor
+// thread. The platform's VPNManager derives from it and adds starting,
+// stopping and finding the process and its adapter.
+//
+// Holds no Flutter types; stage events leave through the stage listener and
+// stats as StatsSample, and the plugin encodes both.
+class TunnelSession {
+public:
+    using StageListener = std::function<void(const std::string& tunnelId, const StageEvent& event)>;
+
+    static constexpr const char* kDefaultTunnel = "default";
+
+    TunnelSession(std::string tunnelId, TunnelServices& services);
+    virtual ~TunnelSession();
+
+    TunnelSession(const TunnelSession&) = delete;
+    TunnelSession& operator=(const TunnelSession&) = delete;
+
+    const std::string& getTunnelId() const;
+    bool isActive() const;
+
+    // Main thread; receives every stage event of this tunnel
+    void setStageListener(StageListener listener);
+    // Main thread: sends the current stage to the listener again, so Dart
+    // starts from it (initialize)
+    void announceStage();
+    // Blocks until openvpn is gone (process exit); the plugin runs it on its
+    // command executor. Stage events reach the listener through the platform poster.
+    void stopVPN();
+    std::string getStatus();
+    StatsSample getConnectionStats();
+    const ThroughputHistory& getThroughput() const;
+
+    // Stats stream (main thread): returns true and fills stats only if the
+    // counters changed since the last published sample
+    bool sampleChangedStats(StatsSample& stats);
+    // Forget the last published sample so the next one is always sent
+    void resetStatsStream();
+
+    // How often openvpn pushes traffic counters, applied on the next connect
+    void setByteCountInterval(int seconds);
+
+    // Config cache counters
+    uint64_t getConfigCacheHits() const;
+    uint64_t getConfigCacheMisses() const;
+
+    // Last lines openvpn printed, oldest first; kept after it exits
+    std::vector<std::string> getRecentOutput(size_t maxLines) const;
+
+    // Called from the monitor thread when stage updates become pending;
+    // should schedule processPendingStatusUpdates() on the main thread
+    void setStatusWakeCallback(std::function<void()> callback);
+
+    // Process pending status updates (call from main thread)
+    void processPendingStatusUpdates();
+
+    // Set on the main thread; without it, work meant for the main thread runs inline
+    void setPlatformPoster(std::function<void(std::function<void()>)> post);
+
+protected:
+    std::string tunnelId;
+    TunnelServices& services;
+    StageMachine stages;
+    std::shared_ptr<const std::string> currentConfig; // Rewritten profile, piped to openvpn
+    // Answered when openvpn asks over the management interface (>PASSWORD:);
+    // never written to disk and wiped when the session ends
+    std::string authUsername;
+    std::string authPassword;
+    int monitorWatch = TunnelMonitor::kNoWatch;
+
+    // OpenVPN management interface (state notifications)
+    ManagementClient management;
+    std::chrono::steady_clock::time_point processStartedAt;
+
+    // openvpn's stdout and stderr, read on the monitor thread. Known lines
+    // raise stages right away, also before the management interface is up
+    OutputPipe outputPipe;
+    OutputParser outputParser;
+
+    // Platform part of the session
+    virtual bool hasProcess() const = 0;
+    // Terminates and reaps the openvpn process if there is one; the monitor
+    // does not watch it anymore
+    virtual void terminateProcess() = 0;
+    // Asks openvpn to exit, or kills it, without waiting; called on the
+    // monitor thread, which then sees the exit
+    virtual void signalProcess(bool kill) = 0;
+    // How the process ended, for the log ("code 1"); called on the monitor thread
+    virtual std::string exitStatus() = 0;
+    // This tunnel's adapter in the snapshot, nullptr while it has none
+    virtual const AdapterInfo* findAdapter(const AdapterSnapshot& adapters) const = 0;
+    // Attaches management to this tunnel's openvpn; false until it listens.
+    // Called on the monitor thread.
+    virtual bool connectManagement() = 0;
+
+    // Stops without reporting stages; for the derived class's destructor,
+    // since this one can't reach terminateProcess() anymore
+    void shutdownSession();
+
+    // Start of a connect: drops stale stage updates and a process left from
+    // an earlier failure, and starts resolving the profile's 'remote' names.
+    // False if the tunnel is active already.
+    bool beginConnect(const std::string& config, std::vector<std::string>& remoteHosts);
+    // A superseding disconnect is queued behind the command
+    static bool cancelled(const CancellationToken* cancel);
+    // Rewrites the profile into currentConfig with the platform's device
+    // rules, or reuses the one from an earlier connect. driverKey tells the
+    // cached variants of a profile apart.
+    bool prepareConfig(const std::string& config, bool queryCredentials, const std::vector<std::string>& remoteHosts,
+                       const std::vector<RewriteRule>& deviceRules, int driverKey);
+    // Wipes the rewritten profile and the credentials
+    void clearSession();
+    // openvpn runs and has its profile: resets the counters and hands the
+    // process to the shared monitor. On false the tunnel is stopped again.
+    bool watchProcess(ProcessHandle process);
+
+    void updateStatus(VpnStage stage, VpnError error = VpnError::None);
+
+private:
+    VpnStage currentStage = VpnStage::Disconnected;
+    StageListener stageListener;
+
+    // Hands work to the platform thread when commands run on the executor
+    std::function<void(std::function<void()>)> platformPost;
+
+    // Stage updates from the monitor thread, drained on the platform thread
+    StatusQueue statusQueue;
+
+    // Network adapters, kept current by the registry. The sampler on the
+    // monitor thread uses the snapshot while the tunnel is watched, the
+    // command thread otherwise (connects and stops).
+    std::shared_ptr<const AdapterSnapshot> adapterSnapshot;
+
+    // Rewritten config reuse across reconnects
+    ConfigCache configCache;
+
+    static constexpr int kManagementRetryMs = 50;
+    // How long a connect waits for 'remote' names that are not cached yet
+    static constexpr std::chrono::milliseconds kDnsResolveBudget{1500};
+    // How long the exit handler waits for output still in the pipe
+    static constexpr int kOutputDrainMs = 200;
+
+    // Monitor thread: the connect ran out of time and openvpn was asked to
+    // exit; it is killed if it is still there at killAt
+    bool abandoned = false;
+    std::chrono::steady_clock::time_point killAt;
+    static constexpr int kExitGraceMs = 5000;
+
+    // Traffic totals pushed by the management interface (>BYTECOUNT:)
+    std::atomic<uint64_t> managementBytesIn{0};
+    std::atomic<uint64_t> managementBytesOut{0};
+    std::atomic<bool> hasManagementByteCount{false};
+    int byteCountInterval = 1; // seconds
+
+    // Connection tracking
+    std::chrono::system_clock::time_point connectionStartTime;
+    // Per-second traffic of the session, fed by every >BYTECOUNT: (or every
+    // sample until the first one arrives)
+    ThroughputHistory throughput;
+    // The adapter's counters since the connect
+    SessionCounters sessionCounters;
+
+    // Sampled every kStatsSampleMs on the monitor thread while openvpn runs
+    // (the watch's timer); status calls and the stats stream only copy the
+    // latest sample, without locking
+    SeqLock<StatsSample> latestStats;
+    std::chrono::steady_clock::time_point nextStatsSample;
+    static constexpr int kStatsSampleMs = 1000;
+
+    // Last sample pushed on the stats stream, and the last one returned by
+    // getConnectionStats(); intervals are measured from them
+    StatsSample publishedStats;
+    bool hasPublishedStats = false;
+    StatsSample polledStats;
+
+    // Tunnel monitor handlers, run on the shared monitor thread
+    void onProcessExit(bool waitFailed);
+    bool onManagementReadable();
+    bool onMonitorTimer();
+    bool onOutputReadable();
+    void drainOutput(int waitMs);
+    void rearmMonitor();
+    // Stops watching; the process, if any, is left running
+    void stopWatching();
+
+    void updateStatusThreadSafe(VpnStage stage, VpnError error = VpnError::None);
+    void runOnPlatform(std::function<void()> task);
+    void deliverStageEvent(const StageEvent& event);
+    void resetSpeedTracking();
+    const AdapterSnapshot& currentAdapters();
+
+    // Network statistics, read by the sampler on the monitor thread
+    InterfaceCounters getTrafficCounters();
+    InterfaceCounters getInterfaceCounters();
+    StatsSample takeStatsSample();
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "logger.h"
+#include "tunnel_session.h"
+
+namespace openvpn_flutter {
+
+// Owns the tunnels, keyed by id, and the services they share. The default
+// tunnel always exists and is what calls without a tunnel_id address; other
+// tunnels are created on their first connect and live until removed.
+//
+// Tunnel is the platform's VPNManager, a TunnelSession constructed from its
+// id and the shared services.
+template <typename Tunnel>
+class TunnelSupervisor {
+private:
+    // Declared first so every tunnel is gone before the shared monitor stops
+    TunnelServices services;
+
+    mutable std::mutex mutex;
+    std::map<std::string, std::shared_ptr<Tunnel>> tunnels;
+
+    // Applied to every tunnel, including ones created later (main thread)
+    TunnelSession::StageListener stageListener;
+    std::function<void()> statusWake;
+    std::function<void(std::function<void()>)> platformPost;
+
+    std::shared_ptr<Tunnel> create(const std::string& id) {
+        // Every tunnel may need its process watched by the one monitor thread
+        if (tunnels.size() >= TunnelMonitor::kMaxWatches) {
+            LOG_ERROR("Cannot create tunnel " << id << ": " << tunnels.size() << " tunnels exist already");
+            return nullptr;
+        }
+        auto created = std::make_shared<Tunnel>(id, services);
+        created->setStageListener(stageListener);
+        if (statusWake) {
+            created->setStatusWakeCallback(statusWake);
+        }
+        if (platformPost) {
+            created->setPlatformPoster(platformPost);
+        }
+        tunnels[id] = created;
+        LOG_INFO("Created tunnel " << id << " (" << tunnels.size() << " total)");
+        return created;
+    }
+
+public:
+    TunnelSupervisor() {
+        tunnels[TunnelSession::kDefaultTunnel] = std::make_shared<Tunnel>(TunnelSession::kDefaultTunnel, services);
+    }
+
+    ~TunnelSupervisor() {
+        // Tunnels stop their processes and unwatch them before the monitor goes
+        std::lock_guard<std::mutex> lock(mutex);
+        tunnels.clear();
+    }
+
+    TunnelSupervisor(const TunnelSupervisor&) = delete;
+    TunnelSupervisor& operator=(const TunnelSupervisor&) = delete;
+
+    // Letters, digits, '-' and '_', at most 32 characters; ids end up in
+    // adapter and file names
+    static bool isValidId(const std::string& id) {
+        if (id.empty() || id.size() > 32) {
+            return false;
+        }
+        for (char c : id) {
+            bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                         c == '-' || c == '_';
+            if (!valid) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Tunnel& defaultTunnel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return *tunnels.at(TunnelSession::kDefaultTunnel);
+    }
+
+    // Creates the tunnel if it does not exist yet; nullptr if that would
+    // make more than TunnelMonitor::kMaxWatches
+    std::shared_ptr<Tunnel> tunnel(const std::string& id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = tunnels.find(id);
+        if (it != tunnels.end()) {
+            return it->second;
+        }
+        return create(id);
+    }
+
+    // nullptr if there is no such tunnel
+    std::shared_ptr<Tunnel> find(const std::string& id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = tunnels.find(id);
+        return it != tunnels.end() ? it->second : nullptr;
+    }
+
+    std::vector<std::shared_ptr<Tunnel>> all() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::shared_ptr<Tunnel>> result;
+        result.reserve(tunnels.size());
+        for (const auto& [id, tunnel] : tunnels) {
+            result.push_back(tunnel);
+        }
+        return result;
+    }
+
+    // Forget a tunnel, which must be stopped already; the default tunnel stays
+    bool remove(const std::string& id) {
+        if (id == TunnelSession::kDefaultTunnel) {
+            return false;
+        }
+        std::shared_ptr<Tunnel> removed; // Destroyed outside the lock
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = tunnels.find(id);
+            if (it == tunnels.end()) {
+                return false;
+            }
+            removed = std::move(it->second);
+            tunnels.erase(it);
+        }
+        LOG_INFO("Removed tunnel " << id);
+        return true;
+    }
+
+    void setStageListener(TunnelSession::StageListener listener) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stageListener = std::move(listener);
+        for (const auto& [id, tunnel] : tunnels) {
+            tunnel->setStageListener(stageListener);
+        }
+    }
+
+    void setStatusWakeCallback(std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        statusWake = std::move(callback);
+        for (const auto& [id, tunnel] : tunnels) {
+            tunnel->setStatusWakeCallback(statusWake);
+        }
+    }
+
+    void setPlatformPoster(std::function<void(std::function<void()>)> post) {
+        std::lock_guard<std::mutex> lock(mutex);
+        platformPost = std::move(post);
+        for (const auto& [id, tunnel] : tunnels) {
+            tunnel->setPlatformPoster(platformPost);
+        }
+    }
+
+    // Drain the stage updates of every tunnel (main thread)
+    void processPendingStatusUpdates() {
+        // Each tunnel's queue keeps its own order; one wake-up drains all of them
+        for (const auto& tunnel : all()) {
+            tunnel->processPendingStatusUpdates();
+        }
+    }
+
+    // Connect latency histograms of all tunnels together
+    ConnectMetrics& metrics() {
+        return services.metrics;
+    }
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace openvpn_flutter {
+
+// Version of the event and stats maps sent to Dart; bump when a key changes meaning
+constexpr int32_t kEventSchemaVersion = 2;
+
+// Connection stages reported to Dart on the vpnstage channel
+enum class VpnStage : uint8_t {
+    Disconnected,
+    Connecting,
+    TcpConnect,
+    Resolve,
+    WaitConnection,
+    Authenticating,
+    GetConfig,
+    AssignIp,
+    Connected,
+    Exiting,
+    Error
+};
+
+// Why a connection failed; values are part of the Dart-facing schema, never reorder
+enum class VpnError : int32_t {
+    None = 0,
+    DriverUnavailable = 1,
+    OpenVpnNotFound = 2,
+    ConfigWriteFailed = 3,
+    ManagementPortUnavailable = 4,
+    NotElevated = 5,
+    ProcessStartFailed = 6,
+    InternalError = 7,
+    WaitFailed = 8,
+    ConnectTimeout = 9,
+    FatalError = 10,
+    AuthFailed = 11,
+    TlsError = 12
+};
+
+// A stage change as it travels from the monitor thread to the platform thread.
+// Kept trivially copyable so it fits the lock-free status queue; the reason
+// text is looked up from the error code on delivery.
+struct StageEvent {
+    VpnStage stage = VpnStage::Disconnected;
+    VpnError error = VpnError::None;
+    int64_t timestampMs = 0; // steady_clock, not wall time
+
+    bool sameAs(const StageEvent& other) const {
+        return stage == other.stage && error == other.error;
+    }
+};
+
+inline StageEvent makeStageEvent(VpnStage stage, VpnError error = VpnError::None) {
+    StageEvent event;
+    event.stage = stage;
+    event.error = error;
+    event.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    return event;
+}
+
+// Names must match VPNStage on the Dart side
+inline const char* stageName(VpnStage stage) {
+    switch (stage) {
+        case VpnStage::Disconnected: return "disconnected";
+        case VpnStage::Connecting: return "connecting";
+        case VpnStage::TcpConnect: return "tcp_connect";
+        case VpnStage::Resolve: return "resolve";
+        case VpnStage::WaitConnection: return "wait_connection";
+        case VpnStage::Authenticating: return "authenticating";
+        case VpnStage::GetConfig: return "get_config";
+        case VpnStage::AssignIp: return "assign_ip";
+        case VpnStage::Connected: return "connected";
+        case VpnStage::Exiting: return "exiting";
+        case VpnStage::Error: return "error";
+    }
+    return "unknown";
+}
+
+inline const char* errorReason(VpnError error) {
+    switch (error) {
+        case VpnError::None: return "";
+#ifdef _WIN32
+        case VpnError::DriverUnavailable: return "No usable WinTun or TAP-Windows driver";
+        case VpnError::OpenVpnNotFound: return "Bundled openvpn.exe not found";
+#else
+        case VpnError::DriverUnavailable: return "/dev/net/tun is not available";
+        case VpnError::OpenVpnNotFound: return "openvpn executable not found";
+#endif
+        case VpnError::ConfigWriteFailed: return "Could not pass the config to OpenVPN";
+        case VpnError::ManagementPortUnavailable: return "No free port for the management interface";
+#ifdef _WIN32
+        case VpnError::NotElevated: return "Administrator privileges are required";
+#else
+        case VpnError::NotElevated: return "openvpn needs root or CAP_NET_ADMIN";
+#endif
+        case VpnError::ProcessStartFailed: return "Could not start the OpenVPN process";
+        case VpnError::InternalError: return "Unexpected error while starting the connection";
+        case VpnError::WaitFailed: return "Lost track of the OpenVPN process";
+        case VpnError::ConnectTimeout: return "Connection timed out";
+        case VpnError::FatalError: return "OpenVPN reported a fatal error";
+        case VpnError::AuthFailed: return "The server rejected the username or password";
+        case VpnError::TlsError: return "The TLS handshake with the server failed";
+    }
+    return "Unknown error";
+}
+
+} // namespace openvpn_flutter
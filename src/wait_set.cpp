@@ -0,0 +1,301 @@
+#include "wait_set.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <windows.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+
+namespace openvpn_flutter {
+
+namespace {
+
+#ifndef _WIN32
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+// Without pidfd (Linux < 5.3) process exit is checked at this interval
+constexpr int kProcessPollMs = 100;
+
+int openPidFd(ProcessHandle pid) {
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+// True if the child has exited; the zombie is left for the owner to reap
+bool hasExited(ProcessHandle pid) {
+    siginfo_t info{};
+    if (waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOHANG | WNOWAIT) != 0) {
+        return errno == ECHILD;
+    }
+    return info.si_pid == pid;
+}
+#endif
+
+} // namespace
+
+// StopSignal
+
+StopSignal::StopSignal() {
+#ifdef _WIN32
+    handle = CreateEventW(NULL, TRUE, FALSE, NULL);
+#else
+    handle = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+}
+
+StopSignal::~StopSignal() {
+#ifdef _WIN32
+    if (handle) {
+        CloseHandle(handle);
+    }
+#else
+    if (handle >= 0) {
+        ::close(handle);
+    }
+#endif
+}
+
+void StopSignal::set() {
+#ifdef _WIN32
+    SetEvent(handle);
+#else
+    uint64_t one = 1;
+    ssize_t written = ::write(handle, &one, sizeof(one));
+    (void)written;
+#endif
+}
+
+void StopSignal::reset() {
+#ifdef _WIN32
+    ResetEvent(handle);
+#else
+    uint64_t value;
+    while (::read(handle, &value, sizeof(value)) > 0) {
+    }
+#endif
+}
+
+NativeHandle StopSignal::getHandle() const {
+    return handle;
+}
+
+// WaitSet
+
+WaitSet::~WaitSet() {
+    clear();
+}
+
+int WaitSet::append(const Source& source) {
+    sources.push_back(source);
+    return static_cast<int>(sources.size() - 1);
+}
+
+int WaitSet::addProcess(ProcessHandle process) {
+    if (sources.size() >= kMaxSources) {
+        return kFailed;
+    }
+    Source source{SourceType::Process, process, NativeHandle(), SocketHandle(), false, true};
+#ifdef _WIN32
+    source.handle = process;
+#else
+    source.handle = pidFdDisabled ? -1 : openPidFd(process);
+    source.ownsHandle = source.handle >= 0;
+#endif
+    return append(source);
+}
+
+int WaitSet::addSignal(const StopSignal& signal) {
+    if (sources.size() >= kMaxSources) {
+        return kFailed;
+    }
+    return append(Source{SourceType::Signal, ProcessHandle(), signal.getHandle(), SocketHandle(), false, true});
+}
+
+int WaitSet::addSocket(SocketHandle socket) {
+    if (sources.size() >= kMaxSources) {
+        return kFailed;
+    }
+    Source source{SourceType::Socket, ProcessHandle(), NativeHandle(), socket, false, true};
+#ifdef _WIN32
+    // Readability is signalled through an event bound to the socket
+    WSAEVENT event = WSACreateEvent();
+    if (event == WSA_INVALID_EVENT ||
+        WSAEventSelect(static_cast<SOCKET>(socket), event, FD_READ | FD_CLOSE) != 0) {
+        if (event != WSA_INVALID_EVENT) {
+            WSACloseEvent(event);
+        }
+        source.active = false;
+    } else {
+        source.handle = event;
+        source.ownsHandle = true;
+    }
+#else
+    source.handle = socket;
+#endif
+    return append(source);
+}
+
+int WaitSet::addHandle(NativeHandle handle) {
+    if (sources.size() >= kMaxSources) {
+        return kFailed;
+    }
+    return append(Source{SourceType::Handle, ProcessHandle(), handle, SocketHandle(), false, true});
+}
+
+void WaitSet::remove(int id) {
+    if (id < 0 || static_cast<size_t>(id) >= sources.size()) {
+        return;
+    }
+    Source& source = sources[static_cast<size_t>(id)];
+    if (source.ownsHandle) {
+#ifdef _WIN32
+        if (source.type == SourceType::Socket) {
+            WSAEventSelect(static_cast<SOCKET>(source.socket), NULL, 0);
+            WSACloseEvent(source.handle);
+        }
+#else
+        ::close(source.handle);
+#endif
+        source.ownsHandle = false;
+    }
+    source.active = false;
+}
+
+void WaitSet::clear() {
+    for (size_t i = 0; i < sources.size(); i++) {
+        remove(static_cast<int>(i));
+    }
+    sources.clear();
+}
+
+#ifndef _WIN32
+void WaitSet::disablePidFd() {
+    pidFdDisabled = true;
+}
+#endif
+
+int WaitSet::wait(int timeoutMs) {
+#ifdef _WIN32
+    HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+    int ids[MAXIMUM_WAIT_OBJECTS];
+    DWORD count = 0;
+    static_assert(kMaxSources <= MAXIMUM_WAIT_OBJECTS, "More sources than one wait takes");
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources[i].active && sources[i].handle) {
+            handles[count] = sources[i].handle;
+            ids[count] = static_cast<int>(i);
+            count++;
+        }
+    }
+    if (count == 0) {
+        if (timeoutMs < 0) {
+            return kFailed;
+        }
+        Sleep(static_cast<DWORD>(timeoutMs));
+        return kTimeout;
+    }
+
+    DWORD rc = WaitForMultipleObjects(count, handles, FALSE,
+                                      timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs));
+    if (rc == WAIT_TIMEOUT) {
+        return kTimeout;
+    }
+    if (rc >= WAIT_OBJECT_0 && rc < WAIT_OBJECT_0 + count) {
+        int id = ids[rc - WAIT_OBJECT_0];
+        Source& source = sources[static_cast<size_t>(id)];
+        if (source.type == SourceType::Socket) {
+            // Resets the event; the owner drains the socket until it would block
+            WSANETWORKEVENTS events;
+            WSAEnumNetworkEvents(static_cast<SOCKET>(source.socket), source.handle, &events);
+        }
+        return id;
+    }
+    return kFailed;
+#else
+    std::vector<pollfd> fds;
+    std::vector<int> ids;
+    fds.reserve(sources.size());
+    ids.reserve(sources.size());
+    bool pollsProcesses = false;
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        const Source& source = sources[i];
+        if (!source.active) {
+            continue;
+        }
+        if (source.type == SourceType::Process && source.handle < 0) {
+            // No pidfd: fall back to checking the child periodically
+            pollsProcesses = true;
+            continue;
+        }
+        fds.push_back(pollfd{source.handle, POLLIN, 0});
+        ids.push_back(static_cast<int>(i));
+    }
+
+    // The first pidfd-less process that has exited, or kTimeout
+    auto exitedProcess = [this]() {
+        for (size_t i = 0; i < sources.size(); i++) {
+            const Source& source = sources[i];
+            if (source.active && source.type == SourceType::Process && source.handle < 0 &&
+                hasExited(source.process)) {
+                return static_cast<int>(i);
+            }
+        }
+        return kTimeout;
+    };
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        if (pollsProcesses) {
+            int id = exitedProcess();
+            if (id != kTimeout) {
+                return id;
+            }
+        }
+
+        int pollMs = kInfinite;
+        if (timeoutMs >= 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            pollMs = static_cast<int>(std::max<int64_t>(remaining, 0));
+        }
+        if (pollsProcesses) {
+            pollMs = pollMs < 0 ? kProcessPollMs : std::min(pollMs, kProcessPollMs);
+        }
+
+        int rc = poll(fds.data(), static_cast<nfds_t>(fds.size()), pollMs);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            return kFailed;
+        }
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (fds[i].revents != 0) {
+                return ids[i];
+            }
+        }
+        // Polling a process only shortens the sleep, not the caller's timeout
+        if (timeoutMs >= 0 && std::chrono::steady_clock::now() >= deadline) {
+            return pollsProcesses ? exitedProcess() : kTimeout;
+        }
+    }
+#endif
+}
+
+} // namespace openvpn_flutter
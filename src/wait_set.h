@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "management_client.h"
+
+namespace openvpn_flutter {
+
+// Native handle types
+#ifdef _WIN32
+using NativeHandle = void*;   // HANDLE
+using ProcessHandle = void*;  // Process HANDLE
+#else
+using NativeHandle = int;     // File descriptor
+using ProcessHandle = int;    // pid_t of a child process
+#endif
+
+// Manually reset wake-up signal (event on Windows, eventfd on Linux)
+class StopSignal {
+private:
+    NativeHandle handle;
+
+public:
+    StopSignal();
+    ~StopSignal();
+
+    StopSignal(const StopSignal&) = delete;
+    StopSignal& operator=(const StopSignal&) = delete;
+
+    void set();
+    void reset();
+    NativeHandle getHandle() const;
+};
+
+// Blocks on a child process, stop signals, sockets and pipes at the same time
+// (WaitForMultipleObjects on Windows, poll over pidfd/eventfd/sockets on Linux),
+// so exits, stop requests and incoming data are observed without polling.
+class WaitSet {
+private:
+    enum class SourceType { Process, Signal, Socket, Handle };
+
+    struct Source {
+        SourceType type;
+        ProcessHandle process;
+        NativeHandle handle;  // Waitable handle: process, event, pidfd or socket
+        SocketHandle socket;
+        bool ownsHandle;
+        bool active;
+    };
+
+    std::vector<Source> sources;
+#ifndef _WIN32
+    bool pidFdDisabled = false;
+#endif
+
+    int append(const Source& source);
+
+public:
+    static constexpr int kTimeout = -1;
+    static constexpr int kFailed = -2;
+    static constexpr int kInfinite = -1;
+    // WaitForMultipleObjects takes at most 64 handles; poll has no such limit
+#ifdef _WIN32
+    static constexpr size_t kMaxSources = 64;
+#else
+    static constexpr size_t kMaxSources = 4096;
+#endif
+
+    WaitSet() = default;
+    ~WaitSet();
+
+    WaitSet(const WaitSet&) = delete;
+    WaitSet& operator=(const WaitSet&) = delete;
+
+    // Each add returns the id that wait() reports when that source fires, or
+    // kFailed once the set holds kMaxSources
+    int addProcess(ProcessHandle process);
+    int addSignal(const StopSignal& signal);
+    int addSocket(SocketHandle socket);
+    // An event (Windows) or readable descriptor the owner resets itself, such
+    // as the completion event of an overlapped read
+    int addHandle(NativeHandle handle);
+    void remove(int id);
+    void clear();
+#ifndef _WIN32
+    // Processes added from now on are watched as on kernels without pidfd
+    // (< 5.3), by checking them periodically; for tests
+    void disablePidFd();
+#endif
+
+    // Wait until a source fires (returns its id), the timeout elapses
+    // (kTimeout) or waiting fails (kFailed). timeoutMs < 0 waits forever.
+    int wait(int timeoutMs);
+};
+
+} // namespace openvpn_flutter
@@ -0,0 +1,62 @@
+#include "worker_pool.h"
+
+#include <utility>
+
+namespace openvpn_flutter {
+
+WorkerPool::WorkerPool(size_t size)
+    : size(size == 0 ? 1 : size) {
+}
+
+WorkerPool::~WorkerPool() {
+    shutdown();
+}
+
+bool WorkerPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return false;
+        }
+        jobs.push_back(std::move(job));
+        if (threads.size() < size && threads.size() < jobs.size()) {
+            threads.emplace_back(&WorkerPool::run, this);
+        }
+    }
+    wake.notify_one();
+    return true;
+}
+
+void WorkerPool::shutdown() {
+    std::vector<std::thread> running;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+        running.swap(threads);
+    }
+    wake.notify_all();
+    for (std::thread& thread : running) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void WorkerPool::run() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openvpn_flutter {
+
+// Small fixed-size thread pool for blocking work (driver probing, process
+// launches) that must stay off the platform thread. Threads are only started
+// on the first submit, so constructing a pool during plugin load is free.
+class WorkerPool {
+private:
+    size_t size;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+
+    void run();
+
+public:
+    explicit WorkerPool(size_t size);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Queue a job; returns false once the pool is shut down
+    bool submit(std::function<void()> job);
+
+    // Drop queued jobs and wait for running ones to finish
+    void shutdown();
+};
+
+} // namespace openvpn_flutter
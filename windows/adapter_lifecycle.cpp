@@ -0,0 +1,161 @@
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+
+#include "adapter_lifecycle.h"
+#include "logger.h"
+
+#include <sstream>
+#include <utility>
+
+namespace openvpn_flutter {
+
+namespace {
+
+// Runs a console tool without a window; false if it could not be started
+bool runHidden(const std::string& commandLine, const std::string& workingDirectory,
+               DWORD timeoutMs, DWORD* exitCode) {
+    STARTUPINFOA startupInfo;
+    PROCESS_INFORMATION processInfo;
+    ZeroMemory(&processInfo, sizeof(processInfo));
+    ZeroMemory(&startupInfo, sizeof(startupInfo));
+    startupInfo.cb = sizeof(startupInfo);
+    startupInfo.dwFlags = STARTF_USESHOWWINDOW;
+    startupInfo.wShowWindow = SW_HIDE;
+
+    std::string mutableCommandLine = commandLine;
+    if (!CreateProcessA(NULL, &mutableCommandLine[0], NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL,
+                        workingDirectory.c_str(), &startupInfo, &processInfo)) {
+        return false;
+    }
+
+    WaitForSingleObject(processInfo.hProcess, timeoutMs);
+    if (exitCode && !GetExitCodeProcess(processInfo.hProcess, exitCode)) {
+        *exitCode = static_cast<DWORD>(-1);
+    }
+    CloseHandle(processInfo.hProcess);
+    CloseHandle(processInfo.hThread);
+    return true;
+}
+
+} // namespace
+
+AdapterLifecycle::AdapterLifecycle(WinTunManager& wintun, AdapterRegistry& registry, std::string adapterName)
+    : wintun(wintun), registry(registry), adapterName(std::move(adapterName)) {
+}
+
+AdapterLifecycle::Health AdapterLifecycle::check() const {
+    // The driver is only loaded while at least one WinTun adapter exists
+    if (wintun.getDriverVersion() == 0) {
+        return Health::DriverNotRunning;
+    }
+
+    auto snapshot = registry.snapshot();
+    const AdapterInfo* adapter = snapshot->findByAlias(adapterName);
+    if (!adapter) {
+        return Health::Missing;
+    }
+
+    // Read the live state of this one interface; the snapshot may lag behind a
+    // session that was closed a moment ago. An adapter that is still up has a
+    // session open by someone else (e.g. an orphaned openvpn.exe).
+    MIB_IF_ROW2 row;
+    ZeroMemory(&row, sizeof(row));
+    row.InterfaceIndex = adapter->index;
+    if (GetIfEntry2(&row) != NO_ERROR) {
+        return Health::Missing;
+    }
+    if (row.OperStatus == IfOperStatusUp) {
+        return Health::StaleOwner;
+    }
+    return Health::Healthy;
+}
+
+bool AdapterLifecycle::ensure(const std::string& tapctlPath, const std::string& workingDirectory, bool& reused) {
+    reused = false;
+    if (created) {
+        Health health = check();
+        if (health == Health::Healthy) {
+            reused = true;
+            return true;
+        }
+        LOG_INFO("WinTun adapter " << adapterName << " unhealthy (" << healthName(health)
+                 << "), recreating");
+    } else if (check() == Health::Healthy) {
+        // Left over from a previous run and not in use, adopt it
+        created = true;
+        reused = true;
+        return true;
+    }
+
+    created = recreate(tapctlPath, workingDirectory);
+    return created;
+}
+
+bool AdapterLifecycle::recreate(const std::string& tapctlPath, const std::string& workingDirectory) {
+    if (!tapctlPath.empty()) {
+        LOG_INFO("Found tapctl.exe, creating WinTun adapter...");
+
+        // CRITICAL: First DELETE any existing adapter to ensure clean state
+        // This is essential after WireGuard has been used, as there may be
+        // stale adapter state that prevents OpenVPN from working
+        std::ostringstream deleteStream;
+        deleteStream << "\"" << tapctlPath << "\" delete \"" << adapterName << "\"";
+        if (runHidden(deleteStream.str(), workingDirectory, 3000, nullptr)) {
+            // Small delay after deletion to ensure system has released resources
+            Sleep(500);
+        }
+
+        // Now CREATE a fresh adapter
+        std::ostringstream createStream;
+        createStream << "\"" << tapctlPath << "\" create --hwid wintun --name \"" << adapterName << "\"";
+        DWORD createExitCode = 0;
+        if (runHidden(createStream.str(), workingDirectory, 5000, &createExitCode)) {
+            if (createExitCode == 0) {
+                LOG_INFO("Successfully created WinTun adapter using tapctl.exe");
+                return true;
+            }
+            LOG_WARN("tapctl.exe exited with code: " << createExitCode << ", falling back to programmatic creation");
+        } else {
+            DWORD error = GetLastError();
+            LOG_WARN("Failed to run tapctl.exe (error " << error << "), falling back to programmatic creation");
+        }
+    } else {
+        LOG_INFO("tapctl.exe not found, using programmatic adapter creation");
+    }
+
+    // Fallback: Create WinTun adapter programmatically
+    wintun.destroyAdapter();
+    if (!wintun.createAdapter(adapterName)) {
+        LOG_ERROR("Failed to create WinTun adapter programmatically");
+        return false;
+    }
+
+    LOG_INFO("WinTun driver initialized successfully (programmatic creation)");
+    return true;
+}
+
+void AdapterLifecycle::invalidate() {
+    created = false;
+}
+
+const std::string& AdapterLifecycle::getAdapterName() const {
+    return adapterName;
+}
+
+const char* AdapterLifecycle::healthName(Health health) {
+    switch (health) {
+        case Health::Healthy: return "healthy";
+        case Health::Missing: return "missing";
+        case Health::DriverNotRunning: return "driver not running";
+        case Health::StaleOwner: return "stale owner";
+    }
+    return "unknown";
+}
+
+} // namespace openvpn_flutter
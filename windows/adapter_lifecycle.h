@@ -0,0 +1,50 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+
+#include "adapter_registry.h"
+#include "wintun_manager.h"
+
+namespace openvpn_flutter {
+
+// Keeps the "OpenVPN-Flutter" WinTun adapter alive between sessions.
+//
+// Recreating the adapter (tapctl delete, settle, tapctl create) costs seconds
+// per connect, so ensure() first runs a cheap health check and only rebuilds
+// the adapter when the check fails.
+class AdapterLifecycle {
+public:
+    enum class Health {
+        Healthy,
+        Missing,           // No adapter with our name
+        DriverNotRunning,  // WinTun driver not loaded
+        StaleOwner         // Adapter still up with no tunnel of ours running
+    };
+
+private:
+    WinTunManager& wintun;
+    AdapterRegistry& registry;
+    std::string adapterName;
+    bool created = false;  // We created or verified the adapter this run
+
+    bool recreate(const std::string& tapctlPath, const std::string& workingDirectory);
+
+public:
+    AdapterLifecycle(WinTunManager& wintun, AdapterRegistry& registry, std::string adapterName);
+
+    // Checked while no tunnel is running
+    Health check() const;
+
+    // Reuse the adapter if healthy, otherwise recreate it (tapctl when
+    // available, WinTun API otherwise). Sets reused to whether it was warm.
+    bool ensure(const std::string& tapctlPath, const std::string& workingDirectory, bool& reused);
+
+    // Force a rebuild on the next ensure(), e.g. after a tunnel failed on it
+    void invalidate();
+
+    const std::string& getAdapterName() const;
+    static const char* healthName(Health health);
+};
+
+} // namespace openvpn_flutter
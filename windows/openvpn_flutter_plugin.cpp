@@ -1,4 +1,9 @@
 #include "openvpn_flutter_plugin.h"
+#include "command_executor.h"
+#include "connection_stats.h"
+#include "logger.h"
+#include "platform_dispatcher.h"
+#include "tunnel_supervisor.h"
 #include "vpn_manager.h"
 
 // This must be included before many other Windows headers.
@@ -13,25 +18,128 @@
 #include <flutter/event_channel.h>
 #include <flutter/event_stream_handler_functions.h>
 
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <type_traits>
 
 #include "include/openvpn_flutter/openvpn_flutter_plugin_c_api.h"
 #include "include/openvpn_flutter/open_v_p_n_flutter_plugin.h"
 
 namespace openvpn_flutter {
 
-// Global VPN manager instance
-static std::unique_ptr<VPNManager> vpnManager = std::make_unique<VPNManager>();
+// Results of work done on the worker pool are handed back to the platform thread
+// here; declared first so it outlives the manager's workers at shutdown
+static PlatformDispatcher platformDispatcher;
+static const UINT dispatchMessage = RegisterWindowMessageW(L"OpenVPNFlutterDispatch");
 
-// Timer for processing status updates
+// All tunnels; calls without a tunnel_id address the default one
+static std::unique_ptr<TunnelSupervisor<VPNManager>> supervisor = std::make_unique<TunnelSupervisor<VPNManager>>();
+
+// Blocking VPN commands run here one at a time, off the platform thread;
+// declared after the supervisor so it is torn down first
+static CommandExecutor commandExecutor;
+
+// How a connect command ended, reported back to the platform thread
+enum class ConnectOutcome { Started, Failed, Cancelled };
+
+// Runs a blocking command on the executor and completes it on the platform
+// thread, or inline when there is no window to post back to
+template <typename Work, typename Complete>
+static void RunCommand(const std::string& name, Work work, Complete complete) {
+    if (!platformDispatcher.canDispatch()) {
+        CancellationToken never;
+        complete(work(never));
+        return;
+    }
+    commandExecutor.submit(name, [work, complete](const CancellationToken& cancel) {
+        auto outcome = work(cancel);
+        platformDispatcher.post([complete, outcome]() { complete(outcome); });
+    });
+}
+
+// tunnel_id argument of a call, the default tunnel if absent; false if malformed
+static bool TunnelIdOf(const flutter::EncodableValue* arguments, std::string& tunnelId) {
+    tunnelId = VPNManager::kDefaultTunnel;
+    const auto* map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+    if (!map) {
+        return true;
+    }
+    auto it = map->find(flutter::EncodableValue("tunnel_id"));
+    if (it == map->end() || it->second.IsNull()) {
+        return true;
+    }
+    const auto* id = std::get_if<std::string>(&it->second);
+    if (!id || !TunnelSupervisor<VPNManager>::isValidId(*id)) {
+        return false;
+    }
+    tunnelId = *id;
+    return true;
+}
+
+// Posted to the top-level window by the monitor thread when stage updates are pending
+static const UINT statusUpdateMessage = RegisterWindowMessageW(L"OpenVPNFlutterStatusUpdate");
+static bool statusWakeAvailable = false;
+
+// Fallback timer for processing status updates when there is no window to post to
 static UINT_PTR statusUpdateTimer = 0;
 static OpenVPNFlutterPlugin* pluginInstance = nullptr;
 
 // Timer callback to process status updates from main thread
 static void CALLBACK StatusUpdateTimerProc(HWND hwnd, UINT message, UINT_PTR idTimer, DWORD dwTime) {
-    if (vpnManager) {
-        vpnManager->processPendingStatusUpdates();
+    if (supervisor) {
+        supervisor->processPendingStatusUpdates();
+    }
+}
+
+// Stats stream sampling, only runs while the vpnstats channel has a listener
+static UINT_PTR statsTimer = 0;
+static constexpr int kDefaultStatsIntervalMs = 1000;
+static constexpr int kMinStatsIntervalMs = 250;
+static constexpr int kMaxStatsIntervalMs = 5000;
+
+// Defaults and bounds of the throughput call
+static constexpr int64_t kDefaultThroughputWindowS = 60;
+static constexpr double kDefaultThroughputPercentile = 95.0;
+static constexpr int64_t kDefaultThroughputPoints = 60;
+static constexpr int64_t kMaxThroughputPoints = 600;
+
+static flutter::EncodableMap EncodeStats(const StatsSample& sample, const std::string& tunnelId) {
+    flutter::EncodableMap stats;
+    visitStats(sample, tunnelId, [&stats](const char* key, const auto& value) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::nullptr_t>) {
+            stats[flutter::EncodableValue(key)] = flutter::EncodableValue();
+        } else {
+            stats[flutter::EncodableValue(key)] = flutter::EncodableValue(value);
+        }
+    });
+    return stats;
+}
+
+static flutter::EncodableMap EncodeStageEvent(const std::string& tunnelId, const StageEvent& event) {
+    flutter::EncodableMap payload;
+    payload[flutter::EncodableValue("version")] = flutter::EncodableValue(kEventSchemaVersion);
+    payload[flutter::EncodableValue("tunnel_id")] = flutter::EncodableValue(tunnelId);
+    payload[flutter::EncodableValue("stage")] = flutter::EncodableValue(stageName(event.stage));
+    payload[flutter::EncodableValue("stage_code")] = flutter::EncodableValue(static_cast<int32_t>(event.stage));
+    payload[flutter::EncodableValue("timestamp_ms")] = flutter::EncodableValue(event.timestampMs);
+    payload[flutter::EncodableValue("error_code")] = flutter::EncodableValue(static_cast<int32_t>(event.error));
+    payload[flutter::EncodableValue("reason")] = flutter::EncodableValue(errorReason(event.error));
+    return payload;
+}
+
+static void CALLBACK StatsTimerProc(HWND hwnd, UINT message, UINT_PTR idTimer, DWORD dwTime) {
+    if (pluginInstance) {
+        pluginInstance->SendStatsIfChanged();
+    }
+}
+
+static void StopStatsTimer() {
+    if (statsTimer != 0) {
+        KillTimer(NULL, statsTimer);
+        statsTimer = 0;
     }
 }
 
@@ -48,6 +156,11 @@ void OpenVPNFlutterPlugin::RegisterWithRegistrar(
           registrar->messenger(), "id.laskarmedia.openvpn_flutter/vpnstage",
           &flutter::StandardMethodCodec::GetInstance());
 
+  auto stats_channel =
+      std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+          registrar->messenger(), "id.laskarmedia.openvpn_flutter/vpnstats",
+          &flutter::StandardMethodCodec::GetInstance());
+
   auto plugin = std::make_unique<OpenVPNFlutterPlugin>(registrar);
   pluginInstance = plugin.get();
 
@@ -63,26 +176,29 @@ void OpenVPNFlutterPlugin::RegisterWithRegistrar(
           std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&& events)
           -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
         plugin_pointer->event_sink_ = std::move(events);
-        vpnManager->setEventSink(plugin_pointer->event_sink_.get());
+        supervisor->setStageListener(
+            [sink = plugin_pointer->event_sink_.get()](const std::string& tunnelId, const StageEvent& event) {
+              sink->Success(flutter::EncodableValue(EncodeStageEvent(tunnelId, event)));
+            });
         
-        // Start timer to process status updates every 100ms
-        if (statusUpdateTimer == 0) {
+        // Without a window to wake, poll status updates every 100ms
+        if (!statusWakeAvailable && statusUpdateTimer == 0) {
           statusUpdateTimer = SetTimer(NULL, 0, 100, StatusUpdateTimerProc);
-          std::cout << "Started status update timer" << std::endl;
+          LOG_DEBUG("Started status update timer");
         }
         
         return nullptr;
       },
       [plugin_pointer = plugin.get()](const flutter::EncodableValue* arguments)
           -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+        supervisor->setStageListener(nullptr);
         plugin_pointer->event_sink_.reset();
-        vpnManager->setEventSink(nullptr);
         
         // Stop timer when event sink is removed
         if (statusUpdateTimer != 0) {
           KillTimer(NULL, statusUpdateTimer);
           statusUpdateTimer = 0;
-          std::cout << "Stopped status update timer" << std::endl;
+          LOG_DEBUG("Stopped status update timer");
         }
         
         return nullptr;
@@ -90,21 +206,106 @@ void OpenVPNFlutterPlugin::RegisterWithRegistrar(
 
   event_channel->SetStreamHandler(std::move(stream_handler));
 
+  // Stats are pushed at the listener's rate ({"interval_ms": int}) and only when they change
+  auto stats_handler = std::make_unique<flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+      [plugin_pointer = plugin.get()](
+          const flutter::EncodableValue* arguments,
+          std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&& events)
+          -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+        int intervalMs = kDefaultStatsIntervalMs;
+        if (arguments) {
+          if (const auto* args = std::get_if<flutter::EncodableMap>(arguments)) {
+            auto it = args->find(flutter::EncodableValue("interval_ms"));
+            if (it != args->end() && std::holds_alternative<int32_t>(it->second)) {
+              intervalMs = std::get<int32_t>(it->second);
+            }
+          }
+        }
+        intervalMs = (std::max)(kMinStatsIntervalMs, (std::min)(intervalMs, kMaxStatsIntervalMs));
+
+        plugin_pointer->stats_event_sink_ = std::move(events);
+        for (const auto& tunnel : supervisor->all()) {
+          tunnel->resetStatsStream();
+        }
+        plugin_pointer->SendStatsIfChanged();
+
+        StopStatsTimer();
+        statsTimer = SetTimer(NULL, 0, static_cast<UINT>(intervalMs), StatsTimerProc);
+        return nullptr;
+      },
+      [plugin_pointer = plugin.get()](const flutter::EncodableValue* arguments)
+          -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+        StopStatsTimer();
+        plugin_pointer->stats_event_sink_.reset();
+        return nullptr;
+      });
+
+  stats_channel->SetStreamHandler(std::move(stats_handler));
+
   registrar->AddPlugin(std::move(plugin));
 }
 
 OpenVPNFlutterPlugin::OpenVPNFlutterPlugin(flutter::PluginRegistrarWindows *registrar)
-    : registrar_(registrar) {}
+    : registrar_(registrar) {
+  // Stage updates are drained on the platform thread when the monitor posts a wake-up
+  window_proc_id_ = registrar_->RegisterTopLevelWindowProcDelegate(
+      [](HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) -> std::optional<LRESULT> {
+        if (message == statusUpdateMessage) {
+          supervisor->processPendingStatusUpdates();
+          return 0;
+        }
+        if (message == dispatchMessage) {
+          platformDispatcher.drain();
+          return 0;
+        }
+        return std::nullopt;
+      });
+
+  HWND window = NULL;
+  if (registrar_->GetView()) {
+    window = GetAncestor(registrar_->GetView()->GetNativeWindow(), GA_ROOT);
+  }
+  if (window) {
+    supervisor->setStatusWakeCallback([window]() {
+      PostMessage(window, statusUpdateMessage, 0, 0);
+    });
+    statusWakeAvailable = true;
+    platformDispatcher.setWakeCallback([window]() {
+      PostMessage(window, dispatchMessage, 0, 0);
+    });
+    supervisor->setPlatformPoster([](std::function<void()> task) {
+      platformDispatcher.post(std::move(task));
+    });
+  }
+}
 
 OpenVPNFlutterPlugin::~OpenVPNFlutterPlugin() {
-  // Clean up timer if plugin is destroyed
+  registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_id_);
+  // The listener holds the stage sink, which goes with the plugin
+  supervisor->setStageListener(nullptr);
+  // Clean up timers if plugin is destroyed
   if (statusUpdateTimer != 0) {
     KillTimer(NULL, statusUpdateTimer);
     statusUpdateTimer = 0;
   }
+  StopStatsTimer();
   if (pluginInstance == this) {
     pluginInstance = nullptr;
   }
+  Logger::instance().flush();
+}
+
+void OpenVPNFlutterPlugin::SendStatsIfChanged() {
+  if (!stats_event_sink_) {
+    return;
+  }
+  // One event per tunnel whose counters changed, tagged with its tunnel_id
+  for (const auto& tunnel : supervisor->all()) {
+    StatsSample sample;
+    if (tunnel->sampleChangedStats(sample)) {
+      stats_event_sink_->Success(flutter::EncodableValue(EncodeStats(sample, tunnel->getTunnelId())));
+    }
+  }
 }
 
 void OpenVPNFlutterPlugin::HandleMethodCall(
@@ -112,33 +313,53 @@ void OpenVPNFlutterPlugin::HandleMethodCall(
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   
   const auto method_name = method_call.method_name();
+  
+  std::string tunnelId;
+  if (!TunnelIdOf(method_call.arguments(), tunnelId)) {
+    result->Error("invalid_tunnel_id", "tunnel_id must be 1-32 letters, digits, '-' or '_'");
+    return;
+  }
 
   if (method_name.compare("initialize") == 0) {
     // Windows OpenVPN initialization with driver setup
-    std::cout << "Initializing OpenVPN Flutter plugin for Windows..." << std::endl;
-    
-    // First try to initialize the driver system
-    bool driverReady = vpnManager->initializeDriver();
+    LOG_INFO("Initializing OpenVPN Flutter plugin for Windows...");
     
-    if (driverReady) {
-      std::cout << "VPN driver initialized successfully" << std::endl;
-      if (event_sink_) {
-        event_sink_->Success(flutter::EncodableValue("disconnected"));
+    std::shared_ptr<VPNManager> tunnel = supervisor->tunnel(tunnelId);
+    if (!tunnel) {
+      result->Error("too_many_tunnels", "No more tunnels can be watched at the same time");
+      return;
+    }
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> pending(std::move(result));
+    auto finish = [tunnel, pending](bool driverReady) {
+      if (driverReady) {
+        LOG_INFO("VPN driver initialized successfully");
+        tunnel->announceStage();
+        pending->Success(flutter::EncodableValue(tunnel->getStatus()));
+      } else {
+        LOG_ERROR("Failed to initialize VPN driver");
+        pending->Error("initialization_failed", 
+                       "Failed to initialize VPN driver. Please ensure:\n"
+                       "1. wintun.dll is present in the application directory\n"
+                       "2. TAP-Windows drivers are installed (fallback)\n"
+                       "3. Application has sufficient privileges\n"
+                       "4. Bundled OpenVPN files are present");
       }
-      result->Success(flutter::EncodableValue("disconnected"));
+    };
+    
+    if (platformDispatcher.canDispatch()) {
+      // Adapter creation and driver probing can take seconds; answer from the
+      // platform thread as soon as a usable driver turns up
+      tunnel->initializeDriverAsync([finish](bool driverReady) {
+        platformDispatcher.post([finish, driverReady]() { finish(driverReady); });
+      });
     } else {
-      std::cerr << "Failed to initialize VPN driver" << std::endl;
-      result->Error("initialization_failed", 
-                   "Failed to initialize VPN driver. Please ensure:\n"
-                   "1. wintun.dll is present in the application directory\n"
-                   "2. TAP-Windows drivers are installed (fallback)\n"
-                   "3. Application has sufficient privileges\n"
-                   "4. Bundled OpenVPN files are present");
+      // No window to post back to, so wait here as before
+      finish(tunnel->initializeDriver());
     }
     
   } else if (method_name.compare("connect") == 0) {
     // Windows OpenVPN connection - Real implementation using VPNManager
-    std::cout << "Starting VPN connection..." << std::endl;
+    LOG_INFO("Starting VPN connection...");
     
     const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
     if (!arguments) {
@@ -177,43 +398,320 @@ void OpenVPNFlutterPlugin::HandleMethodCall(
       }
     }
     
+    std::optional<int> byteCountInterval;
+    auto interval_it = arguments->find(flutter::EncodableValue("bytecount_interval"));
+    if (interval_it != arguments->end()) {
+      if (const auto* interval = std::get_if<int32_t>(&interval_it->second)) {
+        byteCountInterval = *interval;
+      }
+    }
+    
     if (config.empty()) {
       result->Error("invalid_config", "OpenVPN configuration is required");
       return;
     }
     
-    std::cout << "Connecting to VPN: " << name << std::endl;
+    LOG_INFO("Connecting to VPN: " << name << " (tunnel " << tunnelId << ")");
     
-    // Start VPN connection using VPNManager
-    if (vpnManager->startVPN(config, username, password)) {
-      std::cout << "VPN connection initiated successfully" << std::endl;
-      result->Success();
-    } else {
-      std::cerr << "Failed to start VPN connection" << std::endl;
-      std::string errorMsg = "Failed to start OpenVPN connection. Possible causes:\n"
-                            "1. OpenVPN executable not found (openvpn.exe)\n"
-                            "2. VPN driver not available (WinTun or TAP-Windows)\n"
-                            "3. Invalid configuration file\n"
-                            "4. Insufficient privileges\n"
-                            "5. Another VPN connection is active";
-      result->Error("connection_failed", errorMsg);
+    // Start VPN connection using VPNManager; config rewriting, file I/O and
+    // CreateProcess all happen on the command executor
+    std::shared_ptr<VPNManager> tunnel = supervisor->tunnel(tunnelId);
+    if (!tunnel) {
+      result->Error("too_many_tunnels", "No more tunnels can be watched at the same time");
+      return;
     }
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> pending(std::move(result));
+    RunCommand("connect:" + tunnelId,
+      [tunnel, config, username, password, byteCountInterval](const CancellationToken& cancel) {
+        if (byteCountInterval) {
+          tunnel->setByteCountInterval(*byteCountInterval);
+        }
+        if (tunnel->startVPN(config, username, password, &cancel)) {
+          return ConnectOutcome::Started;
+        }
+        return cancel.isCancelled() ? ConnectOutcome::Cancelled : ConnectOutcome::Failed;
+      },
+      [pending](ConnectOutcome outcome) {
+        if (outcome == ConnectOutcome::Started) {
+          LOG_INFO("VPN connection initiated successfully");
+          pending->Success();
+        } else if (outcome == ConnectOutcome::Cancelled) {
+          pending->Error("connection_cancelled", "Connect was superseded by a disconnect");
+        } else {
+          LOG_ERROR("Failed to start VPN connection");
+          std::string errorMsg = "Failed to start OpenVPN connection. Possible causes:\n"
+                                "1. OpenVPN executable not found (openvpn.exe)\n"
+                                "2. VPN driver not available (WinTun or TAP-Windows)\n"
+                                "3. Invalid configuration file\n"
+                                "4. Insufficient privileges\n"
+                                "5. Another VPN connection is active";
+          pending->Error("connection_failed", errorMsg);
+        }
+      });
     
   } else if (method_name.compare("disconnect") == 0) {
-    // Windows OpenVPN disconnection using VPNManager
-    vpnManager->stopVPN();
-    result->Success();
+    // Windows OpenVPN disconnection using VPNManager. A connect of the same
+    // tunnel still queued or starting is cancelled; the disconnect runs right after it
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      result->Success();
+      return;
+    }
+    size_t superseded = commandExecutor.cancel("connect:" + tunnelId);
+    if (superseded > 0) {
+      LOG_INFO("Disconnect supersedes " << superseded << " pending connect(s)");
+    }
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> pending(std::move(result));
+    RunCommand("disconnect:" + tunnelId,
+      [tunnel](const CancellationToken&) {
+        // Waits for the tunnel's monitor handlers and for openvpn.exe to exit
+        tunnel->stopVPN();
+        return true;
+      },
+      [pending](bool) { pending->Success(); });
+    
+  } else if (method_name.compare("remove_tunnel") == 0) {
+    // Stop a tunnel and forget it; the default tunnel can't be removed
+    if (tunnelId == VPNManager::kDefaultTunnel) {
+      result->Error("invalid_tunnel_id", "The default tunnel can't be removed");
+      return;
+    }
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      result->Success(flutter::EncodableValue(false));
+      return;
+    }
+    commandExecutor.cancel("connect:" + tunnelId);
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> pending(std::move(result));
+    RunCommand("remove:" + tunnelId,
+      [tunnel](const CancellationToken&) {
+        tunnel->stopVPN();
+        return true;
+      },
+      [pending, tunnelId](bool) {
+        // Runs after the stage events the stop posted, so none of them
+        // outlives the tunnel
+        pending->Success(flutter::EncodableValue(supervisor->remove(tunnelId)));
+      });
+    
+  } else if (method_name.compare("tunnels") == 0) {
+    // Every tunnel with its current stage
+    flutter::EncodableList tunnels;
+    for (const auto& tunnel : supervisor->all()) {
+      flutter::EncodableMap entry;
+      entry[flutter::EncodableValue("tunnel_id")] = flutter::EncodableValue(tunnel->getTunnelId());
+      entry[flutter::EncodableValue("stage")] = flutter::EncodableValue(tunnel->getStatus());
+      entry[flutter::EncodableValue("active")] = flutter::EncodableValue(tunnel->isActive());
+      tunnels.push_back(flutter::EncodableValue(entry));
+    }
+    result->Success(flutter::EncodableValue(tunnels));
     
   } else if (method_name.compare("status") == 0) {
-    // Return connection status from VPNManager
-    std::string statusJson = vpnManager->getConnectionStats();
-    result->Success(flutter::EncodableValue(statusJson));
+    // Return connection stats of the tunnel, null if there is no such tunnel
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      result->Success();
+      return;
+    }
+    result->Success(flutter::EncodableValue(EncodeStats(tunnel->getConnectionStats(), tunnelId)));
+    
+  } else if (method_name.compare("throughput") == 0) {
+    // Per-second history of the tunnel over a window: current, average, peak
+    // and percentile rates plus a series for charts, null if there is no
+    // such tunnel. Rates are bytes per second.
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    if (!tunnel) {
+      result->Success();
+      return;
+    }
+    int64_t windowSeconds = kDefaultThroughputWindowS;
+    double percentile = kDefaultThroughputPercentile;
+    int64_t maxPoints = kDefaultThroughputPoints;
+    if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+      auto window_it = arguments->find(flutter::EncodableValue("window_s"));
+      if (window_it != arguments->end()) {
+        if (const auto* value = std::get_if<int32_t>(&window_it->second)) {
+          windowSeconds = *value;
+        }
+      }
+      auto percentile_it = arguments->find(flutter::EncodableValue("percentile"));
+      if (percentile_it != arguments->end()) {
+        if (const auto* value = std::get_if<double>(&percentile_it->second)) {
+          percentile = *value;
+        } else if (const auto* intValue = std::get_if<int32_t>(&percentile_it->second)) {
+          percentile = *intValue;
+        }
+      }
+      auto points_it = arguments->find(flutter::EncodableValue("points"));
+      if (points_it != arguments->end()) {
+        if (const auto* value = std::get_if<int32_t>(&points_it->second)) {
+          maxPoints = *value;
+        }
+      }
+    }
+    windowSeconds = std::clamp<int64_t>(windowSeconds, 1, ThroughputHistory::kSeconds);
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    maxPoints = std::clamp<int64_t>(maxPoints, 1, kMaxThroughputPoints);
+
+    const ThroughputHistory& history = tunnel->getThroughput();
+    auto now = ThroughputHistory::Clock::now();
+    Throughput current = history.current(now);
+    ThroughputHistory::Summary summary = history.summarize(windowSeconds, percentile, now);
+    std::array<Throughput, kMaxThroughputPoints> points;
+    int64_t secondsPerPoint = 0;
+    size_t count = history.series(windowSeconds, points.data(), static_cast<size_t>(maxPoints), secondsPerPoint, now);
+    flutter::EncodableList seriesIn;
+    flutter::EncodableList seriesOut;
+    for (size_t i = 0; i < count; i++) {
+      seriesIn.push_back(flutter::EncodableValue(static_cast<int64_t>(points[i].in)));
+      seriesOut.push_back(flutter::EncodableValue(static_cast<int64_t>(points[i].out)));
+    }
+
+    flutter::EncodableMap payload;
+    auto set = [&payload](const char* key, flutter::EncodableValue value) {
+      payload[flutter::EncodableValue(key)] = std::move(value);
+    };
+    set("version", flutter::EncodableValue(kEventSchemaVersion));
+    set("tunnel_id", flutter::EncodableValue(tunnelId));
+    set("window_s", flutter::EncodableValue(summary.seconds));
+    set("current_in_bps", flutter::EncodableValue(static_cast<int64_t>(current.in)));
+    set("current_out_bps", flutter::EncodableValue(static_cast<int64_t>(current.out)));
+    set("average_in_bps", flutter::EncodableValue(static_cast<int64_t>(summary.average.in)));
+    set("average_out_bps", flutter::EncodableValue(static_cast<int64_t>(summary.average.out)));
+    set("peak_in_bps", flutter::EncodableValue(static_cast<int64_t>(summary.peak.in)));
+    set("peak_out_bps", flutter::EncodableValue(static_cast<int64_t>(summary.peak.out)));
+    set("percentile", flutter::EncodableValue(percentile));
+    set("percentile_in_bps", flutter::EncodableValue(static_cast<int64_t>(summary.percentile.in)));
+    set("percentile_out_bps", flutter::EncodableValue(static_cast<int64_t>(summary.percentile.out)));
+    set("step_s", flutter::EncodableValue(secondsPerPoint));
+    set("series_in_bps", flutter::EncodableValue(std::move(seriesIn)));
+    set("series_out_bps", flutter::EncodableValue(std::move(seriesOut)));
+    result->Success(flutter::EncodableValue(payload));
     
   } else if (method_name.compare("stage") == 0) {
-    // Return current stage from VPNManager
-    std::string currentStage = vpnManager->getStatus();
+    // Return current stage of the tunnel
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    std::string currentStage = tunnel ? tunnel->getStatus() : stageName(VpnStage::Disconnected);
     result->Success(flutter::EncodableValue(currentStage));
     
+  } else if (method_name.compare("config_cache_stats") == 0) {
+    // Hit/miss counters of the tunnel's rewritten config cache
+    std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId);
+    flutter::EncodableMap stats;
+    stats[flutter::EncodableValue("hits")] =
+        flutter::EncodableValue(static_cast<int64_t>(tunnel ? tunnel->getConfigCacheHits() : 0));
+    stats[flutter::EncodableValue("misses")] =
+        flutter::EncodableValue(static_cast<int64_t>(tunnel ? tunnel->getConfigCacheMisses() : 0));
+    result->Success(flutter::EncodableValue(stats));
+    
+  } else if (method_name.compare("openvpn_output") == 0) {
+    // Last lines the tunnel's openvpn printed, oldest first
+    size_t limit = OutputParser::kHistoryLines;
+    if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+      auto limit_it = arguments->find(flutter::EncodableValue("limit"));
+      if (limit_it != arguments->end()) {
+        if (const auto* value = std::get_if<int32_t>(&limit_it->second)) {
+          limit = static_cast<size_t>(std::clamp(*value, 1, static_cast<int32_t>(OutputParser::kHistoryLines)));
+        }
+      }
+    }
+    flutter::EncodableList lines;
+    if (std::shared_ptr<VPNManager> tunnel = supervisor->find(tunnelId)) {
+      for (auto& line : tunnel->getRecentOutput(limit)) {
+        lines.push_back(flutter::EncodableValue(std::move(line)));
+      }
+    }
+    result->Success(flutter::EncodableValue(lines));
+    
+  } else if (method_name.compare("metrics") == 0) {
+    // Latency of each connect phase over every tunnel since start (or the
+    // last reset); buckets are returned too so installs can be merged
+    bool reset = false;
+    if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+      auto reset_it = arguments->find(flutter::EncodableValue("reset"));
+      if (reset_it != arguments->end()) {
+        if (const auto* value = std::get_if<bool>(&reset_it->second)) {
+          reset = *value;
+        }
+      }
+    }
+    ConnectMetrics& metrics = supervisor->metrics();
+    flutter::EncodableMap phases;
+    for (size_t i = 0; i < static_cast<size_t>(ConnectPhase::Count); i++) {
+      auto phase = static_cast<ConnectPhase>(i);
+      const LatencyHistogram& histogram = metrics.histogram(phase);
+      LatencyHistogram::Summary summary = histogram.summarize();
+      flutter::EncodableList buckets;
+      for (const auto& [upperUs, count] : histogram.nonEmptyBuckets()) {
+        buckets.push_back(flutter::EncodableValue(flutter::EncodableList{
+            flutter::EncodableValue(static_cast<int64_t>(std::min<uint64_t>(upperUs, INT64_MAX))),
+            flutter::EncodableValue(static_cast<int64_t>(count))}));
+      }
+      flutter::EncodableMap entry;
+      entry[flutter::EncodableValue("count")] = flutter::EncodableValue(static_cast<int64_t>(summary.count));
+      entry[flutter::EncodableValue("mean_ms")] = flutter::EncodableValue(summary.meanMs);
+      entry[flutter::EncodableValue("p50_ms")] = flutter::EncodableValue(summary.p50Ms);
+      entry[flutter::EncodableValue("p90_ms")] = flutter::EncodableValue(summary.p90Ms);
+      entry[flutter::EncodableValue("p99_ms")] = flutter::EncodableValue(summary.p99Ms);
+      entry[flutter::EncodableValue("max_ms")] = flutter::EncodableValue(summary.maxMs);
+      entry[flutter::EncodableValue("buckets_us")] = flutter::EncodableValue(buckets);
+      phases[flutter::EncodableValue(ConnectMetrics::phaseName(phase))] = flutter::EncodableValue(entry);
+    }
+    if (reset) {
+      metrics.reset();
+    }
+    flutter::EncodableMap payload;
+    payload[flutter::EncodableValue("version")] = flutter::EncodableValue(kEventSchemaVersion);
+    payload[flutter::EncodableValue("phases")] = flutter::EncodableValue(phases);
+    result->Success(flutter::EncodableValue(payload));
+    
+  } else if (method_name.compare("set_log_level") == 0) {
+    // Runtime level of the native log; levels compiled out stay off
+    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
+    const std::string* levelName = nullptr;
+    if (arguments) {
+      auto level_it = arguments->find(flutter::EncodableValue("level"));
+      if (level_it != arguments->end()) {
+        levelName = std::get_if<std::string>(&level_it->second);
+      }
+    }
+    LogLevel level;
+    if (!levelName || !Logger::parseLevel(*levelName, level)) {
+      result->Error("invalid_log_level", "level must be one of trace, debug, info, warn, error, off");
+      return;
+    }
+    Logger::instance().setLevel(level);
+    result->Success();
+    
+  } else if (method_name.compare("get_logs") == 0) {
+    // Most recent native log records, oldest first
+    size_t limit = 200;
+    LogLevel minLevel = LogLevel::Trace;
+    if (const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments())) {
+      auto limit_it = arguments->find(flutter::EncodableValue("limit"));
+      if (limit_it != arguments->end()) {
+        if (const auto* value = std::get_if<int32_t>(&limit_it->second)) {
+          limit = static_cast<size_t>(std::clamp(*value, 1, static_cast<int32_t>(Logger::kHistoryCapacity)));
+        }
+      }
+      auto level_it = arguments->find(flutter::EncodableValue("min_level"));
+      if (level_it != arguments->end()) {
+        if (const auto* value = std::get_if<std::string>(&level_it->second)) {
+          Logger::parseLevel(*value, minLevel);
+        }
+      }
+    }
+    flutter::EncodableList records;
+    for (const auto& record : Logger::instance().recent(limit, minLevel)) {
+      flutter::EncodableMap entry;
+      entry[flutter::EncodableValue("timestamp_ms")] = flutter::EncodableValue(record.timestampMs);
+      entry[flutter::EncodableValue("level")] = flutter::EncodableValue(Logger::levelName(record.level));
+      entry[flutter::EncodableValue("thread")] = flutter::EncodableValue(static_cast<int32_t>(record.thread));
+      entry[flutter::EncodableValue("message")] = flutter::EncodableValue(record.message);
+      records.push_back(flutter::EncodableValue(entry));
+    }
+    result->Success(flutter::EncodableValue(records));
+    
   } else if (method_name.compare("request_permission") == 0) {
     // Windows doesn't require VPN permissions like Android
     result->Success(flutter::EncodableValue(true));
@@ -21,6 +21,9 @@ class OpenVPNFlutterPlugin : public flutter::Plugin {
   OpenVPNFlutterPlugin(const OpenVPNFlutterPlugin&) = delete;
   OpenVPNFlutterPlugin& operator=(const OpenVPNFlutterPlugin&) = delete;
 
+  // Called by the stats timer; pushes a sample if anything changed
+  void SendStatsIfChanged();
+
  private:
   // Called when a method is called on this plugin's channel from Dart.
   void HandleMethodCall(
@@ -29,9 +32,15 @@ class OpenVPNFlutterPlugin : public flutter::Plugin {
 
   // Event stream handler for VPN stage changes
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> event_sink_;
+
+  // Event stream handler for connection stats
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> stats_event_sink_;
   
   // Plugin registrar
   flutter::PluginRegistrarWindows *registrar_;
+
+  // Top-level window delegate that drains stage updates
+  int window_proc_id_ = -1;
 };
 
 }  // namespace openvpn_flutter
@@ -6,12 +6,19 @@
 #include <iphlpapi.h>
 #include <netioapi.h>
 #include <ifdef.h>
+#include <bcrypt.h>
 
 #include "vpn_manager.h"
+#include "adapter_lifecycle.h"
+#include "adapter_registry.h"
+#include "binary_locator.h"
+#include "config_cache.h"
+#include "config_rewriter.h"
+#include "logger.h"
+#include "wait_set.h"
 #include <fstream>
 #include <sstream>
 #include <chrono>
-#include <iostream>
 #include <vector>
 #include <iomanip>
 #include <tlhelp32.h>
@@ -24,81 +31,117 @@
 #pragma comment(lib, "advapi32.lib")
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "bcrypt.lib")
 
 namespace openvpn_flutter {
 
-VPNManager::VPNManager() {
+namespace {
+
+// Whether the loopback listener on port belongs to processId
+bool isListenerOf(uint16_t port, DWORD processId) {
+    ULONG size = 0;
+    GetExtendedTcpTable(NULL, &size, FALSE, AF_INET, TCP_TABLE_OWNER_PID_LISTENER, 0);
+    std::vector<char> buffer(size);
+    auto table = reinterpret_cast<MIB_TCPTABLE_OWNER_PID*>(buffer.data());
+    if (size == 0 || GetExtendedTcpTable(table, &size, FALSE, AF_INET, TCP_TABLE_OWNER_PID_LISTENER, 0) != NO_ERROR) {
+        return false;
+    }
+    for (DWORD i = 0; i < table->dwNumEntries; i++) {
+        const MIB_TCPROW_OWNER_PID& row = table->table[i];
+        if (ntohs(static_cast<u_short>(row.dwLocalPort)) == port && row.dwLocalAddr == htonl(INADDR_LOOPBACK)) {
+            return row.dwOwningPid == processId;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+VPNManager::VPNManager(std::string tunnelId, TunnelServices& services)
+    : TunnelSession(std::move(tunnelId), services) {
     ZeroMemory(&processInfo, sizeof(processInfo));
     wintunManager = std::make_unique<WinTunManager>();
+    removeLegacyFiles();
     // Don't initialize driver in constructor - do it lazily when needed
     // This prevents crashes during plugin registration
     // initializeDriver();
 }
 
 VPNManager::~VPNManager() {
-    stopVPN();
+    workers.shutdown();
+    shutdownSession();
 }
 
-void VPNManager::setEventSink(flutter::EventSink<flutter::EncodableValue>* sink) {
-    eventSink = sink;
-}
-
-bool VPNManager::startVPN(const std::string& config, const std::string& username, const std::string& password) {
-    // CRITICAL: Clear any pending status updates from previous connection
-    // This prevents stale "disconnected" updates from overriding the new "connecting" status
-    {
-        std::lock_guard<std::mutex> lock(statusMutex);
-        while (!pendingStatusUpdates.empty()) {
-            std::cout << "Clearing stale pending status: " << pendingStatusUpdates.front() << std::endl;
-            pendingStatusUpdates.pop();
-        }
-    }
-    
-    if (isConnected || isConnecting) {
-        std::cout << "startVPN: Already connected or connecting, returning false" << std::endl;
+bool VPNManager::startVPN(const std::string& config, const std::string& username, const std::string& password,
+                          const CancellationToken* cancel) {
+    std::vector<std::string> remoteHosts;
+    if (!beginConnect(config, remoteHosts)) {
         return false;
     }
     
-    // Initialize driver if not already initialized
+    // Initialize driver if not already initialized; afterwards only check the
+    // warm WinTun adapter is still healthy and rebuild it if it is not
     if (!driverInitialized) {
+        // Also waits out an initialize() that is still probing in the background
+        PhaseSpan driverSpan(services.metrics, ConnectPhase::DriverInit);
         if (!initializeDriver()) {
-            updateStatus("error");
+            updateStatus(VpnStage::Error, VpnError::DriverUnavailable);
             return false;
         }
-        driverInitialized = true;
+    } else if (currentDriver == DriverType::WINTUN && adapterLifecycle && !prepareWinTunAdapter()) {
+        updateStatus(VpnStage::Error, VpnError::DriverUnavailable);
+        return false;
     }
     
     // Ensure driver is available
     if (currentDriver == DriverType::WINTUN && !isWinTunAvailable()) {
         if (allowFallbackToTAP && isTapDriverInstalled()) {
             currentDriver = DriverType::TAP_WINDOWS;
-            std::cout << "Falling back to TAP-Windows driver" << std::endl;
+            LOG_INFO("Falling back to TAP-Windows driver");
         } else {
-            updateStatus("error");
+            updateStatus(VpnStage::Error, VpnError::DriverUnavailable);
             return false;
         }
     } else if (currentDriver == DriverType::TAP_WINDOWS && !isTapDriverInstalled()) {
-        updateStatus("error");
+        updateStatus(VpnStage::Error, VpnError::DriverUnavailable);
+        return false;
+    }
+    if (cancelled(cancel)) {
         return false;
     }
     
     // Get bundled OpenVPN executable
     std::string openVPNPath = getBundledOpenVPNPath();
     if (openVPNPath.empty()) {
-        updateStatus("error");
+        updateStatus(VpnStage::Error, VpnError::OpenVpnNotFound);
         return false;
     }
     
-    // Create config file
-    if (!createConfigFile(config, username, password)) {
-        updateStatus("error");
+    // Rewrite the profile; it reaches openvpn through a pipe, never a file.
+    // With WinTun the profile's dev/dev-type lines go (the adapter is named on
+    // the command line) and 'windows-driver wintun' is added.
+    bool hasCredentials = !username.empty() && !password.empty();
+    if (!prepareConfig(config, hasCredentials, remoteHosts,
+                       currentDriver == DriverType::WINTUN ? ConfigRewriter::wintunRules() : ConfigRewriter::baseRules(),
+                       static_cast<int>(currentDriver))) {
+        updateStatus(VpnStage::Error, VpnError::ConfigWriteFailed);
+        return false;
+    }
+    if (cancelled(cancel)) {
+        clearSession();
         return false;
     }
     
+    // Kept in memory for the >PASSWORD: prompt only
+    if (hasCredentials) {
+        authUsername = username;
+        authPassword = password;
+    }
+    
     try {
         // Prepare command line arguments for bundled OpenVPN
         std::ostringstream cmdStream;
-        cmdStream << "\"" << openVPNPath << "\" --config \"" << currentConfigPath << "\"";
+        cmdStream << "\"" << openVPNPath << "\" --config stdin";
         
         // Add minimal options
         cmdStream << " --verb 3";
@@ -106,393 +149,409 @@ bool VPNManager::startVPN(const std::string& config, const std::string& username
         // Disable DCO to avoid netsh permission issues
         cmdStream << " --disable-dco";
         
+        // Management interface for state notifications; openvpn holds until we attach
+        managementPort = ManagementClient::findFreePort();
+        if (managementPort == 0) {
+            LOG_ERROR("Failed to find a free port for the OpenVPN management interface");
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::ManagementPortUnavailable);
+            return false;
+        }
+        if (!writeManagementPassword()) {
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::ManagementPortUnavailable);
+            return false;
+        }
+        cmdStream << " --management 127.0.0.1 " << managementPort << " \"" << managementPasswordFile << "\""
+                  << " --management-hold";
+        if (hasCredentials) {
+            cmdStream << " --management-query-passwords";
+        }
+        
         // For TAP-Windows, add driver-specific options
         if (currentDriver == DriverType::TAP_WINDOWS) {
             cmdStream << " --dev-type tap";
             if (!tapAdapterName.empty()) {
                 cmdStream << " --dev \"" << tapAdapterName << "\"";
             }
-            std::cout << "Using TAP-Windows driver for OpenVPN connection" << std::endl;
+            LOG_INFO("Using TAP-Windows driver for OpenVPN connection");
         } else if (currentDriver == DriverType::WINTUN) {
-            std::cout << "Using WinTun driver (configured via config file: dev tun + windows-driver wintun)" << std::endl;
+            // Pin the tunnel to its own adapter so concurrent tunnels don't race for one
+            cmdStream << " --dev-node \"" << adapterName() << "\"";
+            LOG_INFO("Using WinTun driver (configured via config file: dev tun + windows-driver wintun)");
         }
         
         std::string cmdLine = cmdStream.str();
-        std::cout << "DEBUG: Full OpenVPN command line: " << cmdLine << std::endl;
-        
-        // DEBUG: Verify config file exists and show its first few lines
-        std::ifstream configCheck(currentConfigPath);
-        if (configCheck.is_open()) {
-            std::cout << "DEBUG: Config file exists at: " << currentConfigPath << std::endl;
-            std::string firstLine;
-            int lineCount = 0;
-            while (std::getline(configCheck, firstLine) && lineCount < 10) {
-                std::cout << "DEBUG: Config line " << (lineCount + 1) << ": " << firstLine << std::endl;
-                lineCount++;
-            }
-            configCheck.close();
-        } else {
-            std::cout << "ERROR: Config file does not exist at: " << currentConfigPath << std::endl;
-        }
+        LOG_DEBUG("Full OpenVPN command line: " << cmdLine);
         
         // Check if we're already running as admin
         if (!isRunningAsAdmin()) {
-            std::cout << "Application is not running as administrator. OpenVPN requires elevated privileges." << std::endl;
-            updateStatus("error");
+            LOG_ERROR("Application is not running as administrator. OpenVPN requires elevated privileges.");
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::NotElevated);
             return false;
         }
         
+        if (cancelled(cancel)) {
+            clearSession();
+            return false;
+        }
+        
+        // The child's stdout and stderr come back through an overlapped pipe; a
+        // connect without it still works, failures just take longer to show
+        outputParser.reset();
+        if (!outputPipe.open()) {
+            LOG_WARN("Could not create the output pipe, OpenVPN output is not captured");
+        }
+        
+        // The profile goes to the child's stdin (--config stdin) through an
+        // anonymous pipe, sized so that writing it never waits on openvpn
+        SECURITY_ATTRIBUTES pipeAttributes = {sizeof(pipeAttributes), NULL, TRUE};
+        HANDLE configRead = NULL;
+        HANDLE configWrite = NULL;
+        if (!CreatePipe(&configRead, &configWrite, &pipeAttributes, static_cast<DWORD>(currentConfig->size() + 4096))) {
+            LOG_ERROR("Failed to create the config pipe. Error: " << GetLastError());
+            outputPipe.close();
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::ConfigWriteFailed);
+            return false;
+        }
+        SetHandleInformation(configWrite, HANDLE_FLAG_INHERIT, 0);
+        
+        // Only the pipe ends meant for the child are inherited, not every
+        // inheritable handle of the app (a concurrent tunnel's pipe, say)
+        HANDLE inherited[2] = {configRead, outputPipe.getChildHandle()};
+        DWORD inheritedCount = outputPipe.isOpen() ? 2 : 1;
+        SIZE_T attributeSize = 0;
+        InitializeProcThreadAttributeList(NULL, 1, 0, &attributeSize);
+        std::vector<char> attributeBuffer(attributeSize);
+        auto attributes = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeBuffer.data());
+        if (!InitializeProcThreadAttributeList(attributes, 1, 0, &attributeSize)) {
+            LOG_ERROR("Failed to set up process attributes. Error: " << GetLastError());
+            CloseHandle(configRead);
+            CloseHandle(configWrite);
+            outputPipe.close();
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::ProcessStartFailed);
+            return false;
+        }
+        UpdateProcThreadAttribute(attributes, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherited, inheritedCount * sizeof(HANDLE), NULL, NULL);
+        
         // Start OpenVPN process (already elevated since app is running as admin)
-        STARTUPINFOA startupInfo;
+        STARTUPINFOEXA startupInfo;
         ZeroMemory(&processInfo, sizeof(processInfo));
         ZeroMemory(&startupInfo, sizeof(startupInfo));
-        startupInfo.cb = sizeof(startupInfo);
-        startupInfo.dwFlags = STARTF_USESHOWWINDOW;
-        startupInfo.wShowWindow = SW_HIDE;
-        
-        // Build command line with all arguments
-        std::string fullCmdLine = "\"" + openVPNPath + "\" --config \"" + currentConfigPath + "\" --verb 3 --disable-dco";
-        if (currentDriver == DriverType::TAP_WINDOWS) {
-            fullCmdLine += " --dev-type tap";
-            if (!tapAdapterName.empty()) {
-                fullCmdLine += " --dev \"" + tapAdapterName + "\"";
-            }
+        startupInfo.StartupInfo.cb = sizeof(startupInfo);
+        startupInfo.StartupInfo.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
+        startupInfo.StartupInfo.wShowWindow = SW_HIDE;
+        startupInfo.StartupInfo.hStdInput = configRead;
+        if (outputPipe.isOpen()) {
+            startupInfo.StartupInfo.hStdOutput = outputPipe.getChildHandle();
+            startupInfo.StartupInfo.hStdError = outputPipe.getChildHandle();
         }
-        std::cout << "Full command line: " << fullCmdLine << std::endl;
+        startupInfo.lpAttributeList = attributes;
+        
+        // CreateProcessA may write to the command line, so it gets its own copy
+        std::vector<char> commandLine(cmdLine.begin(), cmdLine.end());
+        commandLine.push_back('\0');
         
         // CRITICAL: Set working directory to app directory for proper DLL loading
         // When running as admin from a shortcut, the working dir might be System32
         std::string appDir = getAppDirectory();
-        std::cout << "Working directory: " << appDir << std::endl;
+        LOG_DEBUG("Working directory: " << appDir);
         
+        PhaseSpan startSpan(services.metrics, ConnectPhase::ProcessStart);
         BOOL success = CreateProcessA(
             NULL,                     // Application name
-            (LPSTR)fullCmdLine.c_str(), // Command line
+            commandLine.data(),       // Command line
             NULL,                     // Process security attributes
             NULL,                     // Thread security attributes
-            FALSE,                    // Inherit handles
-            CREATE_NO_WINDOW,         // Creation flags - hide console window
+            TRUE,                     // Inherit handles - only the pipes, see above
+            CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT, // Creation flags - hide console window
             NULL,                     // Environment
             appDir.c_str(),          // Current directory - SET TO APP DIR!
-            &startupInfo,            // Startup info
+            &startupInfo.StartupInfo, // Startup info
             &processInfo             // Process info
         );
+        DWORD startError = success ? ERROR_SUCCESS : GetLastError();
+        startSpan.finish();
+        processStartedAt = std::chrono::steady_clock::now();
+        DeleteProcThreadAttributeList(attributes);
+        CloseHandle(configRead);
+        // The pipe reports end of output once the child's copy is the last one
+        outputPipe.closeChildHandle();
+        
+        // EOF on the pipe ends the profile
+        bool delivered = false;
+        if (success && processInfo.hProcess) {
+            PhaseSpan writeSpan(services.metrics, ConnectPhase::ConfigWrite);
+            const std::string& profile = *currentConfig;
+            size_t written = 0;
+            while (written < profile.size()) {
+                DWORD chunk = 0;
+                if (!WriteFile(configWrite, profile.data() + written, static_cast<DWORD>(profile.size() - written), &chunk, NULL)) {
+                    break;
+                }
+                written += chunk;
+            }
+            delivered = written == profile.size();
+        }
+        CloseHandle(configWrite);
+        
+        if (success && processInfo.hProcess && !delivered) {
+            LOG_ERROR("Failed to pass the config to OpenVPN. Error: " << GetLastError());
+            TerminateProcess(processInfo.hProcess, 1);
+            CloseHandle(processInfo.hProcess);
+            CloseHandle(processInfo.hThread);
+            ZeroMemory(&processInfo, sizeof(processInfo));
+            outputPipe.close();
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::ConfigWriteFailed);
+            return false;
+        }
         
         if (success && processInfo.hProcess) {
             hProcess = processInfo.hProcess;
-            
-            isConnecting = true;
-            connectionStartTime = std::chrono::system_clock::now();
-            
-            // Reset speed tracking
-            lastBytesIn = 0;
-            lastBytesOut = 0;
-            lastStatsTime = std::chrono::system_clock::time_point{};
-            currentSpeedIn = 0.0;
-            currentSpeedOut = 0.0;
-            smoothedSpeedIn = 0.0;
-            smoothedSpeedOut = 0.0;
-            
-            updateStatus("connecting");
-            
-            // Start monitoring thread
-            shouldMonitor = true;
-            statusMonitorThread = std::thread(&VPNManager::monitorConnection, this);
-            
-            return true;
+            return watchProcess(hProcess);
         } else {
-            DWORD error = GetLastError();
-            std::cerr << "Failed to start bundled OpenVPN process. Error: " << error << std::endl;
-            updateStatus("error");
+            LOG_ERROR("Failed to start bundled OpenVPN process. Error: " << startError);
+            outputPipe.close();
+            clearSession();
+            updateStatus(VpnStage::Error, VpnError::ProcessStartFailed);
             return false;
         }
     } catch (const std::exception& e) {
-        std::cerr << "Exception in startVPN: " << e.what() << std::endl;
-        updateStatus("error");
+        LOG_ERROR("Exception in startVPN: " << e.what());
+        clearSession();
+        updateStatus(VpnStage::Error, VpnError::InternalError);
         return false;
     }
 }
 
-void VPNManager::stopVPN() {
-    std::cout << "stopVPN: Starting disconnect process..." << std::endl;
-    
-    // Signal the monitor thread to stop
-    shouldMonitor = false;
-    
-    // Wait for the monitoring thread to finish
-    if (statusMonitorThread.joinable()) {
-        std::cout << "stopVPN: Waiting for monitor thread to finish..." << std::endl;
-        statusMonitorThread.join();
-        std::cout << "stopVPN: Monitor thread finished" << std::endl;
+bool VPNManager::hasProcess() const {
+    return hProcess != NULL;
+}
+
+void VPNManager::terminateProcess() {
+    // The WinTun adapter is kept for the next connect; startVPN health-checks it
+    // and only recreates it if it is gone or still held by someone else
+    removeManagementPasswordFile();
+    SecureZeroMemory(managementPassword.data(), managementPassword.size());
+    managementPassword.clear();
+    if (!hProcess) {
+        return;
     }
-    
-    // Terminate OpenVPN process if running
+    LOG_DEBUG("stopVPN: Terminating OpenVPN process...");
+    PhaseSpan terminateSpan(services.metrics, ConnectPhase::ProcessStop);
+    TerminateProcess(hProcess, 0);
+    WaitForSingleObject(hProcess, 5000);
+    terminateSpan.finish();
+    CloseHandle(hProcess);
+    CloseHandle(processInfo.hThread);
+    hProcess = NULL;
+    ZeroMemory(&processInfo, sizeof(processInfo));
+    LOG_DEBUG("stopVPN: OpenVPN process terminated");
+}
+
+void VPNManager::signalProcess(bool) {
+    // openvpn.exe takes no signals from other processes, so both end it; the
+    // handle stays open until stopVPN
     if (hProcess) {
-        std::cout << "stopVPN: Terminating OpenVPN process..." << std::endl;
-        TerminateProcess(hProcess, 0);
-        WaitForSingleObject(hProcess, 5000);
-        CloseHandle(hProcess);
-        CloseHandle(processInfo.hThread);
-        hProcess = NULL;
-        ZeroMemory(&processInfo, sizeof(processInfo));
-        std::cout << "stopVPN: OpenVPN process terminated" << std::endl;
+        TerminateProcess(hProcess, 1);
     }
-    
-    // CRITICAL: Clear all connection state flags
-    isConnected = false;
-    isConnecting = false;
-    
-    // CRITICAL: Reset driver initialization flag so it will be re-initialized on next connect
-    // This ensures a fresh WinTun adapter is created, avoiding conflicts with WireGuard
-    driverInitialized = false;
-    
-    // CRITICAL: Clear any pending status updates from the monitor thread
-    // These might contain stale "disconnected" or "connecting" states
+}
+
+void VPNManager::initializeDriverAsync(std::function<void(bool)> onReady) {
+    bool alreadyReady = false;
     {
-        std::lock_guard<std::mutex> lock(statusMutex);
-        while (!pendingStatusUpdates.empty()) {
-            std::cout << "stopVPN: Clearing pending status: " << pendingStatusUpdates.front() << std::endl;
-            pendingStatusUpdates.pop();
+        std::lock_guard<std::mutex> lock(driverMutex);
+        if (driverInitState == DriverInitState::Done && driverInitialized) {
+            alreadyReady = true;
+        } else {
+            if (onReady) {
+                driverWaiters.push_back(std::move(onReady));
+            }
+            if (driverInitState == DriverInitState::Running) {
+                return;
+            }
+            driverInitState = DriverInitState::Running;
+            driverProbesPending = 2;
+            wintunProbeOk = false;
+            tapProbeOk = false;
+            driverReadyNotified = false;
         }
     }
+    if (alreadyReady) {
+        if (onReady) {
+            onReady(true);
+        }
+        return;
+    }
     
-    // Now send the final disconnected status
-    updateStatus("disconnected");
-    
-    // Reset speed tracking on disconnect
-    lastBytesIn = 0;
-    lastBytesOut = 0;
-    lastStatsTime = std::chrono::system_clock::time_point{};
-    currentSpeedIn = 0.0;
-    currentSpeedOut = 0.0;
-    smoothedSpeedIn = 0.0;
-    smoothedSpeedOut = 0.0;
-    
-    cleanupTempFiles();
-    std::cout << "stopVPN: Disconnect complete, ready for new connection" << std::endl;
+    // WinTun adapter preparation and TAP detection don't depend on each other,
+    // so neither has to wait for the other's registry reads or process launches
+    workers.submit([this] { finishDriverProbe(DriverType::WINTUN, probeWinTun()); });
+    workers.submit([this] { finishDriverProbe(DriverType::TAP_WINDOWS, probeTapDriver()); });
 }
 
-std::string VPNManager::getStatus() {
-    return currentStatus;
-}
-
-std::string VPNManager::getConnectionStats() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    
-    // Get real network statistics from the VPN adapter
-    auto [bytesIn, bytesOut] = getRealNetworkStats();
-    
-    // Check if we have any VPN activity (even if connection flags aren't set correctly)
-    bool hasVpnActivity = (bytesIn > 0 || bytesOut > 0) || (isConnected || isConnecting);
-    
-    if (hasVpnActivity) {
-        // Calculate connection duration
-        auto connectionDuration = std::chrono::duration_cast<std::chrono::seconds>(now - connectionStartTime);
-        int hours = static_cast<int>(connectionDuration.count()) / 3600;
-        int minutes = (static_cast<int>(connectionDuration.count()) % 3600) / 60;
-        int seconds = static_cast<int>(connectionDuration.count()) % 60;
-        
-        // Calculate speeds
-        updateSpeedCalculations(bytesIn, bytesOut, now);
-        
-        // Convert bytes per second to Mbps
-        double speedInMbps = (currentSpeedIn * 8.0) / (1024.0 * 1024.0);
-        double speedOutMbps = (currentSpeedOut * 8.0) / (1024.0 * 1024.0);
-        
-        std::ostringstream oss;
-        oss << "{\"connected_on\":\"";
-        
-        struct tm* timeinfo = std::localtime(&time_t);
-        oss << std::put_time(timeinfo, "%Y-%m-%d %H:%M:%S");
-        
-        oss << "\",\"duration\":\"" 
-            << std::setfill('0') << std::setw(2) << hours << ":"
-            << std::setfill('0') << std::setw(2) << minutes << ":"
-            << std::setfill('0') << std::setw(2) << seconds << "\""
-            << ",\"byte_in\":\"" << bytesIn << "\""
-            << ",\"byte_out\":\"" << bytesOut << "\""
-            << ",\"packets_in\":\"" << bytesIn << "\""
-            << ",\"packets_out\":\"" << bytesOut << "\""
-            << ",\"speed_in_mbps\":\"" << std::fixed << std::setprecision(2) << speedInMbps << "\""
-            << ",\"speed_out_mbps\":\"" << std::fixed << std::setprecision(2) << speedOutMbps << "\""
-            << ",\"speed_in_bps\":\"" << static_cast<uint64_t>(currentSpeedIn) << "\""
-            << ",\"speed_out_bps\":\"" << static_cast<uint64_t>(currentSpeedOut) << "\"}";
-        
-        std::cout << "🚀 Returning full stats with speeds: " << speedInMbps << " Mbps down, " << speedOutMbps << " Mbps up" << std::endl;
-        return oss.str();
-    }
-    return "{\"connected_on\":null,\"duration\":\"00:00:00\",\"byte_in\":\"0\",\"byte_out\":\"0\",\"packets_in\":\"0\",\"packets_out\":\"0\"}";
+bool VPNManager::initializeDriver() {
+    initializeDriverAsync(nullptr);
+    std::unique_lock<std::mutex> lock(driverMutex);
+    driverDecided.wait(lock, [this] { return driverInitState == DriverInitState::Done; });
+    return driverInitialized;
 }
 
-bool VPNManager::initializeDriver() {
+bool VPNManager::probeWinTun() {
     // Try WinTun first (preferred)
     if (preferredDriver == DriverType::WINTUN || 
         (preferredDriver == DriverType::TAP_WINDOWS && allowFallbackToTAP)) {
-        
-        if (initializeWinTun()) {
-            currentDriver = DriverType::WINTUN;
-            driverInitialized = true;
-            std::cout << "Using WinTun driver for VPN connections" << std::endl;
-            return true;
-        }
+        return initializeWinTun();
+    }
+    return false;
+}
+
+bool VPNManager::probeTapDriver() {
+    // Detection only; installing a driver or creating an adapter may prompt for
+    // elevation, so that is left for when WinTun has actually failed
+    if (!allowFallbackToTAP) {
+        return false;
     }
+    bool installed = isTapDriverInstalled();
+    std::string adapter = installed ? findTapAdapter() : "";
+    LOG_INFO("TAP driver installed: " << (installed ? "Yes" : "No")
+             << ", adapter: " << (adapter.empty() ? "None" : adapter));
     
-    // Fallback to TAP-Windows if allowed
-    if (allowFallbackToTAP && initializeTapDriver()) {
-        currentDriver = DriverType::TAP_WINDOWS;
-        driverInitialized = true;
-        std::cout << "Using TAP-Windows driver for VPN connections" << std::endl;
-        return true;
+    std::lock_guard<std::mutex> lock(driverMutex);
+    tapDriverInstalled = installed;
+    tapAdapterName = adapter;
+    return installed && !adapter.empty();
+}
+
+void VPNManager::finishDriverProbe(DriverType driver, bool ok) {
+    std::vector<std::function<void(bool)>> ready;
+    bool needsTapSetup = false;
+    {
+        std::lock_guard<std::mutex> lock(driverMutex);
+        (driver == DriverType::WINTUN ? wintunProbeOk : tapProbeOk) = ok;
+        --driverProbesPending;
+        if (driverInitState != DriverInitState::Running) {
+            return; // Decided by the other probe already
+        }
+        
+        // The first usable driver answers initialize(); which one is used is
+        // only final once WinTun succeeded or both probes are in
+        if (ok && !driverReadyNotified) {
+            driverReadyNotified = true;
+            ready.swap(driverWaiters);
+        }
+        if (wintunProbeOk) {
+            selectDriverLocked(DriverType::WINTUN);
+        } else if (driverProbesPending == 0) {
+            if (tapProbeOk) {
+                selectDriverLocked(DriverType::TAP_WINDOWS);
+            } else {
+                needsTapSetup = true;
+            }
+        }
+    }
+    for (auto& callback : ready) {
+        callback(true);
+    }
+    if (!needsTapSetup) {
+        return;
     }
     
-    std::cerr << "Failed to initialize any VPN driver" << std::endl;
-    driverInitialized = false;
-    return false;
+    // Fallback to TAP-Windows if allowed, installing it when missing
+    bool tapReady = allowFallbackToTAP && initializeTapDriver();
+    {
+        std::lock_guard<std::mutex> lock(driverMutex);
+        if (tapReady) {
+            selectDriverLocked(DriverType::TAP_WINDOWS);
+        } else {
+            LOG_ERROR("Failed to initialize any VPN driver");
+            driverInitialized = false;
+            driverInitState = DriverInitState::Done;
+            driverDecided.notify_all();
+        }
+        ready.clear();
+        ready.swap(driverWaiters);
+    }
+    for (auto& callback : ready) {
+        callback(tapReady);
+    }
+}
+
+void VPNManager::selectDriverLocked(DriverType driver) {
+    currentDriver = driver;
+    driverInitialized = true;
+    driverInitState = DriverInitState::Done;
+    LOG_INFO("Using " << (driver == DriverType::WINTUN ? "WinTun" : "TAP-Windows")
+             << " driver for VPN connections");
+    driverDecided.notify_all();
 }
 
 bool VPNManager::initializeWinTun() {
+    PhaseSpan span(services.metrics, ConnectPhase::WinTunInit);
     if (!wintunManager) {
         wintunManager = std::make_unique<WinTunManager>();
     }
+    wintunManager->setDllPath(findBundledExecutable("wintun.dll"));
     
     if (!wintunManager->initialize()) {
-        std::cerr << "Failed to initialize WinTun manager" << std::endl;
+        LOG_ERROR("Failed to initialize WinTun manager");
         return false;
     }
     
     if (!wintunManager->isWinTunAvailable()) {
-        std::cerr << "WinTun is not available on this system" << std::endl;
+        LOG_ERROR("WinTun is not available on this system");
         return false;
     }
     
-    // Try using tapctl.exe (OpenVPN 2.6.14+ preferred method)
-    std::string tapctlPath = findBundledExecutable("tapctl.exe");
-    std::string appDir = getAppDirectory();
-    std::string adapterName = "OpenVPN-Flutter";
-    
-    if (!tapctlPath.empty()) {
-        std::cout << "Found tapctl.exe, creating WinTun adapter..." << std::endl;
-        
-        // CRITICAL: First DELETE any existing adapter to ensure clean state
-        // This is essential after WireGuard has been used, as there may be
-        // stale adapter state that prevents OpenVPN from working
-        std::ostringstream deleteStream;
-        deleteStream << "\"" << tapctlPath << "\" delete \"" << adapterName << "\"";
-        std::string deleteCmdLine = deleteStream.str();
-        
-        STARTUPINFOA deleteStartupInfo;
-        PROCESS_INFORMATION deleteProcessInfo;
-        ZeroMemory(&deleteProcessInfo, sizeof(deleteProcessInfo));
-        ZeroMemory(&deleteStartupInfo, sizeof(deleteStartupInfo));
-        deleteStartupInfo.cb = sizeof(deleteStartupInfo);
-        deleteStartupInfo.dwFlags = STARTF_USESHOWWINDOW;
-        deleteStartupInfo.wShowWindow = SW_HIDE;
-        
-        BOOL deleteSuccess = CreateProcessA(
-            NULL,
-            (LPSTR)deleteCmdLine.c_str(),
-            NULL,
-            NULL,
-            FALSE,
-            CREATE_NO_WINDOW,
-            NULL,
-            appDir.c_str(),
-            &deleteStartupInfo,
-            &deleteProcessInfo
-        );
-        
-        if (deleteSuccess) {
-            WaitForSingleObject(deleteProcessInfo.hProcess, 3000);
-            CloseHandle(deleteProcessInfo.hProcess);
-            CloseHandle(deleteProcessInfo.hThread);
-            
-            // Small delay after deletion to ensure system has released resources
-            Sleep(500);
-        }
-        
-        // Now CREATE a fresh adapter
-        std::ostringstream createStream;
-        createStream << "\"" << tapctlPath << "\" create --hwid wintun --name \"" << adapterName << "\"";
-        std::string createCmdLine = createStream.str();
-        
-        STARTUPINFOA createStartupInfo;
-        PROCESS_INFORMATION createProcessInfo;
-        ZeroMemory(&createProcessInfo, sizeof(createProcessInfo));
-        ZeroMemory(&createStartupInfo, sizeof(createStartupInfo));
-        createStartupInfo.cb = sizeof(createStartupInfo);
-        createStartupInfo.dwFlags = STARTF_USESHOWWINDOW;
-        createStartupInfo.wShowWindow = SW_HIDE;
-        
-        BOOL createSuccess = CreateProcessA(
-            NULL,
-            (LPSTR)createCmdLine.c_str(),
-            NULL,
-            NULL,
-            FALSE,
-            CREATE_NO_WINDOW,
-            NULL,
-            appDir.c_str(),
-            &createStartupInfo,
-            &createProcessInfo
-        );
-        
-        if (createSuccess) {
-            WaitForSingleObject(createProcessInfo.hProcess, 5000);
-            DWORD createExitCode;
-            if (GetExitCodeProcess(createProcessInfo.hProcess, &createExitCode)) {
-                CloseHandle(createProcessInfo.hProcess);
-                CloseHandle(createProcessInfo.hThread);
-                
-                if (createExitCode == 0) {
-                    std::cout << "Successfully created WinTun adapter using tapctl.exe" << std::endl;
-                    return true;
-                } else {
-                    std::cout << "tapctl.exe exited with code: " << createExitCode << ", falling back to programmatic creation" << std::endl;
-                }
-            } else {
-                CloseHandle(createProcessInfo.hProcess);
-                CloseHandle(createProcessInfo.hThread);
-                std::cout << "Could not get tapctl.exe exit code, falling back to programmatic creation" << std::endl;
-            }
-        } else {
-            DWORD error = GetLastError();
-            std::cout << "Failed to run tapctl.exe (error " << error << "), falling back to programmatic creation" << std::endl;
-        }
-    } else {
-        std::cout << "tapctl.exe not found, using programmatic adapter creation" << std::endl;
+    services.adapterRegistry.start();
+    if (!adapterLifecycle) {
+        adapterLifecycle = std::make_unique<AdapterLifecycle>(*wintunManager, services.adapterRegistry, adapterName());
     }
-    
-    // Fallback: Create WinTun adapter programmatically
-    if (!wintunManager->createAdapter(adapterName)) {
-        std::cerr << "Failed to create WinTun adapter programmatically" << std::endl;
-        return false;
+    return prepareWinTunAdapter();
+}
+
+bool VPNManager::prepareWinTunAdapter() {
+    // tapctl.exe (OpenVPN 2.6.14+) is preferred when the adapter has to be rebuilt
+    auto started = std::chrono::steady_clock::now();
+    bool reused = false;
+    bool ready = adapterLifecycle->ensure(findBundledExecutable("tapctl.exe"), getAppDirectory(), reused);
+    auto finished = std::chrono::steady_clock::now();
+    services.metrics.record(ConnectPhase::AdapterPrepare, finished - started);
+    if (!reused) {
+        // What every connect paid before the adapter was kept warm
+        services.metrics.record(ConnectPhase::AdapterRecreate, finished - started);
     }
-    
-    std::cout << "WinTun driver initialized successfully (programmatic creation)" << std::endl;
-    return true;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(finished - started);
+    LOG_INFO("WinTun adapter " << (ready ? "ready" : "failed") << " in " << elapsed.count() << " ms ("
+             << (reused ? "reused warm adapter" : "recreated") << ")");
+    return ready;
 }
 
 bool VPNManager::initializeTapDriver() {
+    PhaseSpan span(services.metrics, ConnectPhase::TapInit);
     // Check if TAP driver is installed
     tapDriverInstalled = isTapDriverInstalled();
-    std::cout << "TAP driver installed: " << (tapDriverInstalled ? "Yes" : "No") << std::endl;
+    LOG_INFO("TAP driver installed: " << (tapDriverInstalled ? "Yes" : "No"));
     
     if (tapDriverInstalled) {
         // Find existing TAP adapter
         tapAdapterName = findTapAdapter();
-        std::cout << "TAP adapter found: " << (tapAdapterName.empty() ? "None" : tapAdapterName) << std::endl;
+        LOG_INFO("TAP adapter found: " << (tapAdapterName.empty() ? "None" : tapAdapterName));
         
         if (tapAdapterName.empty()) {
             // Try to create one
-            std::cout << "Attempting to create TAP adapter..." << std::endl;
+            LOG_INFO("Attempting to create TAP adapter...");
             return createTapAdapter();
         }
         return true;
     }
     
     // Try to install TAP driver
-    std::cout << "Attempting to install TAP driver..." << std::endl;
+    LOG_INFO("Attempting to install TAP driver...");
     return installTapDriver();
 }
 
@@ -500,13 +559,13 @@ bool VPNManager::installTapDriver() {
     try {
         std::string tapDriverPath = findBundledExecutable("tapinstall.exe");
         if (tapDriverPath.empty()) {
-            std::cerr << "TAP driver installer not found in bundle" << std::endl;
+            LOG_ERROR("TAP driver installer not found in bundle");
             return false;
         }
         
         std::string tapInfPath = findBundledExecutable("OemVista.inf");
         if (tapInfPath.empty()) {
-            std::cerr << "TAP driver INF file not found in bundle" << std::endl;
+            LOG_ERROR("TAP driver INF file not found in bundle");
             return false;
         }
         
@@ -514,14 +573,14 @@ bool VPNManager::installTapDriver() {
         std::string installCmd = "\"" + tapDriverPath + "\" install \"" + tapInfPath + "\" tap0901";
         
         if (!runAsAdmin(installCmd)) {
-            std::cerr << "Failed to install TAP driver" << std::endl;
+            LOG_ERROR("Failed to install TAP driver");
             return false;
         }
         
         // Create TAP adapter
         std::string createCmd = "\"" + tapDriverPath + "\" create tap0901 TAPVPN";
         if (!runAsAdmin(createCmd)) {
-            std::cerr << "Failed to create TAP adapter" << std::endl;
+            LOG_ERROR("Failed to create TAP adapter");
             return false;
         }
         
@@ -567,461 +626,165 @@ bool VPNManager::isTapDriverInstalled() {
     return false;
 }
 
+BinaryLocator& VPNManager::binaries() {
+    // Shared by all tunnels; driver probes on the worker pools can get here at the same time
+    std::call_once(services.binaryLocatorOnce, [this] {
+        auto& binaryLocator = services.binaryLocator;
+        std::string appDir = getAppDirectory();
+        binaryLocator = std::make_unique<BinaryLocator>(appDir, appDir + "\\openvpn_flutter_binaries.manifest");
+    
+        // Look for bundled OpenVPN executable in multiple possible locations
+        binaryLocator->setSearchDirectories("openvpn.exe", {
+            // Installed app locations (most common for installed apps)
+            appDir + "\\openvpn_bundle\\bin",
+            appDir + "\\bin",
+            appDir,
+            // Flutter build output locations
+            appDir + "\\data\\flutter_assets\\windows\\bin",
+            appDir + "\\data\\flutter_assets\\bin",
+            // Direct bundle locations
+            appDir + "\\openvpn",
+            // Plugin asset locations
+            appDir + "\\..\\..\\..\\windows\\runner\\bin",
+            // Development locations
+            ".\\bin",
+            "."
+        });
+    
+        // wintun.dll is loaded from next to the app first so its dependencies are found
+        binaryLocator->setSearchDirectories("wintun.dll", {
+            appDir,
+            appDir + "\\bin",
+            ".\\bin",
+            ".\\wintun"
+        });
+    
+        binaryLocator->setSearchDirectories({
+            // Flutter build output locations
+            appDir + "\\data\\flutter_assets\\windows\\bin",
+            appDir + "\\data\\flutter_assets\\bin",
+            appDir + "\\data\\flutter_assets\\drivers",
+            // Direct bundle locations
+            appDir + "\\bin",
+            appDir + "\\drivers",
+            appDir + "\\openvpn_bundle\\bin",
+            appDir + "\\openvpn_bundle",
+            appDir,
+            // Plugin asset locations
+            appDir + "\\..\\..\\..\\windows\\runner\\bin",
+            appDir + "\\..\\..\\..\\windows\\runner\\drivers",
+            // Development locations
+            ".\\bin",
+            ".\\drivers",
+            "."
+        });
+    });
+    return *services.binaryLocator;
+}
+
 std::string VPNManager::getBundledOpenVPNPath() {
-    // Look for bundled OpenVPN executable in multiple possible locations
-    std::string appDir = getAppDirectory();
-    
-    std::vector<std::string> possiblePaths = {
-        // Installed app locations (most common for installed apps)
-        appDir + "\\openvpn_bundle\\bin\\openvpn.exe",
-        appDir + "\\bin\\openvpn.exe",
-        appDir + "\\openvpn.exe",
-        // Flutter build output locations
-        appDir + "\\data\\flutter_assets\\windows\\bin\\openvpn.exe",
-        appDir + "\\data\\flutter_assets\\bin\\openvpn.exe",
-        // Direct bundle locations
-        appDir + "\\openvpn\\openvpn.exe",
-        // Plugin asset locations  
-        appDir + "\\..\\..\\..\\windows\\runner\\bin\\openvpn.exe",
-        // Development locations
-        ".\\bin\\openvpn.exe",
-        ".\\openvpn.exe"
-    };
-    
-    for (const auto& path : possiblePaths) {
-        if (PathFileExistsA(path.c_str())) {
-            std::cout << "Found OpenVPN executable at: " << path << std::endl;
-            return path;
-        }
+    std::string path = binaries().locate("openvpn.exe");
+    if (path.empty()) {
+        LOG_ERROR("OpenVPN executable not found in any expected location");
+        LOG_ERROR("Searched in app directory: " << getAppDirectory());
     }
-    
-    std::cerr << "OpenVPN executable not found in any expected location" << std::endl;
-    std::cerr << "Searched in app directory: " << appDir << std::endl;
-    return "";
+    return path;
 }
 
 std::string VPNManager::findBundledExecutable(const std::string& filename) {
-    std::string appDir = getAppDirectory();
-    
-    std::vector<std::string> possiblePaths = {
-        // Flutter build output locations
-        appDir + "\\data\\flutter_assets\\windows\\bin\\" + filename,
-        appDir + "\\data\\flutter_assets\\bin\\" + filename,
-        appDir + "\\data\\flutter_assets\\drivers\\" + filename,
-        // Direct bundle locations
-        appDir + "\\bin\\" + filename,
-        appDir + "\\drivers\\" + filename,
-        appDir + "\\openvpn_bundle\\bin\\" + filename,
-        appDir + "\\openvpn_bundle\\" + filename,
-        appDir + "\\" + filename,
-        // Plugin asset locations
-        appDir + "\\..\\..\\..\\windows\\runner\\bin\\" + filename,
-        appDir + "\\..\\..\\..\\windows\\runner\\drivers\\" + filename,
-        // Development locations
-        ".\\bin\\" + filename,
-        ".\\drivers\\" + filename,
-        ".\\" + filename
-    };
-    
-    for (const auto& path : possiblePaths) {
-        if (PathFileExistsA(path.c_str())) {
-            std::cout << "Found " << filename << " at: " << path << std::endl;
-            return path;
-        }
-    }
-    
-    std::cout << "Warning: " << filename << " not found in any expected location" << std::endl;
-    return "";
+    return binaries().locate(filename);
 }
 
-void VPNManager::monitorConnection() {
-    int connectionAttempts = 0;
-    const int maxConnectionAttempts = 300; // 30 seconds
-    int connectedStableCount = 0;
-    const int requiredStableCount = 10; // 1 second of stable connection
-    
-    while (shouldMonitor && hProcess) {
-        DWORD exitCode;
-        if (GetExitCodeProcess(hProcess, &exitCode)) {
-            if (exitCode == STILL_ACTIVE) {
-                if (isConnecting) {
-                    connectionAttempts++;
-                    
-                    // Check if OpenVPN process is running and stable
-                    if (connectionAttempts > 50) { // Give 5 seconds for process to start
-                        // Try to detect actual connection by checking for network adapter changes
-                        // or by reading OpenVPN log output (simplified check here)
-                        bool connectionDetected = checkConnectionStatus();
-                        
-                        if (connectionDetected) {
-                            connectedStableCount++;
-                            if (connectedStableCount >= requiredStableCount) {
-                                isConnecting = false;
-                                isConnected = true;
-                                updateStatusThreadSafe("connected");
-                                std::cout << "VPN connection established successfully" << std::endl;
-                            }
-                        } else {
-                            connectedStableCount = 0; // Reset counter if connection not stable
-                        }
-                    }
-                    
-                    if (connectionAttempts > maxConnectionAttempts) {
-                        updateStatusThreadSafe("error");
-                        std::cerr << "VPN connection timeout" << std::endl;
-                        break;
-                    }
-                } else if (isConnected) {
-                    // Continuously monitor active connection
-                    if (!checkConnectionStatus()) {
-                        // Connection lost
-                        isConnected = false;
-                        updateStatusThreadSafe("disconnected");
-                        std::cout << "VPN connection lost" << std::endl;
-                        break;
-                    }
-                }
-            } else {
-                // Process exited
-                std::cout << "OpenVPN process exited with code: " << exitCode << std::endl;
-                isConnected = false;
-                isConnecting = false;
-                updateStatusThreadSafe("disconnected");
-                std::cout << "OpenVPN process exited with code: " << exitCode << std::endl;
-                break;
-            }
-        } else {
-            // Error getting process status
-            isConnected = false;
-            isConnecting = false;
-            updateStatusThreadSafe("error");
-            std::cerr << "Error monitoring OpenVPN process" << std::endl;
-            break;
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    }
+std::string VPNManager::exitStatus() {
+    DWORD exitCode = 0;
+    GetExitCodeProcess(hProcess, &exitCode);
+    return "code " + std::to_string(exitCode);
 }
 
-bool VPNManager::checkConnectionStatus() {
-    // Check if we have a VPN adapter with an IP address in the VPN range (10.x.x.x)
-    // This works for both WinTun and TAP adapters created by OpenVPN
-    
-    ULONG bufferSize = 0;
-    GetAdaptersAddresses(AF_INET, GAA_FLAG_INCLUDE_PREFIX, NULL, NULL, &bufferSize);
-    
-    if (bufferSize > 0) {
-        std::vector<char> buffer(bufferSize);
-        PIP_ADAPTER_ADDRESSES adapters = reinterpret_cast<PIP_ADAPTER_ADDRESSES>(buffer.data());
-        
-        if (GetAdaptersAddresses(AF_INET, GAA_FLAG_INCLUDE_PREFIX, NULL, adapters, &bufferSize) == NO_ERROR) {
-            for (PIP_ADAPTER_ADDRESSES adapter = adapters; adapter != NULL; adapter = adapter->Next) {
-                // Check if adapter is up and has an IP address
-                if (adapter->OperStatus == IfOperStatusUp && adapter->FirstUnicastAddress != NULL) {
-                    // Check if this is a TUN/TAP adapter (OpenVPN, WinTun, etc.)
-                    std::wstring description(adapter->Description);
-                    bool isVpnAdapter = (description.find(L"TAP") != std::wstring::npos ||
-                                        description.find(L"TUN") != std::wstring::npos ||
-                                        description.find(L"Wintun") != std::wstring::npos ||
-                                        description.find(L"OpenVPN") != std::wstring::npos);
-                    
-                    if (isVpnAdapter) {
-                        // Check if the IP address is in a typical VPN range (10.x.x.x or 172.16-31.x.x)
-                        for (PIP_ADAPTER_UNICAST_ADDRESS addr = adapter->FirstUnicastAddress; addr != NULL; addr = addr->Next) {
-                            if (addr->Address.lpSockaddr->sa_family == AF_INET) {
-                                struct sockaddr_in* sockaddr = (struct sockaddr_in*)addr->Address.lpSockaddr;
-                                unsigned char* ip = (unsigned char*)&sockaddr->sin_addr;
-                                
-                                // Check for 10.x.x.x (common VPN range)
-                                if (ip[0] == 10) {
-                                    return true;
-                                }
-                                // Check for 172.16.x.x - 172.31.x.x (VPN range)
-                                if (ip[0] == 172 && ip[1] >= 16 && ip[1] <= 31) {
-                                    return true;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+bool VPNManager::connectManagement() {
+    // Whoever else got the port first would be handed the password, and the
+    // credentials after it
+    if (!isListenerOf(managementPort, processInfo.dwProcessId)) {
+        return false;
     }
-    
-    return false;
-}
-
-bool VPNManager::checkTapAdapterStatus() {
-    if (tapAdapterName.empty()) return false;
-    
-    // Check if TAP adapter has an IP address assigned
-    ULONG bufferSize = 0;
-    GetAdaptersAddresses(AF_INET, GAA_FLAG_INCLUDE_PREFIX, NULL, NULL, &bufferSize);
-    
-    if (bufferSize > 0) {
-        std::vector<char> buffer(bufferSize);
-        PIP_ADAPTER_ADDRESSES adapters = reinterpret_cast<PIP_ADAPTER_ADDRESSES>(buffer.data());
-        
-        if (GetAdaptersAddresses(AF_INET, GAA_FLAG_INCLUDE_PREFIX, NULL, adapters, &bufferSize) == NO_ERROR) {
-            for (PIP_ADAPTER_ADDRESSES adapter = adapters; adapter != NULL; adapter = adapter->Next) {
-                if (adapter->AdapterName && 
-                    std::string(adapter->AdapterName) == tapAdapterName &&
-                    adapter->OperStatus == IfOperStatusUp &&
-                    adapter->FirstUnicastAddress != NULL) {
-                    return true; // Adapter is up and has IP address
-                }
-            }
-        }
+    management.setPassword(managementPassword);
+    if (!management.connect("127.0.0.1", managementPort)) {
+        return false;
     }
-    
-    return false;
+    // openvpn reads the file at startup
+    removeManagementPasswordFile();
+    return true;
 }
 
-void VPNManager::updateStatus(const std::string& status) {
-    // This method should only be called from the main thread
-    currentStatus = status;
-    if (eventSink) {
-        eventSink->Success(flutter::EncodableValue(status));
+bool VPNManager::writeManagementPassword() {
+    removeManagementPasswordFile();
+    unsigned char random[24];
+    if (!BCRYPT_SUCCESS(BCryptGenRandom(NULL, random, sizeof(random), BCRYPT_USE_SYSTEM_PREFERRED_RNG))) {
+        LOG_ERROR("Failed to generate the management interface password");
+        return false;
     }
-}
+    static const char hexDigits[] = "0123456789abcdef";
+    managementPassword.clear();
+    for (unsigned char byte : random) {
+        managementPassword += hexDigits[byte >> 4];
+        managementPassword += hexDigits[byte & 0x0f];
+    }
+    SecureZeroMemory(random, sizeof(random));
 
-void VPNManager::updateStatusThreadSafe(const std::string& status) {
-    // Thread-safe method for background threads to queue status updates
-    std::lock_guard<std::mutex> lock(statusMutex);
-    pendingStatusUpdates.push(status);
-    std::cout << "Queued status update: " << status << " (from background thread)" << std::endl;
-}
+    // The user's temp directory is readable by the user (and administrators) only
+    char tempDir[MAX_PATH];
+    char path[MAX_PATH];
+    DWORD length = GetTempPathA(MAX_PATH, tempDir);
+    if (length == 0 || length > MAX_PATH || GetTempFileNameA(tempDir, "ovf", 0, path) == 0) {
+        LOG_ERROR("Failed to create the management password file: " << GetLastError());
+        return false;
+    }
+    managementPasswordFile = path;
 
-void VPNManager::processPendingStatusUpdates() {
-    // Process all pending status updates from the main thread
-    std::lock_guard<std::mutex> lock(statusMutex);
-    while (!pendingStatusUpdates.empty()) {
-        std::string status = pendingStatusUpdates.front();
-        pendingStatusUpdates.pop();
-        
-        // Update status using the main thread
-        currentStatus = status;
-        if (eventSink) {
-            eventSink->Success(flutter::EncodableValue(status));
-            std::cout << "Processed status update from main thread: " << status << std::endl;
-        }
+    HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Failed to open the management password file: " << GetLastError());
+        removeManagementPasswordFile();
+        return false;
     }
+    std::string line = managementPassword + "\n";
+    DWORD written = 0;
+    BOOL ok = WriteFile(file, line.data(), static_cast<DWORD>(line.size()), &written, NULL) && written == line.size();
+    SecureZeroMemory(line.data(), line.size());
+    CloseHandle(file);
+    if (!ok) {
+        LOG_ERROR("Failed to write the management password file: " << GetLastError());
+        removeManagementPasswordFile();
+        return false;
+    }
+    return true;
 }
 
-bool VPNManager::createConfigFile(const std::string& config, const std::string& username, const std::string& password) {
-    try {
-        // Use app directory instead of user temp to ensure elevated process can access it
-        std::string appDir = getAppDirectory();
-        currentConfigPath = appDir + "\\openvpn_flutter_config.ovpn";
-        
-        std::cout << "Creating config file at: " << currentConfigPath << std::endl;
-        
-        std::ofstream configFile(currentConfigPath);
-        if (!configFile.is_open()) {
-            return false;
-        }
-        
-        // Modify config based on driver type
-        std::string modifiedConfig = config;
-        
-        // Remove deprecated client-cert-not-required option if present
-        size_t pos = 0;
-        while ((pos = modifiedConfig.find("client-cert-not-required", pos)) != std::string::npos) {
-            size_t endPos = modifiedConfig.find('\n', pos);
-            if (endPos == std::string::npos) endPos = modifiedConfig.length();
-            modifiedConfig.erase(pos, endPos - pos + 1);
-        }
-        
-        // When using WinTun, remove dev/dev-type directives from config file
-        // We specify them on the command line instead to avoid conflicts
-        if (currentDriver == DriverType::WINTUN) {
-            // Remove 'dev tap' lines
-            pos = 0;
-            while ((pos = modifiedConfig.find("dev tap", pos)) != std::string::npos) {
-                size_t lineStart = modifiedConfig.rfind('\n', pos);
-                if (lineStart == std::string::npos) lineStart = 0;
-                else lineStart++;
-                
-                size_t lineEnd = modifiedConfig.find('\n', pos);
-                if (lineEnd == std::string::npos) lineEnd = modifiedConfig.length();
-                else lineEnd++;
-                
-                std::string line = modifiedConfig.substr(lineStart, lineEnd - lineStart);
-                if (line.find("dev tap") != std::string::npos && 
-                    line.find('#') == std::string::npos) {
-                    modifiedConfig.erase(lineStart, lineEnd - lineStart);
-                    pos = lineStart;
-                    std::cout << "Removed 'dev tap' line for WinTun" << std::endl;
-                } else {
-                    pos = lineEnd;
-                }
-            }
-            
-            // Remove any existing windows-driver directives first (we'll add the correct one)
-            pos = 0;
-            while ((pos = modifiedConfig.find("windows-driver", pos)) != std::string::npos) {
-                size_t lineStart = modifiedConfig.rfind('\n', pos);
-                if (lineStart == std::string::npos) lineStart = 0;
-                else lineStart++;
-                
-                size_t lineEnd = modifiedConfig.find('\n', pos);
-                if (lineEnd == std::string::npos) lineEnd = modifiedConfig.length();
-                else lineEnd++;
-                
-                std::string line = modifiedConfig.substr(lineStart, lineEnd - lineStart);
-                if (line.find("windows-driver") != std::string::npos && 
-                    line.find('#') == std::string::npos) {
-                    modifiedConfig.erase(lineStart, lineEnd - lineStart);
-                    pos = lineStart;
-                    std::cout << "Removed existing 'windows-driver' line from config (will add correct one)" << std::endl;
-                } else {
-                    pos = lineEnd;
-                }
-            }
-            
-            // Add 'windows-driver wintun' - REQUIRED for OpenVPN 2.6.14+ WinTun
-            // This directive tells OpenVPN to use WinTun driver on Windows
-            // Note: 'dev tun' is already in the config file from the API
-            if (modifiedConfig.find("windows-driver wintun") == std::string::npos) {
-                // Add after 'dev tun' line (which should already exist)
-                size_t devTunPos = modifiedConfig.find("dev tun");
-                if (devTunPos != std::string::npos) {
-                    size_t devTunLineEnd = modifiedConfig.find('\n', devTunPos);
-                    if (devTunLineEnd != std::string::npos) {
-                        modifiedConfig.insert(devTunLineEnd + 1, "windows-driver wintun\n");
-                        std::cout << "Added 'windows-driver wintun' to config file (REQUIRED for WinTun)" << std::endl;
-                    }
-                } else {
-                    // Fallback: if dev tun not found, add after remote
-                    size_t insertPos = modifiedConfig.find("remote ");
-                    if (insertPos != std::string::npos) {
-                        size_t remoteLineEnd = modifiedConfig.find('\n', insertPos);
-                        if (remoteLineEnd != std::string::npos) {
-                            modifiedConfig.insert(remoteLineEnd + 1, "windows-driver wintun\n");
-                            std::cout << "Added 'windows-driver wintun' to config file (REQUIRED for WinTun)" << std::endl;
-                        }
-                    }
-                }
-            } else {
-                std::cout << "Found 'windows-driver wintun' in config - keeping it" << std::endl;
-            }
-            
-            // Remove 'persist-tun' as it may conflict with WinTun
-            pos = 0;
-            while ((pos = modifiedConfig.find("persist-tun", pos)) != std::string::npos) {
-                size_t lineStart = modifiedConfig.rfind('\n', pos);
-                if (lineStart == std::string::npos) lineStart = 0;
-                else lineStart++;
-                
-                size_t lineEnd = modifiedConfig.find('\n', pos);
-                if (lineEnd == std::string::npos) lineEnd = modifiedConfig.length();
-                else lineEnd++;
-                
-                std::string line = modifiedConfig.substr(lineStart, lineEnd - lineStart);
-                if (line.find("persist-tun") != std::string::npos && 
-                    line.find('#') == std::string::npos) {
-                    modifiedConfig.erase(lineStart, lineEnd - lineStart);
-                    pos = lineStart;
-                    std::cout << "Removed 'persist-tun' line for WinTun compatibility" << std::endl;
-                } else {
-                    pos = lineEnd;
-                }
-            }
-            
-            // Remove any existing dev-type directives (we specify on command line)
-            pos = 0;
-            while ((pos = modifiedConfig.find("dev-type", pos)) != std::string::npos) {
-                size_t lineStart = modifiedConfig.rfind('\n', pos);
-                if (lineStart == std::string::npos) lineStart = 0;
-                else lineStart++;
-                
-                size_t lineEnd = modifiedConfig.find('\n', pos);
-                if (lineEnd == std::string::npos) lineEnd = modifiedConfig.length();
-                else lineEnd++;
-                
-                std::string line = modifiedConfig.substr(lineStart, lineEnd - lineStart);
-                if (line.find("dev-type") != std::string::npos && 
-                    line.find('#') == std::string::npos) {
-                    modifiedConfig.erase(lineStart, lineEnd - lineStart);
-                    pos = lineStart;
-                    std::cout << "Removed 'dev-type' line from config (using command line instead)" << std::endl;
-                } else {
-                    pos = lineEnd;
-                }
-            }
-        }
-        
-        configFile << modifiedConfig;
-        
-        if (currentDriver == DriverType::WINTUN) {
-            std::cout << "Modified config for WinTun compatibility:" << std::endl;
-            std::cout << "  - Config file: 'dev tun' (from API) + 'windows-driver wintun' (added)" << std::endl;
-            std::cout << "  - Command line: Basic options only (WinTun configured via config file)" << std::endl;
-        } else {
-            std::cout << "Using original config from API without modifications" << std::endl;
-        }
-        
-        // DEBUG: Show full config content for WinTun
-        if (currentDriver == DriverType::WINTUN) {
-            std::cout << "DEBUG: Full modified config content:" << std::endl;
-            std::cout << modifiedConfig << std::endl;
-            std::cout << "DEBUG: End of modified config" << std::endl;
-        } else {
-            std::cout << "Config preview (first 500 chars): " << modifiedConfig.substr(0, 500) << std::endl;
-        }
-        
-        if (!username.empty() && !password.empty()) {
-            std::string authPath = appDir + "\\openvpn_flutter_auth.txt";
-            
-            std::ofstream authFile(authPath);
-            if (authFile.is_open()) {
-                authFile << username << "\n" << password;
-                authFile.close();
-                
-                configFile << "\nauth-user-pass \"" << authPath << "\"";
-            }
-        }
-        
-        configFile.close();
-        return true;
-    } catch (...) {
-        return false;
+void VPNManager::removeManagementPasswordFile() {
+    if (!managementPasswordFile.empty()) {
+        DeleteFileA(managementPasswordFile.c_str());
+        managementPasswordFile.clear();
     }
 }
 
-void VPNManager::cleanupTempFiles() {
-    if (!currentConfigPath.empty()) {
-        DeleteFileA(currentConfigPath.c_str());
-        
-        std::string authPath = currentConfigPath;
-        size_t pos = authPath.find_last_of('.');
-        if (pos != std::string::npos) {
-            authPath = authPath.substr(0, pos) + "_auth.txt";
-            DeleteFileA(authPath.c_str());
-        }
-        
-        currentConfigPath.clear();
+void VPNManager::removeLegacyFiles() {
+    // Earlier versions wrote the profile and plaintext credentials next to the
+    // app and did not always remove them (the auth file was deleted under the
+    // wrong name)
+    DeleteFileA(tunnelFilePath("openvpn_flutter_config", ".ovpn").c_str());
+    DeleteFileA(tunnelFilePath("openvpn_flutter_auth", ".txt").c_str());
+    if (tunnelId == kDefaultTunnel) {
+        DeleteFileA((getAppDirectory() + "\\openvpn_flutter_config_auth.txt").c_str());
     }
 }
 
 std::string VPNManager::findTapAdapter() {
-    // Enumerate network adapters to find TAP adapter
-    ULONG bufferSize = 0;
-    GetAdaptersAddresses(AF_UNSPEC, 0, NULL, NULL, &bufferSize);
-    
-    if (bufferSize > 0) {
-        std::vector<char> buffer(bufferSize);
-        PIP_ADAPTER_ADDRESSES adapters = reinterpret_cast<PIP_ADAPTER_ADDRESSES>(buffer.data());
-        
-        if (GetAdaptersAddresses(AF_UNSPEC, 0, NULL, adapters, &bufferSize) == NO_ERROR) {
-            for (PIP_ADAPTER_ADDRESSES adapter = adapters; adapter != NULL; adapter = adapter->Next) {
-                if (adapter->Description && 
-                    (wcsstr(adapter->Description, L"TAP-Windows") != NULL || 
-                     wcsstr(adapter->Description, L"TAP-Win32") != NULL)) {
-                    // AdapterName is already a narrow string (PCHAR)
-                    return std::string(adapter->AdapterName);
-                }
-            }
+    // Runs on driver probe workers, so it can't use the tunnel's own snapshot
+    services.adapterRegistry.start();
+    auto snapshot = services.adapterRegistry.snapshot();
+    for (const AdapterInfo& adapter : snapshot->adapters) {
+        if (adapter.kind == AdapterKind::TapWindows) {
+            return adapter.name;
         }
     }
     
@@ -1087,6 +850,23 @@ bool VPNManager::isRunningAsAdmin() {
     return isAdmin == TRUE;
 }
 
+std::string VPNManager::adapterName() const {
+    // The default tunnel keeps the adapter name earlier versions created
+    if (tunnelId == kDefaultTunnel) {
+        return "OpenVPN-Flutter";
+    }
+    return "OpenVPN-Flutter-" + tunnelId;
+}
+
+std::string VPNManager::tunnelFilePath(const std::string& stem, const std::string& extension) {
+    // Use app directory instead of user temp to ensure elevated process can access it
+    std::string path = getAppDirectory() + "\\" + stem;
+    if (tunnelId != kDefaultTunnel) {
+        path += "_" + tunnelId;
+    }
+    return path + extension;
+}
+
 std::string VPNManager::getAppDirectory() {
     char path[MAX_PATH];
     GetModuleFileNameA(NULL, path, MAX_PATH);
@@ -1110,91 +890,10 @@ void VPNManager::setPreferredDriver(DriverType type, bool allowFallback) {
     allowFallbackToTAP = allowFallback;
 }
 
-std::pair<uint64_t, uint64_t> VPNManager::getRealNetworkStats() {
-    uint64_t bytesIn = 0;
-    uint64_t bytesOut = 0;
-    
-    // Get network adapter statistics
-    ULONG bufferSize = 0;
-    GetAdaptersAddresses(AF_UNSPEC, 0, NULL, NULL, &bufferSize);
-    
-    if (bufferSize > 0) {
-        std::vector<char> buffer(bufferSize);
-        PIP_ADAPTER_ADDRESSES adapters = reinterpret_cast<PIP_ADAPTER_ADDRESSES>(buffer.data());
-        
-        if (GetAdaptersAddresses(AF_UNSPEC, 0, NULL, adapters, &bufferSize) == NO_ERROR) {
-            for (PIP_ADAPTER_ADDRESSES adapter = adapters; adapter != NULL; adapter = adapter->Next) {
-                // Look for VPN-related adapters
-                if (adapter->Description && 
-                    (wcsstr(adapter->Description, L"TAP-Windows") != NULL ||
-                     wcsstr(adapter->Description, L"OpenVPN") != NULL ||
-                     wcsstr(adapter->Description, L"WinTun") != NULL ||
-                     wcsstr(adapter->Description, L"Wintun") != NULL ||
-                     wcsstr(adapter->Description, L"Data Channel Offload") != NULL)) {
-                    
-                    // Get interface statistics using GetIfEntry2
-                    MIB_IF_ROW2 ifRow;
-                    ZeroMemory(&ifRow, sizeof(ifRow));
-                    ifRow.InterfaceIndex = adapter->IfIndex;
-                    
-                    if (GetIfEntry2(&ifRow) == NO_ERROR) {
-                        bytesIn += ifRow.InOctets;
-                        bytesOut += ifRow.OutOctets;
-                        
-                        std::wcout << L"Found VPN adapter: " << adapter->Description 
-                                  << L" - In: " << ifRow.InOctets 
-                                  << L" Out: " << ifRow.OutOctets << std::endl;
-                    }
-                }
-            }
-        }
-    }
-    
-    return std::make_pair(bytesIn, bytesOut);
-}
-
-void VPNManager::updateSpeedCalculations(uint64_t bytesIn, uint64_t bytesOut, const std::chrono::system_clock::time_point& now) {
-    // Initialize on first call
-    if (lastStatsTime.time_since_epoch().count() == 0) {
-        lastBytesIn = bytesIn;
-        lastBytesOut = bytesOut;
-        lastStatsTime = now;
-        currentSpeedIn = 0.0;
-        currentSpeedOut = 0.0;
-        smoothedSpeedIn = 0.0;
-        smoothedSpeedOut = 0.0;
-        return;
-    }
-    
-    // Calculate time difference
-    auto timeDiff = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastStatsTime);
-    double timeDiffSeconds = timeDiff.count() / 1000.0;
-    
-    // Only calculate if enough time has passed (at least 100ms for accurate speed calculation)
-    // This prevents division by very small numbers and reduces jitter
-    if (timeDiffSeconds >= 0.1) {
-        // Calculate byte differences
-        uint64_t byteInDiff = bytesIn - lastBytesIn;
-        uint64_t byteOutDiff = bytesOut - lastBytesOut;
-        
-        // Calculate raw speeds (bytes per second)
-        double rawSpeedIn = byteInDiff / timeDiffSeconds;
-        double rawSpeedOut = byteOutDiff / timeDiffSeconds;
-        
-        // Smooth the speeds with exponential moving average to reduce jitter
-        // Use member variables instead of static to reset properly on disconnect
-        // Weight: 70% new value, 30% old value for responsive but stable speeds
-        smoothedSpeedIn = (smoothedSpeedIn * 0.3) + (rawSpeedIn * 0.7);
-        smoothedSpeedOut = (smoothedSpeedOut * 0.3) + (rawSpeedOut * 0.7);
-        
-        currentSpeedIn = smoothedSpeedIn;
-        currentSpeedOut = smoothedSpeedOut;
-        
-        // Update tracking variables
-        lastBytesIn = bytesIn;
-        lastBytesOut = bytesOut;
-        lastStatsTime = now;
-    }
+const AdapterInfo* VPNManager::findAdapter(const AdapterSnapshot& adapters) const {
+    // A kept WinTun adapter is found by its alias, a TAP adapter by its name
+    return currentDriver == DriverType::WINTUN ? adapters.findByAlias(adapterName())
+                                               : adapters.findByName(tapAdapterName);
 }
 
 } // namespace openvpn_flutter 
\ No newline at end of file
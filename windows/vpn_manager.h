@@ -4,14 +4,17 @@
 #include <string>
 #include <memory>
 #include <atomic>
-#include <thread>
-#include <flutter/event_channel.h>
-#include <flutter/encodable_value.h>
 #include <mutex>
-#include <queue>
-#include <chrono>
-#include <iomanip>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include "adapter_lifecycle.h"
+#include "adapter_registry.h"
+#include "binary_locator.h"
+#include "command_executor.h"
+#include "tunnel_session.h"
 #include "wintun_manager.h"
+#include "worker_pool.h"
 
 namespace openvpn_flutter {
 
@@ -20,60 +23,69 @@ enum class DriverType {
     TAP_WINDOWS
 };
 
-class VPNManager {
+// One tunnel: its own openvpn.exe and adapter. The session (stages,
+// management interface, counters) is shared with Linux; this adds the
+// process, the WinTun or TAP-Windows driver and the bundled binaries.
+class VPNManager : public TunnelSession {
 private:
     PROCESS_INFORMATION processInfo;
     HANDLE hProcess = NULL;
-    std::atomic<bool> isConnected{false};
-    std::atomic<bool> isConnecting{false};
-    std::string currentConfigPath;
-    std::string currentStatus = "disconnected";
-    std::thread statusMonitorThread;
-    std::atomic<bool> shouldMonitor{true};
-    flutter::EventSink<flutter::EncodableValue>* eventSink = nullptr;
     
     // Driver management
     DriverType preferredDriver = DriverType::WINTUN;
     bool allowFallbackToTAP = true;
     DriverType currentDriver = DriverType::WINTUN;
-    bool driverInitialized = false;
+    std::atomic<bool> driverInitialized{false};
+    
+    // Driver probing runs on the worker pool; everything below is guarded by
+    // driverMutex and the choice is final once driverInitState is Done
+    enum class DriverInitState { Idle, Running, Done };
+    std::mutex driverMutex;
+    std::condition_variable driverDecided;
+    DriverInitState driverInitState = DriverInitState::Idle;
+    int driverProbesPending = 0;
+    bool wintunProbeOk = false;
+    bool tapProbeOk = false;
+    bool driverReadyNotified = false;
+    std::vector<std::function<void(bool)>> driverWaiters;
     
     // WinTun management
     std::unique_ptr<WinTunManager> wintunManager;
+    std::unique_ptr<AdapterLifecycle> adapterLifecycle; // Keeps the adapter warm across connects
     
     // TAP adapter management (fallback)
     std::string tapAdapterName;
     bool tapDriverInstalled = false;
     
-    // Thread-safe status updates
-    std::mutex statusMutex;
-    std::queue<std::string> pendingStatusUpdates;
-    
-    // Connection tracking
-    std::chrono::system_clock::time_point connectionStartTime;
+    // Management interface on loopback. openvpn asks for the password from
+    // the file; it is generated per connect and the file is deleted once
+    // we are attached.
+    uint16_t managementPort = 0;
+    std::string managementPassword;
+    std::string managementPasswordFile;
     
-    // Speed calculation tracking
-    uint64_t lastBytesIn = 0;
-    uint64_t lastBytesOut = 0;
-    std::chrono::system_clock::time_point lastStatsTime;
-    double currentSpeedIn = 0.0;  // bytes per second
-    double currentSpeedOut = 0.0; // bytes per second
-    double smoothedSpeedIn = 0.0;  // smoothed speed for download
-    double smoothedSpeedOut = 0.0; // smoothed speed for upload
+    // Blocking work kept off the platform thread
+    WorkerPool workers{2};
     
 public:
-    VPNManager();
-    ~VPNManager();
+    VPNManager(std::string tunnelId, TunnelServices& services);
+    ~VPNManager() override;
     
-    void setEventSink(flutter::EventSink<flutter::EncodableValue>* sink);
-    bool startVPN(const std::string& config, const std::string& username = "", const std::string& password = "");
-    void stopVPN();
-    std::string getStatus();
-    std::string getConnectionStats();
+    // Blocks (process start); the plugin runs it on its command executor.
+    // Stage events reach the listener through the platform poster.
+    bool startVPN(const std::string& config, const std::string& username = "", const std::string& password = "",
+                  const CancellationToken* cancel = nullptr);
     
     // Driver management
+    // Probe WinTun and TAP-Windows concurrently on the worker pool. onReady is
+    // called once, on a worker thread (or right away if a driver is already
+    // set up), with true as soon as a usable driver is found or false when
+    // none is.
+    void initializeDriverAsync(std::function<void(bool)> onReady);
+    // Blocks until the driver choice is final
     bool initializeDriver();
     bool initializeWinTun();
+    bool prepareWinTunAdapter();
     bool initializeTapDriver();
     bool installTapDriver();
     bool isWinTunAvailable();
@@ -81,19 +93,27 @@ public:
     DriverType getCurrentDriver() const;
     void setPreferredDriver(DriverType type, bool allowFallback = true);
     
-    // Process pending status updates (call from main thread)
-    void processPendingStatusUpdates();
+protected:
+    bool hasProcess() const override;
+    void terminateProcess() override;
+    void signalProcess(bool kill) override;
+    std::string exitStatus() override;
+    const AdapterInfo* findAdapter(const AdapterSnapshot& adapters) const override;
+    bool connectManagement() override;
     
 private:
+    bool writeManagementPassword();
+    void removeManagementPasswordFile();
+    BinaryLocator& binaries();
+    bool probeWinTun();
+    bool probeTapDriver();
+    void finishDriverProbe(DriverType driver, bool ok);
+    void selectDriverLocked(DriverType driver);
     std::string getBundledOpenVPNPath();
     std::string findBundledExecutable(const std::string& filename);
-    void monitorConnection();
-    void updateStatus(const std::string& status);
-    void updateStatusThreadSafe(const std::string& status);
-    bool createConfigFile(const std::string& config, const std::string& username, const std::string& password);
-    void cleanupTempFiles();
-    bool checkConnectionStatus();
-    bool checkTapAdapterStatus();
+    std::string adapterName() const;
+    std::string tunnelFilePath(const std::string& stem, const std::string& extension);
+    void removeLegacyFiles();
     
     // TAP adapter utilities
     std::string findTapAdapter();
@@ -105,10 +125,6 @@ private:
     bool runAsAdmin(const std::string& command, const std::string& params = "");
     bool isRunningAsAdmin();
     std::string getAppDirectory();
-    
-    // Network statistics
-    std::pair<uint64_t, uint64_t> getRealNetworkStats();
-    void updateSpeedCalculations(uint64_t bytesIn, uint64_t bytesOut, const std::chrono::system_clock::time_point& now);
 };
 
-} // namespace openvpn_flutter 
\ No newline at end of file
+} // namespace openvpn_flutter
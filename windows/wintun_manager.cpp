@@ -1,5 +1,5 @@
 #include "wintun_manager.h"
-#include <iostream>
+#include "logger.h"
 #include <sstream>
 #include <vector>
 #include <shlwapi.h>
@@ -21,14 +21,18 @@ WinTunManager::~WinTunManager() {
     CoUninitialize();
 }
 
+void WinTunManager::setDllPath(const std::string& path) {
+    dllPath = path;
+}
+
 bool WinTunManager::initialize() {
     if (!loadWinTunDll()) {
-        std::cerr << "Failed to load WinTun.dll" << std::endl;
+        LOG_ERROR("Failed to load WinTun.dll");
         return false;
     }
     
     if (!loadWinTunFunctions()) {
-        std::cerr << "Failed to load WinTun functions" << std::endl;
+        LOG_ERROR("Failed to load WinTun functions");
         return false;
     }
     
@@ -44,7 +48,7 @@ bool WinTunManager::isWinTunAvailable() {
 
 bool WinTunManager::createAdapter(const std::string& name) {
     if (!wintunDll || !WinTunCreateAdapter) {
-        std::cerr << "WinTun not initialized" << std::endl;
+        LOG_ERROR("WinTun not initialized");
         return false;
     }
     
@@ -59,11 +63,11 @@ bool WinTunManager::createAdapter(const std::string& name) {
     
     if (!adapter) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to create WinTun adapter. Error: " << error << std::endl;
+        LOG_ERROR("Failed to create WinTun adapter. Error: " << error);
         return false;
     }
     
-    std::cout << "WinTun adapter created successfully: " << adapterName << std::endl;
+    LOG_INFO("WinTun adapter created successfully: " << adapterName);
     return true;
 }
 
@@ -78,20 +82,19 @@ bool WinTunManager::destroyAdapter() {
 
 bool WinTunManager::startSession() {
     if (!adapter || !WinTunStartSession) {
-        std::cerr << "WinTun adapter not available" << std::endl;
+        LOG_ERROR("WinTun adapter not available");
         return false;
     }
     
-    // Start session with 0x400000 (4MB) ring buffer capacity
-    session = WinTunStartSession(adapter, 0x400000);
+    session = WinTunStartSession(adapter, kSessionCapacity);
     
     if (!session) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to start WinTun session. Error: " << error << std::endl;
+        LOG_ERROR("Failed to start WinTun session. Error: " << error);
         return false;
     }
     
-    std::cout << "WinTun session started successfully" << std::endl;
+    LOG_INFO("WinTun session started successfully");
     return true;
 }
 
@@ -113,6 +116,33 @@ DWORD WinTunManager::getDriverVersion() {
     return 0;
 }
 
+bool WinTunManager::hasDataPlane() const {
+    return session && WinTunReceivePacket && WinTunReleaseReceivePacket && WinTunAllocateSendPacket &&
+           WinTunSendPacket && WinTunGetReadWaitEvent;
+}
+
+BYTE* WinTunManager::receivePacket(DWORD* size) {
+    // NULL with ERROR_NO_MORE_ITEMS once the ring is empty
+    return WinTunReceivePacket(session, size);
+}
+
+void WinTunManager::releaseReceivePacket(const BYTE* packet) {
+    WinTunReleaseReceivePacket(session, packet);
+}
+
+BYTE* WinTunManager::allocateSendPacket(DWORD size) {
+    // NULL with ERROR_BUFFER_OVERFLOW while the ring is full
+    return WinTunAllocateSendPacket(session, size);
+}
+
+void WinTunManager::sendPacket(const BYTE* packet) {
+    WinTunSendPacket(session, packet);
+}
+
+HANDLE WinTunManager::getReadWaitEvent() {
+    return session && WinTunGetReadWaitEvent ? WinTunGetReadWaitEvent(session) : NULL;
+}
+
 bool WinTunManager::loadWinTunDll() {
     if (wintunDll) {
         return true; // Already loaded
@@ -161,12 +191,12 @@ bool WinTunManager::loadWinTunDll() {
             DLL_DIRECTORY_COOKIE cookie = addDllDir(&wbinDir[0]);
             if (cookie) {
                 dllDirCookies.push_back(cookie);
-                std::cout << "Added bin directory to DLL search path: " << binDir << std::endl;
+                LOG_DEBUG("Added bin directory to DLL search path: " << binDir);
             }
         } else {
             // Fallback to SetDllDirectory for older Windows
             SetDllDirectoryA(binDir.c_str());
-            std::cout << "Added bin directory to DLL search path (via SetDllDirectory): " << binDir << std::endl;
+            LOG_DEBUG("Added bin directory to DLL search path (via SetDllDirectory): " << binDir);
         }
     }
     
@@ -178,19 +208,23 @@ bool WinTunManager::loadWinTunDll() {
         DLL_DIRECTORY_COOKIE cookie = addDllDir(&wappDir[0]);
         if (cookie) {
             dllDirCookies.push_back(cookie);
-            std::cout << "Added app directory to DLL search path: " << appDir << std::endl;
+            LOG_DEBUG("Added app directory to DLL search path: " << appDir);
         }
     }
     
     // Try to load WinTun.dll from various locations
     // Prefer app directory first (dependencies should be there too)
-    std::vector<std::string> possiblePaths = {
+    std::vector<std::string> possiblePaths;
+    if (!dllPath.empty()) {
+        possiblePaths.push_back(dllPath);
+    }
+    possiblePaths.insert(possiblePaths.end(), {
         appDir + "\\wintun.dll",         // App directory (preferred - dependencies nearby)
         appDir + "\\bin\\wintun.dll",    // Bin subdirectory
         "wintun.dll",                    // Current directory
         ".\\bin\\wintun.dll",           // bin subdirectory
         ".\\wintun\\wintun.dll",        // wintun subdirectory
-    };
+    });
     
     for (const auto& path : possiblePaths) {
         // Use LOAD_WITH_ALTERED_SEARCH_PATH to search in DLL's directory first
@@ -201,19 +235,19 @@ bool WinTunManager::loadWinTunDll() {
             wintunDll = LoadLibraryA(path.c_str());
         }
         if (wintunDll) {
-            std::cout << "WinTun.dll loaded from: " << path << std::endl;
+            LOG_INFO("WinTun.dll loaded from: " << path);
             
             // Verify DLL loaded correctly by checking if we can get a proc address
             // This helps catch cases where DLL loads but isn't initialized
             FARPROC testProc = GetProcAddress(wintunDll, "DllMain");
             if (!testProc) {
-                std::cerr << "Warning: DLL loaded but DllMain not found - DLL may not be initialized" << std::endl;
+                LOG_WARN("DLL loaded but DllMain not found - DLL may not be initialized");
             }
             
             return true;
         } else {
             DWORD error = GetLastError();
-            std::cerr << "Failed to load from " << path << ". Error: " << error << std::endl;
+            LOG_WARN("Failed to load from " << path << ". Error: " << error);
         }
     }
     
@@ -228,8 +262,8 @@ bool WinTunManager::loadWinTunDll() {
     }
     
     DWORD error = GetLastError();
-    std::cerr << "Failed to load WinTun.dll from all attempted paths. Last error: " << error << std::endl;
-    std::cerr << "Make sure wintun.dll is available in your application directory" << std::endl;
+    LOG_ERROR("Failed to load WinTun.dll from all attempted paths. Last error: " << error);
+    LOG_ERROR("Make sure wintun.dll is available in your application directory");
     return false;
 }
 
@@ -244,6 +278,11 @@ void WinTunManager::unloadWinTunDll() {
         WinTunStartSession = nullptr;
         WinTunEndSession = nullptr;
         WinTunGetRunningDriverVersion = nullptr;
+        WinTunReceivePacket = nullptr;
+        WinTunReleaseReceivePacket = nullptr;
+        WinTunAllocateSendPacket = nullptr;
+        WinTunSendPacket = nullptr;
+        WinTunGetReadWaitEvent = nullptr;
     }
 }
 
@@ -255,14 +294,14 @@ bool WinTunManager::loadWinTunFunctions() {
     // Diagnostic: Try to get DLL info
     char modulePath[MAX_PATH];
     if (GetModuleFileNameA(wintunDll, modulePath, MAX_PATH)) {
-        std::cout << "Attempting to load functions from: " << modulePath << std::endl;
+        LOG_DEBUG("Attempting to load functions from: " << modulePath);
     }
     
     // Verify DLL is valid by checking if we can get any export
     // Try to get the DLL's entry point or any common export
     FARPROC testProc = GetProcAddress(wintunDll, "DllGetClassObject");
     if (testProc) {
-        std::cout << "DLL appears to be a COM DLL (unexpected for WinTun)" << std::endl;
+        LOG_INFO("DLL appears to be a COM DLL (unexpected for WinTun)");
     }
     
     // Check DLL version info if available
@@ -273,18 +312,18 @@ bool WinTunManager::loadWinTunFunctions() {
         "DllMain", "DllGetClassObject", "DllCanUnloadNow", "DllRegisterServer",
         "WinTunCreateAdapter", "WintunCreateAdapter", "wintun_create_adapter"
     };
-    std::cout << "Checking DLL exports..." << std::endl;
+    LOG_DEBUG("Checking DLL exports...");
     bool foundAnyExport = false;
     for (const char* exportName : testExports) {
         FARPROC proc = GetProcAddress(wintunDll, exportName);
         if (proc) {
-            std::cout << "Found export: " << exportName << std::endl;
+            LOG_DEBUG("Found export: " << exportName);
             foundAnyExport = true;
         }
     }
     if (!foundAnyExport) {
-        std::cerr << "WARNING: Could not find any common exports in DLL!" << std::endl;
-        std::cerr << "This suggests the DLL might not be a valid WinTun DLL or is corrupted." << std::endl;
+        LOG_WARN("Could not find any common exports in DLL!");
+        LOG_WARN("This suggests the DLL might not be a valid WinTun DLL or is corrupted.");
     }
     
     // Try loading with both ANSI and Unicode function name variants
@@ -305,14 +344,14 @@ bool WinTunManager::loadWinTunFunctions() {
         WinTunCreateAdapter = reinterpret_cast<WINTUN_CREATE_ADAPTER_FUNC>(
             GetProcAddress(wintunDll, name));
         if (WinTunCreateAdapter) {
-            std::cout << "Found WinTunCreateAdapter with name: " << name << std::endl;
+            LOG_DEBUG("Found WinTunCreateAdapter with name: " << name);
             break;
         }
     }
     if (!WinTunCreateAdapter) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to load WinTunCreateAdapter. Error: " << error << std::endl;
-        std::cerr << "Tried names: WintunCreateAdapter, WinTunCreateAdapter, _WinTunCreateAdapter@12, _WintunCreateAdapter@12, WinTunCreateAdapterA, WinTunCreateAdapterW" << std::endl;
+        LOG_ERROR("Failed to load WinTunCreateAdapter. Error: " << error);
+        LOG_ERROR("Tried names: WintunCreateAdapter, WinTunCreateAdapter, _WinTunCreateAdapter@12, _WintunCreateAdapter@12, WinTunCreateAdapterA, WinTunCreateAdapterW");
     }
     
     // Try both case variants for CloseAdapter
@@ -332,7 +371,7 @@ bool WinTunManager::loadWinTunFunctions() {
     }
     if (!WinTunCloseAdapter) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to load WinTunCloseAdapter. Error: " << error << std::endl;
+        LOG_ERROR("Failed to load WinTunCloseAdapter. Error: " << error);
     }
     
     // Try both case variants for StartSession
@@ -352,7 +391,7 @@ bool WinTunManager::loadWinTunFunctions() {
     }
     if (!WinTunStartSession) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to load WinTunStartSession. Error: " << error << std::endl;
+        LOG_ERROR("Failed to load WinTunStartSession. Error: " << error);
     }
     
     // Try both case variants for EndSession
@@ -372,7 +411,7 @@ bool WinTunManager::loadWinTunFunctions() {
     }
     if (!WinTunEndSession) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to load WinTunEndSession. Error: " << error << std::endl;
+        LOG_ERROR("Failed to load WinTunEndSession. Error: " << error);
     }
     
     // Try both case variants for GetRunningDriverVersion
@@ -392,38 +431,56 @@ bool WinTunManager::loadWinTunFunctions() {
     }
     if (!WinTunGetRunningDriverVersion) {
         DWORD error = GetLastError();
-        std::cerr << "Failed to load WinTunGetRunningDriverVersion. Error: " << error << std::endl;
+        LOG_ERROR("Failed to load WinTunGetRunningDriverVersion. Error: " << error);
     }
     
     // Check if all required functions were loaded
     if (!WinTunCreateAdapter || !WinTunCloseAdapter || 
         !WinTunStartSession || !WinTunEndSession) {
-        std::cerr << "Failed to load required WinTun functions" << std::endl;
-        std::cerr << "WinTunCreateAdapter: " << (WinTunCreateAdapter ? "OK" : "FAILED") << std::endl;
-        std::cerr << "WinTunCloseAdapter: " << (WinTunCloseAdapter ? "OK" : "FAILED") << std::endl;
-        std::cerr << "WinTunStartSession: " << (WinTunStartSession ? "OK" : "FAILED") << std::endl;
-        std::cerr << "WinTunEndSession: " << (WinTunEndSession ? "OK" : "FAILED") << std::endl;
+        LOG_ERROR("Failed to load required WinTun functions");
+        LOG_ERROR("WinTunCreateAdapter: " << (WinTunCreateAdapter ? "OK" : "FAILED"));
+        LOG_ERROR("WinTunCloseAdapter: " << (WinTunCloseAdapter ? "OK" : "FAILED"));
+        LOG_ERROR("WinTunStartSession: " << (WinTunStartSession ? "OK" : "FAILED"));
+        LOG_ERROR("WinTunEndSession: " << (WinTunEndSession ? "OK" : "FAILED"));
         
         // Diagnostic: Check if DLL is valid by trying to get module filename
         char dllModulePath[MAX_PATH];
         if (GetModuleFileNameA(wintunDll, dllModulePath, MAX_PATH)) {
-            std::cerr << "DLL module path: " << dllModulePath << std::endl;
+            LOG_ERROR("DLL module path: " << dllModulePath);
         }
         
         // Note: GetProcAddress returns NULL if function not found, but doesn't set error code
         // This suggests the DLL might be wrong version, corrupted, or missing exports
-        std::cerr << "Possible causes:" << std::endl;
-        std::cerr << "  1. DLL version mismatch (wrong WinTun version)" << std::endl;
-        std::cerr << "  2. DLL is corrupted or incomplete" << std::endl;
-        std::cerr << "  3. DLL architecture mismatch (x86 vs x64)" << std::endl;
-        std::cerr << "  4. Missing DLL dependencies" << std::endl;
+        LOG_ERROR("Possible causes:");
+        LOG_ERROR("  1. DLL version mismatch (wrong WinTun version)");
+        LOG_ERROR("  2. DLL is corrupted or incomplete");
+        LOG_ERROR("  3. DLL architecture mismatch (x86 vs x64)");
+        LOG_ERROR("  4. Missing DLL dependencies");
         return false;
     }
     
-    std::cout << "WinTun functions loaded successfully" << std::endl;
+    loadDataPlaneFunctions();
+    LOG_INFO("WinTun functions loaded successfully");
     return true;
 }
 
+void WinTunManager::loadDataPlaneFunctions() {
+    // Exported as Wintun*; older builds of this plugin looked for WinTun* too
+    auto load = [this](const char* suffix) -> FARPROC {
+        FARPROC proc = GetProcAddress(wintunDll, (std::string("Wintun") + suffix).c_str());
+        return proc ? proc : GetProcAddress(wintunDll, (std::string("WinTun") + suffix).c_str());
+    };
+    WinTunReceivePacket = reinterpret_cast<WINTUN_RECEIVE_PACKET_FUNC>(load("ReceivePacket"));
+    WinTunReleaseReceivePacket = reinterpret_cast<WINTUN_RELEASE_RECEIVE_PACKET_FUNC>(load("ReleaseReceivePacket"));
+    WinTunAllocateSendPacket = reinterpret_cast<WINTUN_ALLOCATE_SEND_PACKET_FUNC>(load("AllocateSendPacket"));
+    WinTunSendPacket = reinterpret_cast<WINTUN_SEND_PACKET_FUNC>(load("SendPacket"));
+    WinTunGetReadWaitEvent = reinterpret_cast<WINTUN_GET_READ_WAIT_EVENT_FUNC>(load("GetReadWaitEvent"));
+    if (!WinTunReceivePacket || !WinTunReleaseReceivePacket || !WinTunAllocateSendPacket || !WinTunSendPacket ||
+        !WinTunGetReadWaitEvent) {
+        LOG_WARN("WinTun packet functions not found, the in-process data plane is unavailable");
+    }
+}
+
 std::string WinTunManager::generateAdapterName() {
     // Generate a unique adapter name
     return "OpenVPN-Flutter-" + std::to_string(GetTickCount64());
@@ -34,6 +34,7 @@ private:
     WINTUN_SESSION_HANDLE session = NULL;
     std::string adapterName;
     GUID adapterGuid;
+    std::string dllPath; // Resolved location of wintun.dll, tried first
     
     // WinTun function pointers
     WINTUN_CREATE_ADAPTER_FUNC WinTunCreateAdapter = nullptr;
@@ -41,11 +42,23 @@ private:
     WINTUN_START_SESSION_FUNC WinTunStartSession = nullptr;
     WINTUN_END_SESSION_FUNC WinTunEndSession = nullptr;
     WINTUN_GET_RUNNING_DRIVER_VERSION_FUNC WinTunGetRunningDriverVersion = nullptr;
+    // Packet I/O of a session (WinTunPacketRing); optional, adapters work without them
+    WINTUN_RECEIVE_PACKET_FUNC WinTunReceivePacket = nullptr;
+    WINTUN_RELEASE_RECEIVE_PACKET_FUNC WinTunReleaseReceivePacket = nullptr;
+    WINTUN_ALLOCATE_SEND_PACKET_FUNC WinTunAllocateSendPacket = nullptr;
+    WINTUN_SEND_PACKET_FUNC WinTunSendPacket = nullptr;
+    WINTUN_GET_READ_WAIT_EVENT_FUNC WinTunGetReadWaitEvent = nullptr;
     
 public:
+    // Ring buffer of a session, each direction; a power of two between 128 KiB and 64 MiB
+    static constexpr DWORD kSessionCapacity = 0x400000;
+    
+
     WinTunManager();
     ~WinTunManager();
     
+    // Use a wintun.dll already located by the caller before the built-in search
+    void setDllPath(const std::string& path);
     bool initialize();
     bool isWinTunAvailable();
     bool createAdapter(const std::string& name);
@@ -55,10 +68,21 @@ public:
     std::string getAdapterName() const;
     DWORD getDriverVersion();
     
+    // Packet I/O on the running session. Only one process can hold a session
+    // on an adapter, so these are for an in-process data plane, not for an
+    // adapter openvpn.exe has opened.
+    bool hasDataPlane() const;
+    BYTE* receivePacket(DWORD* size);
+    void releaseReceivePacket(const BYTE* packet);
+    BYTE* allocateSendPacket(DWORD size);
+    void sendPacket(const BYTE* packet);
+    HANDLE getReadWaitEvent();
+    
 private:
     bool loadWinTunDll();
     void unloadWinTunDll();
     bool loadWinTunFunctions();
+    void loadDataPlaneFunctions();
     std::string generateAdapterName();
     GUID generateGuid();
 };
@@ -0,0 +1,80 @@
+#include "wintun_packet_ring.h"
+#include "logger.h"
+
+namespace openvpn_flutter {
+
+WinTunPacketRing::WinTunPacketRing(WinTunManager& wintun)
+    : wintun(wintun), readEvent(wintun.hasDataPlane() ? wintun.getReadWaitEvent() : NULL) {
+    if (!readEvent) {
+        LOG_ERROR("WinTun session has no packet I/O, the packet ring stays empty");
+    }
+}
+
+bool WinTunPacketRing::isUsable() const {
+    return readEvent != NULL && !ended;
+}
+
+size_t WinTunPacketRing::receive(Packet* packets, size_t maxCount) {
+    if (!isUsable()) {
+        return 0;
+    }
+    size_t count = 0;
+    while (count < maxCount) {
+        DWORD size = 0;
+        BYTE* packet = wintun.receivePacket(&size);
+        if (!packet) {
+            DWORD error = GetLastError();
+            if (error == ERROR_HANDLE_EOF) {
+                LOG_INFO("WinTun session ended");
+                ended = true;
+            } else if (error != ERROR_NO_MORE_ITEMS) {
+                LOG_ERROR("WinTun receive failed. Error: " << error);
+            }
+            break;
+        }
+        packets[count].data = packet;
+        packets[count].size = size;
+        count++;
+    }
+    return count;
+}
+
+void WinTunPacketRing::release(const Packet* packets, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        wintun.releaseReceivePacket(packets[i].data);
+    }
+}
+
+uint8_t* WinTunPacketRing::allocateSend(uint32_t size) {
+    if (!isUsable()) {
+        return nullptr;
+    }
+    return wintun.allocateSendPacket(size);
+}
+
+void WinTunPacketRing::send(uint8_t* packet) {
+    wintun.sendPacket(packet);
+}
+
+bool WinTunPacketRing::waitReadable(int timeoutMs) {
+    if (!isUsable()) {
+        // Nothing will arrive; don't let the pump spin until it is stopped
+        if (WaitForSingleObject(wakeSignal.getHandle(), static_cast<DWORD>(timeoutMs)) == WAIT_OBJECT_0) {
+            wakeSignal.reset();
+        }
+        return false;
+    }
+    HANDLE handles[2] = {readEvent, wakeSignal.getHandle()};
+    DWORD result = WaitForMultipleObjects(2, handles, FALSE, static_cast<DWORD>(timeoutMs));
+    if (result == WAIT_OBJECT_0 + 1) {
+        wakeSignal.reset();
+        return false;
+    }
+    return result == WAIT_OBJECT_0;
+}
+
+void WinTunPacketRing::wake() {
+    wakeSignal.set();
+}
+
+} // namespace openvpn_flutter
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <windows.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "packet_ring.h"
+#include "wait_set.h"
+#include "wintun_manager.h"
+
+namespace openvpn_flutter {
+
+// PacketRing over a running WinTun session. Received packets are views into
+// the session's shared ring (no copy), released back in batches; sends are
+// allocated in the ring and written in place. The pump sleeps on the
+// session's read-wait event.
+class WinTunPacketRing : public PacketRing {
+private:
+    WinTunManager& wintun;
+    HANDLE readEvent;
+    StopSignal wakeSignal;
+    bool ended = false; // The session is going away (ERROR_HANDLE_EOF)
+
+public:
+    // The session must be started and stay up while the ring is used
+    explicit WinTunPacketRing(WinTunManager& wintun);
+
+    WinTunPacketRing(const WinTunPacketRing&) = delete;
+    WinTunPacketRing& operator=(const WinTunPacketRing&) = delete;
+
+    bool isUsable() const;
+
+    size_t receive(Packet* packets, size_t maxCount) override;
+    void release(const Packet* packets, size_t count) override;
+    uint8_t* allocateSend(uint32_t size) override;
+    void send(uint8_t* packet) override;
+    bool waitReadable(int timeoutMs) override;
+    void wake() override;
+};
+
+} // namespace openvpn_flutter